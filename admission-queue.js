@@ -0,0 +1,273 @@
+// 라우터 승인 제어(admission control)와 우선순위 대기열
+//
+// config.json 예:
+//   "admission": {
+//     "maxQueueDepth": 64, "maxQueuePerClient": 8, "maxWaitMs": 120000,
+//     "defaultPriority": 0, "priorities": { "team-api-key": 10, "batch-user": -5 }
+//   }
+//
+// - 요청 비용은 예상 토큰 수 (프롬프트 + n_predict / max_tokens, request-router.js 의 estimateRequestTokens).
+//   worker 의 처리 중 토큰(outstandingTokens) + 비용이 KV 용량(capacityOf) 안에 들어가면 바로 보내고,
+//   아니면 대기열에서 기다립니다. 처리 중인 요청이 없는 worker 는 용량보다 큰 요청도 받습니다 (굶주림 방지).
+// - 클라이언트: X-API-Key / Authorization: Bearer / X-User-Id 헤더, 없으면 원격 주소.
+//   priorities 의 키(API 키 또는 사용자 ID)로 우선순위를 정하고, 높은 우선순위 → 먼저 온 순서로 승인합니다.
+//   앞선 요청이 기다리는 worker 에는 뒤의 요청이 끼어들지 않습니다 (큰 요청이 계속 밀리지 않도록).
+// - 대기열이 가득 차거나 클라이언트별 한도를 넘으면 429 + Retry-After (예상 대기 시간),
+//   maxWaitMs 안에 승인되지 않으면 503.
+// - 대기 중에는 onUpdate({ position, estimatedWaitMs }) 를 위치가 바뀔 때와 UPDATE_INTERVAL_MS 마다 호출합니다
+//   (라우터가 스트리밍 요청에 SSE 이벤트로 전달).
+const crypto = require('crypto');
+
+const DEFAULTS = {
+  maxQueueDepth: 64,
+  maxQueuePerClient: 8,
+  maxWaitMs: 120000,
+  defaultPriority: 0
+};
+const UPDATE_INTERVAL_MS = 2000;
+const RATE_WINDOW_MS = 60000; // 처리 속도(토큰/초) 측정 구간
+const DEFAULT_RETRY_AFTER_SEC = 10;
+
+// 요청 헤더 → { id, key } (id 는 통계/로그용, API 키는 해시로만 노출)
+function clientOf(req) {
+  const headers = req.headers || {};
+  const auth = String(headers.authorization || '');
+  const apiKey = headers['x-api-key'] || (auth.toLowerCase().startsWith('bearer ') ? auth.slice(7).trim() : '');
+  if (apiKey) {
+    return { key: String(apiKey), id: `key:${crypto.createHash('sha1').update(String(apiKey)).digest('hex').slice(0, 8)}` };
+  }
+  if (headers['x-user-id']) return { key: String(headers['x-user-id']), id: `user:${headers['x-user-id']}` };
+  const address = (req.socket && req.socket.remoteAddress) || 'unknown';
+  return { key: null, id: `addr:${address}` };
+}
+
+class AdmissionQueue {
+  // registry: WorkerRegistry (pick / begin), capacityOf: (worker) => KV 용량 토큰 수 (Infinity 면 제한 없음)
+  constructor({ registry, capacityOf = () => Infinity, log = console.log }) {
+    this.registry = registry;
+    this.capacityOf = capacityOf;
+    this.log = log;
+    this.options = { ...DEFAULTS };
+    this.priorities = {};
+    this.queue = []; // 우선순위 내림차순 → 도착 순
+    this.seq = 0;
+    this.timer = null;
+    this.completions = []; // [at, tokens] (RATE_WINDOW_MS 안)
+    this.counters = { admitted: 0, queued: 0, rejected: 0, timedOut: 0, cancelled: 0 };
+    this.lastWaitMs = null;
+  }
+
+  // config.json 의 admission 적용
+  configure(admission = {}) {
+    const options = { ...DEFAULTS };
+    for (const key of Object.keys(DEFAULTS)) {
+      const value = Number(admission[key]);
+      if (admission[key] !== undefined && Number.isFinite(value)) options[key] = value;
+    }
+    this.options = options;
+    this.priorities = admission.priorities && typeof admission.priorities === 'object' ? admission.priorities : {};
+  }
+
+  priorityOf(client) {
+    const value = client.key !== null ? Number(this.priorities[client.key]) : NaN;
+    return Number.isFinite(value) ? value : this.options.defaultPriority;
+  }
+
+  fits(worker, tokens) {
+    return worker.inFlight === 0 || worker.outstandingTokens + tokens <= this.capacityOf(worker);
+  }
+
+  // candidates 중 용량이 남는 worker 로 승인 (없으면 대기)
+  // → { ok: true, worker, done, queued, waitedMs } | { ok: false, status, type, message, retryAfter, cancelled }
+  // closed: 클라이언트 연결 (close 이벤트가 오면 대기 취소)
+  admit(candidates, tokens, { client, affinityKey = null, onUpdate = null, closed = null }) {
+    return new Promise((resolve) => {
+      const entry = {
+        seq: ++this.seq,
+        client,
+        priority: this.priorityOf(client),
+        tokens,
+        candidates,
+        affinityKey,
+        onUpdate,
+        enqueuedAt: Date.now(),
+        position: 0,
+        accepted: false, // 한도 확인 전에는 위치를 알리지 않음
+        resolve: null,
+        timeout: null
+      };
+      const onClose = () => this.remove(entry, { ok: false, status: 499, cancelled: true }, 'cancelled');
+      entry.resolve = (result) => {
+        if (closed) closed.removeListener('close', onClose);
+        clearTimeout(entry.timeout);
+        resolve(result);
+      };
+      this.insert(entry);
+      this.drain();
+      if (!this.queue.includes(entry)) return;
+
+      // 바로 승인되지 않음: 대기열 한도 확인
+      const queuedByClient = this.queue.filter(e => e.client.id === client.id).length;
+      if (this.queue.length > this.options.maxQueueDepth || queuedByClient > this.options.maxQueuePerClient) {
+        const full = this.queue.length > this.options.maxQueueDepth;
+        const retryAfter = this.retryAfterSec(this.estimateWaitMs(entry));
+        this.remove(entry, {
+          ok: false,
+          status: 429,
+          type: 'queue_full_error',
+          message: full
+            ? `Request queue is full (${this.options.maxQueueDepth} waiting)`
+            : `Too many queued requests for this client (limit ${this.options.maxQueuePerClient})`,
+          retryAfter
+        }, 'rejected');
+        return;
+      }
+      this.counters.queued++;
+      entry.accepted = true;
+      if (closed) closed.once('close', onClose);
+      entry.timeout = setTimeout(() => {
+        this.remove(entry, {
+          ok: false,
+          status: 503,
+          type: 'queue_timeout_error',
+          message: `Request was not admitted within ${Math.round(this.options.maxWaitMs / 1000)}s (${tokens} tokens)`,
+          retryAfter: this.retryAfterSec(this.estimateWaitMs(entry))
+        }, 'timedOut');
+      }, this.options.maxWaitMs);
+      this.notify(false);
+      this.startTimer();
+    });
+  }
+
+  insert(entry) {
+    const index = this.queue.findIndex(e => e.priority < entry.priority);
+    if (index === -1) this.queue.push(entry);
+    else this.queue.splice(index, 0, entry);
+  }
+
+  remove(entry, result, counter) {
+    const index = this.queue.indexOf(entry);
+    if (index === -1) return;
+    this.queue.splice(index, 1);
+    this.counters[counter]++;
+    entry.resolve(result);
+    this.drain();
+  }
+
+  // 앞에서부터 승인 가능한 요청을 보냄. 승인되지 못한 요청의 후보 worker 는 뒤의 요청에게도 막힘
+  drain() {
+    const blocked = new Set();
+    for (const entry of [...this.queue]) {
+      const open = entry.candidates.filter(w => w.healthy && !blocked.has(w));
+      const fitting = open.filter(w => this.fits(w, entry.tokens));
+      if (fitting.length === 0) {
+        for (const w of entry.candidates) blocked.add(w);
+        continue;
+      }
+      this.queue.splice(this.queue.indexOf(entry), 1);
+      this.grant(entry, fitting);
+    }
+    if (this.queue.length === 0) this.stopTimer();
+    else this.notify(false);
+  }
+
+  grant(entry, fitting) {
+    const worker = this.registry.pick(fitting, { affinityKey: entry.affinityKey });
+    const release = this.registry.begin(worker, entry.tokens);
+    let released = false;
+    const done = () => {
+      if (released) return;
+      released = true;
+      release();
+      this.recordCompletion(entry.tokens);
+      this.drain();
+    };
+    const waitedMs = Date.now() - entry.enqueuedAt;
+    this.counters.admitted++;
+    if (entry.accepted) this.lastWaitMs = waitedMs;
+    entry.resolve({ ok: true, worker, done, queued: entry.accepted, waitedMs });
+  }
+
+  recordCompletion(tokens) {
+    const now = Date.now();
+    this.completions.push([now, tokens]);
+    while (this.completions.length > 0 && now - this.completions[0][0] > RATE_WINDOW_MS) this.completions.shift();
+  }
+
+  // 최근 RATE_WINDOW_MS 동안 끝난 요청의 예상 토큰 합 / 경과 시간 (측정값이 없으면 null)
+  drainTokensPerSec() {
+    if (this.completions.length < 2) return null;
+    const elapsed = (Date.now() - this.completions[0][0]) / 1000;
+    if (elapsed <= 0) return null;
+    return this.completions.reduce((sum, [, tokens]) => sum + tokens, 0) / elapsed;
+  }
+
+  // 앞선 요청 + 자신의 비용이 처리되는 시간 (속도를 모르면 null)
+  estimateWaitMs(entry) {
+    const rate = this.drainTokensPerSec();
+    if (!rate) return null;
+    let ahead = 0;
+    for (const e of this.queue) {
+      if (e === entry) break;
+      ahead += e.tokens;
+    }
+    return Math.round(((ahead + entry.tokens) / rate) * 1000);
+  }
+
+  retryAfterSec(waitMs) {
+    return waitMs === null ? DEFAULT_RETRY_AFTER_SEC : Math.max(1, Math.ceil(waitMs / 1000));
+  }
+
+  // 위치가 바뀐 요청(force 면 모두)에 onUpdate
+  notify(force) {
+    this.queue.forEach((entry, index) => {
+      const position = index + 1;
+      if (!entry.onUpdate || !entry.accepted || (!force && entry.position === position)) return;
+      entry.position = position;
+      try {
+        entry.onUpdate({ position, estimatedWaitMs: this.estimateWaitMs(entry) });
+      } catch (error) {
+        this.log(`[Admission] Queue update failed: ${error.message}`);
+      }
+    });
+  }
+
+  startTimer() {
+    if (this.timer) return;
+    this.timer = setInterval(() => {
+      // worker 상태가 바뀌었을 수 있으므로 (health check 복구 등) 다시 시도한 뒤 대기 상태 전송
+      this.drain();
+      this.notify(true);
+    }, UPDATE_INTERVAL_MS);
+    this.timer.unref();
+  }
+
+  stopTimer() {
+    if (this.timer) clearInterval(this.timer);
+    this.timer = null;
+  }
+
+  stats() {
+    const now = Date.now();
+    const rate = this.drainTokensPerSec();
+    return {
+      ...this.options,
+      priorities: Object.keys(this.priorities).length,
+      queueDepth: this.queue.length,
+      queuedTokens: this.queue.reduce((sum, e) => sum + e.tokens, 0),
+      drainTokensPerSec: rate === null ? null : Math.round(rate),
+      lastWaitMs: this.lastWaitMs,
+      ...this.counters,
+      queue: this.queue.map((e, index) => ({
+        position: index + 1,
+        client: e.client.id,
+        priority: e.priority,
+        tokens: e.tokens,
+        waitedMs: now - e.enqueuedAt,
+        estimatedWaitMs: this.estimateWaitMs(e)
+      }))
+    };
+  }
+}
+
+module.exports = { AdmissionQueue, clientOf };
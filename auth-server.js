@@ -207,6 +207,8 @@ const PORT = 8082; // 인증 서버는 8082 포트 사용
 
 server.listen(PORT, () => {
   console.log(`[Auth Server] Started on port ${PORT}`);
+  // 인증 서버는 가끔만 응답하므로 P 코어를 추론 서버에 양보
+  require('./perf-profile').demoteCurrentProcess('Auth server');
 });
 
 // 서버 종료 처리
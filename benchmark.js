@@ -0,0 +1,526 @@
+// 처리량/지연 벤치마크: GGUF(8080) / MLX(8081) 의 스트리밍 /completion 을
+// 프롬프트 길이 × 출력 길이 × 동시 요청 수 조합으로 돌려 TTFT, ITL 백분위, prefill/decode t/s,
+// 서버 프로세스 최대 메모리(native addon)를 측정하고 JSON/CSV 로 저장합니다.
+//
+// 사용 예:
+//   node benchmark.js --backend gguf,mlx --prompt-tokens 128,1024 --output-tokens 128 --concurrency 1,4
+//   npm run benchmark -- --backend gguf --model llama31-banyaa-q4_k_m --label q4_k_m-ngl99
+//   node benchmark.js --backend mlx --stream-format binary --frame-interval-ms 50   # 묶음 프레임 (MLX)
+const fs = require('fs');
+const path = require('path');
+const http = require('http');
+const { execFileSync } = require('child_process');
+const { parseArgs, parseList } = require('./cli-args');
+
+let nativeAddon = null;
+try {
+  nativeAddon = require('./native');
+} catch (error) {
+  // 빌드되지 않은 환경: 메모리 측정 없이 실행
+}
+
+const DEFAULTS = {
+  backend: 'gguf',
+  ggufUrl: 'http://localhost:8080',
+  mlxUrl: 'http://localhost:8081',
+  managerUrl: 'http://localhost:8083',
+  promptTokens: '128,512,2048',
+  outputTokens: '128',
+  concurrency: '1,2,4',
+  requests: 0, // 셀당 요청 수 (0 이면 max(동시 요청 수 × 2, 4))
+  warmup: 1,
+  model: '',
+  label: '',
+  pids: '',
+  out: path.join(__dirname, 'bench-results'),
+  timeoutMs: 10 * 60 * 1000,
+  // 토큰 스트림 프레이밍 (mlx/stream_framing.py): token | coalesced (SSE) | binary (MLX /chat/ws)
+  streamFormat: 'token',
+  frameIntervalMs: 50,
+  frameMaxTokens: 32
+};
+const STREAM_FORMATS = ['token', 'coalesced', 'binary'];
+const BINARY_NO_TOKEN = 0xFFFFFFFF;
+const SAMPLE_INTERVAL_MS = 100;
+const FILLER = 'The quick brown fox jumps over the lazy dog while the curious cat watches from the old wooden fence. ';
+
+function percentile(sorted, p) {
+  if (sorted.length === 0) return null;
+  const index = Math.min(sorted.length - 1, Math.max(0, Math.ceil((p / 100) * sorted.length) - 1));
+  return sorted[index];
+}
+
+function mean(values) {
+  return values.length > 0 ? values.reduce((a, b) => a + b, 0) / values.length : null;
+}
+
+function round(value, digits = 2) {
+  return value === null || value === undefined || Number.isNaN(value) ? null : Number(value.toFixed(digits));
+}
+
+function postJson(baseUrl, pathname, body, timeoutMs = 30000) {
+  return new Promise((resolve, reject) => {
+    const target = new URL(pathname, baseUrl);
+    const payload = JSON.stringify(body);
+    const req = http.request(target, {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(payload) }
+    }, (res) => {
+      let data = '';
+      res.on('data', (chunk) => { data += chunk; });
+      res.on('end', () => {
+        try {
+          resolve({ statusCode: res.statusCode, body: JSON.parse(data) });
+        } catch (error) {
+          resolve({ statusCode: res.statusCode, body: null });
+        }
+      });
+    });
+    req.on('error', reject);
+    req.setTimeout(timeoutMs, () => req.destroy(new Error(`POST ${pathname} timeout`)));
+    req.end(payload);
+  });
+}
+
+function getJson(baseUrl, pathname, timeoutMs = 3000) {
+  return new Promise((resolve) => {
+    const req = http.get(new URL(pathname, baseUrl), (res) => {
+      let data = '';
+      res.on('data', (chunk) => { data += chunk; });
+      res.on('end', () => {
+        try {
+          resolve(JSON.parse(data));
+        } catch (error) {
+          resolve(null);
+        }
+      });
+    });
+    req.on('error', () => resolve(null));
+    req.setTimeout(timeoutMs, () => req.destroy());
+  });
+}
+
+// /tokenize 로 토큰 수를 맞춘 합성 프롬프트 (요청마다 앞부분을 바꿔 prefix 캐시 적중을 막음)
+async function makePromptBuilder(backend, targetTokens) {
+  const countTokens = async (text) => {
+    const res = await postJson(backend.url, '/tokenize', { content: text, add_special: false });
+    const tokens = res.body && res.body.tokens;
+    if (!Array.isArray(tokens)) throw new Error(`${backend.name}: /tokenize failed (${res.statusCode})`);
+    return tokens.length;
+  };
+  const perRepeat = await countTokens(FILLER.repeat(8)) / 8;
+  let repeats = Math.max(1, Math.round(targetTokens / perRepeat));
+  const actual = await countTokens(`[bench 000000] ${FILLER.repeat(repeats)}`);
+  repeats = Math.max(1, repeats + Math.round((targetTokens - actual) / perRepeat));
+  const body = FILLER.repeat(repeats);
+  return {
+    promptTokens: await countTokens(`[bench 000000] ${body}`),
+    build: (index) => `[bench ${String(index).padStart(6, '0')}] ${body}`
+  };
+}
+
+function streamFormatField(options) {
+  if (options.streamFormat === 'token') return {};
+  return { stream_format: { mode: options.streamFormat, interval_ms: options.frameIntervalMs, max_tokens: options.frameMaxTokens } };
+}
+
+// 묶음 프레임의 토큰 시각: 첫 프레임 도착 시각 + 서버가 기록한 생성 시각 차이
+// (프레임 도착 간격이 아니라 실제 토큰 간격으로 ITL 을 계산)
+function pushFrameTimes(result, now, times) {
+  if (result.frameBase === null) result.frameBase = { arrivedAt: now, serverMs: times[0] };
+  for (const t of times) result.tokenTimes.push(result.frameBase.arrivedAt + (t - result.frameBase.serverMs));
+}
+
+// SSE / WebSocket JSON 이벤트 하나 처리
+function handleStreamEvent(result, event, now) {
+  if (event.error) result.error = typeof event.error === 'string' ? event.error : JSON.stringify(event.error);
+  if (event.type === 'error') result.error = event.message || 'error';
+  if (Array.isArray(event.times)) {
+    result.frames++;
+    if (event.times.length > 0) pushFrameTimes(result, now, event.times);
+  } else if (event.content) {
+    result.frames++;
+    result.tokenTimes.push(now);
+  }
+  if (event.stop) {
+    if (event.timings) result.serverTimings = event.timings;
+    if (event.tokens_predicted !== undefined) result.tokensPredicted = event.tokens_predicted;
+    if (event.tokens_evaluated !== undefined) result.tokensEvaluated = event.tokens_evaluated;
+    // 추측 디코딩 수락 수 (llama-server 는 timings, MLX 서버는 최종 청크에 같은 이름)
+    const draft = event.timings && event.timings.draft_n !== undefined ? event.timings : event;
+    if (draft.draft_n) result.draft = { drafted: draft.draft_n, accepted: draft.draft_n_accepted || 0 };
+  }
+}
+
+// binary 프레임: u8 version | u8 flags | u16 n | u32 text_bytes | u32 id × n | u32 time_us × n | ...
+function handleBinaryFrame(result, buffer, now) {
+  const n = buffer.readUInt16LE(2);
+  const times = [];
+  for (let i = 0; i < n; i++) {
+    if (buffer.readUInt32LE(8 + i * 4) === BINARY_NO_TOKEN) continue;
+    times.push(buffer.readUInt32LE(8 + n * 4 + i * 4) / 1000);
+  }
+  result.frames++;
+  if (times.length > 0) pushFrameTimes(result, now, times);
+}
+
+function newResult() {
+  return { ok: false, startedAt: performance.now(), tokenTimes: [], frames: 0, frameBase: null, serverTimings: null, error: null };
+}
+
+function finishResult(result) {
+  result.endedAt = performance.now();
+  result.ok = !result.error && result.tokenTimes.length > 0;
+  return result;
+}
+
+// 스트리밍 /completion 한 번: 토큰(청크) 도착 시각을 기록
+function streamCompletion(backend, prompt, outputTokens, options) {
+  if (options.streamFormat === 'binary') return streamWebSocket(backend, prompt, outputTokens, options);
+  return new Promise((resolve) => {
+    const body = JSON.stringify({
+      prompt,
+      n_predict: outputTokens,
+      max_tokens: outputTokens,
+      temperature: 0,
+      ignore_eos: true,
+      cache_prompt: false,
+      stream: true,
+      ...streamFormatField(options),
+      ...(options.model ? { model: options.model } : {})
+    });
+    const result = newResult();
+    const req = http.request(new URL('/completion', backend.url), {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(body), 'Cache-Control': 'no-cache' }
+    }, (res) => {
+      if (res.statusCode !== 200) {
+        result.error = `HTTP ${res.statusCode}`;
+        res.resume();
+        res.on('end', () => resolve(result));
+        return;
+      }
+      let buffer = '';
+      res.setEncoding('utf8');
+      res.on('data', (chunk) => {
+        const now = performance.now();
+        buffer += chunk;
+        let boundary;
+        while ((boundary = buffer.indexOf('\n\n')) !== -1) {
+          const frame = buffer.slice(0, boundary);
+          buffer = buffer.slice(boundary + 2);
+          for (const line of frame.split('\n')) {
+            if (!line.startsWith('data: ')) continue;
+            let event;
+            try {
+              event = JSON.parse(line.slice(6));
+            } catch (error) {
+              continue;
+            }
+            handleStreamEvent(result, event, now);
+          }
+        }
+      });
+      res.on('end', () => resolve(finishResult(result)));
+    });
+    req.on('error', (error) => {
+      result.error = error.message;
+      resolve(result);
+    });
+    req.setTimeout(options.timeoutMs, () => req.destroy(new Error('timeout')));
+    req.end(body);
+  });
+}
+
+// MLX /chat/ws 한 번 (binary 프레임). Node 22+ 의 전역 WebSocket 사용
+// /chat/ws 는 채팅 템플릿을 적용하므로 프롬프트 토큰 수는 서버가 보고한 tokens_evaluated 로 계산
+function streamWebSocket(backend, prompt, outputTokens, options) {
+  return new Promise((resolve) => {
+    const result = newResult();
+    const ws = new WebSocket(new URL('/chat/ws', backend.url.replace(/^http/, 'ws')));
+    ws.binaryType = 'arraybuffer';
+    const timer = setTimeout(() => {
+      result.error = 'timeout';
+      ws.close();
+    }, options.timeoutMs);
+    ws.onopen = () => ws.send(JSON.stringify({
+      prompt,
+      max_tokens: outputTokens,
+      temperature: 0,
+      ignore_eos: true,
+      ...streamFormatField(options)
+    }));
+    ws.onmessage = (message) => {
+      const now = performance.now();
+      if (message.data instanceof ArrayBuffer) {
+        handleBinaryFrame(result, Buffer.from(message.data), now);
+        return;
+      }
+      try {
+        handleStreamEvent(result, JSON.parse(message.data), now);
+      } catch (error) {
+        // JSON 이 아닌 메시지는 무시
+      }
+    };
+    ws.onerror = () => {
+      if (!result.error) result.error = 'WebSocket error';
+    };
+    ws.onclose = () => {
+      clearTimeout(timer);
+      resolve(finishResult(result));
+    };
+  });
+}
+
+// 추론 서버 프로세스: --pids, 포트 listen 중인 프로세스, 매니저가 띄운 GGUF 풀 프로세스
+async function discoverPids(backend, options) {
+  if (options.pids) return parseList(options.pids).map(Number);
+  const pids = new Set();
+  try {
+    const port = new URL(backend.url).port;
+    const output = execFileSync('lsof', ['-ti', `tcp:${port}`, '-sTCP:LISTEN'], { encoding: 'utf8' });
+    output.split('\n').map(Number).filter(Boolean).forEach(pid => pids.add(pid));
+  } catch (error) {
+    // lsof 없음 또는 listen 중인 프로세스 없음
+  }
+  if (backend.name === 'gguf') {
+    const pool = await getJson(options.managerUrl, '/api/model-pool');
+    if (pool && Array.isArray(pool.models)) pool.models.forEach(m => m.pid && pids.add(m.pid));
+  }
+  return [...pids];
+}
+
+// 셀 실행 중 서버 프로세스 footprint(Metal 할당 포함)와 GPU 사용률의 최댓값 기록
+function startMemoryProbe(pids) {
+  const probe = { peakFootprintBytes: null, peakGpuUtil: null, timer: null };
+  if (!nativeAddon || !nativeAddon.getSystemCounters || pids.length === 0) return probe;
+  const sample = () => {
+    const counters = nativeAddon.getSystemCounters(pids, 'benchmark');
+    if (!counters || counters.error) return;
+    const footprint = (counters.processes || []).reduce((sum, p) => sum + (p.footprintBytes || 0), 0);
+    if (footprint > 0) probe.peakFootprintBytes = Math.max(probe.peakFootprintBytes || 0, footprint);
+    if (counters.gpu && counters.gpu.device !== null) {
+      probe.peakGpuUtil = Math.max(probe.peakGpuUtil || 0, counters.gpu.device);
+    }
+  };
+  sample();
+  probe.timer = setInterval(sample, SAMPLE_INTERVAL_MS);
+  return probe;
+}
+
+function stopMemoryProbe(probe) {
+  if (probe.timer) clearInterval(probe.timer);
+}
+
+function summarizeCell(cell, results, wallMs, probe) {
+  const ok = results.filter(r => r.ok);
+  const ttft = ok.map(r => r.tokenTimes[0] - r.startedAt).sort((a, b) => a - b);
+  const itl = [];
+  const decodeRates = [];
+  const prefillRates = [];
+  let outputTokens = 0;
+  let drafted = 0;
+  let draftAccepted = 0;
+  let frames = 0;
+  for (const r of ok) {
+    frames += r.frames;
+    if (r.draft) {
+      drafted += r.draft.drafted;
+      draftAccepted += r.draft.accepted;
+    }
+    // SSE 청크 하나 = 토큰 하나 (묶음 프레임은 토큰별 시각), 서버가 보고한 수가 있으면 우선
+    const n = r.tokensPredicted || (r.serverTimings && r.serverTimings.predicted_n) || r.tokenTimes.length;
+    outputTokens += n;
+    for (let i = 1; i < r.tokenTimes.length; i++) itl.push(r.tokenTimes[i] - r.tokenTimes[i - 1]);
+    const decodeMs = r.tokenTimes[r.tokenTimes.length - 1] - r.tokenTimes[0];
+    if (r.serverTimings && r.serverTimings.predicted_per_second) {
+      decodeRates.push(r.serverTimings.predicted_per_second);
+    } else if (decodeMs > 0 && n > 1) {
+      decodeRates.push(((n - 1) * 1000) / decodeMs);
+    }
+    if (r.serverTimings && r.serverTimings.prompt_per_second) {
+      prefillRates.push(r.serverTimings.prompt_per_second);
+    } else {
+      const promptTokens = r.tokensEvaluated || cell.promptTokens;
+      prefillRates.push((promptTokens * 1000) / (r.tokenTimes[0] - r.startedAt));
+    }
+  }
+  itl.sort((a, b) => a - b);
+  const errors = results.filter(r => !r.ok).map(r => r.error || 'no tokens');
+
+  return {
+    label: cell.label,
+    backend: cell.backend,
+    model: cell.model,
+    promptTokens: cell.promptTokens,
+    outputTokens: cell.outputTokens,
+    concurrency: cell.concurrency,
+    streamFormat: cell.streamFormat,
+    requests: results.length,
+    errors: errors.length,
+    firstError: errors[0] || null,
+    wallSeconds: round(wallMs / 1000, 3),
+    ttftMsP50: round(percentile(ttft, 50)),
+    ttftMsP90: round(percentile(ttft, 90)),
+    ttftMsP99: round(percentile(ttft, 99)),
+    itlMsP50: round(percentile(itl, 50)),
+    itlMsP90: round(percentile(itl, 90)),
+    itlMsP99: round(percentile(itl, 99)),
+    itlMsMax: round(itl.length > 0 ? itl[itl.length - 1] : null),
+    prefillTokensPerSec: round(mean(prefillRates)),
+    decodeTokensPerSec: round(mean(decodeRates)),
+    outputTokensPerSec: round(wallMs > 0 ? (outputTokens * 1000) / wallMs : null),
+    draftAcceptance: drafted > 0 ? round(draftAccepted / drafted, 3) : null,
+    framesPerRequest: ok.length > 0 ? round(frames / ok.length, 1) : null,
+    peakFootprintMB: probe.peakFootprintBytes ? round(probe.peakFootprintBytes / 1024 / 1024, 1) : null,
+    peakGpuUtil: round(probe.peakGpuUtil, 1)
+  };
+}
+
+async function runCell(backend, builder, cell, options) {
+  const total = options.requests > 0 ? options.requests : Math.max(cell.concurrency * 2, 4);
+  for (let i = 0; i < options.warmup; i++) {
+    await streamCompletion(backend, builder.build(999000 + i), Math.min(cell.outputTokens, 8), options);
+  }
+
+  const probe = startMemoryProbe(backend.pids);
+  const results = [];
+  let next = 0;
+  const start = performance.now();
+  // 동시 요청 수만큼의 워커가 남은 요청을 하나씩 가져감 (closed-loop)
+  const worker = async () => {
+    while (next < total) {
+      const index = next++;
+      results.push(await streamCompletion(backend, builder.build(cell.seed + index), cell.outputTokens, options));
+    }
+  };
+  await Promise.all(Array.from({ length: cell.concurrency }, worker));
+  const wallMs = performance.now() - start;
+  stopMemoryProbe(probe);
+  return summarizeCell(cell, results, wallMs, probe);
+}
+
+const CSV_COLUMNS = [
+  'label', 'backend', 'model', 'promptTokens', 'outputTokens', 'concurrency', 'streamFormat', 'requests', 'errors', 'wallSeconds',
+  'ttftMsP50', 'ttftMsP90', 'ttftMsP99', 'itlMsP50', 'itlMsP90', 'itlMsP99', 'itlMsMax',
+  'prefillTokensPerSec', 'decodeTokensPerSec', 'outputTokensPerSec', 'draftAcceptance', 'framesPerRequest',
+  'peakFootprintMB', 'peakGpuUtil'
+];
+
+function toCsv(rows) {
+  const escape = (value) => {
+    if (value === null || value === undefined) return '';
+    const text = String(value);
+    return /[",\n]/.test(text) ? `"${text.replace(/"/g, '""')}"` : text;
+  };
+  return [CSV_COLUMNS.join(','), ...rows.map(row => CSV_COLUMNS.map(c => escape(row[c])).join(','))].join('\n') + '\n';
+}
+
+function printUsage() {
+  console.log(`Usage: node benchmark.js [options]
+  --backend gguf,mlx          backends to run (default: ${DEFAULTS.backend})
+  --gguf-url URL              GGUF server (default: ${DEFAULTS.ggufUrl})
+  --mlx-url URL               MLX server (default: ${DEFAULTS.mlxUrl})
+  --prompt-tokens 128,512     prompt lengths in tokens (default: ${DEFAULTS.promptTokens})
+  --output-tokens 128         output lengths in tokens (default: ${DEFAULTS.outputTokens})
+  --concurrency 1,2,4         concurrent streams (default: ${DEFAULTS.concurrency})
+  --requests N                requests per cell (default: max(concurrency x 2, 4))
+  --warmup N                  warmup requests per cell (default: ${DEFAULTS.warmup})
+  --model ID                  model field sent to the GGUF router
+  --label NAME                run label stored in every row (e.g. q4_k_m-ngl99)
+  --pids 123,456              server PIDs for peak memory (default: auto-detect)
+  --stream-format MODE        token | coalesced | binary (MLX /chat/ws, Node 22+) (default: ${DEFAULTS.streamFormat})
+  --frame-interval-ms N       coalesced/binary frame interval (default: ${DEFAULTS.frameIntervalMs})
+  --frame-max-tokens N        coalesced/binary tokens per frame (default: ${DEFAULTS.frameMaxTokens})
+  --out DIR                   output directory (default: bench-results/)`);
+}
+
+async function main() {
+  const options = parseArgs(process.argv.slice(2), DEFAULTS);
+  if (options.help) {
+    printUsage();
+    return;
+  }
+  const promptLengths = parseList(options.promptTokens).map(Number);
+  const outputLengths = parseList(options.outputTokens).map(Number);
+  const concurrencies = parseList(options.concurrency).map(Number);
+  const label = options.label || new Date().toISOString();
+  if (!STREAM_FORMATS.includes(options.streamFormat)) {
+    console.error(`[Benchmark] ❌ Unknown --stream-format ${options.streamFormat} (${STREAM_FORMATS.join(', ')})`);
+    process.exitCode = 1;
+    return;
+  }
+  if (options.streamFormat === 'binary' && typeof WebSocket === 'undefined') {
+    console.error('[Benchmark] ❌ --stream-format binary needs a global WebSocket (Node 22+)');
+    process.exitCode = 1;
+    return;
+  }
+
+  const rows = [];
+  for (const name of parseList(options.backend)) {
+    const backend = { name, url: name === 'mlx' ? options.mlxUrl : options.ggufUrl };
+    const health = await getJson(backend.url, '/health');
+    if (!health) {
+      console.error(`[Benchmark] ❌ ${name} server not reachable at ${backend.url}, skipping`);
+      continue;
+    }
+    if (options.streamFormat === 'binary' && name !== 'mlx') {
+      console.error(`[Benchmark] ❌ binary stream format is only served by the MLX server, skipping ${name}`);
+      continue;
+    }
+    backend.pids = await discoverPids(backend, options);
+    console.log(`[Benchmark] ${name} @ ${backend.url} (pids: ${backend.pids.join(', ') || 'unknown'})`);
+
+    for (const promptTokens of promptLengths) {
+      const builder = await makePromptBuilder(backend, promptTokens);
+      for (const outputTokens of outputLengths) {
+        for (const concurrency of concurrencies) {
+          const cell = {
+            label,
+            backend: name,
+            model: options.model || null,
+            promptTokens: builder.promptTokens,
+            outputTokens,
+            concurrency,
+            streamFormat: options.streamFormat,
+            seed: rows.length * 1000
+          };
+          const row = await runCell(backend, builder, cell, options);
+          rows.push(row);
+          console.log(`[Benchmark] ${name} prompt=${row.promptTokens} output=${outputTokens} c=${concurrency}: ` +
+            `TTFT p50 ${row.ttftMsP50}ms p99 ${row.ttftMsP99}ms, ITL p50 ${row.itlMsP50}ms p99 ${row.itlMsP99}ms, ` +
+            `prefill ${row.prefillTokensPerSec} t/s, decode ${row.decodeTokensPerSec} t/s, ` +
+            `total ${row.outputTokensPerSec} t/s, peak ${row.peakFootprintMB ?? '-'} MB` +
+            (row.errors ? `, ${row.errors} errors (${row.firstError})` : ''));
+        }
+      }
+    }
+  }
+
+  if (rows.length === 0) {
+    console.error('[Benchmark] No results');
+    process.exitCode = 1;
+    return;
+  }
+  fs.mkdirSync(options.out, { recursive: true });
+  const stamp = new Date().toISOString().replace(/[:.]/g, '-');
+  const base = path.join(options.out, `bench-${stamp}`);
+  const report = {
+    label,
+    createdAt: new Date().toISOString(),
+    host: { platform: process.platform, arch: process.arch, vram: nativeAddon ? nativeAddon.getVRAMInfo() : null },
+    options: {
+      promptLengths, outputLengths, concurrencies, requests: options.requests, warmup: options.warmup,
+      streamFormat: options.streamFormat, frameIntervalMs: options.frameIntervalMs, frameMaxTokens: options.frameMaxTokens
+    },
+    results: rows
+  };
+  fs.writeFileSync(`${base}.json`, JSON.stringify(report, null, 2));
+  fs.writeFileSync(`${base}.csv`, toCsv(rows));
+  console.log(`[Benchmark] ✅ Results written to ${base}.json and ${base}.csv`);
+}
+
+main().catch((error) => {
+  console.error('[Benchmark] ❌', error);
+  process.exitCode = 1;
+});
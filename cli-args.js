@@ -0,0 +1,27 @@
+// 명령행 스크립트(benchmark.js / tune-model.js / replay-traffic.js) 공통 인자 파싱
+//
+// --kebab-case 값 → options.camelCase. 값이 없으면 'true', defaults 의 값이 숫자인 키는 Number 로 바꿉니다.
+// --help / -h 는 options.help = true.
+
+function parseArgs(argv, defaults) {
+  const options = { ...defaults };
+  for (let i = 0; i < argv.length; i++) {
+    const arg = argv[i];
+    if (arg === '--help' || arg === '-h') {
+      options.help = true;
+      continue;
+    }
+    if (!arg.startsWith('--')) continue;
+    const key = arg.slice(2).replace(/-([a-z])/g, (_, c) => c.toUpperCase());
+    const value = argv[i + 1] !== undefined && !argv[i + 1].startsWith('--') ? argv[++i] : 'true';
+    options[key] = typeof defaults[key] === 'number' ? Number(value) : value;
+  }
+  return options;
+}
+
+// 쉼표 구분 목록 (빈 항목 제외)
+function parseList(value) {
+  return String(value).split(',').map(v => v.trim()).filter(Boolean);
+}
+
+module.exports = { parseArgs, parseList };
@@ -0,0 +1,110 @@
+// 서버 측 컨텍스트 윈도우 관리 (GGUF 라우터용)
+//
+// 클라이언트가 대화 턴(messages)을 보내면 턴 단위로 토큰화해 캐시하고, 컨텍스트 크기를 넘으면
+// 가장 오래된 턴부터 잘라낸 뒤 토큰 ID 배열을 llama-server 에 그대로 넘깁니다.
+// 이전 요청에서 본 턴은 다시 토큰화하지 않으므로 긴 대화에서도 새 턴만 /tokenize 합니다.
+// 프롬프트 형식은 frontend/src/services/api.js 의 buildLlama3Prompt 와 같아야 합니다.
+// MLX 서버는 같은 규칙을 mlx/context_window.py 로 구현합니다.
+const MIN_PREDICT = 32;
+const TURN_CACHE_MAX_ENTRIES = 4096;
+
+// messages([{ role, content }], 첫 system 포함) → Llama-3 형식 세그먼트
+// 특수 토큰 경계에서 나누므로 세그먼트별 토큰화 결과를 이어 붙이면 전체 토큰화와 같습니다.
+function llama3Segments(messages) {
+  const turns = [];
+  let system = '';
+  for (const message of messages) {
+    if (message.role === 'system' && turns.length === 0 && !system) {
+      system = String(message.content || '');
+      continue;
+    }
+    const role = message.role === 'assistant' ? 'assistant' : 'user';
+    turns.push({ role, text: `<|start_header_id|>${role}<|end_header_id|>\n\n${message.content || ''}<|eot_id|>` });
+  }
+  return {
+    head: `<|begin_of_text|><|start_header_id|>system<|end_header_id|>\n\n${system}<|eot_id|>`,
+    turns,
+    tail: '<|start_header_id|>assistant<|end_header_id|>\n\n'
+  };
+}
+
+// 고정 토큰(시스템 + 생성 헤더)과 턴별 토큰 수로 남길 턴 범위와 n_predict 결정
+// policy 'truncate': 오래된 턴부터 제거 (마지막 턴은 유지), 'reject': 넘으면 오류
+function fitTurns(turns, { fixedTokens, contextSize, nPredict = -1, policy = 'truncate' }) {
+  const total = (start) => fixedTokens + turns.slice(start).reduce((sum, t) => sum + t.tokens, 0);
+  // 생성에 남겨둘 최소 공간: 요청한 n_predict (컨텍스트의 1/4 까지)
+  const reserve = Math.max(MIN_PREDICT, Math.min(nPredict > 0 ? nPredict : Infinity, Math.floor(contextSize / 4)));
+
+  let start = 0;
+  if (policy === 'truncate') {
+    while (start < turns.length - 1 && total(start) + reserve > contextSize) start++;
+    // 답변만 남고 질문이 잘린 턴은 함께 제거
+    while (start < turns.length - 1 && turns[start].role === 'assistant') start++;
+  }
+  const promptTokens = total(start);
+  const result = { start, promptTokens, truncatedTurns: start, contextSize };
+  if (promptTokens + MIN_PREDICT > contextSize) {
+    result.error = `Prompt (${promptTokens} tokens) exceeds context size (${contextSize})`;
+    return result;
+  }
+
+  // api.js 가 하던 동적 n_predict: 설정값, 프롬프트의 4배, 남은 컨텍스트의 80% 중 최소 (최소 32)
+  // n_predict <= 0 (무제한) 이면 남은 컨텍스트 전체 (mlx/context_window.py 의 dynamic_n_predict 와 같음)
+  const remaining = contextSize - promptTokens;
+  if (nPredict > 0) {
+    const maxByPrompt = Math.max(promptTokens * 4, 64);
+    const maxByContext = Math.floor(remaining * 0.8);
+    result.nPredict = Math.min(remaining, Math.max(MIN_PREDICT, Math.min(nPredict, maxByPrompt, maxByContext)));
+  } else {
+    result.nPredict = remaining;
+  }
+  return result;
+}
+
+// 세그먼트 텍스트 → 토큰 배열 [{ id, piece }] (모델별 LRU)
+class TurnTokenCache {
+  constructor(maxEntries = TURN_CACHE_MAX_ENTRIES) {
+    this.maxEntries = maxEntries;
+    this.entries = new Map();
+    this.hits = 0;
+    this.misses = 0;
+  }
+
+  async get(modelId, text, tokenize) {
+    const key = `${modelId}\u0000${text}`;
+    const cached = this.entries.get(key);
+    if (cached) {
+      this.entries.delete(key);
+      this.entries.set(key, cached);
+      this.hits++;
+      return cached;
+    }
+    this.misses++;
+    const tokens = await tokenize(text);
+    this.entries.set(key, tokens);
+    if (this.entries.size > this.maxEntries) {
+      this.entries.delete(this.entries.keys().next().value);
+    }
+    return tokens;
+  }
+}
+
+// messages 요청 → { prompt: 토큰 ID 배열, pieces, promptTokens, nPredict, truncatedTurns, contextSize } | { error, ... }
+// tokenize(text) 는 [{ id, piece }] 를 돌려줘야 합니다 (llama-server /tokenize with_pieces)
+async function prepareMessagesPrompt({ modelId, messages, contextSize, nPredict, policy, tokenize, cache }) {
+  const segments = llama3Segments(messages);
+  const [head, tail, ...turnTokens] = await Promise.all(
+    [segments.head, segments.tail, ...segments.turns.map(t => t.text)].map(text => cache.get(modelId, text, tokenize))
+  );
+  const turns = segments.turns.map((turn, i) => ({ role: turn.role, tokens: turnTokens[i].length }));
+  const fit = fitTurns(turns, { fixedTokens: head.length + tail.length, contextSize, nPredict, policy });
+  if (fit.error) return fit;
+  const tokens = [...head, ...turnTokens.slice(fit.start).flat(), ...tail];
+  return {
+    ...fit,
+    prompt: tokens.map(t => t.id),
+    pieces: tokens.map(t => t.piece)
+  };
+}
+
+module.exports = { llama3Segments, fitTurns, TurnTokenCache, prepareMessagesPrompt };
@@ -3,6 +3,14 @@ import PerformancePanel from './PerformancePanel';
 import './LogPanel.css';
 import { getActiveServerUrl, getActiveModelFormat } from '../services/api';
 
+// 화면에 유지하는 최대 로그 줄 수 (오래된 줄부터 버림, 전체 기록은 메인 프로세스 링 버퍼 / 로그 파일)
+const MAX_LOG_LINES = 2000;
+
+const appendLogs = (prevLogs, lines) => {
+  const next = prevLogs.concat(lines);
+  return next.length > MAX_LOG_LINES ? next.slice(next.length - MAX_LOG_LINES) : next;
+};
+
 const LogPanel = () => {
   const [activeTab, setActiveTab] = useState('performance');
   const [logs, setLogs] = useState(['Waiting for server logs...']);
@@ -11,17 +19,32 @@ const LogPanel = () => {
 
   useEffect(() => {
     const handleLogMessage = (message) => {
-      setLogs(prevLogs => [...prevLogs, message]);
+      setLogs(prevLogs => appendLogs(prevLogs, [message]));
+    };
+
+    // 메인 프로세스 로그 파이프라인의 배치 (렌더링은 배치당 한 번)
+    const handleLogBatch = (batch) => {
+      const lines = batch.dropped > 0
+        ? [`[Log] ${batch.dropped} lines dropped (log panel busy)`, ...batch.lines]
+        : batch.lines;
+      setLogs(prevLogs => appendLogs(prevLogs, lines));
     };
 
     const handleClientLogEvent = (event) => {
       if (event && event.detail) {
-        setLogs(prevLogs => [...prevLogs, event.detail]);
+        setLogs(prevLogs => appendLogs(prevLogs, [event.detail]));
       }
     };
 
     if (window.electronAPI) {
       window.electronAPI.onLogMessage(handleLogMessage);
+      if (window.electronAPI.onLogBatch) {
+        // 창이 열리기 전에 나온 로그 (링 버퍼) 를 먼저 채움
+        window.electronAPI.getLogHistory(MAX_LOG_LINES).then((lines) => {
+          if (lines && lines.length > 0) setLogs(prevLogs => appendLogs(prevLogs, lines));
+        }).catch(() => {});
+        window.electronAPI.onLogBatch(handleLogBatch);
+      }
     }
 
     // 프론트엔드에서 발생시키는 server-log 이벤트도 함께 수신
@@ -92,7 +115,7 @@ const LogPanel = () => {
                     if (data.type === 'log' && data.text) {
                       const line = String(data.text).trimEnd();
                       if (line) {
-                        setLogs(prev => [...prev, line]);
+                        setLogs(prev => appendLogs(prev, [line]));
                         // server-log 이벤트 브로드캐스트 (Header에서 프로그레스 파싱용)
                         window.dispatchEvent(new CustomEvent('server-log', { detail: line }));
                       }
@@ -176,7 +199,7 @@ const LogPanel = () => {
                   const json = JSON.parse(data);
                   const line = String(json.text || '').trimEnd();
                   if (line) {
-                    setLogs(prev => [...prev, line]);
+                    setLogs(prev => appendLogs(prev, [line]));
                     // server-log 이벤트 브로드캐스트 (Header에서 프로그레스 파싱용)
                     window.dispatchEvent(new CustomEvent('server-log', { detail: line }));
                   }
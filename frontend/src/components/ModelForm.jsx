@@ -147,7 +147,7 @@ const ModelForm = ({ config, onChange }) => {
   useEffect(() => {
     const defaults = {
       name: 'New Model', modelPath: '', modelFormat: 'gguf', accelerator: 'auto', gpuLayers: 0,
-      contextSize: 2048, maxTokens: 600, temperature: 0.7, topK: 40, topP: 0.95,
+      contextSize: 2048, kvCacheType: 'auto', maxTokens: 600, temperature: 0.7, topK: 40, topP: 0.95,
       minP: 0.05, tfsZ: 1.0, typicalP: 1.0, repeatPenalty: 1.15, repeatLastN: 128,
       penalizeNL: true, presencePenalty: 0.0, frequencyPenalty: 0.0,
       dryMultiplier: 0.5, dryBase: 1.75, dryAllowedLength: 3, dryPenaltyLastN: -1,
@@ -591,6 +591,15 @@ const ModelForm = ({ config, onChange }) => {
             <label>{t('settings.contextSize')}</label>
             <input type="number" name="contextSize" value={formData.contextSize ?? 2048} onChange={handleChange} min="1" />
           </div>
+          <div className="form-group">
+            <label>{t('settings.kvCacheType')}</label>
+            <select name="kvCacheType" value={formData.kvCacheType || 'auto'} onChange={handleChange}>
+              <option value="auto">{t('kvCache.auto')}</option>
+              <option value="f16">f16</option>
+              <option value="q8_0">q8_0</option>
+              <option value="q4_0">q4_0</option>
+            </select>
+          </div>
           <div className="form-group">
             <label>{t('settings.maxTokens')}</label>
             <input type="number" name="maxTokens" value={formData.maxTokens ?? 600} onChange={handleChange} min="-1" />
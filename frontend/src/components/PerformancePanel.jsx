@@ -1,7 +1,37 @@
 import React, { useState, useEffect, useRef } from 'react';
 import './PerformancePanel.css';
 import TokenDebugPanel from './TokenDebugPanel';
-import { getActiveServerUrl, getActiveModelFormat } from '../services/api';
+import { LLAMA_BASE_URL, getActiveModelFormat } from '../services/api';
+import { downloadChromeTrace } from '../services/trace';
+
+// 클라이언트 서버 관리자 (통합 메트릭 스트림)
+const MANAGER_URL = (LLAMA_BASE_URL || 'http://localhost:8080').replace(':8080', ':8083');
+
+// 요청별 지연 분해: 최근 요청 수와 단계 색상 (이름이 같으면 프론트엔드 / 서버 막대에서 같은 색)
+const TRACE_ROWS = 5;
+const STAGE_COLORS = {
+  'build prompt': '#8e7cc3',
+  'websocket connect': '#6fa8dc',
+  'request headers': '#6fa8dc',
+  'queue retry wait': '#e06666',
+  'tokenize request': '#6fa8dc',
+  'first token wait': '#f6b26b',
+  'stream': '#4CAF50',
+  'parse request': '#b4a7d6',
+  'read body': '#b4a7d6',
+  'prepare prompt': '#8e7cc3',
+  'tokenize': '#8e7cc3',
+  'queue': '#e06666',
+  'prefill chunk': '#f6b26b',
+  'prefill': '#f6b26b',
+  'first token': '#ffd966',
+  'decode step': '#4CAF50',
+  'speculative step': '#93c47d',
+  'decode': '#4CAF50',
+};
+// 다른 단계 안에서 합계로만 센 값 (막대에 쌓지 않고 글자로 표시)
+const NESTED_STAGES = new Set(['detokenize', 'event loop handoff']);
+const stageColor = (name) => STAGE_COLORS[name] || '#999';
 
 const PerformancePanel = () => {
   const [cpuUsage, setCpuUsage] = useState(0);
@@ -9,6 +39,8 @@ const PerformancePanel = () => {
   const [memoryUsage, setMemoryUsage] = useState(0);
   const [vramTotal, setVramTotal] = useState(0); // VRAM 총량
   const [vramUsed, setVramUsed] = useState(0); // VRAM 사용량
+  const [kvCache, setKvCache] = useState(null); // { type, bytes } KV 캐시 타입과 크기
+  const [latency, setLatency] = useState(null); // { ttft: { p50, p99 }, itl: { p50, p99 } } (ms, 라우터 측정)
   const [contextUsage, setContextUsage] = useState(0);
   const [contextUsed, setContextUsed] = useState(0);
   const [contextSize, setContextSize] = useState(2048);
@@ -23,7 +55,8 @@ const PerformancePanel = () => {
   const lastProcCpuSampleAtRef = useRef(null);
   const lastPredictedTotalRef = useRef(null);
   const eventSourceRef = useRef(null);
-  const websocketRef = useRef(null);
+  const [traces, setTraces] = useState([]); // 최근 요청의 구간 요약 (services/trace.js 의 request-trace 이벤트)
+  const [traceChatOnly, setTraceChatOnly] = useState(true);
 
   const getActiveModelIdForMetrics = () => {
     // New client-only config (SettingsPage)
@@ -47,19 +80,21 @@ const PerformancePanel = () => {
 
   useEffect(() => {
     // 토큰 속도 업데이트를 위한 전역 이벤트 리스너
-    const handleTokenReceived = () => {
+    // detail.count: 묶음 프레임(coalesced / binary)으로 한 번에 온 토큰 수
+    const handleTokenReceived = (event) => {
       const now = Date.now();
+      const count = event?.detail?.count || 1;
       
       // 첫 토큰인 경우 시간 초기화
       if (lastTokenTimeRef.current === 0) {
         lastTokenTimeRef.current = now;
-        tokenCountRef.current = 1; // 첫 토큰도 카운트에 포함
+        tokenCountRef.current = count; // 첫 토큰도 카운트에 포함
         lastUpdateTimeRef.current = now;
         // console.log('[PerformancePanel] First token received, initializing timer');
         return; // 첫 토큰은 시간만 설정하고 계산하지 않음
       }
       
-      tokenCountRef.current += 1;
+      tokenCountRef.current += count;
       const timeDiff = now - lastTokenTimeRef.current;
       const timeSinceLastUpdate = now - lastUpdateTimeRef.current;
       
@@ -149,6 +184,7 @@ const PerformancePanel = () => {
             setVramUsed(metrics.vramUsed);
             // console.log('[PerformancePanel] Set vramUsed:', metrics.vramUsed);
           }
+          setKvCache(metrics.kvCache || null);
         } catch (error) {
           console.error('Failed to get system metrics:', error);
           // Fallback to mock data
@@ -201,289 +237,211 @@ const PerformancePanel = () => {
     };
   }, []);
 
-  // Metrics stream (SSE for GGUF, WebSocket for MLX)
+  // 통합 메트릭 스트림 (클라이언트 모드): 관리자(8083)의 /metrics/stream 하나로 모든 백엔드를 받음
+  // 첫 이벤트는 전체 snapshot, 이후 바뀐 필드만 delta. 활성 모델의 백엔드 항목을 골라 표시합니다.
   useEffect(() => {
     if (window.electronAPI && window.electronAPI.getSystemMetrics) return;
-    
-    const modelFormat = getActiveModelFormat();
-    const useWebSocket = modelFormat === 'mlx';
-    
-    if (useWebSocket && typeof WebSocket === 'undefined') return;
-    if (!useWebSocket && typeof EventSource === 'undefined') return;
+    if (typeof EventSource === 'undefined') return;
 
     let stopped = false;
     let reconnectTimer = null;
-    let probeTimer = null;
-    let currentModelId = '';
-    let currentServerUrl = '';
+    let snapshot = { system: {}, backends: {} };
 
-    const close = () => {
-      if (eventSourceRef.current) {
-        try { eventSourceRef.current.close(); } catch (_e) {}
-        eventSourceRef.current = null;
-      }
-      if (websocketRef.current) {
-        try { websocketRef.current.close(); } catch (_e) {}
-        websocketRef.current = null;
+    const handleMetricsData = (data) => {
+      try {
+        const vramTotalBytes = Number(data.vramTotal || 0);
+        const vramUsedBytes = Number(data.vramUsed || 0);
+        if (vramTotalBytes > 0) {
+          setVramTotal(Math.round(vramTotalBytes));
+        }
+        if (vramUsedBytes >= 0) {
+          setVramUsed(Math.round(vramUsedBytes));
+        }
+        setKvCache(data.kvCache || null);
+
+        const sysMemTotal = Number(data.sysMemTotal || 0);
+        const sysMemUsed = Number(data.sysMemUsed || 0);
+        if (sysMemTotal > 0 && sysMemUsed >= 0) {
+          const memUsage = Math.max(0, Math.min(100, (sysMemUsed / sysMemTotal) * 100));
+          setMemoryUsage(memUsage);
+        }
+
+        const now = Date.now();
+        const cpuSec = Number(data.procCpuSec || 0);
+        const hasCpuCounter = typeof data.cpuUsage === 'number';
+        const cores = Math.max(1, Math.round(Number(data.cpuCores || 1)));
+        if (hasCpuCounter) {
+          // 서버가 호스트 CPU 사용률을 직접 보고하는 경우 (Electron 매니저와 같은 기준)
+          setCpuUsage(Math.max(0, Math.min(100, data.cpuUsage)));
+        } else if (lastProcCpuSecondsRef.current != null && lastProcCpuSampleAtRef.current != null) {
+          const dt = (now - lastProcCpuSampleAtRef.current) / 1000;
+          const dcpu = cpuSec - lastProcCpuSecondsRef.current;
+          if (dt > 0 && dcpu >= 0) {
+            const pct = (dcpu / dt / cores) * 100;
+            setCpuUsage(Math.max(0, Math.min(100, pct)));
+          }
+        } else {
+          // 첫 번째 메트릭: 초기값 설정 (CPU 사용률은 다음 메트릭부터 계산)
+          // CPU 사용률을 0으로 설정하거나, 프로세스 CPU 시간만 저장
+          setCpuUsage(0);
+        }
+        lastProcCpuSecondsRef.current = cpuSec;
+        lastProcCpuSampleAtRef.current = now;
+
+        const tps = Number(data.tps || 0);
+        // 클라이언트 측 계산 값이 있으면 우선 사용 (더 정확한 실시간 속도)
+        if (tokenSpeedRef.current > 0) {
+          setTokenSpeed(tokenSpeedRef.current);
+        } else if (tps > 0) {
+          // 클라이언트 측 계산이 없으면 서버 메트릭 사용
+          setTokenSpeed(Math.max(0, tps));
+          tokenSpeedRef.current = tps;
+        }
+        
+        // GPU 게이지: 서버가 GPU 사용률을 보고하면 사용, 아니면 VRAM 점유율(%)로 대체
+        if (typeof data.gpuUsage === 'number') {
+          setGpuUsage(Math.max(0, Math.min(100, data.gpuUsage)));
+        } else if (vramTotalBytes > 0) {
+          const gpuUsage = Math.max(0, Math.min(100, (vramUsedBytes / vramTotalBytes) * 100));
+          setGpuUsage(gpuUsage);
+        } else {
+          setGpuUsage(0);
+        }
+
+        const predictedTotal = Number(data.predictedTotal || 0);
+        if (lastPredictedTotalRef.current != null) {
+          const delta = Math.max(0, Math.round(predictedTotal - lastPredictedTotalRef.current));
+          setTokenCount(delta);
+        }
+        lastPredictedTotalRef.current = predictedTotal;
+      } catch (e) {
+        console.error('[PerformancePanel] Error in handleMetricsData:', e, data);
       }
     };
 
-    const scheduleReconnect = (delayMs = 3000) => {
-      if (stopped) return;
-      if (reconnectTimer) {
-        window.clearTimeout(reconnectTimer);
-      }
-      reconnectTimer = window.setTimeout(() => {
-        reconnectTimer = null;
-        if (!stopped) {
-          connect();
-        }
-      }, delayMs);
+    // 활성 모델 형식의 백엔드 중 모델이 일치하는 항목 (없으면 로컬, 그다음 첫 항목)
+    const pickBackend = () => {
+      const format = getActiveModelFormat();
+      const modelId = getActiveModelIdForMetrics();
+      const entries = Object.values(snapshot.backends).filter((e) => e.backend === format);
+      return entries.find((e) => modelId && (e.model === modelId || e.modelPath === modelId))
+        || entries.find((e) => !e.remote)
+        || entries[0]
+        || null;
     };
 
-    const connect = () => {
-      if (stopped) return;
+    const render = () => {
+      const system = snapshot.system || {};
+      const backend = pickBackend();
+      handleMetricsData({
+        ...system,
+        vramTotal: (backend && backend.vramTotal) || system.vramTotal,
+        vramUsed: backend && backend.vramUsed != null ? backend.vramUsed : system.vramUsed,
+        kvCache: backend ? backend.kvCache : null,
+        tps: backend ? backend.tps : 0,
+        predictedTotal: backend ? backend.predictedTokensTotal : 0,
+      });
+      setLatency(backend ? { ttft: backend.ttftMs, itl: backend.itlMs } : null);
+    };
 
-      const modelId = getActiveModelIdForMetrics();
-      if (!modelId) {
-        currentModelId = '';
-        currentServerUrl = '';
-        close();
-        return;
+    const applyDelta = (delta) => {
+      const backends = { ...snapshot.backends };
+      for (const [id, changes] of Object.entries(delta.backends || {})) {
+        if (changes === null) delete backends[id];
+        else backends[id] = { ...(backends[id] || {}), ...changes };
       }
+      snapshot = { timestamp: delta.timestamp, system: { ...snapshot.system, ...(delta.system || {}) }, backends };
+    };
 
-      // 현재 서버 URL 가져오기
-      const serverUrl = getActiveServerUrl();
-
-      // 이미 같은 모델과 서버 URL로 연결되어 있으면 재연결하지 않음
-      if (useWebSocket) {
-        if (websocketRef.current && websocketRef.current.readyState === WebSocket.OPEN && 
-            currentModelId === modelId && currentServerUrl === serverUrl) {
-          // console.log('[PerformancePanel] WebSocket already connected, skipping');
-          return;
-        }
-      } else {
-        if (eventSourceRef.current && currentModelId === modelId && currentServerUrl === serverUrl) {
-          return;
-        }
+    const close = () => {
+      if (eventSourceRef.current) {
+        try { eventSourceRef.current.close(); } catch (_e) {}
+        eventSourceRef.current = null;
       }
+    };
 
-      // 모델이나 서버 URL이 변경되었으면 재연결
-      currentModelId = modelId;
-      currentServerUrl = serverUrl;
+    const connect = () => {
+      if (stopped) return;
       close();
-
-      const handleMetricsData = (data) => {
+      const es = new EventSource(`${MANAGER_URL}/metrics/stream`);
+      eventSourceRef.current = es;
+      es.addEventListener('snapshot', (evt) => {
         try {
-          // MLX 서버 메트릭 디버깅
-          // console.log('[PerformancePanel] MLX metrics received:', data);
-          
-          const vramTotalBytes = Number(data.vramTotal || 0);
-          const vramUsedBytes = Number(data.vramUsed || 0);
-          if (vramTotalBytes > 0) {
-            setVramTotal(Math.round(vramTotalBytes));
-          }
-          if (vramUsedBytes >= 0) {
-            setVramUsed(Math.round(vramUsedBytes));
-          }
-
-          const sysMemTotal = Number(data.sysMemTotal || 0);
-          const sysMemUsed = Number(data.sysMemUsed || 0);
-          if (sysMemTotal > 0 && sysMemUsed >= 0) {
-            const memUsage = Math.max(0, Math.min(100, (sysMemUsed / sysMemTotal) * 100));
-            setMemoryUsage(memUsage);
-          }
-
-          const now = Date.now();
-          const cpuSec = Number(data.procCpuSec || 0);
-          const cores = Math.max(1, Math.round(Number(data.cpuCores || 1)));
-          if (lastProcCpuSecondsRef.current != null && lastProcCpuSampleAtRef.current != null) {
-            const dt = (now - lastProcCpuSampleAtRef.current) / 1000;
-            const dcpu = cpuSec - lastProcCpuSecondsRef.current;
-            if (dt > 0 && dcpu >= 0) {
-              const pct = (dcpu / dt / cores) * 100;
-              setCpuUsage(Math.max(0, Math.min(100, pct)));
-            }
-          } else {
-            // 첫 번째 메트릭: 초기값 설정 (CPU 사용률은 다음 메트릭부터 계산)
-            // CPU 사용률을 0으로 설정하거나, 프로세스 CPU 시간만 저장
-            setCpuUsage(0);
-          }
-          lastProcCpuSecondsRef.current = cpuSec;
-          lastProcCpuSampleAtRef.current = now;
-
-          const tps = Number(data.tps || 0);
-          // 클라이언트 측 계산 값이 있으면 우선 사용 (더 정확한 실시간 속도)
-          if (tokenSpeedRef.current > 0) {
-            setTokenSpeed(tokenSpeedRef.current);
-          } else if (tps > 0) {
-            // 클라이언트 측 계산이 없으면 서버 메트릭 사용
-            setTokenSpeed(Math.max(0, tps));
-            tokenSpeedRef.current = tps;
-          }
-          
-          // GPU 게이지는 VRAM 점유율(%)을 GPU 지표로 사용
-          if (vramTotalBytes > 0) {
-            const gpuUsage = Math.max(0, Math.min(100, (vramUsedBytes / vramTotalBytes) * 100));
-            setGpuUsage(gpuUsage);
-          } else {
-            setGpuUsage(0);
-          }
-
-          const predictedTotal = Number(data.predictedTotal || 0);
-          if (lastPredictedTotalRef.current != null) {
-            const delta = Math.max(0, Math.round(predictedTotal - lastPredictedTotalRef.current));
-            setTokenCount(delta);
-          }
-          lastPredictedTotalRef.current = predictedTotal;
-        } catch (e) {
-          console.error('[PerformancePanel] Error in handleMetricsData:', e, data);
+          snapshot = JSON.parse(evt.data);
+          render();
+        } catch (_e) {
+          // ignore
         }
+      });
+      es.addEventListener('delta', (evt) => {
+        try {
+          applyDelta(JSON.parse(evt.data));
+          render();
+        } catch (_e) {
+          // ignore
+        }
+      });
+      // 관리자가 재시작되면 자동 재연결
+      es.onerror = () => {
+        close();
+        if (stopped) return;
+        if (reconnectTimer) window.clearTimeout(reconnectTimer);
+        reconnectTimer = window.setTimeout(() => {
+          reconnectTimer = null;
+          connect();
+        }, 3000);
       };
-
-      if (useWebSocket) {
-        // MLX 모델: WebSocket 사용
-        // 서버가 준비되었는지 먼저 확인
-        const checkAndConnect = async () => {
-          // 이미 연결 중이거나 열려있으면 재연결하지 않음
-          if (websocketRef.current && 
-              (websocketRef.current.readyState === WebSocket.CONNECTING || 
-               websocketRef.current.readyState === WebSocket.OPEN)) {
-            return;
-          }
-          
-          try {
-            const healthResponse = await fetch(`${serverUrl}/health`, { signal: AbortSignal.timeout(2000) });
-            
-            // 503 상태 코드는 서버가 로딩 중임을 의미
-            if (healthResponse.status === 503) {
-              // 서버가 로딩 중이면 잠시 후 재시도
-              scheduleReconnect(5000);
-              return;
-            }
-            
-            if (healthResponse.ok) {
-              const healthData = await healthResponse.json();
-              // 서버가 ready 상태이거나 loading 상태일 때만 연결 시도
-              if (healthData.status === 'ready' || healthData.status === 'loading') {
-                const wsUrl = serverUrl.replace('http://', 'ws://').replace('https://', 'wss://');
-                const wsUrlFull = `${wsUrl}/metrics/stream`;
-                const ws = new WebSocket(wsUrlFull);
-                websocketRef.current = ws;
-
-                ws.onopen = () => {
-                  console.log('[PerformancePanel] MLX metrics WebSocket connected');
-                };
-
-                ws.onmessage = (event) => {
-                  try {
-                    const data = JSON.parse(event.data);
-                    if (data.type === 'metrics') {
-                      handleMetricsData(data);
-                    } else {
-                      console.warn('[PerformancePanel] Unexpected message type:', data.type);
-                    }
-                  } catch (e) {
-                    console.error('[PerformancePanel] Failed to parse metrics data:', e, event.data);
-                  }
-                };
-
-                ws.onerror = () => {
-                  // 에러는 조용히 처리, onclose에서 재연결
-                };
-
-                ws.onclose = (event) => {
-                  websocketRef.current = null;
-                  if (!stopped && event.code !== 1000) {  // 정상 종료(1000)가 아닌 경우만 재연결
-                    scheduleReconnect(5000);  // 재연결 간격 증가
-                  }
-                };
-              } else {
-                // 서버가 준비되지 않았으면 재시도
-                scheduleReconnect(5000);
-              }
-            } else {
-              // 헬스 체크 실패 시 재시도
-              scheduleReconnect(5000);
-            }
-          } catch (e) {
-            // 서버가 아직 시작되지 않았거나 연결 불가 - 재시도
-            scheduleReconnect(5000);
-          }
-        };
-        
-        checkAndConnect();
-      } else {
-        // GGUF 모델: SSE 사용
-        // autoload=1 ensures router spawns the model process even if not already loaded
-        const url = `${serverUrl}/metrics/stream?model=${encodeURIComponent(modelId)}&interval_ms=1000&autoload=1`;
-        const es = new EventSource(url);
-        eventSourceRef.current = es;
-
-        es.addEventListener('metrics', (evt) => {
-          try {
-            const data = JSON.parse(evt.data);
-            handleMetricsData(data);
-          } catch (_e) {
-            // ignore
-          }
-        });
-
-        // if the SSE connection drops (e.g. router/model restart), retry automatically
-        es.onerror = () => {
-          close();
-          scheduleReconnect(1000);
-        };
-      }
     };
 
-    // connect immediately and reconnect when config changes
     connect();
-    const onConfigUpdated = () => {
-      // config가 변경되었으면 현재 연결 정보를 초기화하고 재연결
-      currentModelId = '';
-      currentServerUrl = '';
-      close();
-      // 약간의 지연을 두어 localStorage가 완전히 업데이트되도록 함
-      setTimeout(() => {
-        connect();
-      }, 100);
-    };
-
-    window.addEventListener('client-config-updated', onConfigUpdated);
-    window.addEventListener('config-updated', onConfigUpdated);
-    window.addEventListener('storage', onConfigUpdated);
-
-    // Fallback: when localStorage is updated in the same tab, the 'storage' event doesn't fire.
-    // Probe the active model id and server URL locally and connect once they change.
-    probeTimer = window.setInterval(() => {
-      if (stopped) return;
-      const modelId = getActiveModelIdForMetrics();
-      const serverUrl = getActiveServerUrl();
-      
-      // WebSocket이 이미 연결 중이거나 열려있으면 재연결하지 않음
-      if (useWebSocket && websocketRef.current && 
-          (websocketRef.current.readyState === WebSocket.CONNECTING || 
-           websocketRef.current.readyState === WebSocket.OPEN)) {
-        return;
-      }
-      
-      if (modelId && (!eventSourceRef.current || modelId !== currentModelId || serverUrl !== currentServerUrl)) {
-        connect();
-      }
-    }, 2000); // 1초에서 2초로 변경하여 재시도 빈도 감소
+    // 활성 모델이 바뀌면 받은 snapshot 에서 다른 백엔드 항목을 고름 (재연결 불필요)
+    window.addEventListener('client-config-updated', render);
+    window.addEventListener('config-updated', render);
+    window.addEventListener('storage', render);
 
     return () => {
       stopped = true;
-      window.removeEventListener('client-config-updated', onConfigUpdated);
-      window.removeEventListener('config-updated', onConfigUpdated);
-      window.removeEventListener('storage', onConfigUpdated);
-      if (probeTimer) window.clearInterval(probeTimer);
+      window.removeEventListener('client-config-updated', render);
+      window.removeEventListener('config-updated', render);
+      window.removeEventListener('storage', render);
       if (reconnectTimer) window.clearTimeout(reconnectTimer);
       close();
     };
   }, []);
 
+  useEffect(() => {
+    // 끝난 요청의 단계별 지연 (프론트엔드 구간 + 서버가 보고한 단계)
+    const handleRequestTrace = (event) => {
+      const summary = event.detail;
+      if (!summary) return;
+      setTraces(prev => [summary, ...prev].slice(0, TRACE_ROWS * 4));
+    };
+    window.addEventListener('request-trace', handleRequestTrace);
+    return () => window.removeEventListener('request-trace', handleRequestTrace);
+  }, []);
+
+  // 단계 막대 하나 (총 시간 대비 비율, 순서대로 쌓음)
+  const StageBar = ({ stages, totalMs, label }) => {
+    const visible = stages.filter(s => !NESTED_STAGES.has(s.name) && s.ms > 0);
+    if (visible.length === 0) return null;
+    const scale = Math.max(totalMs, visible.reduce((sum, s) => sum + s.ms, 0)) || 1;
+    return (
+      <div className="trace-bar-row">
+        <div className="trace-bar-label">{label}</div>
+        <div className="trace-bar">
+          {visible.map(s => (
+            <div
+              key={s.name}
+              className="trace-bar-segment"
+              title={`${s.name}: ${s.ms.toFixed(1)} ms`}
+              style={{ width: `${(s.ms / scale) * 100}%`, backgroundColor: stageColor(s.name) }}
+            />
+          ))}
+        </div>
+      </div>
+    );
+  };
+
   // 반원형 게이지 컴포넌트
   const SemiCircleGauge = ({ value, label, maxValue = 100 }) => {
     const percentage = Math.min((value / maxValue) * 100, 100);
@@ -638,6 +596,11 @@ const PerformancePanel = () => {
                   ({(vramUsed / 1024 / 1024 / 1024).toFixed(1)} / {(vramTotal / 1024 / 1024 / 1024).toFixed(1)} GB)
                 </span>
               )}
+              {kvCache && (
+                <span style={{ fontSize: '0.7em', display: 'block', fontWeight: 'normal' }}>
+                  KV {kvCache.type} {(kvCache.bytes / 1024 / 1024 / 1024).toFixed(2)} GB
+                </span>
+              )}
             </div>
             <div className="memory-bar-container small">
               <div 
@@ -677,9 +640,59 @@ const PerformancePanel = () => {
         <div className="performance-item token-speed-item">
           <div className="token-speed-label">Token Speed</div>
           <div className="token-speed-value">{tokenSpeed.toFixed(1)} tokens/s</div>
+          {latency && (latency.ttft.p50 != null || latency.itl.p99 != null) && (
+            <div style={{ fontSize: '0.7em', opacity: 0.8 }}>
+              {latency.ttft.p50 != null && `TTFT p50 ${Math.round(latency.ttft.p50)} ms`}
+              {latency.ttft.p50 != null && latency.itl.p99 != null && ' · '}
+              {latency.itl.p99 != null && `ITL p99 ${latency.itl.p99.toFixed(1)} ms`}
+            </div>
+          )}
           <TokenSpeedLamps speed={tokenSpeed} maxSpeed={50} />
         </div>
 
+        {/* 요청별 지연 분해 (프론트엔드 / 서버 단계, Chrome trace 내보내기) */}
+        <div className="performance-item trace-item">
+          <div className="trace-header">
+            <div className="token-speed-label">Latency Breakdown</div>
+            <button className="trace-filter" onClick={() => setTraceChatOnly(v => !v)}>
+              {traceChatOnly ? 'Chat only' : 'All requests'}
+            </button>
+          </div>
+          {(() => {
+            const rows = traces.filter(t => !traceChatOnly || t.kind === 'chat').slice(0, TRACE_ROWS);
+            if (rows.length === 0) {
+              return <div className="trace-empty">No traced requests yet</div>;
+            }
+            return rows.map(t => {
+              // 합계로만 센 값: 서버의 디토크나이즈 / 전달 지연, 프론트엔드의 onToken / 파싱 시간
+              const nested = [...t.server.filter(s => NESTED_STAGES.has(s.name)), ...t.totals];
+              return (
+                <div key={t.id} className="trace-row">
+                  <div className="trace-row-header">
+                    <span>{t.kind} · {t.backend || '-'} · {t.durationMs.toFixed(0)} ms{t.status !== 'ok' ? ` · ${t.status}` : ''}</span>
+                    <button className="trace-export" title="Chrome trace JSON (chrome://tracing, ui.perfetto.dev)"
+                      onClick={() => downloadChromeTrace(t.id, MANAGER_URL)}>
+                      Export trace
+                    </button>
+                  </div>
+                  <StageBar stages={t.stages} totalMs={t.durationMs} label="client" />
+                  <StageBar stages={t.server} totalMs={t.durationMs} label="server" />
+                  <div className="trace-legend">
+                    {[...t.stages, ...t.server].filter(s => !NESTED_STAGES.has(s.name)).map((s, i) => (
+                      <span key={`${s.name}-${i}`}>
+                        <i style={{ backgroundColor: stageColor(s.name) }} />{s.name} {s.ms.toFixed(1)}
+                      </span>
+                    ))}
+                    {nested.map((s, i) => (
+                      <span key={`nested-${s.name}-${i}`} className="trace-nested">{s.name} {s.ms.toFixed(1)}</span>
+                    ))}
+                  </div>
+                </div>
+              );
+            });
+          })()}
+        </div>
+
         {/* Token Debug Panel */}
         <div className="performance-item token-debug-item">
           <TokenDebugPanel />
@@ -1,92 +1,107 @@
-import React, { useState, useEffect } from 'react';
-import { tokenizeText } from '../services/api';
+import React, { useState, useEffect, useRef } from 'react';
+import { tokenizeIncremental } from '../services/api';
 import './TokenDebugPanel.css';
 
+// 공통 normalize 함수 (offset: 이어 붙일 때의 시작 인덱스)
+const normalizeTokens = (tokenData, offset = 0) => {
+  return tokenData.map((t, i) => {
+    // with_pieces=true 일 때: { id, piece }
+    let id = t.id ?? t;
+    let piece = '';
+    if (typeof t.piece === 'string') {
+      piece = t.piece;
+    } else if (Array.isArray(t.piece)) {
+      // 바이트 배열일 경우 문자열로 변환 시도
+      try {
+        piece = String.fromCharCode(...t.piece);
+      } catch {
+        piece = JSON.stringify(t.piece);
+      }
+    } else if (typeof t === 'string') {
+      piece = t;
+    }
+    const isSpecial = /^<\|[^>]*\|>$/.test(piece);
+    return { index: offset + i, id, piece, isSpecial };
+  });
+};
+
 const TokenDebugPanel = () => {
   const [promptTokens, setPromptTokens] = useState([]);
   const [responseTokens, setResponseTokens] = useState([]);
+  // 스트림에 실려 온 토큰을 받았는지 (못 받은 경우에만 /tokenize 로 대체)
+  const inlinePromptRef = useRef(false);
+  const inlineResponseRef = useRef(false);
+  const pendingPromptRef = useRef('');
+  // 마지막 /tokenize 결과 { tokens, cursor } (다음 호출은 달라진 부분만 받음)
+  const promptTokenizeRef = useRef(null);
+  // 응답 토큰은 프레임 단위로 모아서 반영 (토큰마다 렌더링하지 않음)
+  const responseBufferRef = useRef([]);
+  const flushFrameRef = useRef(null);
 
   useEffect(() => {
-    // 공통 normalize 함수
-    const normalizeTokens = (tokenData) => {
-      return tokenData.map((t, index) => {
-        // with_pieces=true 일 때: { id, piece }
-        let id = t.id ?? t;
-        let piece = '';
-        if (typeof t.piece === 'string') {
-          piece = t.piece;
-        } else if (Array.isArray(t.piece)) {
-          // 바이트 배열일 경우 문자열로 변환 시도
-          try {
-            piece = String.fromCharCode(...t.piece);
-          } catch {
-            piece = JSON.stringify(t.piece);
-          }
-        } else if (typeof t === 'string') {
-          piece = t;
-        }
-        const isSpecial = /^<\|[^>]*\|>$/.test(piece);
-        return { index, id, piece, isSpecial };
-      });
+    const flushResponse = () => {
+      flushFrameRef.current = null;
+      const buffered = responseBufferRef.current;
+      if (buffered.length === 0) return;
+      responseBufferRef.current = [];
+      setResponseTokens(prev => [...prev, ...normalizeTokens(buffered, prev.length)]);
     };
 
-    const handlePromptOutput = async (event) => {
-      const prompt = event.detail?.prompt || '';
-      console.log('[TokenDebug] prompt-output event received, prompt length:', prompt.length);
-      if (!prompt) {
-        console.warn('[TokenDebug] Empty prompt, clearing tokens');
-        setPromptTokens([]);
-        return;
-      }
-      try {
-        console.log('[TokenDebug] Calling tokenizeText for prompt...');
-        const tokenData = await tokenizeText(prompt);
-        console.log('[TokenDebug] tokenizeText returned:', tokenData?.length || 0, 'tokens');
-        if (!tokenData || tokenData.length === 0) {
-          console.warn('[TokenDebug] No tokens returned for prompt');
-          setPromptTokens([]);
-          return;
+    const handleTokenDebug = (event) => {
+      const { kind, tokens = [] } = event.detail || {};
+      if (kind === 'start') {
+        inlinePromptRef.current = false;
+        inlineResponseRef.current = false;
+        responseBufferRef.current = [];
+        setResponseTokens([]);
+      } else if (kind === 'prompt') {
+        inlinePromptRef.current = true;
+        setPromptTokens(normalizeTokens(tokens));
+      } else if (kind === 'response') {
+        inlineResponseRef.current = true;
+        responseBufferRef.current.push(...tokens);
+        if (flushFrameRef.current === null) {
+          flushFrameRef.current = requestAnimationFrame(flushResponse);
         }
-        const normalized = normalizeTokens(tokenData);
-        console.log('[TokenDebug] Normalized tokens:', normalized.length);
-        setPromptTokens(normalized);
-      } catch (error) {
-        console.error('[TokenDebug] Failed to tokenize prompt:', error);
+      }
+    };
+
+    const handlePromptOutput = (event) => {
+      // 프롬프트 토큰은 생성 스트림의 첫 이벤트로 받으므로 여기서는 텍스트만 보관
+      pendingPromptRef.current = event.detail?.prompt || '';
+      if (!pendingPromptRef.current) {
         setPromptTokens([]);
       }
     };
 
+    // 스트림에 토큰 정보가 없었던 경우 (예: llama-server 직접 연결)에만 /tokenize 로 대체
     const handleAssistantOutput = async (event) => {
       const text = event.detail?.text || '';
-      console.log('[TokenDebug] assistant-output event received, text length:', text.length);
-      if (!text) {
-        console.warn('[TokenDebug] Empty text, clearing tokens');
-        setResponseTokens([]);
-        return;
-      }
       try {
-        console.log('[TokenDebug] Calling tokenizeText for assistant output...');
-        const tokenData = await tokenizeText(text);
-        console.log('[TokenDebug] tokenizeText returned:', tokenData?.length || 0, 'tokens');
-        if (!tokenData || tokenData.length === 0) {
-          console.warn('[TokenDebug] No tokens returned for assistant output');
-          setResponseTokens([]);
-          return;
+        if (!inlinePromptRef.current && pendingPromptRef.current) {
+          const result = await tokenizeIncremental(pendingPromptRef.current, promptTokenizeRef.current);
+          promptTokenizeRef.current = result;
+          setPromptTokens(normalizeTokens(result.tokens));
+        }
+        if (!inlineResponseRef.current && text) {
+          const result = await tokenizeIncremental(text);
+          setResponseTokens(normalizeTokens(result.tokens));
         }
-        const normalized = normalizeTokens(tokenData);
-        console.log('[TokenDebug] Normalized tokens:', normalized.length);
-        setResponseTokens(normalized);
       } catch (error) {
-        console.error('[TokenDebug] Failed to tokenize assistant output:', error);
-        setResponseTokens([]);
+        console.error('[TokenDebug] Failed to tokenize:', error);
       }
     };
 
+    window.addEventListener('token-debug', handleTokenDebug);
     window.addEventListener('prompt-output', handlePromptOutput);
     window.addEventListener('assistant-output', handleAssistantOutput);
     return () => {
+      window.removeEventListener('token-debug', handleTokenDebug);
       window.removeEventListener('prompt-output', handlePromptOutput);
       window.removeEventListener('assistant-output', handleAssistantOutput);
+      if (flushFrameRef.current !== null) {
+        cancelAnimationFrame(flushFrameRef.current);
+      }
     };
   }, []);
 
@@ -1,6 +1,6 @@
 import React, { useState, useEffect, useRef } from 'react';
 import { Panel, PanelGroup, PanelResizeHandle } from 'react-resizable-panels';
-import { sendChatMessage, buildLlama3Prompt, countTokens, getActiveServerUrl } from '../services/api';
+import { sendChatMessage, buildLlama3Prompt, getConversationTokenUsage, resetConversationTokenUsage, getActiveServerUrl } from '../services/api';
 import { useLanguage } from '../contexts/LanguageContext';
 import LogPanel from '../components/LogPanel';
 import ProgressBar from '../components/ProgressBar';
@@ -14,6 +14,7 @@ const ChatPage = () => {
   const [isModelLoading, setIsModelLoading] = useState(false);
   const [showSpecialTokens, setShowSpecialTokens] = useState(false);
   const [isWaitingForFirstToken, setIsWaitingForFirstToken] = useState(false);
+  const [queueInfo, setQueueInfo] = useState(null); // 관리자 라우터 대기열 { position, estimated_wait_ms }
   const messagesEndRef = useRef(null);
   const inputRef = useRef(null);
   const assistantOutputRef = useRef('');
@@ -26,55 +27,15 @@ const ChatPage = () => {
   useEffect(scrollToBottom, [messages]);
 
   // Context 사용량 계산 및 업데이트
+  // 토큰 수는 채팅 요청의 첫 스트림 이벤트로 서버가 알려주므로 여기서는 /tokenize 를 호출하지 않음
   useEffect(() => {
-    const calculateContextUsage = async () => {
-      try {
-        const config = JSON.parse(localStorage.getItem('modelConfig')) || {};
-        const contextSize = config.contextSize || 2048;
-        
-        // 실제 프롬프트를 생성하여 정확한 토큰 수 계산
-        const prompt = buildLlama3Prompt(messages, language);
-        const promptLength = prompt.length;
-        
-        // 서버의 tokenize API를 사용하여 정확한 토큰 수 계산
-        const actualTokens = await countTokens(prompt);
-        
-        // Context 사용량 이벤트 발생
-        window.dispatchEvent(new CustomEvent('context-update', {
-          detail: {
-            used: actualTokens,
-            total: contextSize
-          }
-        }));
-        
-        // 경고 메시지 출력 (디버그용 로그는 주석 처리)
-        // console.log(`[Context] Prompt length: ${promptLength} chars, Actual tokens: ${actualTokens}, Context size: ${contextSize}`);
-        if (actualTokens > contextSize) {
-          console.error(`[Context] Error: Actual tokens (${actualTokens}) exceeds context size (${contextSize})`);
-        } else if (actualTokens > contextSize * 0.9) {
-          console.warn(`[Context] Warning: Actual tokens (${actualTokens}) is close to context size (${contextSize})`);
-        }
-      } catch (error) {
-        console.error('Failed to calculate context usage:', error);
-        // 에러 발생 시 추정값 사용
-        try {
-          const config = JSON.parse(localStorage.getItem('modelConfig')) || {};
-          const contextSize = config.contextSize || 2048;
-          const prompt = buildLlama3Prompt(messages, language);
-          const estimatedTokens = Math.ceil(prompt.length / 2.0);
-          window.dispatchEvent(new CustomEvent('context-update', {
-            detail: {
-              used: estimatedTokens,
-              total: contextSize
-            }
-          }));
-        } catch (e) {
-          console.error('Failed to use fallback estimation:', e);
-        }
-      }
-    };
-
-    calculateContextUsage();
+    const { used, total } = getConversationTokenUsage(messages, language);
+    window.dispatchEvent(new CustomEvent('context-update', {
+      detail: { used, total }
+    }));
+    if (used > total * 0.9) {
+      console.warn(`[Context] Warning: Tokens (${used}) is close to context size (${total})`);
+    }
   }, [messages, language]);
 
   // 스페셜 토큰 표시 설정 로드
@@ -169,7 +130,13 @@ const ChatPage = () => {
       setIsModelLoading(event.detail.loading);
     };
 
+    // 대기열 위치 (position 0 이면 승인됨)
+    const handleQueueUpdate = (event) => {
+      setQueueInfo(event.detail && event.detail.position !== 0 ? event.detail : null);
+    };
+
     window.addEventListener('model-loading', handleModelLoading);
+    window.addEventListener('queue-update', handleQueueUpdate);
 
     // 초기 체크 (즉시)
     checkServerStatus();
@@ -179,6 +146,7 @@ const ChatPage = () => {
 
     return () => {
       window.removeEventListener('model-loading', handleModelLoading);
+      window.removeEventListener('queue-update', handleQueueUpdate);
       clearInterval(interval);
     };
   }, []);
@@ -275,6 +243,7 @@ const ChatPage = () => {
     } finally {
       setIsLoading(false);
       setIsWaitingForFirstToken(false);
+      setQueueInfo(null);
       // 토큰 생성 완료 후 입력 필드로 포커스 이동
       setTimeout(() => {
         inputRef.current?.focus();
@@ -293,6 +262,7 @@ const ChatPage = () => {
     if (isLoading) return; // 로딩 중이면 초기화 불가
     setMessages([]);
     setInput('');
+    resetConversationTokenUsage();
     
     // Context 사용량 리셋
     try {
@@ -338,9 +308,19 @@ const ChatPage = () => {
                   <div key={index} className={`message ${msg.role}`}>
                     <div className="message-content">
                       {showLoading ? (
-                        <div className="loading-dots">
-                          <span>.</span><span>.</span><span>.</span>
-                        </div>
+                        <>
+                          <div className="loading-dots">
+                            <span>.</span><span>.</span><span>.</span>
+                          </div>
+                          {queueInfo && (
+                            <div className="queue-status">
+                              {queueInfo.position
+                                ? t('chat.queuePosition').replace('{position}', queueInfo.position)
+                                : t('chat.queueRetry')}
+                              {queueInfo.estimated_wait_ms > 0 && ` (~${Math.ceil(queueInfo.estimated_wait_ms / 1000)}s)`}
+                            </div>
+                          )}
+                        </>
                       ) : (
                         renderContent(msg.content)
                       )}
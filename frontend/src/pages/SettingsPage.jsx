@@ -234,6 +234,7 @@ const SettingsPage = () => {
       accelerator: 'auto',
       gpuLayers: -1,
       contextSize: 2048,
+      kvCacheType: 'auto',
       maxTokens: 600,
       temperature: 0.7,
       topK: 40,
@@ -384,7 +385,7 @@ const SettingsPage = () => {
   const getModelLabel = (m) => (m?.modelPath || m?.name || m?.id || '').trim();
   
   const descriptionKeys = [
-    "accelerator", "gpuLayers", "contextSize", "maxTokens", "temperature", 
+    "accelerator", "gpuLayers", "contextSize", "kvCacheType", "maxTokens", "temperature", 
     "topK", "topP", "minP", "tfsZ", "typicalP",
     "repeatPenalty", "repeatLastN", "presencePenalty", "frequencyPenalty", "penalizeNL",
     "dryMultiplier", "dryBase", "dryAllowedLength", "dryPenaltyLastN",
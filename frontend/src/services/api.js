@@ -1,3 +1,5 @@
+import { startTrace, nowUs } from './trace';
+
 export const LLAMA_BASE_URL = import.meta.env.VITE_LLAMACPP_BASE_URL || 'http://localhost:8080';
 
 // 모델 형식에 따라 적절한 포트 선택
@@ -66,8 +68,9 @@ const pushServerLog = (message, data) => {
   }
 };
 
-export const buildLlama3Prompt = (messages, language = 'ko') => {
-  // 언어별 시스템 프롬프트 설정
+// 언어별 시스템 프롬프트 설정
+// prompt-prefixes.json 의 chat-ko / chat-en 과 같은 텍스트여야 서버의 KV 스냅샷이 재사용됩니다
+export const getSystemPrompt = (language = 'ko') => {
   const systemPrompts = {
     ko: [
       "당신은 유용한 AI 어시스턴트 '뤼(Luu)'입니다.",
@@ -84,7 +87,12 @@ export const buildLlama3Prompt = (messages, language = 'ko') => {
     ].join(" ")
   };
   
-  const systemPrompt = systemPrompts[language] || systemPrompts['ko'];
+  return systemPrompts[language] || systemPrompts['ko'];
+};
+
+// context-window.js / mlx/context_window.py 의 llama3Segments 와 같은 형식이어야 합니다
+export const buildLlama3Prompt = (messages, language = 'ko') => {
+  const systemPrompt = getSystemPrompt(language);
   let prompt = `<|begin_of_text|><|start_header_id|>system<|end_header_id|>\n\n${systemPrompt}<|eot_id|>`;
 
   messages.forEach(message => {
@@ -96,8 +104,130 @@ export const buildLlama3Prompt = (messages, language = 'ko') => {
   return prompt;
 };
 
+// 마지막 요청에서 서버가 알려준 프롬프트 토큰 수 + 이후 스트리밍된 토큰 수
+// (대화가 바뀔 때마다 /tokenize 를 호출하지 않고 Context 사용량을 계산하기 위함)
+let conversationTokens = null;
+
+const estimateTokens = (text) => Math.ceil((text || '').length / 2.0);
+
+export const resetConversationTokenUsage = () => {
+  conversationTokens = null;
+};
+
+// 첫 스트림 이벤트 { prompt_tokens, context_size, truncated_turns, n_predict } 처리
+const applyPromptInfo = (info, messageCount) => {
+  conversationTokens = {
+    messageCount,
+    promptTokens: info.prompt_tokens,
+    completionTokens: 0,
+    contextSize: info.context_size,
+  };
+  pushServerLog('[API] Prompt tokens info', info);
+  if (info.truncated_turns > 0) {
+    pushServerLog('[API] Server dropped oldest turns to fit context', {
+      truncatedTurns: info.truncated_turns,
+      contextSize: info.context_size,
+    });
+  }
+  window.dispatchEvent(new CustomEvent('context-update', {
+    detail: { used: info.prompt_tokens, total: info.context_size }
+  }));
+};
+
+// 서버 오류 { n_prompt_tokens, n_ctx, type } → 컨텍스트 초과 메시지 (실제 토큰 수는 이벤트로 전달하여 UI 업데이트)
+const contextErrorMessage = (error, contextSize) => {
+  if (!error || !error.n_prompt_tokens) return null;
+  const actualTokens = error.n_prompt_tokens;
+  const total = error.n_ctx || contextSize;
+  window.dispatchEvent(new CustomEvent('context-update', {
+    detail: {
+      used: actualTokens,
+      total
+    }
+  }));
+  if (error.type !== 'exceed_context_size_error') return null;
+  return `프롬프트가 컨텍스트 크기(${total})를 초과합니다. (사용: ${actualTokens} 토큰) 대화를 초기화하거나 컨텍스트 크기를 늘려주세요.`;
+};
+
+// 관리자 라우터 대기열이 가득 찼을 때(429) 재시도
+const QUEUE_RETRY_LIMIT = 3;
+const QUEUE_RETRY_DEFAULT_SEC = 5;
+const QUEUE_RETRY_MAX_SEC = 30;
+
+const recordCompletionToken = (count = 1) => {
+  if (conversationTokens) conversationTokens.completionTokens += count;
+};
+
+// 토큰 스트림 프레이밍: 토큰을 STREAM_FRAME_INTERVAL_MS 마다 (또는 STREAM_FRAME_MAX_TOKENS 개씩) 묶어 받아
+// 렌더링 / JSON 파싱 횟수를 줄임. MLX WebSocket 은 binary 프레임, SSE 는 coalesced JSON
+// (stream_format 을 모르는 llama-server 는 무시하고 토큰마다 보냄)
+const STREAM_FRAME_INTERVAL_MS = 50;
+const STREAM_FRAME_MAX_TOKENS = 32;
+const BINARY_NO_TOKEN = 0xFFFFFFFF;
+const binaryTextDecoder = new TextDecoder();
+
+// binary 프레임 (mlx/stream_framing.py) → { ids, pieces, content, count }
+// u8 version | u8 flags | u16 n | u32 text_bytes | u32 id × n | u32 time_us × n | u16 text_bytes × n | UTF-8
+const decodeBinaryFrame = (buffer) => {
+  const view = new DataView(buffer);
+  const n = view.getUint16(2, true);
+  const textBytes = view.getUint32(4, true);
+  const lengthsOffset = 8 + n * 8;
+  let textOffset = lengthsOffset + n * 2;
+  const ids = [];
+  const pieces = [];
+  for (let i = 0; i < n; i++) {
+    const length = view.getUint16(lengthsOffset + i * 2, true);
+    const piece = binaryTextDecoder.decode(new Uint8Array(buffer, textOffset, length));
+    textOffset += length;
+    const id = view.getUint32(8 + i * 4, true);
+    if (id === BINARY_NO_TOKEN) {
+      // 디코더 flush 로 남은 텍스트: 앞 토큰의 piece 에 붙임
+      if (pieces.length > 0) pieces[pieces.length - 1] += piece;
+      continue;
+    }
+    ids.push(id);
+    pieces.push(piece);
+  }
+  const content = binaryTextDecoder.decode(new Uint8Array(buffer, lengthsOffset + n * 2, textBytes));
+  return { ids, pieces, content, count: ids.length };
+};
+
+// 스트림 이벤트에 실린 토큰 ID / piece 를 Token Debug 패널로 전달 (별도 /tokenize 호출 없음)
+// kind: 'start' (새 요청) | 'prompt' (프롬프트 전체) | 'response' (생성된 토큰 추가)
+const dispatchTokenDebug = (kind, ids = [], pieces = null, content = '') => {
+  if (kind !== 'start' && (!Array.isArray(ids) || ids.length === 0)) return;
+  // llama-server 는 토큰 ID 만 보내므로 청크의 content 를 첫 토큰의 piece 로 사용
+  const tokens = ids.map((id, i) => ({
+    id,
+    piece: Array.isArray(pieces) ? pieces[i] : (i === 0 ? content : ''),
+  }));
+  window.dispatchEvent(new CustomEvent('token-debug', { detail: { kind, tokens } }));
+};
+
+// 현재 대화의 Context 사용량 { used, total } (네트워크 호출 없음)
+// 서버가 센 값이 없거나 대화가 바뀐 뒤 추가된 메시지는 글자 수로 추정합니다
+export const getConversationTokenUsage = (messages, language = 'ko') => {
+  const config = JSON.parse(localStorage.getItem('modelConfig')) || {};
+  const total = conversationTokens?.contextSize || config.contextSize || 2048;
+  if (messages.length === 0) {
+    return { used: 0, total };
+  }
+  // 요청한 메시지 + 그에 대한 답변까지가 서버 집계 범위
+  if (conversationTokens && messages.length >= conversationTokens.messageCount) {
+    const extra = messages
+      .slice(conversationTokens.messageCount + 1)
+      .reduce((sum, message) => sum + estimateTokens(message.content) + 5, 0);
+    return { used: conversationTokens.promptTokens + conversationTokens.completionTokens + extra, total };
+  }
+  return { used: estimateTokens(buildLlama3Prompt(messages, language)), total };
+};
+
 export const sendChatMessage = async (messages, onToken, language = 'ko', showSpecialTokens = false) => {
+  // 요청 구간 기록 (trace_id 를 본문에 실어 서버 구간과 합침, 끝나면 'request-trace' 이벤트)
+  const trace = startTrace('chat');
   try {
+    const endBuild = trace.begin('build prompt');
     const prompt = buildLlama3Prompt(messages, language);
     const config = JSON.parse(localStorage.getItem('modelConfig')) || {};
     const contextSize = config.contextSize || 2048;
@@ -107,108 +237,122 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
     const modelFormat = getActiveModelFormat();
     const useWebSocket = modelFormat === 'mlx';
     
-    // 서버의 tokenize API를 사용하여 정확한 토큰 수 계산
-    const promptTokens = await countTokens(prompt);
-    const promptLength = prompt.length;
-    
-    // console.log(`[API] Prompt length: ${promptLength} chars, Actual tokens: ${promptTokens}, Context size: ${contextSize}`);
-    // console.log(`[API] Token ratio: ${(promptLength / promptTokens).toFixed(2)} chars/token`);
-    pushServerLog('[API] Prompt tokens info', {
-      promptLength,
-      promptTokens,
-      contextSize,
-      ratio: Number((promptLength / promptTokens).toFixed(2)),
-    });
-    
-    if (promptTokens > contextSize) {
-      // console.error(`[API] Error: Actual tokens (${promptTokens}) exceeds context size (${contextSize})`);
-      pushServerLog('[API][STOP-DEBUG] Prompt exceeds context size', {
-        promptTokens,
-        contextSize,
-      });
-      throw new Error(`프롬프트가 컨텍스트 크기(${contextSize})를 초과합니다. (사용: ${promptTokens} 토큰) 대화를 초기화하거나 컨텍스트 크기를 늘려주세요.`);
-    } else if (promptTokens > contextSize * 0.9) {
-      // console.warn(`[API] Warning: Actual tokens (${promptTokens}) is close to context size (${contextSize})`);
-      pushServerLog('[API][STOP-DEBUG] Prompt tokens close to context limit', {
-        promptTokens,
-        contextSize,
-      });
-    }
-    
-    // 동적 n_predict 계산: 설정값, 남은 컨텍스트, 프롬프트 길이를 모두 고려
-    const maxTokensConfig = config.maxTokens || 1024;
+    // 턴 목록을 그대로 보내면 서버(라우터 / MLX)가 토큰화하면서 컨텍스트를 맞추고
+    // (넘치면 오래된 턴부터 제거) 동적 n_predict 를 계산해 첫 이벤트로 토큰 수를 알려줍니다.
+    // prompt 는 messages 를 모르는 llama-server 에 직접 연결된 경우를 위한 대체값입니다.
+    const chatMessages = [{ role: 'system', content: getSystemPrompt(language) }, ...messages];
     // -1 또는 0이면 무제한 모드 (컨텍스트 한도 내)
-    let dynamicNPredict = maxTokensConfig;
-    
-    if (maxTokensConfig > 0) {
-      const remainingContext = Math.max(contextSize - promptTokens, 0);
-      // 프롬프트 토큰의 최대 4배까지만 생성하도록 제한 (불필요한 장문 방지)
-      const maxByPrompt = Math.max(promptTokens * 4, 64); // 너무 작아지지 않도록 최소 64
-      // 컨텍스트의 80%까지만 생성에 사용 (안전 마진)
-      const maxByContext = remainingContext > 0 ? Math.floor(remainingContext * 0.8) : maxTokensConfig;
-      dynamicNPredict = Math.min(maxTokensConfig, maxByPrompt, maxByContext);
-      // 최소 32 토큰은 허용
-      dynamicNPredict = Math.max(32, dynamicNPredict);
-      
-      // console.log(`[API] Dynamic n_predict: ${dynamicNPredict} (configMax=${maxTokensConfig}, remainingContext=${remainingContext}, maxByPrompt=${maxByPrompt}, maxByContext=${maxByContext})`);
-      pushServerLog('[API] Dynamic n_predict calculated', {
-        dynamicNPredict,
-        configMax: maxTokensConfig,
-        remainingContext,
-        maxByPrompt,
-        maxByContext,
-      });
-    } else {
-       // 무제한 모드 로그
-       // console.log(`[API] Unlimited generation mode (n_predict=${maxTokensConfig}) - STOP via EOS/Context only`);
-       pushServerLog('[API] Unlimited generation mode', {
-         configMax: maxTokensConfig,
-         contextSize,
-         note: 'Only stops at EOS or Context Limit'
-       });
-       dynamicNPredict = -1;
-    }
+    const maxTokensConfig = config.maxTokens || 1024;
+    const nPredict = maxTokensConfig > 0 ? maxTokensConfig : -1;
+    let promptInfo = null;
+    dispatchTokenDebug('start');
     
     const serverUrl = getActiveServerUrl();
+    trace.meta.backend = modelFormat;
+    endBuild({ chars: prompt.length, turns: chatMessages.length });
+    // 첫 토큰 / 스트림 구간 (sentUs: 요청을 보냈거나 응답 헤더를 받은 시각 — 단계가 겹치지 않게)
+    let sentUs = 0;
+    let firstTokenUs = 0;
+    let streamedTokens = 0;
+    const noteTokens = (count) => {
+      if (!firstTokenUs) {
+        firstTokenUs = nowUs();
+        trace.span('first token wait', sentUs, firstTokenUs);
+      }
+      streamedTokens += count;
+    };
+    // 화면 갱신 콜백 시간 (토큰마다 구간을 남기지 않고 합계만)
+    const renderToken = (token) => {
+      const started = performance.now();
+      onToken(token);
+      trace.total('onToken render', performance.now() - started);
+    };
+    const finishTrace = (status, report = null) => {
+      if (trace.finished) return;
+      if (firstTokenUs) trace.span('stream', firstTokenUs, nowUs(), { tokens: streamedTokens });
+      trace.server(report);
+      trace.finish(status);
+    };
     
     // MLX 모델은 WebSocket 사용
     if (useWebSocket && typeof WebSocket !== 'undefined') {
       return new Promise((resolve, reject) => {
         const wsUrl = serverUrl.replace('http://', 'ws://').replace('https://', 'wss://');
-        const ws = new WebSocket(`${wsUrl}/chat/ws`);
+        // trace_id 쿼리: 관리자가 승인 대기 구간을 같은 ID 로 기록 (첫 메시지의 trace_id 는 MLX 서버용)
+        const endConnect = trace.begin('websocket connect');
+        const ws = new WebSocket(`${wsUrl}/chat/ws?trace_id=${trace.id}`);
+        ws.binaryType = 'arraybuffer';
+        
+        // 프레임 하나에 묶여 온 토큰(count 개)을 화면에 한 번에 전달
+        const deliverTokens = (content, count) => {
+          let token = content;
+          // 스페셜 토큰 표시가 꺼져있으면 스페셜 토큰 제거
+          if (!showSpecialTokens) {
+            token = token.replace(/<\|[^>]*\|>/g, '');
+          }
+          recordCompletionToken(count);
+          noteTokens(count);
+          if (token) {
+            renderToken(token);
+            // token-received 이벤트 발생 (PerformancePanel에서 토큰 속도 계산용)
+            window.dispatchEvent(new CustomEvent('token-received', { detail: { count } }));
+          }
+        };
         
         ws.onopen = () => {
+          endConnect();
+          sentUs = nowUs();
           ws.send(JSON.stringify({
+            trace_id: trace.id,
             prompt: prompt,
-            max_tokens: dynamicNPredict > 0 ? dynamicNPredict : 2048,
+            messages: chatMessages,
+            context_size: contextSize,
+            context_overflow: 'truncate',
+            max_tokens: nPredict,
+            return_tokens: true,
             temperature: config.temperature ?? 0.7,
             top_p: config.topP || 0.95,
             min_p: config.minP || 0.05,
             repeat_penalty: config.repeatPenalty || 1.1,
             repeat_last_n: config.repeatLastN || 64,
+            stream_format: { mode: 'binary', interval_ms: STREAM_FRAME_INTERVAL_MS, max_tokens: STREAM_FRAME_MAX_TOKENS },
           }));
         };
         
         ws.onmessage = (event) => {
           try {
+            if (event.data instanceof ArrayBuffer) {
+              const decodeStart = performance.now();
+              const frame = decodeBinaryFrame(event.data);
+              trace.total('decode frames', performance.now() - decodeStart);
+              dispatchTokenDebug('response', frame.ids, frame.pieces, frame.content);
+              if (frame.content) deliverTokens(frame.content, frame.count);
+              return;
+            }
             const data = JSON.parse(event.data);
-            if (data.type === 'token' && data.content) {
-              let token = data.content;
-              // 스페셜 토큰 표시가 꺼져있으면 스페셜 토큰 제거
-              if (!showSpecialTokens) {
-                token = token.replace(/<\|[^>]*\|>/g, '');
-              }
-              if (token) {
-                onToken(token);
-                // token-received 이벤트 발생 (PerformancePanel에서 토큰 속도 계산용)
-                window.dispatchEvent(new CustomEvent('token-received'));
-                // 디버깅용
-                // console.log('[API] token-received event dispatched for token:', token.substring(0, 20));
-              }
+            if (data.type === 'stream_format') {
+              pushServerLog('[API] Stream format negotiated', data);
+            } else if (data.type === 'prompt') {
+              promptInfo = data;
+              if (data.context_size) applyPromptInfo(data, messages.length);
+              dispatchTokenDebug('prompt', data.tokens, data.pieces);
+            } else if ((data.type === 'token' || data.type === 'tokens') && data.tokens) {
+              dispatchTokenDebug('response', data.tokens, data.pieces, data.content);
+            }
+            if ((data.type === 'token' || data.type === 'tokens') && data.content) {
+              // tokens: coalesced 프레임 (n 개의 토큰)
+              deliverTokens(data.content, data.type === 'tokens' ? data.n || 1 : 1);
             } else if (data.type === 'done') {
+              finishTrace('ok', data.trace);
               ws.close();
               resolve();
             } else if (data.type === 'error') {
+              if (data.prompt_tokens) {
+                window.dispatchEvent(new CustomEvent('context-update', {
+                  detail: { used: data.prompt_tokens, total: data.context_size || contextSize }
+                }));
+              }
+              finishTrace('error');
               ws.close();
               reject(new Error(data.message || 'WebSocket error'));
             }
@@ -218,11 +362,13 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
         };
         
         ws.onerror = (error) => {
+          finishTrace('error');
           ws.close();
           reject(new Error('WebSocket connection error'));
         };
         
         ws.onclose = () => {
+          finishTrace('closed');
           resolve();
         };
       });
@@ -231,10 +377,14 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
     // GGUF 모델은 기존 HTTP POST + SSE 방식 사용
     // llama.cpp server uses snake_case for parameters
     const payload = {
+      trace_id: trace.id,
       model,
       prompt,
+      messages: chatMessages,
+      context_size: contextSize,
+      context_overflow: 'truncate',
       stream: true,
-      n_predict: dynamicNPredict,
+      n_predict: nPredict,
       temperature: config.temperature ?? 0.7,
       top_k: config.topK || 40,
       top_p: config.topP || 0.95,
@@ -253,19 +403,35 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
       mirostat_eta: config.mirostatEta || 0.1,
       // 스페셜 토큰 표시가 ON이면 stop 파라미터를 비워서 스페셜 토큰이 중단되지 않도록 함
       stop: showSpecialTokens ? [] : ["<|eot_id|>", "<|end_of_text|>", "<|start_header_id|>", "~HAPY~", "~~", "!!", "..", "ㅋㅋ", "ㅎㅎ", "\n\n"],
-      // 스페셜 토큰을 반환하도록 설정 (가능한 경우)
-      return_tokens: showSpecialTokens
+      // 토큰 ID 를 스트림에 함께 받음 (Token Debug 패널용, 라우터는 프롬프트 토큰/piece 도 첫 이벤트로 전달)
+      return_tokens: true,
+      // 토큰을 묶어서 받음 (MLX 서버만 지원, 프레임의 n = 묶인 토큰 수)
+      stream_format: { mode: 'coalesced', interval_ms: STREAM_FRAME_INTERVAL_MS, max_tokens: STREAM_FRAME_MAX_TOKENS }
     };
 
     // console.log('[API] Request Payload:', JSON.stringify(payload, null, 2)); // 디버그용 Payload 로그 추가
 
-    const response = await fetch(`${serverUrl}/completion`, {
-      method: 'POST',
-      headers: {
-        'Content-Type': 'application/json',
-      },
-      body: JSON.stringify(payload),
-    });
+    // 관리자 라우터의 대기열이 가득 차면 429: Retry-After 만큼 기다렸다가 다시 시도
+    let response;
+    for (let attempt = 0; ; attempt++) {
+      const endRequest = trace.begin('request headers', { attempt });
+      response = await fetch(`${serverUrl}/completion`, {
+        method: 'POST',
+        headers: {
+          'Content-Type': 'application/json',
+        },
+        body: JSON.stringify(payload),
+      });
+      endRequest({ status: response.status, cache: response.headers.get('X-Response-Cache') });
+      sentUs = nowUs();
+      if (response.status !== 429 || attempt >= QUEUE_RETRY_LIMIT) break;
+      const retryAfterSec = Math.min(QUEUE_RETRY_MAX_SEC, Number(response.headers.get('Retry-After')) || QUEUE_RETRY_DEFAULT_SEC);
+      pushServerLog('[API] Request queue full, retrying', { attempt: attempt + 1, retryAfterSec, error: await response.text() });
+      window.dispatchEvent(new CustomEvent('queue-update', { detail: { position: null, estimated_wait_ms: retryAfterSec * 1000 } }));
+      const endRetry = trace.begin('queue retry wait', { retryAfterSec });
+      await new Promise(resolve => setTimeout(resolve, retryAfterSec * 1000));
+      endRetry();
+    }
 
     if (!response.ok) {
       const errorText = await response.text();
@@ -278,31 +444,25 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
         errorText,
         requestPayloadBytes: JSON.stringify(payload).length,
         promptChars: prompt.length,
-        promptTokens,
       });
       
+      finishTrace(`http ${response.status}`);
+      
       // 503 에러 (모델 로딩 중) 감지
       if (response.status === 503) {
         window.dispatchEvent(new CustomEvent('model-loading', { detail: { loading: true } }));
       }
       
       // 에러 응답에서 실제 토큰 수 파싱 시도
+      let contextError = null;
       try {
-        const errorJson = JSON.parse(errorText);
-        if (errorJson.error && errorJson.error.n_prompt_tokens) {
-          const actualTokens = errorJson.error.n_prompt_tokens;
-          // console.error(`[API] Server reported actual tokens: ${actualTokens}`);
-          // 실제 토큰 수를 이벤트로 전달하여 UI 업데이트
-          window.dispatchEvent(new CustomEvent('context-update', {
-            detail: {
-              used: actualTokens,
-              total: contextSize
-            }
-          }));
-        }
+        contextError = contextErrorMessage(JSON.parse(errorText).error, contextSize);
       } catch (e) {
         // JSON 파싱 실패 시 무시
       }
+      if (contextError) {
+        throw new Error(contextError);
+      }
       
       throw new Error(`Server responded with status: ${response.status}. ${errorText}`);
     }
@@ -314,6 +474,7 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
     let tokenCount = 0;
     let stoppedByServer = false;
     let lastParsedChunk = null;
+    let streamError = null; // 스트림 안으로 온 오류 이벤트 (대기열 이벤트를 받은 뒤의 거절 등)
 
     while (true) {
       const { done, value } = await reader.read();
@@ -333,9 +494,34 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
           const jsonString = line.substring(6);
           if (jsonString) {
             try {
+              const parseStart = performance.now();
               const parsed = JSON.parse(jsonString);
+              trace.total('parse events', performance.now() - parseStart);
               lastParsedChunk = parsed;
+              // 관리자 라우터 대기열: 승인될 때까지 위치 / 예상 대기 시간 (position 0 = 승인됨)
+              if (parsed.queue) {
+                window.dispatchEvent(new CustomEvent('queue-update', { detail: parsed.queue }));
+                if (parsed.queue.position > 0) pushServerLog('[API] Waiting in request queue', parsed.queue);
+                continue;
+              }
+              if (parsed.error) {
+                streamError = parsed.error;
+                continue;
+              }
+              // 첫 이벤트: 서버가 센 프롬프트 토큰 수
+              if (!promptInfo && parsed.prompt_tokens !== undefined) {
+                promptInfo = parsed;
+                if (parsed.context_size) applyPromptInfo(parsed, messages.length);
+                dispatchTokenDebug('prompt', parsed.tokens, parsed.pieces);
+                continue;
+              }
+              if (parsed.tokens) {
+                dispatchTokenDebug('response', parsed.tokens, parsed.pieces, parsed.content);
+              }
               if (parsed.content) {
+                const count = parsed.n || 1;
+                recordCompletionToken(count);
+                noteTokens(count);
                 let token = parsed.content;
                 // 스페셜 토큰 표시가 꺼져있으면 스페셜 토큰 제거
                 if (!showSpecialTokens) {
@@ -345,18 +531,12 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
                 // 스페셜 토큰 표시가 ON이면 모든 스페셜 토큰을 그대로 전달
                 // 스페셜 토큰이 있으면 그대로 전달
                 if (token) {
-                  onToken(token);
-                  tokenCount++;
+                  renderToken(token);
+                  tokenCount += count;
                   // 토큰 수신 이벤트 발생 (Performance 패널에서 사용)
-                  window.dispatchEvent(new CustomEvent('token-received'));
+                  window.dispatchEvent(new CustomEvent('token-received', { detail: { count } }));
                 }
               }
-              // return_tokens가 true일 때 토큰 ID도 확인
-              if (showSpecialTokens && parsed.tokens && Array.isArray(parsed.tokens) && parsed.tokens.length > 0) {
-                // 토큰 ID가 있으면 이를 통해 스페셜 토큰을 확인할 수 있음
-                // 하지만 일반적으로 content에 이미 포함되어 있음
-              }
-
               // 서버가 시퀀스를 잘랐다고 보고하는 경우 (컨텍스트 초과 등)
               if (parsed.truncated) {
                 // console.warn('[API][STOP-DEBUG] Server reports truncated sequence:', parsed);
@@ -365,7 +545,7 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
                   stop: parsed.stop,
                   stop_reason: parsed.stop_reason ?? parsed.stop_type,
                   tokenCount,
-                  n_predict: payload.n_predict,
+                  n_predict: promptInfo?.n_predict ?? payload.n_predict,
                   contextSize,
                 });
               }
@@ -387,6 +567,8 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
                 // console.log('[API][STOP-DEBUG] Server sent stop signal:', stopInfo);
                 pushServerLog('[API][STOP-DEBUG] Server sent stop signal', stopInfo);
                 // console.log(`[API] Generation completed: ${tokenCount} tokens in ${duration}ms`);
+                // 서버 단계: MLX 는 trace 요약, llama-server 는 timings (prompt_ms / predicted_ms)
+                finishTrace('ok', parsed.trace || parsed.timings);
                 stoppedByServer = true;
                 return; // Stop processing further tokens
               }
@@ -396,6 +578,13 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
           }
         }
       }
+      if (streamError) {
+        finishTrace('error');
+        reader.cancel().catch(() => {});
+        pushServerLog('[API] Server error event', streamError);
+        throw new Error(contextErrorMessage(streamError, contextSize) ||
+          `Server responded with status: ${streamError.code}. ${streamError.message || ''}`);
+      }
     }
 
     // 스트림이 done으로 끝났는데 서버의 stop 플래그가 없었던 경우
@@ -412,9 +601,11 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
       };
       // console.warn('[API][STOP-DEBUG] Stream ended without explicit stop flag from server.', endInfo);
       pushServerLog('[API][STOP-DEBUG] Stream ended without explicit stop flag from server', endInfo);
+      finishTrace('no stop', lastParsedChunk?.timings);
     }
 
   } catch (error) {
+    trace.finish('error');
     console.error('채팅 스트림 오류:', error);
     throw error;
   }
@@ -422,16 +613,19 @@ export const sendChatMessage = async (messages, onToken, language = 'ko', showSp
 
 // 정확한 토큰 수 계산을 위한 함수
 export const countTokens = async (prompt) => {
+  const trace = startTrace('countTokens', { backend: getActiveModelFormat(), chars: prompt.length });
   try {
     const config = JSON.parse(localStorage.getItem('modelConfig')) || {};
     const model = (config.modelPath || '').trim();
     const serverUrl = getActiveServerUrl();
+    const endRequest = trace.begin('tokenize request');
     const response = await fetch(`${serverUrl}/tokenize`, {
       method: 'POST',
       headers: {
         'Content-Type': 'application/json',
       },
       body: JSON.stringify({
+        trace_id: trace.id,
         model,
         content: prompt,
         add_special: false,
@@ -442,10 +636,15 @@ export const countTokens = async (prompt) => {
 
     if (!response.ok) {
       // tokenize API가 실패하면 추정값 사용 (조용히 처리)
+      endRequest({ status: response.status });
+      trace.finish(`http ${response.status}`);
       return Math.ceil(prompt.length / 2.0);
     }
 
     const data = await response.json();
+    endRequest({ status: response.status });
+    trace.server(data.trace);
+    trace.finish();
     if (data.tokens && Array.isArray(data.tokens)) {
       return data.tokens.length;
     }
@@ -453,6 +652,7 @@ export const countTokens = async (prompt) => {
     // 응답 형식이 다를 경우 추정값 사용
     return Math.ceil(prompt.length / 2.0);
   } catch (error) {
+    trace.finish('error');
     // API 호출 실패 시 보수적인 추정값 사용 (조용히 처리)
     // AbortError나 네트워크 에러는 로그 출력 안 함
     if (error.name !== 'AbortError' && !error.message.includes('Failed to fetch')) {
@@ -464,10 +664,18 @@ export const countTokens = async (prompt) => {
 
 // 토큰 디버깅용 함수: 토큰 ID 및 piece 반환
 export const tokenizeText = async (content) => {
+  const result = await tokenizeIncremental(content);
+  return result.tokens;
+};
+
+// 이전 결과 { tokens, cursor } 를 넘기면 서버(MLX)는 같은 앞부분을 생략하고 start 부터만 돌려주며,
+// 여기서 이전 토큰과 합쳐 전체 목록을 반환합니다. cursor 를 모르는 서버는 항상 전체를 돌려줍니다.
+export const tokenizeIncremental = async (content, previous = null) => {
+  let trace = null;
   try {
     if (!content || content.trim() === '') {
       console.warn('[API] tokenizeText: Empty content');
-      return [];
+      return { tokens: [], cursor: null };
     }
     
     const config = JSON.parse(localStorage.getItem('modelConfig')) || {};
@@ -476,37 +684,50 @@ export const tokenizeText = async (content) => {
     
     // console.log('[API] tokenizeText: Calling', `${serverUrl}/tokenize`, 'with content length:', content.length);
     
+    trace = startTrace('tokenize', { backend: getActiveModelFormat(), chars: content.length, incremental: Boolean(previous?.cursor) });
+    const endRequest = trace.begin('tokenize request');
     const response = await fetch(`${serverUrl}/tokenize`, {
       method: 'POST',
       headers: {
         'Content-Type': 'application/json',
       },
       body: JSON.stringify({
+        trace_id: trace.id,
         model,
         content,
         add_special: true,
         parse_special: true,
         with_pieces: true,
+        cursor: previous?.cursor || undefined,
       }),
     });
 
     if (!response.ok) {
       const errorText = await response.text();
+      endRequest({ status: response.status });
+      trace.finish(`http ${response.status}`);
       console.warn('[API] Tokenize API (with_pieces) failed:', response.status, errorText);
-      return [];
+      return { tokens: [], cursor: null };
     }
 
     const data = await response.json();
+    endRequest({ status: response.status, start: data.start });
+    trace.server(data.trace);
+    trace.finish();
     // console.log('[API] tokenizeText: Response received:', data.tokens?.length || 0, 'tokens', 'data:', data);
     if (data.tokens && Array.isArray(data.tokens)) {
-      return data.tokens;
+      const tokens = data.start > 0 && previous?.tokens
+        ? [...previous.tokens.slice(0, data.start), ...data.tokens]
+        : data.tokens;
+      return { tokens, cursor: data.cursor || null };
     }
 
     console.warn('[API] Unexpected tokenize (with_pieces) response format:', data);
-    return [];
+    return { tokens: [], cursor: null };
   } catch (error) {
+    if (trace) trace.finish('error');
     console.warn('[API] Tokenize (with_pieces) error:', error);
-    return [];
+    return { tokens: [], cursor: null };
   }
 };
 
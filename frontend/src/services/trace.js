@@ -0,0 +1,140 @@
+// 요청 단위 구간(span) 기록 (api.js)
+// 요청마다 trace_id 를 본문에 붙여 보내면 관리자(span-tracer.js)와 MLX 서버(request_trace.py)가 같은 ID 로
+// 구간을 남기고, 관리자의 /api/traces/<id> 가 여기 구간까지 합쳐 Chrome trace JSON 으로 내보냅니다.
+// 시각은 epoch 마이크로초 (performance.timeOrigin 기준이라 같은 호스트의 서버 시각과 맞음).
+//
+// 끝난 요청은 'request-trace' 이벤트로 PerformancePanel 에 전달됩니다:
+//   { id, kind, backend, startedAt, durationMs, stages: [{ name, ms }], server: [{ name, ms }] }
+//   stages 는 프론트엔드에서 본 순차 구간, server 는 서버가 보고한 단계별 합계 (MLX trace / llama-server timings)
+const MAX_RECENT_TRACES = 50;
+const MAX_SPANS = 512;
+// 다른 구간을 감싸는 전체 구간 (단계 막대에서 제외)
+const ENVELOPE_STAGES = new Set(['generate', 'request']);
+
+const recentTraces = [];
+
+export const nowUs = () => Math.round((performance.timeOrigin + performance.now()) * 1000);
+
+const newTraceId = () => (typeof crypto !== 'undefined' && crypto.randomUUID)
+  ? crypto.randomUUID().replace(/-/g, '').slice(0, 16)
+  : `${Date.now().toString(36)}${Math.random().toString(36).slice(2, 10)}`;
+
+const round = (ms) => Math.round(ms * 100) / 100;
+
+// 요청 하나의 trace: begin(name) → 끝낼 때 부르는 함수, total(name, ms) 은 구간 없이 합계만 (토큰 콜백 시간 등)
+export const startTrace = (kind, meta = {}) => {
+  const trace = {
+    id: newTraceId(),
+    kind,
+    meta,
+    startedUs: nowUs(),
+    endedUs: null,
+    spans: [],
+    stages: new Map(), // 이름 → ms (순서 = 처음 기록한 순서)
+    totals: new Map(),
+    server: null,
+  };
+  const addStage = (target, name, ms) => target.set(name, (target.get(name) || 0) + ms);
+
+  const span = (name, startUs, endUs, args = {}) => {
+    const dur = Math.max(0, endUs - startUs);
+    addStage(trace.stages, name, dur / 1000);
+    if (trace.spans.length < MAX_SPANS) trace.spans.push({ name, ts: startUs, dur, args });
+  };
+
+  return {
+    id: trace.id,
+    meta: trace.meta,
+    span,
+    begin(name, args = {}) {
+      const startUs = nowUs();
+      return (extra = {}) => span(name, startUs, nowUs(), { ...args, ...extra });
+    },
+    total(name, ms) {
+      addStage(trace.totals, name, ms);
+    },
+    // 서버가 보고한 단계별 합계: MLX 의 trace 요약 또는 llama-server 의 timings
+    server(report) {
+      if (!report) return;
+      if (report.prompt_ms !== undefined || report.predicted_ms !== undefined) {
+        trace.server = { prefill: Number(report.prompt_ms) || 0, decode: Number(report.predicted_ms) || 0 };
+      } else {
+        trace.server = { ...report };
+      }
+    },
+    get finished() {
+      return trace.endedUs !== null;
+    },
+    finish(status = 'ok') {
+      if (trace.endedUs) return;
+      trace.endedUs = nowUs();
+      trace.status = status;
+      // 전체 구간 (합계로만 센 단계는 args 로)
+      trace.spans.push({
+        name: trace.kind, ts: trace.startedUs, dur: trace.endedUs - trace.startedUs,
+        args: { ...trace.meta, status, ...Object.fromEntries([...trace.totals].map(([name, ms]) => [`${name} ms`, round(ms)])) },
+      });
+      recentTraces.push(trace);
+      if (recentTraces.length > MAX_RECENT_TRACES) recentTraces.shift();
+      window.dispatchEvent(new CustomEvent('request-trace', { detail: summarize(trace) }));
+    },
+  };
+};
+
+const summarize = (trace) => ({
+  id: trace.id,
+  kind: trace.kind,
+  ...trace.meta,
+  status: trace.status,
+  startedAt: Math.round(trace.startedUs / 1000),
+  durationMs: round((trace.endedUs - trace.startedUs) / 1000),
+  stages: [...trace.stages].map(([name, ms]) => ({ name, ms: round(ms) })),
+  totals: [...trace.totals].map(([name, ms]) => ({ name, ms: round(ms) })),
+  server: Object.entries(trace.server || {})
+    .filter(([name]) => !ENVELOPE_STAGES.has(name))
+    .map(([name, ms]) => ({ name, ms: round(Number(ms) || 0) })),
+});
+
+export const getRecentTraces = () => recentTraces.map(summarize).reverse();
+
+// 관리자 없이 (llama-server / MLX 서버 직접 연결) 내보낼 때: 프론트엔드 구간 + 서버 요약만
+const localChromeTrace = (trace) => ({
+  traceEvents: [
+    { name: 'process_name', ph: 'M', pid: 1, tid: 1, args: { name: 'Frontend (api.js)' } },
+    ...trace.spans.map(s => ({ name: s.name, cat: 'frontend', ph: 'X', ts: s.ts, dur: s.dur, pid: 1, tid: 1, args: s.args })),
+  ],
+  displayTimeUnit: 'ms',
+  metadata: { trace_id: trace.id, summary: summarize(trace) },
+});
+
+// Chrome trace JSON: 관리자(managerUrl)가 있으면 서버 구간과 GPU 사용률까지 합친 것, 없으면 프론트엔드 구간만
+export const exportChromeTrace = async (id, managerUrl) => {
+  const trace = recentTraces.find(t => t.id === id);
+  if (!trace) return null;
+  const spans = trace.spans.map(s => ({ ...s, args: { ...s.args, kind: trace.kind } }));
+  try {
+    const response = await fetch(`${managerUrl}/api/traces/${encodeURIComponent(id)}`, {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/json' },
+      body: JSON.stringify({ spans }),
+      signal: AbortSignal.timeout(5000),
+    });
+    if (response.ok) return await response.json();
+  } catch (error) {
+    // 관리자가 없는 구성: 로컬 구간만 내보냄
+  }
+  return localChromeTrace(trace);
+};
+
+// 브라우저 다운로드로 저장 (chrome://tracing 또는 ui.perfetto.dev 에서 열기)
+export const downloadChromeTrace = async (id, managerUrl) => {
+  const exported = await exportChromeTrace(id, managerUrl);
+  if (!exported) return false;
+  const blob = new Blob([JSON.stringify(exported)], { type: 'application/json' });
+  const link = document.createElement('a');
+  link.href = URL.createObjectURL(blob);
+  link.download = `trace-${id}.json`;
+  link.click();
+  setTimeout(() => URL.revokeObjectURL(link.href), 1000);
+  return true;
+};
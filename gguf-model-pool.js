@@ -0,0 +1,288 @@
+// GGUF 모델 풀: 여러 llama-server 프로세스를 통합 메모리 예산 안에서 상주시키고
+// 가장 오래 사용되지 않은 모델부터 내립니다.
+//
+// 각 모델은 basePort 부터 할당되는 내부 포트에서 실행되고, start-client-server.js 의
+// 라우터(8080)가 요청의 model 값으로 이미 떠 있는 프로세스를 골라 전달합니다.
+// 메모리 사용량은 native addon 의 프로세스 footprint(Metal 할당 포함)로 측정하고,
+// 측정 전에는 실행 계획(gguf-planner.js)의 추정치, 계획이 없으면 모델 파일 크기로 추정합니다.
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { waitForHealthy } = require('./kv-snapshot');
+
+let nativeAddon = null;
+try {
+  nativeAddon = require('./native');
+} catch (error) {
+  // 빌드되지 않은 환경: 메모리 측정 없이 추정값만 사용
+}
+
+const MODEL_OVERHEAD_BYTES = 512 * 1024 * 1024; // 컨텍스트/컴퓨트 버퍼 여유분 (추정)
+
+// 통합 메모리 중 모델들이 쓸 수 있는 양 (recommendedMaxWorkingSetSize 기준)
+function defaultMemoryBudget() {
+  if (process.env.MODEL_POOL_MEMORY_MB) {
+    return Number(process.env.MODEL_POOL_MEMORY_MB) * 1024 * 1024;
+  }
+  if (nativeAddon) {
+    const vram = nativeAddon.getVRAMInfo();
+    if (vram && vram.total > 0) return vram.total * 0.9;
+  }
+  return os.totalmem() * 0.7;
+}
+
+class GgufModelPool {
+  constructor({ spawnServer, planModel = null, maxModels = 2, memoryBudgetBytes = defaultMemoryBudget(), basePort = 8090, log = console.log }) {
+    this.spawnServer = spawnServer; // (modelConfig, port, plan) => { process, absoluteModelPath, draftStats } | null
+    this.planModel = planModel; // async (modelConfig, budgetBytes) => plan ({ ok, estimate: { totalBytes } })
+    this.maxModels = Math.max(1, maxModels);
+    this.memoryBudgetBytes = memoryBudgetBytes;
+    this.basePort = basePort;
+    this.log = log;
+    this.entries = new Map(); // model id -> entry
+    this.starting = new Map(); // model id -> Promise<entry>
+    this.evictions = 0;
+  }
+
+  // 요청의 model 값(id, modelPath, 파일 이름)으로 상주 중인 엔트리 찾기
+  findEntry(modelKey) {
+    if (!modelKey) return null;
+    for (const entry of this.entries.values()) {
+      if (matchesModel(entry.modelConfig, modelKey)) return entry;
+    }
+    return null;
+  }
+
+  // 가장 최근에 사용된 준비 완료 엔트리 (model 이 지정되지 않은 요청용)
+  mostRecentEntry() {
+    let best = null;
+    for (const entry of this.entries.values()) {
+      if (entry.ready && (!best || entry.lastUsed > best.lastUsed)) best = entry;
+    }
+    return best;
+  }
+
+  // 모델이 준비된 엔트리 반환 (필요하면 다른 모델을 내리고 새로 띄움)
+  async acquire(modelConfig) {
+    const existing = this.entries.get(modelConfig.id);
+    if (existing) {
+      existing.lastUsed = Date.now();
+      await existing.readyPromise;
+      if (!existing.ready) throw new Error(`Model ${modelConfig.id} failed to start`);
+      return existing;
+    }
+    if (!this.starting.has(modelConfig.id)) {
+      const promise = this.start(modelConfig).finally(() => this.starting.delete(modelConfig.id));
+      this.starting.set(modelConfig.id, promise);
+    }
+    return this.starting.get(modelConfig.id);
+  }
+
+  async start(modelConfig) {
+    // 새 모델에 줄 예산: 남은 메모리, 단 최소한 풀 크기로 나눈 몫 (모자라면 LRU 모델을 내림)
+    let plan = null;
+    if (this.planModel) {
+      this.refreshMemory();
+      const budgetBytes = Math.max(this.memoryBudgetBytes - this.memoryUsed(), this.memoryBudgetBytes / this.maxModels);
+      plan = await this.planModel(modelConfig, budgetBytes);
+    }
+    const estimatedBytes = plan && plan.ok ? plan.estimate.totalBytes : estimateModelBytes(modelConfig);
+    await this.makeRoom(estimatedBytes);
+
+    const port = this.allocatePort();
+    const spawned = this.spawnServer(modelConfig, port, plan && plan.ok ? plan : null);
+    if (!spawned || !spawned.process) {
+      throw new Error(`Failed to spawn llama-server for ${modelConfig.id}`);
+    }
+
+    const entry = {
+      id: modelConfig.id,
+      modelConfig,
+      port,
+      process: spawned.process,
+      absoluteModelPath: spawned.absoluteModelPath,
+      draftStats: spawned.draftStats || null,
+      estimatedBytes,
+      plan: plan && plan.ok ? plan : null,
+      measuredBytes: 0,
+      lastUsed: Date.now(),
+      inFlight: 0,
+      ready: false,
+      startedAt: Date.now(),
+      readyPromise: null
+    };
+    this.entries.set(entry.id, entry);
+
+    spawned.process.once('close', () => {
+      if (this.entries.get(entry.id) === entry) {
+        this.entries.delete(entry.id);
+        this.log(`[Model Pool] ${entry.id} exited (port ${entry.port})`);
+      }
+    });
+
+    entry.readyPromise = waitForHealthy(port, () => this.entries.get(entry.id) === entry).then((healthy) => {
+      entry.ready = healthy;
+      if (healthy) {
+        this.log(`[Model Pool] ✅ ${entry.id} ready on port ${port} in ${((Date.now() - entry.startedAt) / 1000).toFixed(1)}s`);
+        this.refreshMemory();
+      }
+    });
+    await entry.readyPromise;
+    if (!entry.ready) {
+      await this.evict(entry);
+      throw new Error(`Model ${modelConfig.id} did not become healthy`);
+    }
+    return entry;
+  }
+
+  allocatePort() {
+    const used = new Set([...this.entries.values()].map(e => e.port));
+    let port = this.basePort;
+    while (used.has(port)) port++;
+    return port;
+  }
+
+  // phys_footprint 는 mmap 된 GGUF 가중치(파일 매핑)를 빼고 세므로 계획 추정치보다 작게 잡지 않음
+  static entryBytes(entry) {
+    return Math.max(entry.measuredBytes || 0, entry.estimatedBytes);
+  }
+
+  memoryUsed() {
+    let total = 0;
+    for (const entry of this.entries.values()) {
+      total += GgufModelPool.entryBytes(entry);
+    }
+    return total;
+  }
+
+  // 프로세스별 phys_footprint (Apple Silicon 에서는 Metal 버퍼 포함, 파일 매핑 가중치 제외) 갱신
+  refreshMemory() {
+    if (!nativeAddon || !nativeAddon.getSystemCounters) return;
+    const pids = [...this.entries.values()].map(e => e.process.pid).filter(Boolean);
+    if (pids.length === 0) return;
+    const counters = nativeAddon.getSystemCounters(pids, 'model-pool');
+    if (!counters || !counters.processes) return;
+    for (const proc of counters.processes) {
+      const entry = [...this.entries.values()].find(e => e.process.pid === proc.pid);
+      if (entry && proc.footprintBytes > 0) entry.measuredBytes = proc.footprintBytes;
+    }
+  }
+
+  // 새 모델이 들어갈 자리가 생길 때까지 LRU 순서로 유휴 모델을 내림
+  async makeRoom(requiredBytes) {
+    this.refreshMemory();
+    while (this.entries.size > 0 &&
+           (this.entries.size >= this.maxModels || this.memoryUsed() + requiredBytes > this.memoryBudgetBytes)) {
+      const victim = [...this.entries.values()]
+        .filter(e => e.ready && e.inFlight === 0)
+        .sort((a, b) => a.lastUsed - b.lastUsed)[0];
+      if (!victim) {
+        this.log(`[Model Pool] ⚠️  No idle model to evict, starting over budget`);
+        break;
+      }
+      this.log(`[Model Pool] Evicting least recently used model ${victim.id} (${formatBytes(GgufModelPool.entryBytes(victim))})`);
+      this.evictions++;
+      await this.evict(victim);
+    }
+  }
+
+  // 메모리 압력: 최근에 사용한 keep 개를 남기고 나머지 유휴 모델을 내림 (내린 모델 id 목록 반환)
+  async shed(keep = 1) {
+    const victims = [...this.entries.values()]
+      .sort((a, b) => b.lastUsed - a.lastUsed)
+      .slice(keep)
+      .filter(e => e.ready && e.inFlight === 0);
+    for (const victim of victims) {
+      this.log(`[Model Pool] Memory pressure: evicting idle model ${victim.id} (${formatBytes(GgufModelPool.entryBytes(victim))})`);
+      this.evictions++;
+      await this.evict(victim);
+    }
+    return victims.map(v => v.id);
+  }
+
+  evict(entry) {
+    this.entries.delete(entry.id);
+    return stopProcess(entry.process);
+  }
+
+  stopAll() {
+    const entries = [...this.entries.values()];
+    this.entries.clear();
+    return Promise.all(entries.map(e => stopProcess(e.process)));
+  }
+
+  stats() {
+    this.refreshMemory();
+    return {
+      maxModels: this.maxModels,
+      memoryBudgetBytes: this.memoryBudgetBytes,
+      memoryUsedBytes: this.memoryUsed(),
+      evictions: this.evictions,
+      models: [...this.entries.values()].map(e => ({
+        id: e.id,
+        port: e.port,
+        pid: e.process.pid,
+        ready: e.ready,
+        inFlight: e.inFlight,
+        lastUsed: e.lastUsed,
+        memoryBytes: GgufModelPool.entryBytes(e),
+        measured: e.measuredBytes > 0,
+        plan: e.plan ? { gpuLayers: e.plan.gpuLayers, contextSize: e.plan.contextSize, cacheType: e.plan.cacheType, kvCacheBytes: e.plan.kvCache.bytes, reason: e.plan.reason } : null,
+        speculative: e.draftStats ? e.draftStats.toJSON() : null
+      }))
+    };
+  }
+}
+
+function matchesModel(modelConfig, modelKey) {
+  if (!modelConfig || !modelKey) return false;
+  const key = String(modelKey).trim();
+  const modelPath = modelConfig.modelPath || '';
+  return key === modelConfig.id ||
+    key === modelPath ||
+    key === path.basename(modelPath) ||
+    key.replace(/\.gguf$/, '') === path.basename(modelPath).replace(/\.gguf$/, '');
+}
+
+function estimateModelBytes(modelConfig) {
+  const candidates = [modelConfig.modelPath, `${modelConfig.modelPath}.gguf`]
+    .map(p => (p && !path.isAbsolute(p) ? path.resolve(__dirname, 'llama.cpp', 'models', p) : p));
+  for (const candidate of candidates) {
+    try {
+      if (candidate && fs.existsSync(candidate)) {
+        return fs.statSync(candidate).size + MODEL_OVERHEAD_BYTES;
+      }
+    } catch (error) {
+      // 다음 후보 확인
+    }
+  }
+  return MODEL_OVERHEAD_BYTES;
+}
+
+function stopProcess(child) {
+  return new Promise((resolve) => {
+    if (!child || child.exitCode !== null || child.killed) {
+      resolve();
+      return;
+    }
+    const timeout = setTimeout(() => {
+      try {
+        child.kill('SIGKILL');
+      } catch (error) {
+        // 이미 종료됨
+      }
+      resolve();
+    }, 3000);
+    child.once('exit', () => {
+      clearTimeout(timeout);
+      resolve();
+    });
+    child.kill('SIGTERM');
+  });
+}
+
+function formatBytes(bytes) {
+  return `${(bytes / 1024 / 1024 / 1024).toFixed(2)} GB`;
+}
+
+module.exports = { GgufModelPool, matchesModel };
@@ -0,0 +1,349 @@
+// GGUF 실행 계획: 통합 메모리 예산 안에 들어가는 최대 -ngl / -c 와 KV 캐시 타입 선택
+//
+// 1. native addon 으로 GGUF 텐서 테이블과 메타데이터를 읽어 레이어별 가중치 크기를 합산
+// 2. n_layer / n_head_kv / head_dim 으로 토큰당 KV 캐시 크기를 계산
+// 3. Metal recommendedMaxWorkingSetSize(getVRAMInfo().total) 기반 예산과 비교해
+//    전체 오프로드 → 컨텍스트 축소 → KV 양자화 → 부분 오프로드 순으로 맞춥니다.
+//
+// 모델 설정 해석:
+// - gpuLayers: -1 / 'auto' 면 계획값 사용, 0 이상 숫자면 그대로 고정
+// - contextSize: 'auto' / 0 이면 모델 학습 컨텍스트까지 최대화, 숫자면 고정
+// - kvCacheType: 'auto'(기본) 이면 f16 → q8_0 → q4_0 순으로 시도, 그 외 값은 고정 (kv-cache-type.js)
+// - autoFit: false 면 계획 없이 설정값 그대로 실행
+// - performance.ubatchSize: compute 버퍼 추정에 반영 (perf-profile.js, 나머지 성능 인자는 호출하는 쪽에서 추가)
+// - draftModel: 추측 디코딩용 draft 모델의 가중치/KV 도 같은 예산에서 함께 계산 (speculative.js)
+const fs = require('fs');
+const path = require('path');
+const speculative = require('./speculative');
+const perfProfile = require('./perf-profile');
+const { KV_TYPE_BYTES, kvCacheType: resolveKvCacheType, ggufKvArgs, describeKvCache } = require('./kv-cache-type');
+
+let nativeAddon = null;
+try {
+  nativeAddon = require('./native');
+} catch (error) {
+  // 빌드되지 않은 환경: 계획 없이 설정값 사용
+}
+
+const WORKING_SET_HEADROOM = 0.9; // recommendedMaxWorkingSetSize 중 사용할 비율
+const BASE_OVERHEAD_BYTES = 256 * 1024 * 1024; // Metal 컨텍스트, 디바이스 버퍼 등
+const UBATCH_SIZE = 512; // llama-server 기본 --ubatch-size (성능 프로필의 ubatchSize 가 있으면 그 값)
+const MIN_AUTO_CONTEXT = 2048;
+const MAX_AUTO_CONTEXT = Number(process.env.GGUF_MAX_AUTO_CONTEXT) || 32768;
+
+const AUTO_KV_TYPES = ['f16', 'q8_0'];
+const LAST_RESORT_KV_TYPE = 'q4_0';
+
+function defaultBudgetBytes() {
+  if (nativeAddon) {
+    const vram = nativeAddon.getVRAMInfo();
+    if (vram && vram.total > 0) return vram.total * WORKING_SET_HEADROOM;
+  }
+  return 0;
+}
+
+// 상대 경로는 llama.cpp/models 기준, .gguf 확장자 유무 모두 확인
+function resolveModelFile(modelPath, modelsDir = path.join(__dirname, 'llama.cpp', 'models')) {
+  if (!modelPath) return null;
+  const base = path.isAbsolute(modelPath) ? modelPath : path.resolve(modelsDir, modelPath);
+  for (const candidate of [base, `${base}.gguf`]) {
+    try {
+      if (fs.statSync(candidate).isFile()) return candidate;
+    } catch (error) {
+      // 다음 후보 확인
+    }
+  }
+  return null;
+}
+
+// 텐서 테이블 + 메타데이터 → 계획에 필요한 모델 요약
+function summarizeModel(info) {
+  const metadata = info.metadata || {};
+  const arch = metadata['general.architecture'] || 'llama';
+  const meta = (key) => metadata[`${arch}.${key}`];
+
+  const layerBytes = [];
+  const kvWidth = []; // 레이어별 [n_embd_k_gqa, n_embd_v_gqa] (attention 이 없는 레이어는 없음)
+  let outputBytes = 0;
+  let tokenEmbdBytes = 0;
+  let nVocab = 0;
+  let cpuOnlyBytes = 0;
+
+  for (const tensor of info.tensors || []) {
+    const match = /^blk\.(\d+)\.(.+)$/.exec(tensor.name);
+    if (match) {
+      const layer = Number(match[1]);
+      layerBytes[layer] = (layerBytes[layer] || 0) + tensor.size;
+      // attn_k.weight: ne = [n_embd, n_head_kv * head_dim_k]
+      if (match[2] === 'attn_k.weight' && tensor.ne.length >= 2) {
+        kvWidth[layer] = [tensor.ne[1], (kvWidth[layer] || [])[1] || tensor.ne[1]];
+      } else if (match[2] === 'attn_v.weight' && tensor.ne.length >= 2) {
+        kvWidth[layer] = [(kvWidth[layer] || [])[0] || tensor.ne[1], tensor.ne[1]];
+      }
+    } else if (tensor.name === 'output.weight' || tensor.name === 'output_norm.weight') {
+      outputBytes += tensor.size;
+    } else if (tensor.name === 'token_embd.weight') {
+      tokenEmbdBytes = tensor.size;
+      nVocab = tensor.ne[1] || 0;
+    } else {
+      cpuOnlyBytes += tensor.size;
+    }
+  }
+  // 임베딩을 공유하는 모델은 llama.cpp 가 token_embd 를 output 으로 복제해 올림
+  if (!(info.tensors || []).some(t => t.name === 'output.weight')) outputBytes += tokenEmbdBytes;
+
+  const nLayer = meta('block_count') || layerBytes.length;
+  const nHead = meta('attention.head_count') || 0;
+  const nHeadKv = meta('attention.head_count_kv') || nHead;
+  const nEmbd = meta('embedding_length') || 0;
+  const headDimK = meta('attention.key_length') || (nHead > 0 ? nEmbd / nHead : 0);
+  const headDimV = meta('attention.value_length') || headDimK;
+  // 메타데이터 값이 있으면 우선, 없으면 attn_k/attn_v 텐서 shape 사용
+  const kvLayers = [];
+  for (let i = 0; i < nLayer; i++) {
+    if (!kvWidth[i]) continue;
+    kvLayers[i] = nHeadKv > 0 && headDimK > 0
+      ? [nHeadKv * headDimK, nHeadKv * headDimV]
+      : kvWidth[i];
+  }
+
+  return {
+    arch,
+    nLayer,
+    nHead,
+    nHeadKv,
+    nEmbd,
+    nVocab,
+    headDimK,
+    headDimV,
+    nCtxTrain: meta('context_length') || 0,
+    layerBytes: Array.from({ length: nLayer }, (_, i) => layerBytes[i] || 0),
+    kvLayers,
+    outputBytes,
+    cpuBytes: tokenEmbdBytes + cpuOnlyBytes,
+    fileSize: info.fileSize || 0
+  };
+}
+
+function kvBytesPerToken(model, layers, typeK, typeV) {
+  let total = 0;
+  for (const layer of layers) {
+    const width = model.kvLayers[layer];
+    if (width) total += width[0] * KV_TYPE_BYTES[typeK] + width[1] * KV_TYPE_BYTES[typeV];
+  }
+  return total;
+}
+
+// Metal 컴퓨트 버퍼 추정: logits + attention 스크래치 (flash attention 이 없으면 KQ 행렬 전체)
+function computeBytes(model, contextSize, flashAttn) {
+  const ubatch = model.ubatchSize || UBATCH_SIZE;
+  const logits = ubatch * model.nVocab * 4;
+  const attention = flashAttn
+    ? ubatch * model.nEmbd * 4 * 8
+    : contextSize * ubatch * Math.max(1, model.nHead) * 4;
+  return BASE_OVERHEAD_BYTES + logits + attention;
+}
+
+// 실행 시 실제로 쓰일 flash attention: 성능 프로필의 flashAttn (on/off) 을 따르고, 'auto' 나 미설정이면
+// 캐시 타입으로 판단 (f16 → off 로 크게 잡음). 양자화된 V 캐시는 ggufKvArgs 가 --flash-attn on 을 넣어
+// 프로필의 off 보다 우선하므로 항상 on.
+function resolveFlashAttn(setting, cacheType) {
+  if (cacheType !== 'f16') return true;
+  if (setting === true || setting === 'on') return true;
+  if (setting === false || setting === 'off') return false;
+  return false;
+}
+
+// ngl 개 레이어를 올렸을 때 GPU 쪽 메모리 (llama.cpp 는 뒤쪽 레이어부터 오프로드, n_layer 초과분은 output)
+function estimate(model, gpuLayers, contextSize, cacheType, flashAttnSetting = null) {
+  const nOffloaded = Math.min(gpuLayers, model.nLayer);
+  const gpuLayerIds = [];
+  for (let i = model.nLayer - nOffloaded; i < model.nLayer; i++) gpuLayerIds.push(i);
+  const cpuLayerIds = [];
+  for (let i = 0; i < model.nLayer - nOffloaded; i++) cpuLayerIds.push(i);
+
+  const flashAttn = resolveFlashAttn(flashAttnSetting, cacheType);
+  const weightsGpuBytes = gpuLayerIds.reduce((sum, i) => sum + model.layerBytes[i], 0) +
+    (gpuLayers > model.nLayer ? model.outputBytes : 0);
+  const kvGpuBytes = kvBytesPerToken(model, gpuLayerIds, cacheType, cacheType) * contextSize;
+  const kvCpuBytes = kvBytesPerToken(model, cpuLayerIds, cacheType, cacheType) * contextSize;
+  // draft 모델: 전체 GPU 오프로드, 같은 컨텍스트의 f16 KV (Metal 기본 오버헤드는 대상 모델과 공유)
+  const draft = model.draft;
+  const draftBytes = draft
+    ? draft.fileSize + kvBytesPerToken(draft, draft.kvLayers.map((_, i) => i), 'f16', 'f16') * contextSize +
+      computeBytes(draft, contextSize, flashAttn) - BASE_OVERHEAD_BYTES
+    : 0;
+  const gpuBytes = weightsGpuBytes + kvGpuBytes + draftBytes + (gpuLayers > 0 ? computeBytes(model, contextSize, flashAttn) : 0);
+  return {
+    weightsGpuBytes,
+    kvGpuBytes,
+    kvCpuBytes,
+    draftBytes,
+    gpuBytes,
+    totalBytes: model.fileSize + kvGpuBytes + kvCpuBytes + draftBytes + computeBytes(model, contextSize, flashAttn)
+  };
+}
+
+// 최대 컨텍스트부터 절반씩 줄인 후보 (MIN_AUTO_CONTEXT 까지)
+function contextCandidates(model, contextSize) {
+  const requested = Number(contextSize);
+  if (contextSize !== 'auto' && requested > 0) {
+    return [model.nCtxTrain > 0 ? Math.min(requested, model.nCtxTrain) : requested];
+  }
+  const max = Math.min(model.nCtxTrain || MAX_AUTO_CONTEXT, MAX_AUTO_CONTEXT);
+  const candidates = [max];
+  for (let ctx = 1 << Math.floor(Math.log2(max)); ctx >= MIN_AUTO_CONTEXT; ctx >>= 1) {
+    if (ctx < max) candidates.push(ctx);
+  }
+  return candidates;
+}
+
+function choosePlan(model, { gpuLayers, contextSize, kvCacheType, flashAttn = null, budgetBytes }) {
+  const fullLayers = model.nLayer + 1;
+  const fixedLayers = gpuLayers !== 'auto' && Number(gpuLayers) >= 0 ? Math.min(Number(gpuLayers), fullLayers) : null;
+  const autoType = !kvCacheType || kvCacheType === 'auto';
+  const contexts = contextCandidates(model, contextSize);
+  const fits = (ngl, ctx, type) => estimate(model, ngl, ctx, type, flashAttn).gpuBytes <= budgetBytes;
+  const build = (ngl, ctx, type, reason) => ({
+    gpuLayers: ngl,
+    contextSize: ctx,
+    cacheType: type,
+    flashAttn: resolveFlashAttn(flashAttn, type),
+    fullOffload: ngl >= fullLayers,
+    reason,
+    estimate: estimate(model, ngl, ctx, type, flashAttn)
+  });
+
+  const ngl = fixedLayers !== null ? fixedLayers : fullLayers;
+  // 1) 전체(또는 고정) 오프로드 유지: 큰 컨텍스트 우선, 같은 컨텍스트에서는 f16 → q8_0
+  //    q4_0 은 q8_0 으로 어떤 컨텍스트도 맞지 않을 때만 사용
+  const passes = autoType ? [AUTO_KV_TYPES, [LAST_RESORT_KV_TYPE]] : [[kvCacheType]];
+  for (const types of passes) {
+    for (const ctx of contexts) {
+      for (const type of types) {
+        if (fits(ngl, ctx, type)) return build(ngl, ctx, type, fixedLayers !== null ? 'fixed-layers' : 'full-offload');
+      }
+    }
+  }
+
+  // 2) 부분 오프로드: 가장 작은 컨텍스트에서 들어가는 최대 레이어 수
+  const ctx = contexts[contexts.length - 1];
+  const type = autoType ? 'q8_0' : kvCacheType;
+  if (fixedLayers !== null) return build(fixedLayers, ctx, type, 'over-budget');
+  for (let layers = model.nLayer; layers > 0; layers--) {
+    if (fits(layers, ctx, type)) return build(layers, ctx, type, 'partial-offload');
+  }
+  return build(0, ctx, type, 'cpu-only');
+}
+
+// modelConfig → { ok, gpuLayers, contextSize, cacheType, flashAttn, estimate, model, budgetBytes }
+async function planGgufLaunch(modelConfig, { budgetBytes = defaultBudgetBytes(), modelsDir } = {}) {
+  if (!modelConfig || modelConfig.autoFit === false) return { ok: false, error: 'autoFit disabled' };
+  if (!nativeAddon || !nativeAddon.getGgufInfo) return { ok: false, error: 'native addon not available' };
+  if (!(budgetBytes > 0)) return { ok: false, error: 'memory budget unknown' };
+  const kvCacheType = resolveKvCacheType(modelConfig);
+  if (kvCacheType === null) return { ok: false, error: `unsupported kvCacheType: ${modelConfig.kvCacheType}` };
+
+  const modelFile = resolveModelFile(modelConfig.modelPath, modelsDir);
+  if (!modelFile) return { ok: false, error: `model file not found: ${modelConfig.modelPath}` };
+
+  const info = await nativeAddon.getGgufInfo(modelFile, { tensors: true, metadata: true });
+  if (!info || !info.ok) return { ok: false, error: info ? info.error : 'GGUF parse failed' };
+
+  const model = summarizeModel(info);
+  if (model.nLayer === 0) return { ok: false, error: 'no transformer layers found' };
+  const profile = perfProfile.resolveProfile(modelConfig);
+  model.ubatchSize = Number(profile.ubatchSize) || UBATCH_SIZE;
+  const draft = await planDraft(modelConfig, modelFile, model);
+
+  const plan = choosePlan(model, {
+    gpuLayers: modelConfig.gpuLayers === undefined || modelConfig.gpuLayers === null ? -1 : modelConfig.gpuLayers,
+    contextSize: modelConfig.contextSize || 'auto',
+    kvCacheType,
+    flashAttn: profile.flashAttn,
+    budgetBytes
+  });
+  const bytesPerToken = kvBytesPerToken(model, model.kvLayers.map((_, i) => i), plan.cacheType, plan.cacheType);
+  return {
+    ok: true,
+    modelFile,
+    budgetBytes,
+    ...plan,
+    draft,
+    kvCache: describeKvCache(plan.cacheType, bytesPerToken, plan.contextSize),
+    model: {
+      arch: model.arch,
+      nLayer: model.nLayer,
+      nHeadKv: model.nHeadKv,
+      headDimK: model.headDimK,
+      headDimV: model.headDimV,
+      nCtxTrain: model.nCtxTrain,
+      kvBytesPerToken: bytesPerToken
+    }
+  };
+}
+
+// 계획 → llama-server 인자 (-ngl, -c, KV 캐시 타입; 양자화된 V 캐시는 flash attention 필요)
+// draft 모델 확인: 파일이 없거나 어휘 크기가 다르면 추측 디코딩 없이 실행
+// 결과 { file, settings, skipped } | null (draftModel 미설정), file 이 있으면 model.draft 에 요약 저장
+async function planDraft(modelConfig, modelFile, model) {
+  const settings = speculative.draftSettings(modelConfig);
+  if (!settings) return null;
+  const file = resolveModelFile(settings.modelPath, path.dirname(modelFile));
+  if (!file) return { file: null, settings, skipped: `draft model file not found: ${settings.modelPath}` };
+  const info = await nativeAddon.getGgufInfo(file, { tensors: true, metadata: true });
+  if (!info || !info.ok) return { file: null, settings, skipped: `draft GGUF parse failed: ${info ? info.error : 'unknown'}` };
+  const draftModel = summarizeModel(info);
+  if (draftModel.nVocab && model.nVocab && draftModel.nVocab !== model.nVocab) {
+    return { file: null, settings, skipped: `draft vocab size ${draftModel.nVocab} != target ${model.nVocab}` };
+  }
+  draftModel.ubatchSize = model.ubatchSize;
+  model.draft = draftModel;
+  return { file, settings, skipped: null };
+}
+
+// 계획 없이 실행할 때의 KV 캐시 타입 인자 ('auto' 와 알 수 없는 값은 llama-server 기본값 f16)
+function kvArgs(modelConfig) {
+  return ggufKvArgs(resolveKvCacheType(modelConfig));
+}
+
+// 계획 없이 실행할 때의 draft 인자 (파일 확인만)
+function draftArgs(modelConfig, modelFile) {
+  const settings = speculative.draftSettings(modelConfig);
+  if (!settings) return [];
+  const file = resolveModelFile(settings.modelPath, path.dirname(modelFile));
+  return file ? speculative.ggufDraftArgs(file, settings) : [];
+}
+
+function planArgs(plan) {
+  const args = ['-ngl', plan.gpuLayers.toString(), '-c', plan.contextSize.toString()];
+  args.push(...ggufKvArgs(plan.cacheType));
+  if (plan.draft && plan.draft.file) {
+    args.push(...speculative.ggufDraftArgs(plan.draft.file, plan.draft.settings));
+  }
+  return args;
+}
+
+function describePlan(plan) {
+  const gb = (bytes) => `${(bytes / 1024 / 1024 / 1024).toFixed(2)} GB`;
+  let draft = '';
+  if (plan.draft) {
+    draft = plan.draft.file
+      ? ` draft=${path.basename(plan.draft.file)} (${gb(plan.estimate.draftBytes)})`
+      : ` draft skipped: ${plan.draft.skipped}`;
+  }
+  return `ngl=${plan.gpuLayers}/${plan.model.nLayer + 1} ctx=${plan.contextSize} kv=${plan.cacheType} (${gb(plan.kvCache.bytes)})${draft} ` +
+    `(${plan.reason}, GPU ${gb(plan.estimate.gpuBytes)} / budget ${gb(plan.budgetBytes)})`;
+}
+
+module.exports = {
+  planGgufLaunch,
+  planArgs,
+  draftArgs,
+  kvArgs,
+  describePlan,
+  resolveModelFile,
+  defaultBudgetBytes,
+  summarizeModel,
+  choosePlan
+};
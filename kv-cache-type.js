@@ -0,0 +1,62 @@
+// KV 캐시 양자화 설정: 모델 설정의 kvCacheType
+//
+// - 'auto'(기본): GGUF 는 gguf-planner.js 가 메모리 예산에 맞춰 f16 → q8_0 → q4_0 중 선택, MLX 는 f16
+// - 'f16' / 'q8_0' / 'q4_0' (GGUF 는 KV_TYPE_BYTES 의 다른 타입도 허용)
+//
+// GGUF: --cache-type-k / --cache-type-v (양자화된 V 캐시는 --flash-attn on 필요)
+// MLX:  MLX_KV_BITS / MLX_KV_GROUP_SIZE 환경변수 → BatchScheduler 가 QuantizedKVCache 사용
+//       (q8_0 → 8 bit, q4_0 → 4 bit, 그룹 크기 64)
+
+// 원소당 바이트 (블록 양자화는 블록 크기/원소 수)
+const KV_TYPE_BYTES = {
+  f32: 4,
+  f16: 2,
+  bf16: 2,
+  q8_0: 34 / 32,
+  q5_1: 24 / 32,
+  q5_0: 22 / 32,
+  q4_1: 20 / 32,
+  q4_0: 18 / 32
+};
+const MLX_KV_BITS = { q8_0: 8, q4_0: 4 };
+const MLX_KV_GROUP_SIZE = 64;
+
+// modelConfig → 'auto' | 타입 이름 (알 수 없는 값은 null)
+function kvCacheType(modelConfig) {
+  const type = modelConfig && modelConfig.kvCacheType ? String(modelConfig.kvCacheType).trim() : 'auto';
+  if (type === 'auto' || type in KV_TYPE_BYTES) return type;
+  return null;
+}
+
+// llama-server 인자 (f16/auto 는 기본값이므로 인자 없음)
+function ggufKvArgs(type) {
+  if (!type || type === 'auto' || type === 'f16') return [];
+  return ['--cache-type-k', type, '--cache-type-v', type, '--flash-attn', 'on'];
+}
+
+// MLX 서버 환경변수 (f16/auto 면 빈 객체)
+function mlxKvEnv(modelConfig) {
+  const type = kvCacheType(modelConfig);
+  if (type === null) {
+    console.warn(`[KV Cache] Unsupported kvCacheType "${modelConfig.kvCacheType}", using f16`);
+    return {};
+  }
+  const bits = MLX_KV_BITS[type];
+  if (!bits) {
+    if (type !== 'auto' && type !== 'f16') console.warn(`[KV Cache] MLX supports q8_0/q4_0 only, using f16 for ${type}`);
+    return {};
+  }
+  return { MLX_KV_BITS: String(bits), MLX_KV_GROUP_SIZE: String(MLX_KV_GROUP_SIZE) };
+}
+
+// 토큰당 KV 바이트 (레이어 합계)와 컨텍스트 전체 크기 → 메트릭용 요약
+function describeKvCache(type, bytesPerToken, contextSize) {
+  return {
+    type,
+    contextSize,
+    bytesPerToken: Math.round(bytesPerToken),
+    bytes: Math.round(bytesPerToken * contextSize)
+  };
+}
+
+module.exports = { KV_TYPE_BYTES, kvCacheType, ggufKvArgs, mlxKvEnv, describeKvCache };
@@ -0,0 +1,193 @@
+// 이름 있는 프롬프트 prefix 의 KV 스냅샷 관리
+//
+// prompt-prefixes.json 에 정의된 긴 시스템 프롬프트의 KV 상태를 kv-cache/ 아래에 저장해 두고
+// 서버가 뜰 때 복원하여 재시작/모델 전환 후 첫 요청의 prefill 을 건너뜁니다.
+// - GGUF: llama-server 의 --slot-save-path 와 /slots/{id}?action=save|restore 사용
+// - MLX: 서버에 MLX_PROMPT_PREFIXES / MLX_KV_SNAPSHOT_DIR 를 넘기면 서버가 직접 복원 (mlx/kv_snapshot.py)
+const fs = require('fs');
+const path = require('path');
+const http = require('http');
+const crypto = require('crypto');
+
+const PROMPT_PREFIXES_PATH = path.join(__dirname, 'prompt-prefixes.json');
+// 패키징된 앱에서는 __dirname 이 읽기 전용이므로 LLM_KV_CACHE_DIR 로 위치 지정
+const DEFAULT_KV_CACHE_DIR = path.join(__dirname, 'kv-cache');
+const HEALTH_TIMEOUT_MS = 5 * 60 * 1000; // 큰 모델 로딩 대기 한도
+
+function loadPromptPrefixes() {
+  try {
+    if (fs.existsSync(PROMPT_PREFIXES_PATH)) {
+      const data = JSON.parse(fs.readFileSync(PROMPT_PREFIXES_PATH, 'utf-8'));
+      return (data.prefixes || []).filter(p => p && p.name && p.text);
+    }
+  } catch (error) {
+    console.error('[KV Snapshot] Failed to load prompt prefixes:', error.message);
+  }
+  return [];
+}
+
+// kv-cache/<format>/<modelId> (없으면 생성)
+function snapshotDir(format, modelId) {
+  const safeId = String(modelId || 'default').replace(/[^A-Za-z0-9._-]/g, '_');
+  const dir = path.join(process.env.LLM_KV_CACHE_DIR || DEFAULT_KV_CACHE_DIR, format, safeId);
+  fs.mkdirSync(dir, { recursive: true });
+  return dir;
+}
+
+// 모델 파일(경로/크기/수정 시각)과 prefix 토큰이 같을 때만 같은 파일 이름
+function ggufSnapshotFileName(prefix, modelPath, tokens) {
+  const hash = crypto.createHash('sha1');
+  try {
+    const stat = fs.statSync(modelPath);
+    hash.update(`${path.resolve(modelPath)}:${stat.size}:${stat.mtimeMs}`);
+  } catch (error) {
+    hash.update(path.resolve(modelPath));
+  }
+  hash.update(tokens.join(','));
+  return `${prefix.name}-${hash.digest('hex').slice(0, 12)}.bin`;
+}
+
+function requestJson(port, method, pathname, body, timeoutMs = 120000) {
+  return new Promise((resolve, reject) => {
+    const payload = body ? JSON.stringify(body) : null;
+    const req = http.request({
+      host: '127.0.0.1',
+      port,
+      method,
+      path: pathname,
+      headers: payload ? { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(payload) } : {}
+    }, (res) => {
+      let data = '';
+      res.on('data', (chunk) => { data += chunk; });
+      res.on('end', () => {
+        let json = null;
+        try {
+          json = data ? JSON.parse(data) : null;
+        } catch (error) {
+          // JSON 이 아닌 응답은 null 로 전달
+        }
+        resolve({ statusCode: res.statusCode, body: json });
+      });
+    });
+    req.on('error', reject);
+    req.setTimeout(timeoutMs, () => {
+      req.destroy(new Error(`${method} ${pathname} timeout`));
+    });
+    if (payload) req.write(payload);
+    req.end();
+  });
+}
+
+// llama-server 의 /health 가 200 (모델 로드 완료) 이 될 때까지 대기
+async function waitForHealthy(port, isAlive, timeoutMs = HEALTH_TIMEOUT_MS) {
+  const deadline = Date.now() + timeoutMs;
+  while (Date.now() < deadline) {
+    if (isAlive && !isAlive()) return false;
+    try {
+      const res = await requestJson(port, 'GET', '/health', null, 2000);
+      if (res.statusCode === 200) return true;
+    } catch (error) {
+      // 아직 listen 전
+    }
+    await new Promise(resolve => setTimeout(resolve, 1000));
+  }
+  return false;
+}
+
+// 같은 prefix 의 이전 스냅샷만 (<name>-<12자리 hash>.bin — "chat" 이 "chat-ko-..." 를 지우지 않도록)
+function removeStaleSnapshots(dir, prefixName, keepFile) {
+  const escaped = prefixName.replace(/[.*+?^${}()|[\]\\]/g, '\\$&');
+  const pattern = new RegExp(`^${escaped}-[0-9a-f]{12}\\.bin$`);
+  try {
+    for (const file of fs.readdirSync(dir)) {
+      if (file !== keepFile && pattern.test(file)) {
+        fs.unlinkSync(path.join(dir, file));
+      }
+    }
+  } catch (error) {
+    // 정리 실패는 무시
+  }
+}
+
+// messages 요청(start-client-server.js prepareGgufMessages)과 같은 토큰화: prefix 텍스트가 BOS 를 직접 포함하므로
+// add_special 없이, <|start_header_id|> 등은 스페셜 토큰으로 — 다르면 슬롯 캐시가 첫 토큰부터 어긋남
+async function tokenizePrefix(port, text) {
+  const res = await requestJson(port, 'POST', '/tokenize', { content: text, add_special: false, parse_special: true }, 30000);
+  if (res.statusCode !== 200 || !Array.isArray(res.body?.tokens)) throw new Error(`tokenize failed (${res.statusCode})`);
+  return res.body.tokens.map(t => (typeof t === 'object' ? t.id : t));
+}
+
+// llama-server 가 뜬 뒤 prefix 별로 슬롯에 KV 를 복원 (스냅샷이 없으면 prefill 후 저장)
+// prefix 는 슬롯 하나에 하나씩 배치되므로 슬롯 수보다 많은 prefix 는 건너뜁니다.
+async function warmGgufPrefixes({ port, modelPath, slotSavePath, isAlive, log = console.log }) {
+  const prefixes = loadPromptPrefixes();
+  if (prefixes.length === 0) return;
+  if (!(await waitForHealthy(port, isAlive))) {
+    log('[KV Snapshot] llama-server not healthy, skipping prefix restore');
+    return;
+  }
+
+  let totalSlots = 1;
+  try {
+    const props = await requestJson(port, 'GET', '/props', null, 5000);
+    if (props.body && props.body.total_slots) totalSlots = props.body.total_slots;
+  } catch (error) {
+    // 구버전 llama-server: 슬롯 1개로 가정
+  }
+
+  for (let slot = 0; slot < Math.min(prefixes.length, totalSlots); slot++) {
+    const prefix = prefixes[slot];
+    const start = Date.now();
+    try {
+      const tokens = await tokenizePrefix(port, prefix.text);
+      const filename = ggufSnapshotFileName(prefix, modelPath, tokens);
+      if (fs.existsSync(path.join(slotSavePath, filename))) {
+        const res = await requestJson(port, 'POST', `/slots/${slot}?action=restore`, { filename });
+        if (res.statusCode === 200) {
+          log(`[KV Snapshot] Restored "${prefix.name}" into slot ${slot}: ${res.body?.n_restored ?? '?'} tokens in ${Date.now() - start}ms`);
+          continue;
+        }
+        log(`[KV Snapshot] Restore of "${prefix.name}" failed (${res.statusCode}), rebuilding`);
+      }
+      // n_predict 0: 프롬프트만 prefill 해서 슬롯 캐시에 남김 (문자열 대신 토큰 ID 라 BOS 가 다시 붙지 않음)
+      const fill = await requestJson(port, 'POST', '/completion', {
+        prompt: tokens,
+        n_predict: 0,
+        cache_prompt: true,
+        id_slot: slot,
+        stream: false
+      });
+      if (fill.statusCode !== 200) {
+        log(`[KV Snapshot] Prefill of "${prefix.name}" failed (${fill.statusCode})`);
+        continue;
+      }
+      const save = await requestJson(port, 'POST', `/slots/${slot}?action=save`, { filename });
+      if (save.statusCode === 200) {
+        removeStaleSnapshots(slotSavePath, prefix.name, filename);
+        log(`[KV Snapshot] Saved "${prefix.name}" from slot ${slot}: ${save.body?.n_saved ?? '?'} tokens (${filename})`);
+      } else {
+        log(`[KV Snapshot] Save of "${prefix.name}" failed (${save.statusCode})`);
+      }
+    } catch (error) {
+      log(`[KV Snapshot] "${prefix.name}" failed: ${error.message}`);
+    }
+  }
+}
+
+// MLX 서버 spawn 환경 변수
+function mlxSnapshotEnv(modelId) {
+  if (loadPromptPrefixes().length === 0) return {};
+  return {
+    MLX_PROMPT_PREFIXES: PROMPT_PREFIXES_PATH,
+    MLX_KV_SNAPSHOT_DIR: snapshotDir('mlx', modelId)
+  };
+}
+
+module.exports = {
+  requestJson,
+  waitForHealthy,
+  loadPromptPrefixes,
+  snapshotDir,
+  warmGgufPrefixes,
+  mlxSnapshotEnv
+};
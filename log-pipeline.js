@@ -0,0 +1,279 @@
+// 서버 로그 파이프라인: 자식 프로세스 stdout/stderr → 줄 단위 링 버퍼 → 렌더러 IPC 배치
+//
+// - source(): 청크를 줄로 나누고 (잘린 마지막 줄은 다음 청크와 이어 붙임) 줄마다 레벨을 정해
+//   설정된 level 보다 낮은 줄은 바로 버립니다 (콘솔 / IPC / 파일 모두 건너뜀).
+// - 렌더러로는 batchMs 마다 쌓인 줄을 'log-batch' 메시지 하나로 보냅니다 (최대 maxBatchLines 줄).
+//   렌더러가 배치를 처리하면 preload 가 'log-ack' 를 돌려주고, ack 되지 않은 배치가 maxInFlight 개면
+//   더 보내지 않고 기다립니다. 기다리는 줄이 maxPendingLines 를 넘으면 오래된 줄부터 버리고 dropped 로 셉니다
+//   (다음 배치에 버린 줄 수를 함께 보냄). 링 버퍼에는 버려진 줄도 남아 있어 get-log-history 로 다시 볼 수 있습니다.
+// - 콘솔 출력도 배치마다 한 번에 씁니다 (echo 가 켜진 줄만, sendLog 처럼 호출한 쪽이 이미 출력한 줄은 제외).
+// - file 이 켜져 있으면 worker 스레드가 배치를 파일에 이어 쓰고 maxFileBytes 를 넘으면 회전합니다
+//   (server.log → server.log.1 → ... → server.log.<maxFiles>).
+//
+// config.json 예:
+//   "logging": { "level": "info", "batchMs": 50, "file": true, "maxFileMB": 10, "maxFiles": 5 }
+// LOG_LEVEL 환경 변수가 있으면 level 보다 우선합니다.
+const path = require('path');
+const fs = require('fs');
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+
+const LEVELS = ['debug', 'info', 'warn', 'error'];
+const DEFAULTS = {
+  level: 'info',
+  batchMs: 50,
+  maxBatchLines: 500,
+  maxPendingLines: 5000,
+  maxInFlight: 4,
+  ringCapacity: 5000,
+  file: false,
+  maxFileMB: 10,
+  maxFiles: 5
+};
+const ACK_TIMEOUT_MS = 2000; // 렌더러가 새로고침되어 ack 가 오지 않으면 대기 해제
+const MAX_LINE_CHARS = 8192; // 줄바꿈 없이 계속 들어오는 출력은 이 길이에서 끊음
+
+// 줄 내용으로 레벨 판단 (llama.cpp: "E ..." / "W ..." 접두사, [ERROR] / [WARN] / [DEBUG] 태그, uvicorn "ERROR:")
+function classifyLine(text, fallback = 'info') {
+  if (/\[ERROR\]|^\s*(E|ERROR:?)\s|\berror\b|\bfailed\b/i.test(text)) return 'error';
+  if (/\[WARN(ING)?\]|^\s*(W|WARNING:?)\s|\bwarn(ing)?\b/i.test(text)) return 'warn';
+  if (/\[DEBUG\]|^\s*(D|DEBUG:?)\s/i.test(text)) return 'debug';
+  // llama-server --verbose 의 요청/응답 덤프와 토큰 단위 줄
+  if (/^\s*(srv\s+log_server_r|slot\s+\w+: id\s+\d+ \| task \d+ \| next token)/.test(text)) return 'debug';
+  return fallback;
+}
+
+class LogPipeline {
+  // send(channel, payload): 렌더러로 전달 (창이 없으면 false 반환), echo: 콘솔 출력 함수
+  constructor({ send, echo = (text) => process.stdout.write(text), options = {} }) {
+    this.send = send;
+    this.echo = echo;
+    this.ring = [];
+    this.ringStart = 0;
+    this.seq = 0;
+    this.pending = [];
+    this.echoPending = [];
+    this.filePending = [];
+    this.inFlight = 0;
+    this.lastSentAt = 0;
+    this.timer = null;
+    this.writer = null;
+    this.counters = { lines: 0, filtered: 0, dropped: 0, droppedSinceLastBatch: 0, batches: 0, ackTimeouts: 0 };
+    this.configure(options);
+  }
+
+  configure(options = {}) {
+    const next = { ...DEFAULTS };
+    for (const key of Object.keys(DEFAULTS)) {
+      if (options[key] === undefined) continue;
+      next[key] = typeof DEFAULTS[key] === 'number' ? Number(options[key]) || DEFAULTS[key] : options[key];
+    }
+    if (process.env.LOG_LEVEL) next.level = process.env.LOG_LEVEL;
+    if (!LEVELS.includes(next.level)) next.level = DEFAULTS.level;
+    this.options = next;
+    this.minLevel = LEVELS.indexOf(next.level);
+    this.ring = this.ringLines().slice(-next.ringCapacity);
+    this.ringStart = 0;
+    return next;
+  }
+
+  // 파일 로그 시작 (worker 스레드), dir 아래 server.log
+  openFile(dir) {
+    this.closeFile();
+    if (!this.options.file || !dir) return;
+    try {
+      fs.mkdirSync(dir, { recursive: true });
+      this.writer = new Worker(__filename, {
+        workerData: {
+          file: path.join(dir, 'server.log'),
+          maxBytes: this.options.maxFileMB * 1024 * 1024,
+          maxFiles: this.options.maxFiles
+        }
+      });
+      this.writer.on('error', (error) => {
+        this.writer = null;
+        this.push('error', `[Log] File writer failed: ${error.message}`, { echo: true });
+      });
+      this.writer.unref();
+    } catch (error) {
+      this.writer = null;
+      this.push('error', `[Log] Cannot open log file in ${dir}: ${error.message}`, { echo: true });
+    }
+  }
+
+  closeFile() {
+    if (!this.writer) return;
+    this.writer.postMessage({ close: true });
+    this.writer = null;
+  }
+
+  // 자식 프로세스 스트림용 줄 분리기: { write(chunk), end() }
+  // prefix 는 줄마다 붙이고 (예: '[MLX Server] '), defaultLevel 은 내용으로 레벨을 알 수 없을 때 사용
+  source(prefix = '', { defaultLevel = 'info', echo = true } = {}) {
+    let rest = '';
+    const emit = (line) => {
+      const text = line.endsWith('\r') ? line.slice(0, -1) : line;
+      if (text.trim()) this.push(classifyLine(text, defaultLevel), prefix + text, { echo, classified: true });
+    };
+    return {
+      write: (chunk) => {
+        const text = rest + chunk.toString('utf8');
+        const lines = text.split('\n');
+        rest = lines.pop();
+        for (const line of lines) emit(line);
+        while (rest.length > MAX_LINE_CHARS) {
+          emit(rest.slice(0, MAX_LINE_CHARS));
+          rest = rest.slice(MAX_LINE_CHARS);
+        }
+      },
+      end: () => {
+        if (rest) emit(rest);
+        rest = '';
+      }
+    };
+  }
+
+  // 줄 하나 추가. level 은 classified 가 아니면 내용의 태그([ERROR] 등)로 다시 판단
+  // echo: 콘솔에도 출력 (호출한 쪽에서 이미 console.log 했으면 false)
+  push(level, text, { echo = false, classified = false } = {}) {
+    const lineLevel = classified ? level : classifyLine(text, level);
+    if (LEVELS.indexOf(lineLevel) < this.minLevel) {
+      this.counters.filtered++;
+      return;
+    }
+    const entry = { seq: ++this.seq, ts: Date.now(), level: lineLevel, text };
+    this.counters.lines++;
+    this.appendRing(entry);
+    this.pending.push(entry);
+    if (echo) this.echoPending.push(entry);
+    if (this.writer) this.filePending.push(entry);
+    if (this.pending.length > this.options.maxPendingLines) {
+      const overflow = this.pending.length - this.options.maxPendingLines;
+      this.pending.splice(0, overflow);
+      this.counters.dropped += overflow;
+      this.counters.droppedSinceLastBatch += overflow;
+    }
+    this.schedule();
+  }
+
+  appendRing(entry) {
+    if (this.ring.length < this.options.ringCapacity) {
+      this.ring.push(entry);
+    } else {
+      this.ring[this.ringStart] = entry;
+      this.ringStart = (this.ringStart + 1) % this.ring.length;
+    }
+  }
+
+  ringLines() {
+    return this.ring.slice(this.ringStart).concat(this.ring.slice(0, this.ringStart));
+  }
+
+  schedule() {
+    if (this.timer) return;
+    this.timer = setTimeout(() => {
+      this.timer = null;
+      this.flush();
+    }, this.options.batchMs);
+  }
+
+  flush() {
+    if (this.echoPending.length > 0) {
+      this.echo(this.echoPending.map(e => e.text).join('\n') + '\n');
+      this.echoPending = [];
+    }
+    if (this.filePending.length > 0) {
+      if (this.writer) this.writer.postMessage({ lines: this.filePending.map(formatFileLine) });
+      this.filePending = [];
+    }
+    if (this.pending.length === 0) return;
+    if (this.inFlight >= this.options.maxInFlight) {
+      // 렌더러가 밀림: ack 를 기다림 (오래 오지 않으면 새로고침 등으로 잃어버린 것으로 봄)
+      if (Date.now() - this.lastSentAt < ACK_TIMEOUT_MS) {
+        this.schedule();
+        return;
+      }
+      this.counters.ackTimeouts++;
+      this.inFlight = 0;
+    }
+    const batch = this.pending.splice(0, this.options.maxBatchLines);
+    const sent = this.send('log-batch', {
+      lines: batch.map(e => e.text),
+      levels: batch.map(e => e.level),
+      lastSeq: batch[batch.length - 1].seq,
+      dropped: this.counters.droppedSinceLastBatch
+    });
+    if (sent === false) {
+      // 창이 없음: 링 버퍼에만 남김 (창이 열리면 get-log-history 로 받아 감)
+      this.pending = [];
+      return;
+    }
+    this.counters.droppedSinceLastBatch = 0;
+    this.counters.batches++;
+    this.inFlight++;
+    this.lastSentAt = Date.now();
+    if (this.pending.length > 0) this.schedule();
+  }
+
+  // 렌더러가 배치 하나를 처리함
+  ack() {
+    if (this.inFlight > 0) this.inFlight--;
+    if (this.pending.length > 0) this.schedule();
+  }
+
+  // 렌더러가 새로 열림: 대기 중인 ack 초기화, 최근 limit 줄 반환
+  history(limit = this.options.ringCapacity) {
+    this.inFlight = 0;
+    this.pending = [];
+    this.counters.droppedSinceLastBatch = 0;
+    return this.ringLines().slice(-limit).map(e => e.text);
+  }
+
+  stats() {
+    return {
+      ...this.counters,
+      level: this.options.level,
+      ringLines: this.ring.length,
+      pendingLines: this.pending.length,
+      inFlight: this.inFlight,
+      file: Boolean(this.writer)
+    };
+  }
+}
+
+function formatFileLine(entry) {
+  return `${new Date(entry.ts).toISOString()} ${entry.level.toUpperCase().padEnd(5)} ${entry.text}`;
+}
+
+// ---- 파일 쓰기 worker (메인 스레드를 막지 않도록 동기 I/O 는 여기서만) ----
+function runFileWriter({ file, maxBytes, maxFiles }) {
+  let size = 0;
+  try {
+    size = fs.statSync(file).size;
+  } catch (error) {
+    // 새 파일
+  }
+  const rotate = () => {
+    for (let i = maxFiles - 1; i >= 1; i--) {
+      if (fs.existsSync(`${file}.${i}`)) fs.renameSync(`${file}.${i}`, `${file}.${i + 1}`);
+    }
+    if (fs.existsSync(file)) fs.renameSync(file, `${file}.1`);
+    size = 0;
+  };
+  parentPort.on('message', (message) => {
+    if (message.close) {
+      parentPort.close();
+      return;
+    }
+    const text = message.lines.join('\n') + '\n';
+    const bytes = Buffer.byteLength(text);
+    if (size > 0 && size + bytes > maxBytes) rotate();
+    fs.appendFileSync(file, text);
+    size += bytes;
+  });
+}
+
+if (!isMainThread && workerData && workerData.file) {
+  runFileWriter(workerData);
+}
+
+module.exports = { LogPipeline, classifyLine, LEVELS };
@@ -17,8 +17,58 @@ let currentModelConfig = null; // 현재 로드된 모델 설정
 let currentServerType = null; // 현재 실행 중인 서버 타입: 'gguf' 또는 'mlx'
 let lastVramUpdateTime = 0; // 마지막 VRAM 업데이트 시간 (디버깅용)
 
+// native addon (Metal VRAM, GGUF 리더). 빌드되지 않은 환경에서는 JS 구현으로 폴백
+let nativeAddon = null;
+try {
+  nativeAddon = require('./native');
+} catch (error) {
+  console.warn(`[Main] Native addon not available, using JS fallbacks: ${error.message}`);
+}
+
+const VRAM_SAMPLE_INTERVAL_MS = 250; // 네이티브 VRAM 샘플링 주기
+
+// 프롬프트 prefix KV 스냅샷 (kv-snapshot.js). 사용자 데이터 디렉터리에 저장
+if (!process.env.LLM_KV_CACHE_DIR) {
+  process.env.LLM_KV_CACHE_DIR = path.join(app.getPath('userData'), 'kv-cache');
+}
+const kvSnapshot = require('./kv-snapshot');
+const ggufPlanner = require('./gguf-planner');
+const speculative = require('./speculative');
+const kvCacheType = require('./kv-cache-type');
+const perfProfile = require('./perf-profile');
+const metricsHub = require('./metrics-hub');
+const { ModelPrewarmer } = require('./model-prewarm');
+const { LogPipeline, LEVELS: LOG_LEVELS } = require('./log-pipeline');
+
+const { GGUF_METRICS } = metricsHub;
+const VRAM_METRIC_NAMES = new Set([GGUF_METRICS.vramTotal, GGUF_METRICS.vramUsed, GGUF_METRICS.vramFree]);
+let metricsErrorLogged = false;
+let ggufDraftStats = null; // 추측 디코딩 수락률 (draftModel 이 설정된 GGUF 서버)
+let ggufKvCache = null; // 계획된 KV 캐시 타입/크기 (kv-cache-type.js describeKvCache)
+// 모델 로드 시 페이지 캐시 프리웜 (로그 패널에 읽은 양/소요 시간 표시)
+const modelPrewarmer = new ModelPrewarmer({
+  log: (msg) => {
+    console.log(msg);
+    sendLog('log-message', `[INFO] ${msg}`);
+  }
+});
+
+// 서버 로그 → 렌더러: 줄 단위 링 버퍼 + 레벨 필터 + 시간 단위 IPC 배치 (log-pipeline.js)
+// 옵션은 config.json 의 logging (앱 시작 시 적용)
+const logPipeline = new LogPipeline({
+  send: (channel, payload) => {
+    if (!mainWindow || mainWindow.isDestroyed()) return false;
+    mainWindow.webContents.send(channel, payload);
+    return true;
+  }
+});
+
+// get-gguf-info 결과 캐시 (경로 + 크기 + mtime 기준, 모델 목록을 다시 열 때 재파싱 방지)
+const ggufInfoCache = new Map();
+
 // ----------------------------
 // GGUF metadata parser (no full-file read)
+// native addon 의 getGgufInfo 를 사용할 수 없을 때의 폴백 구현
 // ----------------------------
 const GGUF_VALUE_TYPE = {
   UINT8: 0,
@@ -311,6 +361,79 @@ function initVRAMInfo() {
 // estimateVRAMUsage() 함수를 사용했지만, 추정값이 실제 메트릭을 덮어쓰는 문제가 있어
 // 현재는 완전히 제거했습니다. 이제 VRAM 정보는 오직 llama-server 의 /metrics 응답만 사용합니다.
 
+// 네이티브 addon 이 없을 때의 호스트 CPU 사용률 (os.cpus() 누적 tick 차이)
+let lastOsCpuTimes = null;
+function sampleOsCpuUsage() {
+  const totals = os.cpus().reduce((acc, cpu) => {
+    const t = cpu.times;
+    acc.busy += t.user + t.nice + t.sys + t.irq;
+    acc.total += t.user + t.nice + t.sys + t.irq + t.idle;
+    return acc;
+  }, { busy: 0, total: 0 });
+  const prev = lastOsCpuTimes;
+  lastOsCpuTimes = totals;
+  if (!prev || totals.total <= prev.total) return 0;
+  return ((totals.busy - prev.busy) / (totals.total - prev.total)) * 100;
+}
+
+// 현재 추론 서버 프로세스 PID (GGUF: llama-server, MLX: Python 서버)
+function getInferencePids() {
+  const pids = [];
+  if (currentServerType === 'gguf' && llamaServerProcess && llamaServerProcess.pid) {
+    pids.push(llamaServerProcess.pid);
+  }
+  if (mlxServerInstance && mlxServerInstance.process && mlxServerInstance.process.pid) {
+    pids.push(mlxServerInstance.process.pid);
+  }
+  return pids;
+}
+
+// CPU/GPU/메모리 압력 카운터. 첫 호출(기준값 없음)이나 미지원 항목은 0/null
+function readSystemCounters() {
+  const result = {
+    cpu: 0,
+    gpu: 0,
+    cpuProcess: null,
+    gpuRenderer: null,
+    gpuTiler: null,
+    memoryPressure: null,
+    swapUsed: null,
+    compressedMemory: null,
+  };
+  if (!nativeAddon || !nativeAddon.getSystemCounters) {
+    result.cpu = sampleOsCpuUsage();
+    return result;
+  }
+  const counters = nativeAddon.getSystemCounters(getInferencePids(), 'main-metrics');
+  result.cpu = counters.cpu && counters.cpu.usage != null ? counters.cpu.usage : 0;
+  if (counters.processes && counters.processes.length > 0) {
+    result.cpuProcess = counters.processes.reduce((sum, p) => sum + (p.usage || 0), 0);
+  }
+  if (counters.gpu) {
+    result.gpu = counters.gpu.device != null ? counters.gpu.device : 0;
+    result.gpuRenderer = counters.gpu.renderer;
+    result.gpuTiler = counters.gpu.tiler;
+  }
+  if (counters.memory) {
+    result.memoryPressure = counters.memory.pressureLevel;
+    result.swapUsed = counters.memory.swapUsed;
+    result.compressedMemory = counters.memory.compressed;
+  }
+  return result;
+}
+
+// llama-server /metrics 에 VRAM 값이 없을 때 (MLX 서버, 서버 미실행 등) 네이티브 샘플러의 최신 값 사용
+function updateVramFromNativeSampler() {
+  if (!nativeAddon || !nativeAddon.getVRAMSamples) return;
+  const samples = nativeAddon.getVRAMSamples(Date.now() - VRAM_SAMPLE_INTERVAL_MS * 4);
+  const latest = samples[samples.length - 1];
+  if (latest && latest.total > 0) {
+    cachedVramTotal = latest.total;
+    cachedVramUsed = latest.used;
+    lastVramUpdateTime = latest.ts;
+  }
+}
+
 function createWindow() {
   mainWindow = new BrowserWindow({
     width: 1200,
@@ -336,17 +459,22 @@ function createWindow() {
   });
 }
 
+// 로그 패널로 한 줄 전달 (레벨은 [ERROR] / [WARN] 등 태그로 판단, 배치로 묶여 전송)
+// 호출한 쪽이 이미 console.log 하므로 콘솔에는 다시 쓰지 않음
 function sendLog(channel, message) {
-  if (mainWindow) {
-    mainWindow.webContents.send(channel, message);
-  }
+  logPipeline.push('info', String(message).trimEnd());
 }
 
 // 메인 프로세스 로그를 렌더러로 전달 (개발자 도구에서 확인 가능)
 function logToRenderer(level, ...args) {
-  const message = args.map(arg => 
-    typeof arg === 'object' ? JSON.stringify(arg, null, 2) : String(arg)
-  ).join(' ');
+  const message = args.map(arg => {
+    if (typeof arg !== 'object' || arg === null) return String(arg);
+    try {
+      return JSON.stringify(arg);
+    } catch (error) {
+      return String(arg);
+    }
+  }).join(' ');
   
   // 터미널에도 출력
   if (level === 'error') {
@@ -357,10 +485,22 @@ function logToRenderer(level, ...args) {
     console.log(...args);
   }
   
-  // 렌더러로도 전달 (개발자 도구에서 확인 가능)
-  if (mainWindow && !mainWindow.isDestroyed()) {
-    mainWindow.webContents.send('main-log', { level, message, timestamp: new Date().toISOString() });
+  // 렌더러로도 전달 (로그 파이프라인의 배치에 포함)
+  logPipeline.push(LOG_LEVELS.includes(level) ? level : 'info', `[Main] ${message}`, { classified: true });
+}
+
+// config.json 의 logging 적용 (레벨, 배치 주기, 파일 로그)
+function configureLogPipeline() {
+  let logging = {};
+  try {
+    logging = JSON.parse(fs.readFileSync(configPath, 'utf-8')).logging || {};
+  } catch (error) {
+    // 설정 파일이 없거나 잘못됨: 기본값
   }
+  const options = logPipeline.configure(logging);
+  logPipeline.openFile(path.join(app.getPath('userData'), 'logs'));
+  console.log(`[Main] Log pipeline: level ${options.level}, batch ${options.batchMs}ms` +
+    (options.file ? `, file ${path.join(app.getPath('userData'), 'logs', 'server.log')}` : ''));
 }
 
 function initializeConfig() {
@@ -530,7 +670,7 @@ function startServerByFormat(modelConfig) {
   }
 }
 
-function startGgufServer(modelConfig) {
+async function startGgufServer(modelConfig) {
   if (!modelConfig) {
     console.error('[Server] No model config provided to startGgufServer');
     return;
@@ -562,9 +702,29 @@ function startGgufServer(modelConfig) {
     return;
   }
   
-  const args = ['-m', modelPath, '--metrics', '--port', '8080']; // --metrics 플래그 추가, 포트 명시
-  if (contextSize) args.push('-c', contextSize.toString());
-  if (gpuLayers !== undefined && gpuLayers !== null) args.push('-ngl', gpuLayers.toString());
+  // 이름 있는 prompt prefix 의 슬롯 KV 스냅샷 저장 위치
+  const slotSavePath = kvSnapshot.snapshotDir('gguf', modelConfig.id);
+  const args = ['-m', modelPath, '--metrics', '--port', '8080', '--slot-save-path', slotSavePath]; // --metrics 플래그 추가, 포트 명시
+  // 통합 메모리 예산(recommendedMaxWorkingSetSize)에 맞춘 -ngl / -c / KV 캐시 타입
+  const plan = await ggufPlanner.planGgufLaunch(modelConfig, { modelsDir: path.dirname(modelPath) }).catch((error) => ({ ok: false, error: error.message }));
+  if (currentModelConfig !== modelConfig) return; // 계획 중 다른 모델로 전환됨
+  ggufKvCache = plan.ok ? plan.kvCache : null;
+  if (plan.ok) {
+    const msg = `Auto-fit plan: ${ggufPlanner.describePlan(plan)}`;
+    console.log(`[Server] ${msg}`);
+    sendLog('log-message', `[INFO] ${msg}`);
+    args.push(...ggufPlanner.planArgs(plan));
+  } else {
+    console.log(`[Server] Auto-fit skipped: ${plan.error}`);
+    if (contextSize && contextSize !== 'auto') args.push('-c', contextSize.toString());
+    if (gpuLayers !== undefined && gpuLayers !== null && gpuLayers !== 'auto') args.push('-ngl', gpuLayers.toString());
+    args.push(...ggufPlanner.kvArgs(modelConfig));
+    args.push(...ggufPlanner.draftArgs(modelConfig, modelPath));
+  }
+  // 모델별 성능 프로필 (models-config.json performance: 슬롯 수, P 코어 스레드, 배치 크기 등)
+  const profile = perfProfile.resolveProfile(modelConfig);
+  sendLog('log-message', `[INFO] Performance profile: ${perfProfile.describeProfile(profile)}`);
+  args.push(...perfProfile.ggufArgs(profile, args));
   if (frequencyPenalty) args.push('--frequency-penalty', frequencyPenalty.toString());
   if (presencePenalty) args.push('--presence-penalty', presencePenalty.toString());
 
@@ -572,19 +732,27 @@ function startGgufServer(modelConfig) {
   console.log(`Starting server: ${commandString}`);
   sendLog('log-message', `[INFO] Starting server: ${commandString}`);
   
+  // llama-server 의 순차 읽기와 동시에 여러 스레드로 가중치를 페이지 캐시에 올림
+  modelPrewarmer.prewarm(modelConfig, 'load').catch((error) => console.error('[Server] Prewarm failed:', error.message));
   llamaServerProcess = spawn(serverExecutable, args);
+  perfProfile.promoteProcess(llamaServerProcess.pid);
+  ggufDraftStats = args.includes('-md') ? new speculative.DraftStats() : null;
+  const draftStats = ggufDraftStats;
 
+  // 청크를 줄로 나눠 레벨 필터를 거친 뒤 배치로 콘솔 / 로그 패널에 전달
+  const stdoutLog = logPipeline.source('');
+  const stderrLog = logPipeline.source('[STDERR] ');
   llamaServerProcess.stdout.on('data', (data) => {
-    const msg = data.toString();
-    console.log(msg);
-    sendLog('log-message', msg);
+    stdoutLog.write(data);
+    if (draftStats) draftStats.parse(data.toString());
   });
   llamaServerProcess.stderr.on('data', (data) => {
-    const msg = data.toString();
-    console.error(msg);
-    sendLog('log-message', `[STDERR] ${msg}`);
+    stderrLog.write(data);
+    if (draftStats) draftStats.parse(data.toString());
   });
   llamaServerProcess.on('close', (code) => {
+    stdoutLog.end();
+    stderrLog.end();
     const msg = `llama-server process exited with code ${code}`;
     console.log(msg);
     sendLog('log-message', `[INFO] ${msg}`);
@@ -597,6 +765,22 @@ function startGgufServer(modelConfig) {
   });
 
   currentServerType = 'gguf';
+
+  // 모델 로드가 끝나면 시스템 프롬프트 KV 를 스냅샷에서 복원 (없으면 prefill 후 저장)
+  const spawnedProcess = llamaServerProcess;
+  kvSnapshot.warmGgufPrefixes({
+    port: 8080,
+    modelPath,
+    slotSavePath,
+    isAlive: () => llamaServerProcess === spawnedProcess,
+    log: (line) => {
+      console.log(line);
+      sendLog('log-message', `[INFO] ${line}`);
+    }
+  }).catch((error) => {
+    console.error('[Server] KV snapshot warmup failed:', error.message);
+  });
+
   const msg = `[INFO] GGUF server started for model: ${modelPath}`;
   console.log(msg);
   sendLog('log-message', msg);
@@ -625,24 +809,24 @@ async function startMlxServer(modelConfig) {
       stdio: 'pipe',
       env: {
         ...process.env,
+        ...kvSnapshot.mlxSnapshotEnv(modelConfig.id),
+        ...speculative.mlxDraftEnv(modelConfig, path.join(__dirname, 'mlx', 'models')),
+        ...kvCacheType.mlxKvEnv(modelConfig),
+        ...perfProfile.mlxEnv(perfProfile.resolveProfile(modelConfig)),
         MLX_MODEL_PATH: modelPath,
         PORT: '8081'
       }
     });
+    perfProfile.promoteProcess(mlxServerProcess.pid);
     
-    mlxServerProcess.stdout.on('data', (data) => {
-      const output = data.toString();
-      console.log(`[MLX Server] ${output}`);
-      sendLog('log-message', `[MLX Server] ${output}`);
-    });
-    
-    mlxServerProcess.stderr.on('data', (data) => {
-      const output = data.toString();
-      console.error(`[MLX Server Error] ${output}`);
-      sendLog('log-message', `[MLX Server Error] ${output}`);
-    });
+    const stdoutLog = logPipeline.source('[MLX Server] ');
+    const stderrLog = logPipeline.source('[MLX Server Error] ');
+    mlxServerProcess.stdout.on('data', (data) => stdoutLog.write(data));
+    mlxServerProcess.stderr.on('data', (data) => stderrLog.write(data));
     
     mlxServerProcess.on('close', (code) => {
+      stdoutLog.end();
+      stderrLog.end();
       console.log(`[MLX Server] Process exited with code ${code}`);
       sendLog('log-message', `[MLX Server] Process exited with code ${code}`);
       mlxServerInstance = null;
@@ -691,6 +875,11 @@ function startAuthServer() {
 app.whenReady().then(() => {
   initVRAMInfo();
   initializeConfig();
+  configureLogPipeline();
+  // 네이티브 VRAM 샘플러: 백그라운드 스레드가 링 버퍼에 기록, IPC 는 구간 단위로 읽기만 함
+  if (nativeAddon && nativeAddon.startVRAMSampler) {
+    nativeAddon.startVRAMSampler(VRAM_SAMPLE_INTERVAL_MS);
+  }
   startAuthServer(); // 인증 서버 시작
 
   ipcMain.handle('load-config', async () => {
@@ -759,12 +948,37 @@ app.whenReady().then(() => {
       if (!fs.existsSync(modelPath)) {
         return { ok: false, error: 'File not found' };
       }
-      return parseGgufInfoFromFile(modelPath);
+      const stat = await fs.promises.stat(modelPath);
+      const cacheKey = `${modelPath}:${stat.size}:${stat.mtimeMs}`;
+      if (ggufInfoCache.has(cacheKey)) {
+        return ggufInfoCache.get(cacheKey);
+      }
+      // native 리더는 mmap + 워커 스레드에서 파싱하므로 메인 스레드를 막지 않음
+      const info = nativeAddon && nativeAddon.getGgufInfo
+        ? await nativeAddon.getGgufInfo(modelPath)
+        : parseGgufInfoFromFile(modelPath);
+      if (info && info.ok) {
+        ggufInfoCache.set(cacheKey, info);
+      }
+      return info;
     } catch (error) {
       return { ok: false, error: error.message || String(error) };
     }
   });
 
+  // 네이티브 샘플러의 VRAM/GPU 이력 (sinceTs 이후 샘플만 반환)
+  // 로그 패널: 배치 처리 완료 (backpressure), 창이 열릴 때 링 버퍼의 최근 줄, 드롭/필터 통계
+  ipcMain.on('log-ack', () => logPipeline.ack());
+  ipcMain.handle('get-log-history', async (_event, limit) => logPipeline.history(Number(limit) || undefined));
+  ipcMain.handle('get-log-stats', async () => logPipeline.stats());
+
+  ipcMain.handle('get-vram-samples', async (_event, sinceTs) => {
+    if (!nativeAddon || !nativeAddon.getVRAMSamples) {
+      return [];
+    }
+    return nativeAddon.getVRAMSamples(Number(sinceTs) || 0);
+  });
+
   ipcMain.handle('verify-mlx-model', async (_event, modelId) => {
     try {
       if (!modelId || typeof modelId !== 'string') {
@@ -833,126 +1047,61 @@ app.whenReady().then(() => {
       const usedMemory = totalMemory - freeMemory;
       const memoryUsagePercent = (usedMemory / totalMemory) * 100;
       
-      // CPU 사용량 (임시)
-      const cpuUsage = Math.random() * 100; 
-      
-      // GPU 사용량: 실제 GPU 처리량 (토큰 처리 속도 기반 또는 GPU 활성화 여부)
-      let gpuUsage = 0;
+      // CPU / GPU 사용량: 네이티브 카운터 (host_processor_info, IOAccelerator)
+      const counters = readSystemCounters();
+      const cpuUsage = counters.cpu;
+      const gpuUsage = counters.gpu;
       
       // VRAM 사용량: 별도로 계산 (GPU 사용량과 분리)
       let vramUsagePercent = 0;
       
-      // 항상 /metrics 엔드포인트에서 VRAM 정보 가져오기 시도
+      // llama-server /metrics 에서 VRAM 값만 스트리밍 파싱 (없으면 네이티브 샘플러 값)
       try {
-        const data = await new Promise((resolve, reject) => {
-          const req = http.get('http://localhost:8080/metrics', { timeout: 2000 }, (res) => {
-            let data = '';
-            res.on('data', (chunk) => { data += chunk; });
-            res.on('end', () => {
-              if (res.statusCode === 200) {
-                resolve(data);
-              } else {
-                reject(new Error(`HTTP ${res.statusCode}`));
-              }
-            });
-          });
-          req.on('error', reject);
-          req.on('timeout', () => {
-            req.destroy();
-            reject(new Error('Timeout'));
-          });
-        });
-
-        // 디버깅: 받은 데이터 확인
-        const vramLines = data.split('\n').filter(line => line.includes('vram') && !line.startsWith('#'));
-        console.log('[Main] VRAM lines from /metrics:', vramLines);
-
-        // GPU 사용량: 토큰 처리 속도 기반 계산
-        const tokensPerSecondMatch = data.match(/llamacpp:predicted_tokens_seconds\s+([\d.]+)/);
-        if (tokensPerSecondMatch) {
-          const tokensPerSecond = parseFloat(tokensPerSecondMatch[1]);
-          gpuUsage = Math.min((tokensPerSecond / 100) * 100, 100);
-        } else if (currentModelConfig && currentModelConfig.gpuLayers > 0) {
-          gpuUsage = 50;
-        }
-
-        // VRAM 사용량: 별도로 계산
-        const lines = data.split('\n');
-        let vramTotalMatch = null;
-        let vramUsedMatch = null;
-        let vramFreeMatch = null;
-
-        for (const line of lines) {
-          if (!vramTotalMatch && line.includes('vram_total_bytes') && !line.startsWith('#')) {
-            vramTotalMatch = line.match(/llamacpp:vram_total_bytes\s+([\d.e+\-]+)/);
-          }
-          if (!vramUsedMatch && line.includes('vram_used_bytes') && !line.startsWith('#')) {
-            vramUsedMatch = line.match(/llamacpp:vram_used_bytes\s+([\d.e+\-]+)/);
-          }
-          if (!vramFreeMatch && line.includes('vram_free_bytes') && !line.startsWith('#')) {
-            vramFreeMatch = line.match(/llamacpp:vram_free_bytes\s+([\d.e+\-]+)/);
-          }
-        }
-
-        console.log('[Main] VRAM parsing - Total match:', vramTotalMatch ? vramTotalMatch[1] : 'null');
-        console.log('[Main] VRAM parsing - Used match:', vramUsedMatch ? vramUsedMatch[1] : 'null');
-        console.log('[Main] VRAM parsing - Free match:', vramFreeMatch ? vramFreeMatch[1] : 'null');
-
-        if (vramTotalMatch && vramUsedMatch) {
-          const parsedTotal = Math.round(parseFloat(vramTotalMatch[1]));
-          const parsedUsed = Math.round(parseFloat(vramUsedMatch[1]));
-          console.log('[Main] VRAM parsed - Total:', parsedTotal, 'Used:', parsedUsed);
-
-          if (parsedTotal > 0 && parsedUsed >= 0) {
-            cachedVramTotal = parsedTotal;
-            cachedVramUsed = parsedUsed;
-            lastVramUpdateTime = Date.now();
-            vramUsagePercent = (cachedVramUsed / cachedVramTotal) * 100;
-            const logMsg = `[Main] VRAM from metrics: ${(cachedVramUsed / 1024 / 1024 / 1024).toFixed(2)} GB / ${(cachedVramTotal / 1024 / 1024 / 1024).toFixed(2)} GB (${vramUsagePercent.toFixed(1)}%)`;
-            console.log(logMsg);
-            sendLog('log-message', logMsg);
-          }
-        } else if (vramFreeMatch && vramTotalMatch) {
-          const parsedTotal = Math.round(parseFloat(vramTotalMatch[1]));
-          const vramFree = Math.round(parseFloat(vramFreeMatch[1]));
-          const calculatedUsed = parsedTotal - vramFree;
-          console.log('[Main] VRAM calculated - Total:', parsedTotal, 'Free:', vramFree, 'Used:', calculatedUsed);
-
-          if (parsedTotal > 0 && calculatedUsed >= 0) {
-            cachedVramTotal = parsedTotal;
-            cachedVramUsed = calculatedUsed;
-            lastVramUpdateTime = Date.now();
-            vramUsagePercent = (cachedVramUsed / cachedVramTotal) * 100;
-            const logMsg = `[Main] VRAM from metrics (calculated): ${(cachedVramUsed / 1024 / 1024 / 1024).toFixed(2)} GB / ${(cachedVramTotal / 1024 /
-1024 / 1024).toFixed(2)} GB (${vramUsagePercent.toFixed(1)}%)`;
-            console.log(logMsg);
-            sendLog('log-message', logMsg);
-          }
+        const values = await metricsHub.scrapePrometheus({ host: '127.0.0.1', port: 8080 }, VRAM_METRIC_NAMES, { timeoutMs: 2000 });
+        const total = values.get(GGUF_METRICS.vramTotal);
+        const used = values.has(GGUF_METRICS.vramUsed)
+          ? values.get(GGUF_METRICS.vramUsed)
+          : (total !== undefined && values.has(GGUF_METRICS.vramFree) ? total - values.get(GGUF_METRICS.vramFree) : undefined);
+        if (total > 0 && used >= 0) {
+          cachedVramTotal = Math.round(total);
+          cachedVramUsed = Math.round(used);
+          lastVramUpdateTime = Date.now();
         } else {
-          console.warn('[Main] VRAM metrics not found in /metrics response');
+          updateVramFromNativeSampler();
         }
+        metricsErrorLogged = false;
       } catch (error) {
-        const errorMsg = `[Main] Error fetching metrics: ${error.message}`;
-        console.error(errorMsg);
-        sendLog('log-message', errorMsg);
-        if (currentModelConfig && currentModelConfig.gpuLayers > 0) {
-          gpuUsage = 50;
+        // 서버가 내려가 있는 동안 매초 같은 오류를 남기지 않도록 상태가 바뀔 때 한 번만 기록
+        if (!metricsErrorLogged) {
+          const errorMsg = `[Main] Error fetching metrics: ${error.message}`;
+          console.error(errorMsg);
+          sendLog('log-message', errorMsg);
+          metricsErrorLogged = true;
         }
+        updateVramFromNativeSampler();
+      }
+      if (cachedVramTotal > 0) {
+        vramUsagePercent = (cachedVramUsed / cachedVramTotal) * 100;
       }
-      
-          // 디버깅: 반환되는 값 확인
-      console.log('[Main] Returning metrics - llamaServerProcess:', !!llamaServerProcess, 'vramTotal:', cachedVramTotal, 'vramUsed:', cachedVramUsed, 'vramUsage:', Math.round(vramUsagePercent), 'vramUsagePercent:', vramUsagePercent, 'lastUpdate:', lastVramUpdateTime > 0 ? new Date(lastVramUpdateTime).toISOString() : 'never');
       
       return {
         cpu: Math.round(cpuUsage),
-        gpu: Math.round(gpuUsage), // GPU 사용량 (처리량 기반)
+        gpu: Math.round(gpuUsage), // GPU 사용량 (IOAccelerator Device Utilization %)
+        cpuProcess: counters.cpuProcess, // 추론 서버 프로세스 CPU (전체 코어 대비 %)
+        gpuRenderer: counters.gpuRenderer,
+        gpuTiler: counters.gpuTiler,
+        memoryPressure: counters.memoryPressure, // 1 normal, 2 warn, 4 critical
+        swapUsed: counters.swapUsed,
+        compressedMemory: counters.compressedMemory,
         memory: Math.round(memoryUsagePercent),
         totalMemory: totalMemory,
         usedMemory: usedMemory,
         freeMemory: freeMemory,
         vramTotal: cachedVramTotal, // VRAM 총량
         vramUsed: cachedVramUsed, // VRAM 사용량
-        vramUsage: Math.round(vramUsagePercent) // VRAM 점유율 (%)
+        vramUsage: Math.round(vramUsagePercent), // VRAM 점유율 (%)
+        speculative: currentServerType === 'gguf' && ggufDraftStats ? ggufDraftStats.toJSON() : null, // draft 수락률
+        kvCache: currentServerType === 'gguf' ? ggufKvCache : null // KV 캐시 타입과 VRAM 중 KV 몫
       };
     } catch (error) {
       console.error('Failed to get system metrics:', error);
@@ -968,6 +1117,8 @@ app.whenReady().then(() => {
 });
 
 app.on('window-all-closed', () => {
+  logPipeline.flush();
+  logPipeline.closeFile();
   if (llamaServerProcess) {
     llamaServerProcess.kill();
   }
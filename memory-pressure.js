@@ -0,0 +1,96 @@
+// 통합 메모리 압력 감시 (native startMemoryPressureMonitor)
+//
+// dispatch MEMORYPRESSURE 알림과 vm_statistics64 의 swapout / 압축 속도로
+// 'normal' | 'warn' | 'critical' 단계를 정하고, 단계가 바뀌면 'change' 이벤트를 냅니다.
+// 스왑이 시작되면 디코드 속도가 급격히 떨어지므로, 커널 알림보다 먼저 오는
+// 압축/스왑 속도 증가를 기준으로 manager 가 부하를 줄이게 합니다 (start-client-server.js 의 정책).
+//
+// 네이티브 모니터를 쓸 수 없으면 getSystemCounters 의 memory.pressureLevel 을 주기적으로 읽습니다.
+const EventEmitter = require('events');
+
+let nativeAddon = null;
+try {
+  nativeAddon = require('./native');
+} catch (error) {
+  // 빌드되지 않은 환경: 메모리 압력 감시 없음
+}
+
+const LEVELS = ['normal', 'warn', 'critical'];
+const FALLBACK_POLL_MS = 2000;
+// kern.memorystatus_vm_pressure_level: 1 normal, 2 warn, 4 critical
+const KERNEL_LEVELS = { 1: 'normal', 2: 'warn', 4: 'critical' };
+
+class MemoryPressureWatcher extends EventEmitter {
+  constructor({ intervalMs = Number(process.env.MEMORY_PRESSURE_INTERVAL_MS || 1000), log = console.log } = {}) {
+    super();
+    this.intervalMs = intervalMs;
+    this.log = log;
+    this.level = 'normal';
+    this.latest = null;
+    this.changedAt = null;
+    this.changes = 0;
+    this.source = null; // 'native' | 'poll'
+    this.pollTimer = null;
+  }
+
+  start() {
+    if (this.source || !nativeAddon) return;
+    if (nativeAddon.startMemoryPressureMonitor) {
+      const result = nativeAddon.startMemoryPressureMonitor((event) => this.handle(event), { intervalMs: this.intervalMs });
+      if (result && result.running) {
+        this.source = 'native';
+        return;
+      }
+    }
+    if (nativeAddon.getSystemCounters) {
+      this.source = 'poll';
+      this.pollTimer = setInterval(() => {
+        const counters = nativeAddon.getSystemCounters([], 'memory-pressure');
+        const kernelLevel = counters && counters.memory ? KERNEL_LEVELS[counters.memory.pressureLevel] : null;
+        if (kernelLevel) this.handle({ ts: Date.now(), level: kernelLevel, kernelLevel, reason: 'kernel' });
+      }, FALLBACK_POLL_MS);
+      this.pollTimer.unref();
+    }
+  }
+
+  stop() {
+    if (this.source === 'native') nativeAddon.stopMemoryPressureMonitor();
+    if (this.pollTimer) clearInterval(this.pollTimer);
+    this.pollTimer = null;
+    this.source = null;
+  }
+
+  handle(event) {
+    this.latest = event;
+    if (!LEVELS.includes(event.level) || event.level === this.level) return;
+    const previous = this.level;
+    this.level = event.level;
+    this.changedAt = event.ts || Date.now();
+    this.changes++;
+    const rates = event.swapoutBytesPerSec !== undefined
+      ? ` (swapout ${formatRate(event.swapoutBytesPerSec)}, compress ${formatRate(event.compressBytesPerSec)})`
+      : '';
+    this.log(`[Memory Pressure] ${previous} → ${event.level}: ${event.reason || 'kernel'}${rates}`);
+    this.emit('change', event.level, event, previous);
+  }
+
+  isNormal() {
+    return this.level === 'normal';
+  }
+
+  stats() {
+    return {
+      source: this.source,
+      level: this.level,
+      changedAt: this.changedAt,
+      changes: this.changes,
+      latest: this.source === 'native' ? nativeAddon.getMemoryPressure() || this.latest : this.latest
+    };
+  }
+}
+
+function formatRate(bytesPerSec) {
+  return `${((bytesPerSec || 0) / 1024 / 1024).toFixed(1)} MB/s`;
+}
+
+module.exports = { MemoryPressureWatcher, LEVELS };
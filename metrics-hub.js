@@ -0,0 +1,470 @@
+// 통합 메트릭: GGUF(llama-server Prometheus 텍스트) / MLX(JSON) 백엔드를 하나의 스키마로 정규화
+//
+// - PrometheusStreamParser: /metrics 응답을 청크 단위로 받아 한 번의 스캔으로 샘플을 넘김
+//   (전체 텍스트를 모으거나 줄마다 정규식을 돌리지 않음). 필요한 이름만 골라 담습니다.
+// - 카운터는 이전 수집값과의 차이로 속도를 계산합니다 (prefill/decode t/s).
+// - TTFT / ITL 은 라우터가 전달하는 SSE 스트림에서 직접 잽니다 (백엔드 종류와 무관하게 같은 기준).
+// - MetricsHub: 주기마다 한 번만 수집해 Prometheus 텍스트(GET /metrics)와
+//   SSE push 스트림(GET /metrics/stream: 첫 이벤트 snapshot, 이후 바뀐 필드만 delta)으로 제공
+//
+// 정규화 스키마 (backends[id]):
+//   { id, backend: 'gguf' | 'mlx', model, modelPath, remote, prefillTps, decodeTps, tps,
+//     ttftMs: { p50, p99 }, itlMs: { p50, p99 }, queueDepth, activeRequests,
+//     kvUsage, kvTokens, kvCache, vramUsed, vramTotal, promptTokensTotal, predictedTokensTotal }
+const http = require('http');
+
+const SCRAPE_TIMEOUT_MS = 3000;
+const LATENCY_WINDOW = 1024; // 분위수 계산에 쓰는 최근 샘플 수
+const TOKEN_EVENT_MARKER = '"content"'; // 토큰 이벤트 (llama-server / MLX 공통 필드, 프롬프트 정보 이벤트에는 없음)
+const FRAME_COUNT_PATTERN = /"n":\s*(\d+)/; // MLX coalesced 프레임의 토큰 수 (mlx/stream_framing.py)
+
+const EMPTY_CONTENT_PATTERN = /^"content":\s*""/; // llama-server 최종 이벤트 등 토큰이 아닌 빈 content
+
+// SSE 텍스트 조각의 토큰 수: 내용이 있는 "content" 이벤트마다 1, coalesced 프레임이면 "n"
+// (라우터의 메트릭 / 트래픽 기록 / 재생 / span 기록이 모두 이 기준을 씀 — 프레임 형식이 바뀌면 여기만 고침)
+function countStreamTokens(text) {
+  let tokens = 0;
+  for (let i = text.indexOf(TOKEN_EVENT_MARKER); i !== -1; i = text.indexOf(TOKEN_EVENT_MARKER, i + TOKEN_EVENT_MARKER.length)) {
+    const end = text.indexOf('\n', i);
+    const event = text.slice(i, end === -1 ? undefined : end);
+    const frame = FRAME_COUNT_PATTERN.exec(event);
+    if (frame) tokens += Math.max(1, Number(frame[1]));
+    else if (!EMPTY_CONTENT_PATTERN.test(event)) tokens++;
+  }
+  return tokens;
+}
+
+const GGUF_METRICS = {
+  promptTokens: 'llamacpp:prompt_tokens_total',
+  promptSeconds: 'llamacpp:prompt_seconds_total',
+  predictedTokens: 'llamacpp:tokens_predicted_total',
+  predictedSeconds: 'llamacpp:tokens_predicted_seconds_total',
+  promptTps: 'llamacpp:prompt_tokens_seconds',
+  predictedTps: 'llamacpp:predicted_tokens_seconds',
+  processing: 'llamacpp:requests_processing',
+  deferred: 'llamacpp:requests_deferred',
+  kvUsage: 'llamacpp:kv_cache_usage_ratio',
+  kvTokens: 'llamacpp:kv_cache_tokens',
+  vramTotal: 'llamacpp:vram_total_bytes',
+  vramUsed: 'llamacpp:vram_used_bytes',
+  vramFree: 'llamacpp:vram_free_bytes'
+};
+const GGUF_METRIC_NAMES = new Set(Object.values(GGUF_METRICS));
+
+function isSpace(code) {
+  return code === 32 || code === 9 || code === 13;
+}
+
+// Prometheus 텍스트 형식의 증분 파서. onSample(name, labels, value) 는 샘플 줄마다 호출되고
+// labels 는 중괄호 안의 원문 문자열입니다 (레이블이 없으면 '').
+class PrometheusStreamParser {
+  constructor(onSample) {
+    this.onSample = onSample;
+    this.rest = '';
+    this.types = new Map(); // # TYPE 주석: name -> counter | gauge | ...
+  }
+
+  write(chunk) {
+    const text = this.rest ? this.rest + chunk : String(chunk);
+    let start = 0;
+    let newline;
+    while ((newline = text.indexOf('\n', start)) !== -1) {
+      this.line(text, start, newline);
+      start = newline + 1;
+    }
+    this.rest = start < text.length ? text.slice(start) : '';
+  }
+
+  end() {
+    if (this.rest) this.line(this.rest, 0, this.rest.length);
+    this.rest = '';
+  }
+
+  line(text, start, end) {
+    while (start < end && isSpace(text.charCodeAt(start))) start++;
+    if (start >= end) return;
+    if (text.charCodeAt(start) === 35) { // '#'
+      if (text.startsWith('# TYPE ', start)) {
+        const parts = text.slice(start + 7, end).trim().split(/\s+/);
+        if (parts.length >= 2) this.types.set(parts[0], parts[1]);
+      }
+      return;
+    }
+    let i = start;
+    while (i < end && text.charCodeAt(i) !== 123 && !isSpace(text.charCodeAt(i))) i++; // '{'
+    const name = text.slice(start, i);
+    let labels = '';
+    if (text.charCodeAt(i) === 123) {
+      const close = text.indexOf('}', i);
+      if (close === -1 || close > end) return;
+      labels = text.slice(i + 1, close);
+      i = close + 1;
+    }
+    while (i < end && isSpace(text.charCodeAt(i))) i++;
+    let j = i;
+    while (j < end && !isSpace(text.charCodeAt(j))) j++;
+    const value = Number(text.slice(i, j));
+    if (name && Number.isFinite(value)) this.onSample(name, labels, value);
+  }
+}
+
+// target({ host, port }) 의 /metrics 에서 names 에 있는 레이블 없는 샘플만 Map 으로 수집
+function scrapePrometheus(target, names, { headers = {}, timeoutMs = SCRAPE_TIMEOUT_MS } = {}) {
+  return new Promise((resolve, reject) => {
+    const values = new Map();
+    const parser = new PrometheusStreamParser((name, labels, value) => {
+      if (!labels && names.has(name)) values.set(name, value);
+    });
+    const req = http.get({ host: target.host, port: target.port, path: '/metrics', headers }, (res) => {
+      if (res.statusCode !== 200) {
+        res.resume();
+        reject(new Error(`HTTP ${res.statusCode}`));
+        return;
+      }
+      res.setEncoding('utf8');
+      res.on('data', (chunk) => parser.write(chunk));
+      res.on('end', () => {
+        parser.end();
+        resolve(values);
+      });
+      res.on('error', reject);
+    });
+    req.on('error', reject);
+    req.setTimeout(timeoutMs, () => req.destroy(new Error('metrics timeout')));
+  });
+}
+
+function fetchJson(target, pathname, { headers = {}, timeoutMs = SCRAPE_TIMEOUT_MS } = {}) {
+  return new Promise((resolve, reject) => {
+    const req = http.get({ host: target.host, port: target.port, path: pathname, headers }, (res) => {
+      let data = '';
+      res.setEncoding('utf8');
+      res.on('data', (chunk) => { data += chunk; });
+      res.on('end', () => {
+        if (res.statusCode !== 200) {
+          reject(new Error(`HTTP ${res.statusCode}`));
+          return;
+        }
+        try {
+          resolve(JSON.parse(data));
+        } catch (error) {
+          reject(error);
+        }
+      });
+      res.on('error', reject);
+    });
+    req.on('error', reject);
+    req.setTimeout(timeoutMs, () => req.destroy(new Error(`${pathname} timeout`)));
+  });
+}
+
+// 최근 샘플의 분위수 (고정 크기 링 버퍼)
+class LatencyWindow {
+  constructor(capacity = LATENCY_WINDOW) {
+    this.samples = new Float64Array(capacity);
+    this.size = 0;
+    this.next = 0;
+  }
+
+  record(value) {
+    this.samples[this.next] = value;
+    this.next = (this.next + 1) % this.samples.length;
+    if (this.size < this.samples.length) this.size++;
+  }
+
+  quantiles() {
+    if (this.size === 0) return { p50: null, p99: null };
+    const sorted = Array.from(this.samples.subarray(0, this.size)).sort((a, b) => a - b);
+    const at = (q) => sorted[Math.min(sorted.length - 1, Math.floor(q * sorted.length))];
+    return { p50: round(at(0.5)), p99: round(at(0.99)) };
+  }
+}
+
+function round(value, digits = 2) {
+  if (value === null || value === undefined || !Number.isFinite(value)) return null;
+  const scale = 10 ** digits;
+  return Math.round(value * scale) / scale;
+}
+
+// 카운터의 이전 수집값 대비 증가분 (서버 재시작으로 줄어들면 새 값 기준)
+function counterDelta(prev, current) {
+  if (current === undefined) return 0;
+  if (prev === undefined || current < prev) return current;
+  return current - prev;
+}
+
+// 바뀐 최상위 필드만 담은 객체 (중첩 객체는 값으로 비교), 바뀐 게 없으면 null
+function diffFields(prev, next) {
+  let changes = null;
+  for (const key of Object.keys(next)) {
+    const a = prev ? prev[key] : undefined;
+    const b = next[key];
+    const same = a === b || (typeof b === 'object' && b !== null && JSON.stringify(a) === JSON.stringify(b));
+    if (!same) (changes || (changes = {}))[key] = b;
+  }
+  return changes;
+}
+
+class MetricsHub {
+  // listSources(): [{ id, backend, model, modelPath, host, port, remote }]
+  // readSystem(): 호스트 메트릭 객체 (cpuUsage, gpuUsage, sysMemTotal, sysMemUsed, vramTotal, vramUsed, ...)
+  constructor({ listSources, readSystem = () => ({}), intervalMs = 1000, requestHeaders = {}, log = console.log }) {
+    this.listSources = listSources;
+    this.readSystem = readSystem;
+    this.intervalMs = intervalMs;
+    this.requestHeaders = requestHeaders;
+    this.log = log;
+    this.latency = new Map(); // source id -> { ttft, itl }
+    this.previous = new Map(); // source id -> { counters, at, prefillTps, decodeTps }
+    this.snapshot = null;
+    this.collecting = null;
+    this.subscribers = new Set();
+    this.timer = null;
+  }
+
+  latencyFor(id) {
+    if (!this.latency.has(id)) this.latency.set(id, { ttft: new LatencyWindow(), itl: new LatencyWindow() });
+    return this.latency.get(id);
+  }
+
+  // 라우터가 전달하는 SSE 응답에서 TTFT(요청 시작 → 첫 토큰 이벤트)와 토큰 간 간격 측정
+  // 청크 하나에 이벤트가 여러 개 묶여 오거나 coalesced 프레임("n" 개의 토큰)이면 간격을 토큰 수로 나눕니다.
+  observeStream(id, upstreamRes, startedAt) {
+    if (upstreamRes.statusCode !== 200 || !(upstreamRes.headers['content-type'] || '').includes('text/event-stream')) return;
+    const stats = this.latencyFor(id);
+    let last = 0;
+    upstreamRes.on('data', (chunk) => {
+      const now = Date.now();
+      const events = countStreamTokens(chunk.toString('utf8'));
+      if (events === 0) return;
+      if (!last) {
+        stats.ttft.record(now - startedAt);
+      } else {
+        const gap = (now - last) / events;
+        for (let k = 0; k < events; k++) stats.itl.record(gap);
+      }
+      last = now;
+    });
+  }
+
+  async collectSource(source, now) {
+    const prev = this.previous.get(source.id) || {};
+    const latency = this.latencyFor(source.id);
+    const entry = {
+      id: source.id,
+      backend: source.backend,
+      model: source.model || null,
+      modelPath: source.modelPath || null,
+      remote: Boolean(source.remote),
+      prefillTps: prev.prefillTps ?? null,
+      decodeTps: prev.decodeTps ?? null,
+      tps: 0,
+      ttftMs: latency.ttft.quantiles(),
+      itlMs: latency.itl.quantiles(),
+      queueDepth: null,
+      activeRequests: null,
+      kvUsage: null,
+      kvTokens: null,
+      kvCache: source.kvCache || null,
+      vramUsed: null,
+      vramTotal: null,
+      promptTokensTotal: null,
+      predictedTokensTotal: null
+    };
+    const elapsed = prev.at ? (now - prev.at) / 1000 : 0;
+
+    if (source.backend === 'gguf') {
+      const v = await scrapePrometheus(source, GGUF_METRIC_NAMES, { headers: this.requestHeaders });
+      const counters = {
+        promptTokens: v.get(GGUF_METRICS.promptTokens),
+        promptSeconds: v.get(GGUF_METRICS.promptSeconds),
+        predictedTokens: v.get(GGUF_METRICS.predictedTokens),
+        predictedSeconds: v.get(GGUF_METRICS.predictedSeconds)
+      };
+      const old = prev.counters || {};
+      const dPrompt = counterDelta(old.promptTokens, counters.promptTokens);
+      const dPromptSec = counterDelta(old.promptSeconds, counters.promptSeconds);
+      const dPredicted = counterDelta(old.predictedTokens, counters.predictedTokens);
+      const dPredictedSec = counterDelta(old.predictedSeconds, counters.predictedSeconds);
+      if (prev.counters && dPromptSec > 0) entry.prefillTps = round(dPrompt / dPromptSec);
+      if (prev.counters && dPredictedSec > 0) entry.decodeTps = round(dPredicted / dPredictedSec);
+      // 카운터가 없는 구버전: 누적 평균 게이지
+      if (entry.prefillTps === null && v.has(GGUF_METRICS.promptTps)) entry.prefillTps = round(v.get(GGUF_METRICS.promptTps));
+      if (entry.decodeTps === null && v.has(GGUF_METRICS.predictedTps)) entry.decodeTps = round(v.get(GGUF_METRICS.predictedTps));
+      entry.tps = prev.counters && elapsed > 0 ? round(dPredicted / elapsed) : 0;
+      entry.queueDepth = v.get(GGUF_METRICS.deferred) ?? null;
+      entry.activeRequests = v.get(GGUF_METRICS.processing) ?? null;
+      entry.kvUsage = v.get(GGUF_METRICS.kvUsage) ?? null;
+      entry.kvTokens = v.get(GGUF_METRICS.kvTokens) ?? null;
+      entry.vramTotal = v.get(GGUF_METRICS.vramTotal) ?? null;
+      entry.vramUsed = v.get(GGUF_METRICS.vramUsed) ??
+        (entry.vramTotal !== null && v.has(GGUF_METRICS.vramFree) ? entry.vramTotal - v.get(GGUF_METRICS.vramFree) : null);
+      entry.promptTokensTotal = counters.promptTokens ?? null;
+      entry.predictedTokensTotal = counters.predictedTokens ?? null;
+      this.previous.set(source.id, { counters, at: now, prefillTps: entry.prefillTps, decodeTps: entry.decodeTps });
+    } else {
+      const m = await fetchJson(source, '/metrics', { headers: this.requestHeaders });
+      const counters = { predictedTokens: Number(m.predictedTotal) || 0 };
+      const dPredicted = counterDelta((prev.counters || {}).predictedTokens, counters.predictedTokens);
+      entry.tps = prev.counters && elapsed > 0 ? round(dPredicted / elapsed) : round(Number(m.tps) || 0);
+      // MLX 서버는 배치 전체 속도(tps)와 스텝 시간을 보고: 단일 시퀀스 decode 속도는 1000 / lastStepMs
+      if (m.lastStepMs > 0) entry.decodeTps = round(1000 / m.lastStepMs);
+      entry.queueDepth = m.queueLength ?? null;
+      entry.activeRequests = m.activeRequests ?? null;
+      entry.kvCache = m.kvCache || entry.kvCache;
+      entry.vramTotal = m.vramTotal ?? null;
+      entry.vramUsed = m.vramUsed ?? null;
+      entry.predictedTokensTotal = counters.predictedTokens;
+      this.previous.set(source.id, { counters, at: now, prefillTps: entry.prefillTps, decodeTps: entry.decodeTps });
+    }
+    return entry;
+  }
+
+  // 모든 백엔드를 동시에 수집 (진행 중인 수집이 있으면 그 결과를 함께 기다림)
+  collect() {
+    if (!this.collecting) {
+      this.collecting = this.collectNow().finally(() => { this.collecting = null; });
+    }
+    return this.collecting;
+  }
+
+  async collectNow() {
+    const now = Date.now();
+    const sources = this.listSources();
+    const results = await Promise.all(sources.map(source => this.collectSource(source, now).catch(() => null)));
+    const backends = {};
+    for (const entry of results) {
+      if (entry) backends[entry.id] = entry;
+    }
+    // 사라진 백엔드의 이전 카운터 정리
+    for (const id of [...this.previous.keys()]) {
+      if (!sources.some(s => s.id === id)) this.previous.delete(id);
+    }
+    let system = {};
+    try {
+      system = this.readSystem() || {};
+    } catch (error) {
+      // 호스트 메트릭 없이 진행
+    }
+    const previous = this.snapshot;
+    this.snapshot = { timestamp: now, system, backends };
+    this.publish(previous, this.snapshot);
+    return this.snapshot;
+  }
+
+  // 주기보다 오래된 스냅샷이면 새로 수집
+  async current() {
+    if (!this.snapshot || Date.now() - this.snapshot.timestamp > this.intervalMs) return this.collect();
+    return this.snapshot;
+  }
+
+  publish(previous, next) {
+    if (this.subscribers.size === 0) return;
+    const delta = { timestamp: next.timestamp, system: diffFields(previous && previous.system, next.system), backends: {} };
+    let changed = Boolean(delta.system);
+    for (const [id, entry] of Object.entries(next.backends)) {
+      const changes = diffFields(previous && previous.backends[id], entry);
+      if (changes) {
+        delta.backends[id] = changes;
+        changed = true;
+      }
+    }
+    for (const id of Object.keys((previous && previous.backends) || {})) {
+      if (!next.backends[id]) {
+        delta.backends[id] = null; // 제거됨
+        changed = true;
+      }
+    }
+    if (!delta.system) delete delta.system;
+    if (!changed) return;
+    const message = `event: delta\ndata: ${JSON.stringify(delta)}\n\n`;
+    for (const res of this.subscribers) res.write(message);
+  }
+
+  // SSE 구독: 첫 이벤트는 전체 snapshot, 이후 delta (구독자가 있을 때만 주기 수집)
+  async subscribe(req, res) {
+    res.writeHead(200, {
+      'Content-Type': 'text/event-stream',
+      'Cache-Control': 'no-cache',
+      Connection: 'keep-alive',
+      'Access-Control-Allow-Origin': '*'
+    });
+    const snapshot = await this.current();
+    res.write(`event: snapshot\ndata: ${JSON.stringify(snapshot)}\n\n`);
+    this.subscribers.add(res);
+    if (!this.timer) {
+      this.timer = setInterval(() => this.collect(), this.intervalMs);
+    }
+    req.on('close', () => {
+      this.subscribers.delete(res);
+      if (this.subscribers.size === 0 && this.timer) {
+        clearInterval(this.timer);
+        this.timer = null;
+      }
+    });
+  }
+
+  // 정규화 스키마 → Prometheus 텍스트
+  async prometheus() {
+    const snapshot = await this.current();
+    const lines = [];
+    const family = (name, type, help, samples) => {
+      const present = samples.filter(([, value]) => value !== null && value !== undefined && Number.isFinite(Number(value)));
+      if (present.length === 0) return;
+      lines.push(`# HELP ${name} ${help}`, `# TYPE ${name} ${type}`);
+      for (const [labels, value] of present) lines.push(`${name}${labels} ${Number(value)}`);
+    };
+    const entries = Object.values(snapshot.backends);
+    const labelsOf = (e, extra = '') => {
+      const pairs = [`backend="${e.backend}"`, `worker="${escapeLabel(e.id)}"`];
+      if (e.model) pairs.push(`model="${escapeLabel(e.model)}"`);
+      if (extra) pairs.push(extra);
+      return `{${pairs.join(',')}}`;
+    };
+    const perBackend = (name, type, help, pick) => family(name, type, help, entries.map(e => [labelsOf(e), pick(e)]));
+    const quantiles = (name, help, pick, scale) => family(name, 'gauge', help, entries.flatMap(e => {
+      const q = pick(e) || {};
+      return [
+        [labelsOf(e, 'quantile="0.5"'), q.p50 === null || q.p50 === undefined ? null : q.p50 * scale],
+        [labelsOf(e, 'quantile="0.99"'), q.p99 === null || q.p99 === undefined ? null : q.p99 * scale]
+      ];
+    }));
+
+    perBackend('llm_prefill_tokens_per_second', 'gauge', 'Prompt processing speed per sequence', e => e.prefillTps);
+    perBackend('llm_decode_tokens_per_second', 'gauge', 'Generation speed per sequence', e => e.decodeTps);
+    perBackend('llm_generated_tokens_per_second', 'gauge', 'Generated tokens per second across all sequences', e => e.tps);
+    quantiles('llm_ttft_seconds', 'Time to first token measured at the router', e => e.ttftMs, 1 / 1000);
+    quantiles('llm_itl_seconds', 'Inter-token latency measured at the router', e => e.itlMs, 1 / 1000);
+    perBackend('llm_queue_depth', 'gauge', 'Requests waiting for a slot', e => e.queueDepth);
+    perBackend('llm_active_requests', 'gauge', 'Requests being processed', e => e.activeRequests);
+    perBackend('llm_kv_cache_usage_ratio', 'gauge', 'KV cache usage (0-1)', e => e.kvUsage);
+    perBackend('llm_kv_cache_bytes', 'gauge', 'KV cache size', e => (e.kvCache ? e.kvCache.bytes : null));
+    perBackend('llm_vram_used_bytes', 'gauge', 'GPU memory used as reported by the backend', e => e.vramUsed);
+    perBackend('llm_vram_total_bytes', 'gauge', 'GPU memory available to the backend', e => e.vramTotal);
+    perBackend('llm_prompt_tokens_total', 'counter', 'Prompt tokens processed', e => e.promptTokensTotal);
+    perBackend('llm_generated_tokens_total', 'counter', 'Tokens generated', e => e.predictedTokensTotal);
+
+    const s = snapshot.system;
+    family('llm_host_cpu_usage_percent', 'gauge', 'Host CPU usage', [['', s.cpuUsage]]);
+    family('llm_host_gpu_usage_percent', 'gauge', 'Host GPU device utilization', [['', s.gpuUsage]]);
+    family('llm_host_memory_used_bytes', 'gauge', 'Host memory used', [['', s.sysMemUsed]]);
+    family('llm_host_memory_total_bytes', 'gauge', 'Host memory total', [['', s.sysMemTotal]]);
+    family('llm_host_vram_used_bytes', 'gauge', 'Metal memory allocated on this host', [['', s.vramUsed]]);
+    family('llm_host_vram_total_bytes', 'gauge', 'Metal recommended working set on this host', [['', s.vramTotal]]);
+    family('llm_host_memory_pressure', 'gauge', 'Memory pressure level (1 normal, 2 warn, 4 critical)', [['', s.memoryPressure]]);
+    return `${lines.join('\n')}\n`;
+  }
+}
+
+function escapeLabel(value) {
+  return String(value).replace(/\\/g, '\\\\').replace(/"/g, '\\"').replace(/\n/g, '\\n');
+}
+
+module.exports = {
+  GGUF_METRICS,
+  countStreamTokens,
+  PrometheusStreamParser,
+  scrapePrometheus,
+  LatencyWindow,
+  MetricsHub
+};
@@ -0,0 +1,755 @@
+"""
+MLX 연속 배칭(continuous batching) 스케줄러
+
+진행 중인 모든 요청을 하나의 배치 디코드 스텝으로 묶어 처리합니다.
+- 전용 스레드 하나가 모델을 독점하고, 매 스텝 사이에 대기 중인 프롬프트를 받아들입니다
+  (새 프롬프트는 left padding 으로 함께 prefill 한 뒤 진행 중인 배치에 합쳐집니다).
+- prefill_chunk_tokens 가 주어지면 디코드 중인 요청이 있을 때 prefill 을 스텝당 그 토큰 수만큼만
+  진행합니다. 긴 프롬프트는 여러 스텝에 걸쳐 디코드 스텝 사이사이에 처리되므로, 진행 중인
+  스트림의 토큰 간격(ITL)이 프롬프트 길이만큼 멈추지 않습니다. 토큰 간격 분포는 stats() 의 itlMs.
+- 샘플링 파라미터(temperature, top_p, min_p, repetition penalty)는 요청마다 따로 적용합니다.
+- 토큰은 요청별 asyncio.Queue 로 이벤트 루프에 전달되어 각 엔드포인트가 스트리밍합니다.
+- decoder_factory 로 네이티브 디토크나이저(native_detok.py)를 주면 토큰당 디코딩 비용이 일정합니다.
+- prefix_cache 가 주어지면 끝난 요청의 KV 를 저장하고, 공통 prefix 를 가진 새 요청은
+  나머지 토큰만 prefill 합니다 (prefix_cache.py).
+- draft_model 이 주어지면 요청이 하나뿐일 때 추측 디코딩(draft-and-verify)을 합니다.
+  draft 모델이 num_draft_tokens 개를 제안하고 대상 모델이 한 번의 forward 로 검증해,
+  샘플링 결과가 일치하는 앞부분 + 대상 모델의 다음 토큰을 내보냅니다 (mlx_lm 의
+  speculative_generate_step 과 같은 수락 규칙). 동시 요청이 있으면 일반 배치 디코드로 돌아갑니다.
+- kv_bits 가 주어지면 prefill 첫 청크 이후 KV 캐시를 QuantizedKVCache(8/4 bit)로 바꿉니다.
+  BatchKVCache 에는 양자화 버전이 없으므로 이때는 순차 모드로 동작하고,
+  prefix 캐시에는 역양자화한 KV 를 저장합니다 (재사용 시 다시 양자화).
+
+mlx_lm 에 BatchKVCache 가 없거나 모델 캐시가 배치를 지원하지 않으면
+동시 실행 수 1 의 순차 모드로 동작합니다 (거절 대신 대기열에서 순서를 기다림).
+"""
+import asyncio
+import itertools
+import re
+import threading
+import time
+from collections import deque
+from typing import Callable, List, Optional
+
+import mlx.core as mx
+from mlx_lm.models.cache import KVCache, make_prompt_cache
+
+try:
+    from mlx_lm.models.cache import can_trim_prompt_cache, trim_prompt_cache
+except ImportError:
+    # 캐시 되감기를 지원하지 않는 mlx_lm: 추측 디코딩 비활성화
+    can_trim_prompt_cache = trim_prompt_cache = None
+
+from prefix_cache import PrefixCache
+
+try:
+    from mlx_lm.models.cache import BatchKVCache
+except ImportError:
+    # mlx_lm 0.26 미만: 배치 KV 캐시 없음
+    BatchKVCache = None
+
+SPECIAL_TOKEN_PATTERN = re.compile(r'<\|[^>]*\|>')
+
+
+class IncrementalDecoder:
+    """토큰을 하나씩 받아 새로 확정된 텍스트만 돌려주는 디코더
+
+    멀티바이트 문자가 여러 토큰에 걸쳐 있으면 문자가 완성될 때까지(\\ufffd 가 사라질 때까지)
+    출력을 미룹니다. 디코딩은 마지막으로 확정된 지점 이후의 토큰에 대해서만 수행합니다.
+    """
+
+    def __init__(self, tokenizer):
+        self.tokenizer = tokenizer
+        self.tokens: List[int] = []
+        self.prefix_offset = 0
+        self.read_offset = 0
+
+    def _decode(self, tokens):
+        text = self.tokenizer.decode(tokens, skip_special_tokens=True)
+        return SPECIAL_TOKEN_PATTERN.sub('', text)
+
+    def add(self, token_id: int) -> str:
+        self.tokens.append(token_id)
+        prefix_text = self._decode(self.tokens[self.prefix_offset:self.read_offset])
+        new_text = self._decode(self.tokens[self.prefix_offset:])
+        if len(new_text) > len(prefix_text) and not new_text.endswith('\ufffd'):
+            delta = new_text[len(prefix_text):]
+            self.prefix_offset = self.read_offset
+            self.read_offset = len(self.tokens)
+            return delta
+        return ""
+
+    def flush(self) -> str:
+        """남은 토큰을 강제로 디코딩 (완료 시점에 호출, 끊긴 멀티바이트 문자는 \ufffd 로 남겨 잘렸음을 알림)"""
+        if self.read_offset >= len(self.tokens):
+            return ""
+        prefix_text = self._decode(self.tokens[self.prefix_offset:self.read_offset])
+        new_text = self._decode(self.tokens[self.prefix_offset:])
+        self.prefix_offset = self.read_offset = len(self.tokens)
+        return new_text[len(prefix_text):]
+
+
+class GenerationRequest:
+    """스케줄러에 제출되는 생성 요청 하나
+
+    이벤트(dict)는 queue 로 전달됩니다:
+      {"type": "token", "token": id, "text": str, "at": 생성 시각 (time.time())}
+      {"type": "done", "finish_reason": "eos"|"stop"|"length"|"cancelled", "tokens": n,
+       "cached_tokens": n, "draft_tokens": n, "draft_accepted": n}
+      {"type": "error", "message": str}
+    """
+
+    _ids = itertools.count(1)
+
+    def __init__(self, prompt_tokens: List[int], max_tokens: int, sampler: Callable,
+                 logits_processors: Optional[List[Callable]] = None,
+                 stop_token_ids=None, ignore_eos: bool = False):
+        self.uid = next(self._ids)
+        self.prompt_tokens = list(prompt_tokens)
+        self.max_tokens = max_tokens
+        self.sampler = sampler
+        self.logits_processors = logits_processors or []
+        self.stop_token_ids = set(stop_token_ids or [])
+        self.ignore_eos = ignore_eos  # 벤치마크용: EOS 를 무시하고 max_tokens 까지 생성
+        self.generated: List[int] = []
+        self.finish_reason: Optional[str] = None
+        self.cancelled = False
+        self.submitted_at = time.time()
+        self.started_at = None
+        self.first_token_at = None
+        self.last_token_at = None
+        self.cached_tokens = 0  # prefix 캐시로 건너뛴 프롬프트 토큰 수
+        self.draft_tokens = 0  # 추측 디코딩으로 제안된 / 수락된 토큰 수
+        self.draft_accepted = 0
+        self.loop = None
+        self.queue: Optional[asyncio.Queue] = None
+        self.decoder: Optional[IncrementalDecoder] = None
+        self.trace = None  # request_trace.RequestTrace (trace_id 가 있는 요청만)
+
+    def emit(self, event: dict):
+        """스케줄러 스레드에서 이벤트 루프 쪽 큐로 이벤트 전달"""
+        try:
+            self.loop.call_soon_threadsafe(self.queue.put_nowait, event)
+        except RuntimeError:
+            # 이벤트 루프가 이미 종료됨
+            pass
+
+
+class PrefillJob:
+    """진행 중인 청크 prefill 하나 (같은 캐시로 함께 prefill 하는 요청 묶음)"""
+
+    def __init__(self, requests: List[GenerationRequest], cache, inputs):
+        self.requests = requests
+        self.cache = cache
+        self.inputs = inputs  # 아직 모델에 넣지 않은 토큰 (mx.array, shape [B, L])
+
+
+# ITL 분위수를 계산할 최근 토큰 간격 수
+ITL_WINDOW = 2048
+
+# 메모리 압력 단계 (manager 의 memory-pressure.js 가 POST /memory-pressure 로 전달)
+# 단계별 prefix 캐시 예산 비율: warn 은 절반, critical 은 pinned 가 아닌 항목을 모두 비움
+MEMORY_PRESSURE_PREFIX_FRACTION = {"normal": 1.0, "warn": 0.5, "critical": 0.0}
+
+
+class BatchScheduler:
+    """모델 하나에 대한 연속 배칭 루프"""
+
+    def __init__(self, model, tokenizer, max_batch_size: int = 8,
+                 prefill_step_size: int = 512, prefix_cache: Optional[PrefixCache] = None,
+                 decoder_factory: Optional[Callable] = None, draft_model=None, num_draft_tokens: int = 4,
+                 kv_bits: Optional[int] = None, kv_group_size: int = 64,
+                 prefill_chunk_tokens: int = 0,
+                 thread_init: Optional[Callable[[], None]] = None,
+                 log: Callable[[str], None] = print):
+        self.model = model
+        self.tokenizer = tokenizer
+        # 요청별 스트리밍 디코더 (native_detok.decoder_factory 가 없으면 Python 구현)
+        self.decoder_factory = decoder_factory or (lambda: IncrementalDecoder(tokenizer))
+        self.prefill_step_size = prefill_step_size
+        # 디코드 중인 요청이 있을 때 한 스텝에 prefill 할 최대 토큰 수 (행 수 합계, 0 이면 제한 없음)
+        self.prefill_chunk_tokens = max(0, prefill_chunk_tokens)
+        self.log = log
+        # 스케줄러 스레드 시작 시 호출 (QoS 지정 등)
+        self.thread_init = thread_init
+        plain_kv = self._model_has_plain_kv_cache(model)
+        if kv_bits and not (plain_kv and hasattr(KVCache, 'to_quantized')):
+            log("Quantized KV cache disabled: model cache or mlx_lm version does not support it")
+            kv_bits = None
+        self.kv_bits = kv_bits or None
+        self.kv_group_size = kv_group_size
+        self.batching = BatchKVCache is not None and plain_kv and self.kv_bits is None
+        # 회전/SSM 캐시는 토큰 구간 단위로 잘라 재사용할 수 없음
+        self.prefix_cache = prefix_cache if plain_kv else None
+        self.max_batch_size = max(1, max_batch_size) if self.batching else 1
+        # 메모리 압력: 새로 받을 동시 요청 수를 줄이고 prefix 캐시를 비움 (스케줄러 스레드에서 적용)
+        self.memory_pressure = "normal"
+        self._pressure_applied = "normal"
+        self._prefix_budget = self.prefix_cache.max_bytes if self.prefix_cache is not None else 0
+
+        self.eos_token_ids = set()
+        eos_ids = getattr(tokenizer, 'eos_token_ids', None)
+        if eos_ids:
+            self.eos_token_ids.update(int(t) for t in eos_ids)
+        eos_id = getattr(tokenizer, 'eos_token_id', None)
+        if eos_id is not None:
+            self.eos_token_ids.add(int(eos_id))
+
+        self._pending = deque()
+        self._active: List[GenerationRequest] = []
+        self._cache = None
+        self._last_tokens = None  # 활성 배치의 마지막 토큰 (mx.array, shape [B])
+        self._prefilling = deque()  # PrefillJob (먼저 받은 순서대로 진행)
+        self._cond = threading.Condition()
+        self._stopped = False
+        self._thread = None
+
+        # 추측 디코딩 (draft 캐시는 현재 단일 요청 하나만 따라감)
+        self.draft_model = self._check_draft_model(model, draft_model)
+        self.num_draft_tokens = max(1, num_draft_tokens)
+        self._draft_cache = None
+        self._draft_owner: Optional[GenerationRequest] = None
+        self._draft_len = 0  # draft 캐시에 들어 있는 토큰 수
+
+        # 메트릭
+        self.steps = 0
+        self.last_step_batch = 0
+        self.last_step_ms = 0.0
+        self.draft_steps = 0
+        self.draft_tokens = 0
+        self.draft_accepted = 0
+        self.prefill_chunks = 0
+        self._itl = deque(maxlen=ITL_WINDOW)  # 최근 토큰 간격 (ms)
+
+    @staticmethod
+    def _model_has_plain_kv_cache(model) -> bool:
+        """모든 레이어 캐시가 일반 KVCache 인 모델만 배치 캐시/prefix 재사용 가능"""
+        if not hasattr(model, 'make_cache'):
+            return True
+        try:
+            return all(type(c) is KVCache for c in model.make_cache())
+        except Exception:
+            return False
+
+    def _check_draft_model(self, model, draft_model):
+        """draft 모델을 쓸 수 있는지 확인 (캐시 되감기 지원, 같은 어휘 크기)"""
+        if draft_model is None:
+            return None
+        if trim_prompt_cache is None or not self._trimmable(make_prompt_cache(draft_model)):
+            self.log("Speculative decoding disabled: draft model cache cannot be trimmed")
+            return None
+        target_vocab = getattr(getattr(model, 'args', None), 'vocab_size', None)
+        draft_vocab = getattr(getattr(draft_model, 'args', None), 'vocab_size', None)
+        if target_vocab and draft_vocab and target_vocab != draft_vocab:
+            self.log(f"Speculative decoding disabled: draft vocab size {draft_vocab} != target {target_vocab}")
+            return None
+        return draft_model
+
+    # ---- 이벤트 루프 쪽 API ----
+
+    def start(self):
+        self._thread = threading.Thread(target=self._run, name="mlx-batch-scheduler", daemon=True)
+        self._thread.start()
+        mode = f"batched (max {self.max_batch_size})" if self.batching else "sequential"
+        if self.kv_bits:
+            mode += f", {self.kv_bits}-bit KV cache"
+        if self.draft_model is not None:
+            mode += f", speculative ({self.num_draft_tokens} draft tokens)"
+        if self.batching and self.prefill_chunk_tokens:
+            mode += f", chunked prefill ({self.prefill_chunk_tokens} tokens/step)"
+        self.log(f"Batch scheduler started: {mode}")
+
+    def stop(self):
+        with self._cond:
+            self._stopped = True
+            self._cond.notify()
+        if self._thread is not None:
+            self._thread.join(timeout=5)
+
+    def submit(self, request: GenerationRequest) -> asyncio.Queue:
+        """요청을 대기열에 넣고 이벤트 큐를 반환 (이벤트 루프 안에서 호출)"""
+        request.loop = asyncio.get_running_loop()
+        request.queue = asyncio.Queue()
+        request.decoder = self.decoder_factory()
+        with self._cond:
+            self._pending.append(request)
+            self._cond.notify()
+        return request.queue
+
+    def cancel(self, request: GenerationRequest):
+        """클라이언트 연결 종료 등으로 요청 중단. 다음 스텝에서 배치에서 빠집니다"""
+        request.cancelled = True
+        with self._cond:
+            if request in self._pending:
+                self._pending.remove(request)
+
+    @property
+    def active_count(self) -> int:
+        return len(self._active)
+
+    @property
+    def pending_count(self) -> int:
+        return len(self._pending)
+
+    @property
+    def prefilling_count(self) -> int:
+        return sum(len(job.requests) for job in list(self._prefilling))
+
+    def set_memory_pressure(self, level: str):
+        """'normal' | 'warn' | 'critical' (다음 스텝 전에 스케줄러 스레드가 적용)"""
+        if level not in MEMORY_PRESSURE_PREFIX_FRACTION:
+            raise ValueError(f"unknown memory pressure level: {level}")
+        with self._cond:
+            self.memory_pressure = level
+            self._cond.notify()
+
+    @property
+    def admit_limit(self) -> int:
+        """현재 압력 단계에서 배치에 둘 수 있는 요청 수 (진행 중인 요청은 끊지 않음)"""
+        if self.memory_pressure == "critical":
+            return 1
+        if self.memory_pressure == "warn":
+            return max(1, self.max_batch_size // 2)
+        return self.max_batch_size
+
+    def itl_quantiles(self) -> dict:
+        """최근 ITL_WINDOW 개 토큰 간격의 p50 / p99 (ms, 샘플이 없으면 None)"""
+        samples = sorted(list(self._itl))
+        if not samples:
+            return {"p50": None, "p99": None}
+        at = lambda q: round(samples[min(len(samples) - 1, int(q * len(samples)))], 2)
+        return {"p50": at(0.5), "p99": at(0.99)}
+
+    def stats(self) -> dict:
+        return {
+            "activeRequests": self.active_count,
+            "queueLength": self.pending_count,
+            "maxBatchSize": self.max_batch_size,
+            "admitLimit": self.admit_limit,
+            "memoryPressure": self.memory_pressure,
+            "batching": self.batching,
+            "batchSteps": self.steps,
+            "lastStepBatch": self.last_step_batch,
+            "lastStepMs": self.last_step_ms,
+            "itlMs": self.itl_quantiles(),
+            "prefillChunkTokens": self.prefill_chunk_tokens,
+            "prefillingRequests": self.prefilling_count,
+            "prefillChunks": self.prefill_chunks,
+            "speculative": self.draft_model is not None,
+            "draftSteps": self.draft_steps,
+            "draftTokens": self.draft_tokens,
+            "draftAccepted": self.draft_accepted,
+            "draftAcceptanceRate": self.draft_accepted / self.draft_tokens if self.draft_tokens else None,
+            "kvCache": {"type": f"q{self.kv_bits}" if self.kv_bits else "f16", "bits": self.kv_bits or 16,
+                        "bytes": self._cache_bytes(self._cache) +
+                                 sum(self._cache_bytes(job.cache) for job in list(self._prefilling))},
+            **(self.prefix_cache.stats() if self.prefix_cache else {}),
+        }
+
+    # ---- 스케줄러 스레드 ----
+
+    def _run(self):
+        if self.thread_init is not None:
+            try:
+                self.thread_init()
+            except Exception as e:
+                self.log(f"Scheduler thread init failed: {e}")
+        while True:
+            with self._cond:
+                while (not self._stopped and not self._pending and not self._active and not self._prefilling
+                       and self.memory_pressure == self._pressure_applied):
+                    self._cond.wait()
+                if self._stopped:
+                    break
+                admit = []
+                busy = len(self._active) + self.prefilling_count
+                while self._pending and busy + len(admit) < self.admit_limit:
+                    admit.append(self._pending.popleft())
+
+            try:
+                self._apply_memory_pressure()
+                if admit:
+                    self._admit(admit)
+                if self._prefilling:
+                    self._prefill_step()
+                if self._active:
+                    self._decode_step()
+            except Exception as e:
+                import traceback
+                self.log(f"Batch step failed: {e}")
+                self.log(traceback.format_exc())
+                failed = {r.uid: r for r in self._active + admit + self._prefilling_requests()}
+                for request in failed.values():
+                    request.emit({"type": "error", "message": f"Generation failed: {str(e)}"})
+                self._active = []
+                self._prefilling.clear()
+                self._cache = None
+                self._last_tokens = None
+
+        for request in self._active + self._prefilling_requests() + list(self._pending):
+            request.emit({"type": "done", "finish_reason": "cancelled", "tokens": len(request.generated)})
+
+    def _apply_memory_pressure(self):
+        level = self.memory_pressure
+        if level == self._pressure_applied:
+            return
+        self._pressure_applied = level
+        freed = 0
+        if self.prefix_cache is not None:
+            before = self.prefix_cache.total_bytes
+            self.prefix_cache.set_budget(int(self._prefix_budget * MEMORY_PRESSURE_PREFIX_FRACTION[level]))
+            freed = before - self.prefix_cache.total_bytes
+        if level != "normal":
+            # 해제된 KV 버퍼를 Metal 버퍼 캐시에 남기지 않고 OS 에 돌려줌
+            clear_cache = getattr(mx, "clear_cache", None) or getattr(mx.metal, "clear_cache", None)
+            if clear_cache is not None:
+                clear_cache()
+        self.log(f"Memory pressure {level}: admit limit {self.admit_limit}, "
+                 f"prefix cache freed {freed / 1024 / 1024:.0f} MB")
+
+    def _new_cache(self, left_padding: List[int]):
+        if self.batching:
+            return [BatchKVCache(left_padding) for _ in range(len(self.model.layers))]
+        return make_prompt_cache(self.model)
+
+    def _quantize(self, cache):
+        """kv_bits 설정 시 아직 양자화되지 않은 KVCache 를 QuantizedKVCache 로 변환"""
+        if not self.kv_bits:
+            return cache
+        return [c.to_quantized(group_size=self.kv_group_size, bits=self.kv_bits)
+                if type(c) is KVCache and c.keys is not None else c for c in cache]
+
+    @staticmethod
+    def _cache_bytes(cache) -> int:
+        """캐시 레이어들의 nbytes 합 (스케줄러 스레드와 경합해도 근사값이면 충분)"""
+        if not cache:
+            return 0
+        try:
+            return int(sum(c.nbytes for c in cache))
+        except Exception:
+            return 0
+
+    def _prefilling_requests(self) -> List[GenerationRequest]:
+        return [r for job in self._prefilling for r in job.requests]
+
+    def _admit(self, requests: List[GenerationRequest]):
+        """새 프롬프트의 prefill 작업을 만듦 (진행은 _prefill_step)
+
+        prefix 캐시에 걸린 요청은 캐시된 KV 로 시작해 나머지 토큰만 prefill 하고,
+        나머지 요청은 한 배치로 묶어 처음부터 prefill 합니다.
+        """
+        requests = [r for r in requests if not r.cancelled]
+        if not requests:
+            return
+        now = time.time()
+        cold = []
+        for request in requests:
+            request.started_at = now
+            cached = self.prefix_cache.match(request.prompt_tokens) if self.prefix_cache else None
+            if request.trace:
+                request.trace.add("queue", request.submitted_at, now, cat="scheduler",
+                                  cached_tokens=cached[0] if cached is not None else 0)
+            if cached is not None:
+                request.cached_tokens = cached[0]
+                self._prefilling.append(self._prefill_job([request], cached))
+            else:
+                cold.append(request)
+        if cold:
+            self._prefilling.append(self._prefill_job(cold))
+
+    def _prefill_job(self, requests: List[GenerationRequest], cached=None) -> PrefillJob:
+        n_cached, cached_kv = cached if cached is not None else (0, None)
+        prompts = [r.prompt_tokens[n_cached:] for r in requests]
+        max_len = max(len(p) for p in prompts)
+        padding = [max_len - len(p) for p in prompts]
+        inputs = mx.array([[0] * pad + p for p, pad in zip(prompts, padding)])
+        cache = self._new_cache(padding)
+        if cached_kv is not None:
+            for c, (keys, values) in zip(cache, cached_kv):
+                c.update_and_fetch(keys, values)
+        return PrefillJob(requests, cache, inputs)
+
+    def _prefill_step(self):
+        """대기 중인 prefill 을 이번 스텝의 토큰 예산만큼 진행하고, 끝난 작업은 활성 배치에 합침
+
+        디코드 중인 요청이 없거나 prefill_chunk_tokens 가 0 이면 예산 없이 끝까지 처리합니다.
+        예산은 행 수 × 청크 길이로 세고, 한 스텝에 최소 한 청크는 진행합니다.
+        """
+        budget = self.prefill_chunk_tokens if self._active and self.prefill_chunk_tokens else None
+        progressed = False
+        finished = False
+        while self._prefilling:
+            job = self._prefilling[0]
+            if all(r.cancelled for r in job.requests):
+                self._prefilling.popleft()
+                continue
+            rows, remaining = job.inputs.shape[0], job.inputs.shape[1] - 1
+            if remaining > 0:
+                # 마지막 토큰을 제외한 프롬프트를 청크 단위로 처리
+                limit = remaining if budget is None else budget // rows
+                if limit <= 0:
+                    if progressed:
+                        break
+                    limit = 1
+                n = min(self.prefill_step_size, remaining, limit)
+                chunk_start = time.time()
+                self.model(job.inputs[:, :n], cache=job.cache)
+                job.cache = self._quantize(job.cache)
+                mx.eval([c.state for c in job.cache])
+                self._trace_step(job.requests, "prefill chunk", chunk_start, tokens=n, rows=rows)
+                job.inputs = job.inputs[:, n:]
+                self.prefill_chunks += 1
+                progressed = True
+                if budget is not None:
+                    budget -= n * rows
+                continue
+            self._prefilling.popleft()
+            self._finish_prefill(job)
+            finished = True
+        if finished:
+            self._prune()
+
+    def _finish_prefill(self, job: PrefillJob):
+        """마지막 프롬프트 토큰으로 첫 토큰을 샘플링하고 활성 배치에 합침"""
+        requests = job.requests
+        sample_start = time.time()
+        logits = self.model(job.inputs, cache=job.cache)[:, -1, :]
+        cache = self._quantize(job.cache)
+        tokens = self._sample(requests, logits)
+        self._trace_step(requests, "first token", sample_start, rows=len(requests))
+
+        if self._cache is None:
+            self._cache = cache
+            self._last_tokens = tokens
+            self._active = list(requests)
+        else:
+            for active_cache, new_cache in zip(self._cache, cache):
+                active_cache.extend(new_cache)
+            self._last_tokens = mx.concatenate([self._last_tokens, tokens])
+            self._active.extend(requests)
+        self._dispatch(requests, tokens)
+
+    def _decode_step(self):
+        """활성 배치 전체에 대해 디코드 한 스텝"""
+        start = time.perf_counter()
+        step_start = time.time()
+        batch = self._active
+        if self._can_speculate(batch):
+            self._speculative_step(batch[0])
+            self._trace_step(batch, "speculative step", step_start, draft=self.num_draft_tokens)
+        else:
+            logits = self.model(self._last_tokens[:, None], cache=self._cache)[:, -1, :]
+            tokens = self._sample(batch, logits)
+            self._last_tokens = tokens
+            self._dispatch(batch, tokens)
+            self._trace_step(batch, "decode step", step_start, batch=len(batch))
+        self._prune()
+        self.steps += 1
+        self.last_step_batch = len(batch)
+        self.last_step_ms = (time.perf_counter() - start) * 1000
+
+    @staticmethod
+    def _trace_step(requests: List[GenerationRequest], name: str, start: float, **args):
+        """mx.eval 로 끝난 GPU 스텝을 trace 가 있는 요청에 기록 (배치 전체가 같은 스텝을 공유)"""
+        end = time.time()
+        for request in requests:
+            if request.trace:
+                request.trace.add(name, start, end, cat="gpu", **args)
+
+    @staticmethod
+    def _logprobs(request: GenerationRequest, row, context: List[int]):
+        if request.logits_processors:
+            context = mx.array(context)
+            for processor in request.logits_processors:
+                row = processor(context, row)
+        return row - mx.logsumexp(row, axis=-1, keepdims=True)
+
+    def _sample(self, requests: List[GenerationRequest], logits) -> mx.array:
+        """행마다 해당 요청의 logits processor 와 sampler 적용"""
+        rows = []
+        for i, request in enumerate(requests):
+            logprobs = self._logprobs(request, logits[i:i + 1], request.prompt_tokens + request.generated)
+            rows.append(request.sampler(logprobs).reshape(1))
+        tokens = mx.concatenate(rows).astype(mx.int32)
+        mx.eval(tokens)
+        return tokens
+
+    def _sample_one(self, request: GenerationRequest, row, context: List[int]) -> int:
+        return int(request.sampler(self._logprobs(request, row, context)).item())
+
+    # ---- 추측 디코딩 ----
+
+    def _can_speculate(self, batch: List[GenerationRequest]) -> bool:
+        """단일 스트림이고 되감을 수 있는 캐시이며 2 토큰 이상 남았을 때만"""
+        if self.draft_model is None or len(batch) != 1 or self._pending or self._prefilling:
+            return False
+        request = batch[0]
+        if request.cancelled or request.max_tokens - len(request.generated) < 2:
+            return False
+        return self._trimmable(self._cache)
+
+    @staticmethod
+    def _trimmable(cache) -> bool:
+        try:
+            return can_trim_prompt_cache(cache)
+        except AttributeError:
+            # trim 을 구현하지 않은 캐시 타입 (구버전 BatchKVCache 등)
+            return False
+
+    def _sync_draft(self, request: GenerationRequest, sequence: List[int]):
+        """draft 캐시가 sequence[:-1] 을 담도록 맞춤 (다른 요청이었으면 새로 prefill, 뒤처졌으면 이어서 처리)"""
+        target = len(sequence) - 1
+        if self._draft_owner is not request or self._draft_len > target:
+            self._draft_cache = make_prompt_cache(self.draft_model)
+            self._draft_owner = request
+            self._draft_len = 0
+        missing = sequence[self._draft_len:target]
+        for i in range(0, len(missing), self.prefill_step_size):
+            self.draft_model(mx.array([missing[i:i + self.prefill_step_size]]), cache=self._draft_cache)
+            mx.eval([c.state for c in self._draft_cache])
+        self._draft_len = target
+
+    def _speculative_step(self, request: GenerationRequest):
+        """draft 모델이 k 개 제안 → 대상 모델이 k+1 위치를 한 번에 검증 → 수락된 토큰 + 다음 토큰 전달
+
+        대상 캐시에는 항상 (프롬프트 + 생성 토큰)[:-1] 이 들어 있고 마지막 토큰은 _last_tokens 에 있습니다.
+        """
+        last = int(self._last_tokens[0].item())
+        sequence = request.prompt_tokens + request.generated
+        self._sync_draft(request, sequence)
+        k = min(self.num_draft_tokens, request.max_tokens - len(request.generated) - 1)
+
+        drafts = []
+        context = list(sequence)
+        y = mx.array([[last]])
+        for _ in range(k):
+            logits = self.draft_model(y, cache=self._draft_cache)[:, -1, :]
+            token = self._sample_one(request, logits, context)
+            drafts.append(token)
+            context.append(token)
+            y = mx.array([[token]])
+        self._draft_len += k
+
+        logits = self.model(mx.array([[last] + drafts]), cache=self._cache)[0]
+        accepted = 0
+        context = list(sequence)
+        for j in range(k + 1):
+            token = self._sample_one(request, logits[j:j + 1], context)
+            if j < k and token == drafts[j]:
+                accepted += 1
+                context.append(token)
+                continue
+            next_token = token
+            break
+
+        # 거절된 draft 토큰의 KV 되감기 (draft 캐시는 마지막 제안 토큰을 아직 넣지 않았음)
+        trim_prompt_cache(self._cache, k - accepted)
+        draft_trim = max(0, k - 1 - accepted)
+        trim_prompt_cache(self._draft_cache, draft_trim)
+        self._draft_len -= draft_trim
+
+        self.draft_steps += 1
+        self.draft_tokens += k
+        self.draft_accepted += accepted
+        request.draft_tokens += k
+        request.draft_accepted += accepted
+
+        emitted = drafts[:accepted] + [next_token]
+        for token in emitted:
+            self._dispatch([request], mx.array([token], dtype=mx.int32))
+            if request.finish_reason is not None:
+                break
+        self._last_tokens = mx.array([emitted[-1]], dtype=mx.int32)
+
+    def _dispatch(self, requests: List[GenerationRequest], tokens: mx.array):
+        """샘플링된 토큰을 각 요청에 전달하고 끝난 요청에 finish_reason 설정"""
+        now = time.time()
+        for request, token_id in zip(requests, tokens.tolist()):
+            if request.cancelled:
+                request.finish_reason = "cancelled"
+            elif token_id in self.eos_token_ids and not request.ignore_eos:
+                request.finish_reason = "eos"
+            elif token_id in request.stop_token_ids:
+                request.finish_reason = "stop"
+            else:
+                request.generated.append(token_id)
+                if request.first_token_at is None:
+                    request.first_token_at = now
+                else:
+                    self._itl.append((now - request.last_token_at) * 1000)
+                request.last_token_at = now
+                if request.trace:
+                    detok_start = time.perf_counter()
+                    text = request.decoder.add(token_id)
+                    request.trace.total("detokenize", (time.perf_counter() - detok_start) * 1000)
+                else:
+                    text = request.decoder.add(token_id)
+                request.emit({"type": "token", "token": token_id, "text": text, "at": now})
+                if len(request.generated) >= request.max_tokens:
+                    request.finish_reason = "length"
+
+            if request.finish_reason is None:
+                continue
+            tail = request.decoder.flush()
+            if tail:
+                request.emit({"type": "token", "token": None, "text": tail, "at": now})
+            request.emit({"type": "done", "finish_reason": request.finish_reason,
+                          "tokens": len(request.generated), "cached_tokens": request.cached_tokens,
+                          "draft_tokens": request.draft_tokens, "draft_accepted": request.draft_accepted})
+
+    def _row_kv(self, row: int):
+        """활성 캐시에서 한 행의 KV 와 그 길이 추출"""
+        layers = []
+        length = 0
+        for c in self._cache:
+            if self.batching:
+                # BatchKVCache: 행 i 의 유효 구간은 [left_padding[i], _idx)
+                start = int(c.left_padding[row].item())
+                end = c._idx
+            else:
+                start, end = 0, c.offset
+            length = end - start
+            if isinstance(c.keys, tuple):
+                # QuantizedKVCache: (가중치, scales, biases) 를 같은 구간으로 잘라 역양자화
+                layers.append(tuple(
+                    mx.dequantize(*(x[row:row + 1, :, start:end, :] for x in part),
+                                  group_size=c.group_size, bits=c.bits)
+                    for part in (c.keys, c.values)))
+            else:
+                layers.append((c.keys[row:row + 1, :, start:end, :], c.values[row:row + 1, :, start:end, :]))
+        return length, layers
+
+    def _store_prefix(self, row: int, request: GenerationRequest):
+        """끝난 요청의 프롬프트+생성 토큰 KV 를 prefix 캐시에 저장"""
+        try:
+            length, layers = self._row_kv(row)
+            tokens = (request.prompt_tokens + request.generated)[:length]
+            if len(tokens) == length:
+                self.prefix_cache.insert(tokens, layers)
+        except Exception as e:
+            # 캐시 저장 실패는 생성 결과에 영향을 주지 않음
+            self.log(f"Prefix cache store failed: {e}")
+
+    def _prune(self):
+        """끝난 요청을 활성 배치와 KV 캐시에서 제거"""
+        keep = [i for i, r in enumerate(self._active) if r.finish_reason is None]
+        if len(keep) == len(self._active):
+            return
+        if self._draft_owner is not None and self._draft_owner.finish_reason is not None:
+            self._draft_cache = None
+            self._draft_owner = None
+            self._draft_len = 0
+        if self.prefix_cache is not None:
+            for i, request in enumerate(self._active):
+                if request.finish_reason is not None:
+                    self._store_prefix(i, request)
+        if not keep:
+            self._active = []
+            self._cache = None
+            self._last_tokens = None
+            return
+        indices = mx.array(keep, dtype=mx.int32)
+        for c in self._cache:
+            c.filter(indices)
+        self._last_tokens = self._last_tokens[indices]
+        self._active = [self._active[i] for i in keep]
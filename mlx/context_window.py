@@ -0,0 +1,131 @@
+"""
+서버 측 컨텍스트 윈도우 관리 (context-window.js 의 MLX 서버 버전)
+
+클라이언트가 프롬프트 문자열 대신 대화 턴(messages)을 보내면, 서버가 토큰화하면서
+컨텍스트 크기를 확인하고 넘치면 가장 오래된 턴부터 잘라냅니다.
+보통은 전체 프롬프트를 한 번만 토큰화하고, 넘칠 때만 턴별 토큰 수(LRU 캐시)를 구해
+잘라낼 범위를 정한 뒤 다시 토큰화합니다.
+프롬프트 형식은 frontend/src/services/api.js 의 buildLlama3Prompt 와 같습니다.
+"""
+from collections import OrderedDict
+from typing import Callable, List, Optional, Tuple
+
+MIN_PREDICT = 32
+TURN_CACHE_MAX_ENTRIES = 4096
+
+
+class ContextOverflow(Exception):
+    """컨텍스트에 들어가지 않는 요청 (info 에 prompt_tokens / context_size)"""
+
+    def __init__(self, message: str, info: dict):
+        super().__init__(message)
+        self.info = info
+
+
+def llama3_segments(messages: List[dict]) -> Tuple[str, List[Tuple[str, str]], str]:
+    """messages(첫 system 포함) → (head, [(role, turn_text)], tail)"""
+    system = ""
+    turns = []
+    for message in messages:
+        if message.get("role") == "system" and not turns and not system:
+            system = str(message.get("content") or "")
+            continue
+        role = "assistant" if message.get("role") == "assistant" else "user"
+        turns.append((role, f"<|start_header_id|>{role}<|end_header_id|>\n\n{message.get('content') or ''}<|eot_id|>"))
+    head = f"<|begin_of_text|><|start_header_id|>system<|end_header_id|>\n\n{system}<|eot_id|>"
+    tail = "<|start_header_id|>assistant<|end_header_id|>\n\n"
+    return head, turns, tail
+
+
+def generation_reserve(context_size: int, n_predict: int) -> int:
+    """생성에 남겨둘 최소 공간: 요청한 n_predict (컨텍스트의 1/4 까지)"""
+    limit = context_size // 4
+    return max(MIN_PREDICT, min(n_predict, limit) if n_predict > 0 else limit)
+
+
+def dynamic_n_predict(prompt_tokens: int, context_size: int, n_predict: int) -> int:
+    """api.js 가 하던 동적 n_predict: 설정값, 프롬프트의 4배, 남은 컨텍스트의 80% 중 최소 (최소 32)
+
+    n_predict <= 0 (무제한) 이면 남은 컨텍스트 전체
+    """
+    remaining = context_size - prompt_tokens
+    if n_predict <= 0:
+        return remaining
+    max_by_prompt = max(prompt_tokens * 4, 64)
+    max_by_context = int(remaining * 0.8)
+    return min(remaining, max(MIN_PREDICT, min(n_predict, max_by_prompt, max_by_context)))
+
+
+def fit_turns(turns: List[Tuple[str, int]], fixed_tokens: int, context_size: int, n_predict: int) -> int:
+    """(role, 토큰 수) 목록에서 남길 첫 턴 인덱스 (마지막 턴은 항상 유지)"""
+    reserve = generation_reserve(context_size, n_predict)
+    total = fixed_tokens + sum(n for _, n in turns)
+    start = 0
+    while start < len(turns) - 1 and total + reserve > context_size:
+        total -= turns[start][1]
+        start += 1
+    # 답변만 남고 질문이 잘린 턴은 함께 제거
+    while start < len(turns) - 1 and turns[start][0] == "assistant":
+        start += 1
+    return start
+
+
+class TurnTokenCounter:
+    """턴 텍스트 → 토큰 수 (LRU)"""
+
+    def __init__(self, max_entries: int = TURN_CACHE_MAX_ENTRIES):
+        self.max_entries = max_entries
+        self._entries: "OrderedDict[str, int]" = OrderedDict()
+
+    def count(self, text: str, encode: Callable[[str], List[int]]) -> int:
+        if text in self._entries:
+            self._entries.move_to_end(text)
+            return self._entries[text]
+        n = len(encode(text))
+        self._entries[text] = n
+        if len(self._entries) > self.max_entries:
+            self._entries.popitem(last=False)
+        return n
+
+    def clear(self):
+        self._entries.clear()
+
+
+def prepare_messages(messages: List[dict], encode_prompt: Callable[[str], List[int]],
+                     encode_segment: Callable[[str], List[int]], counter: TurnTokenCounter,
+                     context_size: int, n_predict: int, policy: str = "truncate"):
+    """messages → (prompt_tokens, info)
+
+    encode_prompt: 완성된 프롬프트 문자열 (Llama-3 형식, BOS 포함) → 모델 입력 토큰
+    encode_segment: 턴 하나의 토큰화 (잘라낼 범위 계산용)
+    info: {prompt_tokens, context_size, truncated_turns, n_predict}
+    """
+    head, turns, tail = llama3_segments(messages)
+    tokens = encode_prompt(head + "".join(text for _, text in turns) + tail)
+    start = 0
+    if policy != "reject" and len(tokens) + generation_reserve(context_size, n_predict) > context_size:
+        counts = [(role, counter.count(text, encode_segment)) for role, text in turns]
+        # 템플릿/시스템 프롬프트 등 턴 밖의 토큰은 잘라낼 수 없는 고정분
+        fixed = max(0, len(tokens) - sum(n for _, n in counts))
+        start = fit_turns(counts, fixed, context_size, n_predict)
+        if start > 0:
+            tokens = encode_prompt(head + "".join(text for _, text in turns[start:]) + tail)
+
+    info = {
+        "prompt_tokens": len(tokens),
+        "context_size": context_size,
+        "truncated_turns": start,
+    }
+    if len(tokens) + MIN_PREDICT > context_size:
+        raise ContextOverflow(f"Prompt ({len(tokens)} tokens) exceeds context size ({context_size})", info)
+    info["n_predict"] = dynamic_n_predict(len(tokens), context_size, n_predict)
+    return tokens, info
+
+
+def model_context_size(model, configured: int = 0) -> Optional[int]:
+    """서버가 허용하는 최대 컨텍스트 (MLX_CONTEXT_SIZE, 없으면 모델 설정의 max_position_embeddings)"""
+    if configured > 0:
+        return configured
+    args = getattr(model, "args", None)
+    value = getattr(args, "max_position_embeddings", None) if args is not None else None
+    return int(value) if value else None
@@ -0,0 +1,214 @@
+"""
+로그 / 메트릭 WebSocket fan-out
+
+- LogRing: 고정 크기 링 버퍼 + 단조 증가 시퀀스 번호. 구독자는 마지막으로 받은 seq 만 기억하고,
+  새 항목이 들어오면 깨어나 그 이후 항목만 보냅니다 (폴링 없음). 느린 구독자가 링에서
+  밀려난 구간은 건너뛰고 몇 줄을 놓쳤는지 알려줍니다.
+  append() 는 스케줄러 스레드 등 이벤트 루프 밖에서도 호출할 수 있습니다.
+- MetricsBroadcaster: 메트릭을 주기마다 한 번만 계산하는 producer 태스크 하나가
+  모든 구독자에게 최신 값을 넘깁니다 (구독자별로 최신 값 하나만 보관).
+"""
+import asyncio
+import threading
+import time
+from collections import deque
+from typing import Callable, List, Optional, Tuple
+
+LOG_RING_CAPACITY = 1000
+
+
+class _Subscriber:
+    __slots__ = ("event", "cursor", "replay_until", "latest")
+
+    def __init__(self, cursor: int = 0):
+        self.event = asyncio.Event()
+        self.cursor = cursor  # 마지막으로 받은 seq
+        self.replay_until = cursor  # 구독 전 항목은 로그 줄만 재전송
+        self.latest = None
+
+
+class _Notifier:
+    """이벤트 루프의 구독자들을 깨움 (다른 스레드에서 호출되면 call_soon_threadsafe)"""
+
+    def __init__(self):
+        self.loop: Optional[asyncio.AbstractEventLoop] = None
+        self._loop_thread: Optional[int] = None
+        self.subscribers: List[_Subscriber] = []
+
+    def bind(self, loop: asyncio.AbstractEventLoop):
+        self.loop = loop
+        self._loop_thread = threading.get_ident()
+
+    def _wake_all(self):
+        for subscriber in self.subscribers:
+            subscriber.event.set()
+
+    def notify(self):
+        if self.loop is None or not self.subscribers:
+            return
+        if threading.get_ident() == self._loop_thread:
+            self._wake_all()
+        else:
+            try:
+                self.loop.call_soon_threadsafe(self._wake_all)
+            except RuntimeError:
+                pass  # 루프 종료 중
+
+    def subscribe(self, subscriber: _Subscriber) -> _Subscriber:
+        self.subscribers.append(subscriber)
+        return subscriber
+
+    def unsubscribe(self, subscriber: _Subscriber):
+        if subscriber in self.subscribers:
+            self.subscribers.remove(subscriber)
+
+
+class LogRing:
+    """(seq, payload) 링 버퍼. payload["type"] == "log" 인 항목만 새 구독자에게 재전송됩니다"""
+
+    def __init__(self, capacity: int = LOG_RING_CAPACITY):
+        self._entries: "deque[Tuple[int, dict]]" = deque(maxlen=capacity)
+        self._lock = threading.Lock()
+        self._next_seq = 1
+        self._notifier = _Notifier()
+
+    def bind(self, loop: asyncio.AbstractEventLoop):
+        self._notifier.bind(loop)
+
+    @property
+    def subscriber_count(self) -> int:
+        return len(self._notifier.subscribers)
+
+    def append(self, payload: dict) -> int:
+        with self._lock:
+            seq = self._next_seq
+            self._next_seq += 1
+            self._entries.append((seq, payload))
+        self._notifier.notify()
+        return seq
+
+    def subscribe(self, replay: int = 100) -> _Subscriber:
+        """최근 replay 개의 로그 줄부터 받는 구독자"""
+        with self._lock:
+            logs = [seq for seq, payload in self._entries if payload.get("type") == "log"][-replay:] if replay else []
+            subscriber = _Subscriber(logs[0] - 1 if logs else self._next_seq - 1)
+            subscriber.replay_until = self._next_seq - 1
+        self._notifier.subscribe(subscriber)
+        subscriber.event.set()  # 재전송할 항목부터 바로 처리
+        return subscriber
+
+    def unsubscribe(self, subscriber: _Subscriber):
+        self._notifier.unsubscribe(subscriber)
+
+    def read(self, subscriber: _Subscriber) -> Tuple[List[dict], int]:
+        """subscriber.cursor 이후 항목과 링에서 밀려나 놓친 항목 수"""
+        with self._lock:
+            if not self._entries:
+                return [], 0
+            first_seq = self._entries[0][0]
+            start = max(subscriber.cursor + 1, first_seq)
+            dropped = start - (subscriber.cursor + 1)
+            # seq 는 연속이므로 링 안의 위치는 seq - first_seq
+            items = [payload for seq, payload in list(self._entries)[start - first_seq:]
+                     if seq > subscriber.replay_until or payload.get("type") == "log"]
+            subscriber.cursor = self._next_seq - 1
+        return items, dropped
+
+    async def wait(self, subscriber: _Subscriber):
+        await subscriber.event.wait()
+        subscriber.event.clear()
+
+
+class MetricsBroadcaster:
+    """compute() 를 interval 마다 한 번 호출해 모든 구독자에게 최신 스냅샷을 전달"""
+
+    def __init__(self, compute: Callable[[], dict], interval: float = 1.0):
+        self.compute = compute
+        self.interval = interval
+        self._notifier = _Notifier()
+        self._kick: Optional[asyncio.Event] = None
+        self._task: Optional[asyncio.Task] = None
+        self.latest: Optional[dict] = None
+        self.latest_time = 0.0
+
+    def start(self, loop: asyncio.AbstractEventLoop):
+        self._notifier.bind(loop)
+        self._kick = asyncio.Event()
+        self._task = loop.create_task(self._run())
+
+    def stop(self):
+        if self._task is not None:
+            self._task.cancel()
+            self._task = None
+
+    def kick(self):
+        """다음 주기를 기다리지 않고 바로 다시 계산 (생성 완료 등 상태 변화 시, 스레드 안전)"""
+        if self._notifier.loop is None or self._kick is None:
+            return
+        try:
+            self._notifier.loop.call_soon_threadsafe(self._kick.set)
+        except RuntimeError:
+            pass
+
+    def snapshot(self) -> dict:
+        """가장 최근 스냅샷 (주기보다 오래됐으면 새로 계산)"""
+        if self.latest is None or time.time() - self.latest_time > self.interval:
+            self._publish()
+        return self.latest
+
+    def _publish(self):
+        self.latest = self.compute()
+        self.latest_time = time.time()
+        for subscriber in self._notifier.subscribers:
+            subscriber.latest = self.latest
+            subscriber.event.set()
+
+    async def _run(self):
+        while True:
+            if self._notifier.subscribers:
+                try:
+                    self._publish()
+                except Exception as e:
+                    print(f"[ERROR] Failed to compute metrics: {e}", flush=True)
+            try:
+                await asyncio.wait_for(self._kick.wait(), timeout=self.interval)
+            except asyncio.TimeoutError:
+                pass
+            self._kick.clear()
+
+    def subscribe(self) -> _Subscriber:
+        subscriber = self._notifier.subscribe(_Subscriber())
+        subscriber.latest = self.snapshot()
+        subscriber.event.set()
+        return subscriber
+
+    def unsubscribe(self, subscriber: _Subscriber):
+        self._notifier.unsubscribe(subscriber)
+
+    @staticmethod
+    async def next(subscriber: _Subscriber) -> dict:
+        await subscriber.event.wait()
+        subscriber.event.clear()
+        return subscriber.latest
+
+
+async def run_until_disconnect(websocket, sender):
+    """sender 코루틴을 실행하다가 클라이언트가 연결을 끊으면 바로 정리
+
+    sender 가 새 항목을 기다리는 동안에도 연결 종료를 알 수 있도록 수신 태스크를 함께 돌립니다.
+    """
+    async def receiver():
+        while True:
+            message = await websocket.receive()
+            if message.get("type") == "websocket.disconnect":
+                return
+
+    tasks = [asyncio.ensure_future(sender()), asyncio.ensure_future(receiver())]
+    try:
+        done, _ = await asyncio.wait(tasks, return_when=asyncio.FIRST_COMPLETED)
+        for task in done:
+            if not task.cancelled() and task.exception() is not None:
+                raise task.exception()
+    finally:
+        for task in tasks:
+            task.cancel()
@@ -0,0 +1,117 @@
+"""
+이름 있는 프롬프트 prefix 의 KV 스냅샷 (디스크 저장/복원)
+
+긴 시스템 프롬프트의 KV 를 safetensors 파일로 저장해 두었다가 모델 로드 시 복원하여
+서버 재시작 후에도 prefill 을 건너뜁니다. safetensors 는 mx.load 가 mmap 으로 읽으므로
+복원 비용은 파일을 메모리에 올리는 시간뿐입니다.
+
+파일 이름에는 모델 경로와 토큰 시퀀스의 해시가 들어가므로, 프롬프트나 모델이 바뀌면
+새 스냅샷을 만들고 같은 이름의 이전 스냅샷은 지웁니다.
+"""
+import hashlib
+import json
+import os
+import re
+from pathlib import Path
+from typing import Callable, List, Optional
+
+import mlx.core as mx
+from mlx_lm.models.cache import make_prompt_cache
+
+SNAPSHOT_VERSION = "1"
+SNAPSHOT_SUFFIX = ".safetensors"
+
+
+def load_prompt_prefixes(config_path: str) -> List[dict]:
+    """prompt-prefixes.json 의 {"prefixes": [{"name", "text"}]} 목록"""
+    try:
+        with open(config_path, "r", encoding="utf-8") as f:
+            data = json.load(f)
+    except (OSError, ValueError) as e:
+        print(f"[WARN] Failed to read prompt prefixes {config_path}: {e}", flush=True)
+        return []
+    return [p for p in data.get("prefixes", []) if p.get("name") and p.get("text")]
+
+
+def snapshot_path(directory: str, name: str, model_path: str, tokens: List[int]) -> Path:
+    digest = hashlib.sha1()
+    digest.update(SNAPSHOT_VERSION.encode())
+    digest.update(os.path.abspath(model_path).encode())
+    digest.update(json.dumps(tokens).encode())
+    return Path(directory) / f"{name}-{digest.hexdigest()[:12]}{SNAPSHOT_SUFFIX}"
+
+
+def compute_prefix_kv(model, tokens: List[int], step: int = 512):
+    """tokens 전체를 prefill 하고 레이어별 (keys, values) 반환"""
+    cache = make_prompt_cache(model)
+    inputs = mx.array(tokens)[None]
+    for start in range(0, len(tokens), step):
+        model(inputs[:, start:start + step], cache=cache)
+        mx.eval([c.state for c in cache])
+    return [(c.keys[..., :c.offset, :], c.values[..., :c.offset, :]) for c in cache]
+
+
+def save_snapshot(path: Path, tokens: List[int], layers):
+    arrays = {}
+    for i, (keys, values) in enumerate(layers):
+        arrays[f"keys.{i}"] = keys
+        arrays[f"values.{i}"] = values
+    metadata = {
+        "version": SNAPSHOT_VERSION,
+        "n_tokens": str(len(tokens)),
+        "n_layers": str(len(layers)),
+    }
+    path.parent.mkdir(parents=True, exist_ok=True)
+    # 쓰는 도중 종료되어도 깨진 파일이 남지 않도록 임시 파일에 쓴 뒤 rename
+    tmp_path = path.with_name(path.stem + ".tmp" + SNAPSHOT_SUFFIX)
+    mx.save_safetensors(str(tmp_path), arrays, metadata=metadata)
+    os.replace(tmp_path, path)
+
+
+def load_snapshot(path: Path, n_tokens: int, n_layers: int):
+    """스냅샷을 읽어 레이어별 (keys, values) 반환. 형식이 맞지 않으면 None"""
+    arrays, metadata = mx.load(str(path), return_metadata=True)
+    if (metadata.get("version") != SNAPSHOT_VERSION
+            or metadata.get("n_tokens") != str(n_tokens)
+            or metadata.get("n_layers") != str(n_layers)):
+        return None
+    return [(arrays[f"keys.{i}"], arrays[f"values.{i}"]) for i in range(n_layers)]
+
+
+def remove_stale_snapshots(directory: str, name: str, keep: Path):
+    """같은 이름의 이전 스냅샷 삭제 (name-<12자리 digest> 만: "chat" 이 "chat-ko-..." 를 지우지 않도록)"""
+    pattern = re.compile(rf"{re.escape(name)}-[0-9a-f]{{12}}{re.escape(SNAPSHOT_SUFFIX)}")
+    for old in Path(directory).glob(f"{name}-*{SNAPSHOT_SUFFIX}"):
+        if old != keep and pattern.fullmatch(old.name):
+            try:
+                old.unlink()
+            except OSError:
+                pass
+
+
+def warm_prefixes(model, prefixes, directory: str, model_path: str, prefix_cache,
+                  log: Callable[[str], None] = print):
+    """이름 있는 prefix 들을 스냅샷에서 복원(없으면 계산 후 저장)해 prefix 캐시에 고정
+
+    prefixes: [(name, tokens)]
+    """
+    n_layers = len(model.layers)
+    for name, tokens in prefixes:
+        path = snapshot_path(directory, name, model_path, tokens)
+        layers: Optional[list] = None
+        if path.exists():
+            try:
+                layers = load_snapshot(path, len(tokens), n_layers)
+                if layers is not None:
+                    log(f"KV snapshot restored: {name} ({len(tokens)} tokens)")
+            except Exception as e:
+                log(f"KV snapshot {path.name} unreadable, rebuilding: {e}")
+        if layers is None:
+            layers = compute_prefix_kv(model, tokens)
+            try:
+                save_snapshot(path, tokens, layers)
+                remove_stale_snapshots(directory, name, path)
+                log(f"KV snapshot saved: {name} ({len(tokens)} tokens) -> {path}")
+            except Exception as e:
+                log(f"KV snapshot save failed for {name}: {e}")
+        prefix_cache.insert(tokens, layers, pinned=True)
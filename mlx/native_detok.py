@@ -0,0 +1,229 @@
+"""
+libllm_detok.dylib (native/src/llm_detok.h) ctypes 바인딩
+
+토크나이저 어휘를 토큰별 바이트 piece 테이블로 만들어 네이티브 스트리밍 디토크나이저에 넘깁니다.
+토큰 하나의 디코딩 비용이 출력 길이와 무관하게 일정하며, 스페셜 토큰은 ID 로 걸러집니다.
+
+byte-level BPE(Llama 3, Qwen 등)와 SentencePiece(byte fallback 포함) 어휘를 지원하고,
+라이브러리가 없거나 어휘 형식을 알 수 없거나 자체 검증에 실패하면
+decoder_factory() 가 None 을 반환하여 Python IncrementalDecoder 를 그대로 사용합니다.
+토크나이저의 clean_up_tokenization_spaces 후처리는 적용하지 않습니다 (원문 바이트 그대로).
+"""
+import ctypes
+import json
+import os
+import re
+import sys
+from pathlib import Path
+
+ABI_VERSION = 2
+
+SPECIAL_TOKEN_PATTERN = re.compile(r'^<\|[^>]*\|>$')
+BYTE_FALLBACK_PATTERN = re.compile(r'^<0x([0-9A-Fa-f]{2})>$')
+SELF_CHECK_TEXT = "Hello, world! 안녕하세요 세계. 😀 naïve café — \"quotes\"\n\tcode(x) { return 42; }"
+
+
+def _candidate_paths():
+    env_path = os.getenv("LLM_DETOK_LIB")
+    if env_path:
+        yield Path(env_path)
+    release = Path(__file__).resolve().parent.parent / "native" / "build" / "Release"
+    suffix = "dylib" if sys.platform == "darwin" else "so"
+    yield release / f"libllm_detok.{suffix}"
+    yield release / f"llm_detok.{suffix}"
+
+
+def _load():
+    for path in _candidate_paths():
+        if not path.exists():
+            continue
+        try:
+            lib = ctypes.CDLL(str(path))
+        except OSError as e:
+            print(f"[WARN] Failed to load {path}: {e}", flush=True)
+            continue
+        lib.llm_detok_abi_version.restype = ctypes.c_int
+        if lib.llm_detok_abi_version() != ABI_VERSION:
+            print(f"[WARN] {path}: ABI version mismatch", flush=True)
+            continue
+        lib.llm_detok_vocab_new.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.c_uint32),
+                                            ctypes.c_uint32, ctypes.c_char_p]
+        lib.llm_detok_vocab_new.restype = ctypes.c_void_p
+        lib.llm_detok_vocab_free.argtypes = [ctypes.c_void_p]
+        lib.llm_detok_vocab_max_output.argtypes = [ctypes.c_void_p]
+        lib.llm_detok_vocab_max_output.restype = ctypes.c_uint32
+        lib.llm_detok_stream_new.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        lib.llm_detok_stream_new.restype = ctypes.c_void_p
+        lib.llm_detok_stream_free.argtypes = [ctypes.c_void_p]
+        lib.llm_detok_stream_add.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.c_char_p, ctypes.c_int32]
+        lib.llm_detok_stream_add.restype = ctypes.c_int32
+        lib.llm_detok_stream_finish.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int32]
+        lib.llm_detok_stream_finish.restype = ctypes.c_int32
+        lib.llm_detok_stream_reset.argtypes = [ctypes.c_void_p]
+        return lib
+    return None
+
+
+_lib = _load()
+
+
+def available() -> bool:
+    return _lib is not None
+
+
+def _gpt2_byte_decoder():
+    """byte-level BPE 의 bytes_to_unicode 역매핑 (문자 → 바이트)"""
+    bs = list(range(ord("!"), ord("~") + 1)) + list(range(ord("¡"), ord("¬") + 1)) + list(range(ord("®"), ord("ÿ") + 1))
+    cs = bs[:]
+    n = 0
+    for b in range(256):
+        if b not in bs:
+            bs.append(b)
+            cs.append(256 + n)
+            n += 1
+    return {chr(c): b for b, c in zip(bs, cs)}
+
+
+def _decoder_kind(hf_tokenizer):
+    """backend tokenizer 의 decoder 설정으로 ("bpe" | "spm" | None, strip_leading_space) 판별"""
+    try:
+        config = json.loads(hf_tokenizer.backend_tokenizer.to_str()).get("decoder") or {}
+    except Exception:
+        return None, False
+    decoders = config.get("decoders", []) if config.get("type") == "Sequence" else [config]
+    types = {d.get("type") for d in decoders}
+    if "ByteLevel" in types:
+        return "bpe", False
+    if "Metaspace" in types or "ByteFallback" in types:
+        strip = any(d.get("type") == "Strip" and d.get("start", 0) > 0 for d in decoders) or any(
+            d.get("type") == "Metaspace" and d.get("prepend_scheme", "always") != "never" for d in decoders)
+        return "spm", strip
+    return None, False
+
+
+def build_piece_table(tokenizer):
+    """토크나이저 → (pieces: List[bytes], special: List[bool], strip_leading_space) 또는 None"""
+    hf = getattr(tokenizer, "_tokenizer", tokenizer)
+    kind, strip = _decoder_kind(hf)
+    if kind is None:
+        return None
+    vocab = hf.get_vocab()
+    size = max(vocab.values()) + 1
+    pieces = [b""] * size
+    special = [True] * size  # 어휘에 없는 ID 는 출력하지 않음
+
+    special_ids = set(getattr(hf, "all_special_ids", []) or [])
+    added = {}
+    for token_id, added_token in (getattr(hf, "added_tokens_decoder", None) or {}).items():
+        added[token_id] = added_token
+        if getattr(added_token, "special", False):
+            special_ids.add(token_id)
+
+    byte_decoder = _gpt2_byte_decoder() if kind == "bpe" else None
+    for token, token_id in vocab.items():
+        if token_id in special_ids or SPECIAL_TOKEN_PATTERN.match(token):
+            continue
+        special[token_id] = False
+        if token_id in added:
+            # 추가 토큰은 decoder 를 거치지 않고 내용 그대로 출력됨
+            pieces[token_id] = getattr(added[token_id], "content", str(added[token_id])).encode("utf-8")
+        elif kind == "bpe":
+            if all(ch in byte_decoder for ch in token):
+                pieces[token_id] = bytes(byte_decoder[ch] for ch in token)
+            else:
+                pieces[token_id] = token.encode("utf-8")
+        else:
+            match = BYTE_FALLBACK_PATTERN.match(token)
+            pieces[token_id] = bytes([int(match.group(1), 16)]) if match else token.replace("▁", " ").encode("utf-8")
+    return pieces, special, strip
+
+
+class NativeVocab:
+    """네이티브 어휘 테이블 (프로세스당 모델 하나)"""
+
+    def __init__(self, pieces, special, strip_leading_space: bool):
+        offsets = (ctypes.c_uint32 * (len(pieces) + 1))()
+        total = 0
+        for i, piece in enumerate(pieces):
+            offsets[i] = total
+            total += len(piece)
+        offsets[len(pieces)] = total
+        data = b"".join(pieces)
+        flags = bytes(1 if s else 0 for s in special)
+        self._handle = _lib.llm_detok_vocab_new(data, offsets, len(pieces), flags)
+        if not self._handle:
+            raise RuntimeError("llm_detok_vocab_new failed")
+        self.strip_leading_space = strip_leading_space
+        # 스케줄러 스레드 하나에서만 쓰므로 출력 버퍼는 공유
+        self._buffer = ctypes.create_string_buffer(_lib.llm_detok_vocab_max_output(self._handle))
+
+    def __del__(self):
+        if getattr(self, "_handle", None):
+            _lib.llm_detok_vocab_free(self._handle)
+            self._handle = None
+
+    def decoder(self):
+        return NativeDecoder(self)
+
+
+class NativeDecoder:
+    """IncrementalDecoder 와 같은 인터페이스 (add/flush) 의 네이티브 구현"""
+
+    def __init__(self, vocab: NativeVocab):
+        self._vocab = vocab  # stream 보다 먼저 해제되지 않도록 참조 유지
+        self._stream = _lib.llm_detok_stream_new(vocab._handle, 1 if vocab.strip_leading_space else 0)
+        if not self._stream:
+            raise RuntimeError("llm_detok_stream_new failed")
+
+    def __del__(self):
+        if getattr(self, "_stream", None):
+            _lib.llm_detok_stream_free(self._stream)
+            self._stream = None
+
+    def add(self, token_id: int) -> str:
+        buffer = self._vocab._buffer
+        n = _lib.llm_detok_stream_add(self._stream, token_id, buffer, len(buffer))
+        if n <= 0:
+            return ""
+        return buffer.raw[:n].decode("utf-8", errors="replace")
+
+    def flush(self) -> str:
+        """생성 끝: 완성되지 않은 바이트는 U+FFFD 로 내보냄 (Python 디코더의 errors="replace" 와 같은 동작)"""
+        buffer = self._vocab._buffer
+        n = _lib.llm_detok_stream_finish(self._stream, buffer, len(buffer))
+        if n <= 0:
+            return ""
+        return buffer.raw[:n].decode("utf-8", errors="replace")
+
+
+def _self_check(vocab: NativeVocab, tokenizer) -> bool:
+    """샘플 문장을 토큰 단위로 스트리밍 디코딩해 tokenizer.decode 결과와 비교"""
+    hf = getattr(tokenizer, "_tokenizer", tokenizer)
+    try:
+        ids = hf.encode(SELF_CHECK_TEXT, add_special_tokens=False)
+        expected = hf.decode(ids, skip_special_tokens=True, clean_up_tokenization_spaces=False)
+    except Exception:
+        return False
+    decoder = vocab.decoder()
+    actual = "".join(decoder.add(token_id) for token_id in ids) + decoder.flush()
+    return actual == expected
+
+
+def decoder_factory(tokenizer, log=print):
+    """요청마다 새 NativeDecoder 를 만드는 함수, 사용할 수 없으면 None"""
+    if _lib is None:
+        return None
+    try:
+        table = build_piece_table(tokenizer)
+        if table is None:
+            log("Native detokenizer: unsupported tokenizer decoder, using Python decoder")
+            return None
+        vocab = NativeVocab(*table)
+        if not _self_check(vocab, tokenizer):
+            log("Native detokenizer: self-check mismatch, using Python decoder")
+            return None
+    except Exception as e:
+        log(f"Native detokenizer unavailable: {e}")
+        return None
+    log(f"Native detokenizer enabled ({len(table[0])} tokens)")
+    return vocab.decoder
@@ -0,0 +1,245 @@
+"""
+libllm_metrics.dylib (native/src/llm_metrics.h) ctypes 바인딩
+
+Metal/IOKit/Mach 메트릭을 프로세스 fork 없이 조회합니다.
+라이브러리를 찾지 못하거나 macOS 가 아니면 available() 이 False 이고
+각 조회 함수는 None 을 반환합니다.
+"""
+import ctypes
+import os
+import sys
+from pathlib import Path
+
+ABI_VERSION = 3
+
+# llm_set_thread_qos 의 QoS 클래스 (llm_metrics.h LLM_QOS_*)
+QOS_USER_INTERACTIVE = 0
+QOS_USER_INITIATED = 1
+QOS_DEFAULT = 2
+QOS_UTILITY = 3
+QOS_BACKGROUND = 4
+
+
+class GpuMetrics(ctypes.Structure):
+    _fields_ = [
+        ("vram_total", ctypes.c_uint64),
+        ("vram_used", ctypes.c_uint64),
+        ("device_util", ctypes.c_double),
+        ("renderer_util", ctypes.c_double),
+        ("tiler_util", ctypes.c_double),
+        ("in_use_system_memory", ctypes.c_double),
+    ]
+
+
+class CpuMetrics(ctypes.Structure):
+    _fields_ = [
+        ("host_usage", ctypes.c_double),
+        ("process_usage", ctypes.c_double),
+        ("process_cpu_seconds", ctypes.c_double),
+        ("process_resident_bytes", ctypes.c_uint64),
+        ("process_footprint_bytes", ctypes.c_uint64),
+        ("cores", ctypes.c_uint32),
+    ]
+
+
+class MemoryMetrics(ctypes.Structure):
+    _fields_ = [
+        ("total", ctypes.c_uint64),
+        ("free", ctypes.c_uint64),
+        ("active", ctypes.c_uint64),
+        ("inactive", ctypes.c_uint64),
+        ("wired", ctypes.c_uint64),
+        ("compressed", ctypes.c_uint64),
+        ("app", ctypes.c_uint64),
+        ("swap_used", ctypes.c_uint64),
+        ("swap_total", ctypes.c_uint64),
+        ("swapins", ctypes.c_uint64),
+        ("swapouts", ctypes.c_uint64),
+        ("pressure_level", ctypes.c_int32),
+    ]
+
+
+class CpuTopology(ctypes.Structure):
+    _fields_ = [
+        ("performance_cores", ctypes.c_uint32),
+        ("efficiency_cores", ctypes.c_uint32),
+        ("logical_cores", ctypes.c_uint32),
+    ]
+
+
+class PrewarmProgress(ctypes.Structure):
+    _fields_ = [
+        ("total_bytes", ctypes.c_uint64),
+        ("resident_bytes", ctypes.c_uint64),
+        ("read_bytes", ctypes.c_uint64),
+    ]
+
+
+def _candidate_paths():
+    env_path = os.getenv("LLM_METRICS_LIB")
+    if env_path:
+        yield Path(env_path)
+    repo_root = Path(__file__).resolve().parent.parent
+    yield repo_root / "native" / "build" / "Release" / "libllm_metrics.dylib"
+    yield repo_root / "native" / "build" / "Release" / "llm_metrics.dylib"
+
+
+def _load():
+    if sys.platform != "darwin":
+        return None
+    for path in _candidate_paths():
+        if not path.exists():
+            continue
+        try:
+            lib = ctypes.CDLL(str(path))
+        except OSError as e:
+            print(f"[WARN] Failed to load {path}: {e}", flush=True)
+            continue
+        lib.llm_metrics_abi_version.restype = ctypes.c_int
+        if lib.llm_metrics_abi_version() != ABI_VERSION:
+            print(f"[WARN] {path}: ABI version mismatch", flush=True)
+            continue
+        lib.llm_metrics_gpu.argtypes = [ctypes.POINTER(GpuMetrics)]
+        lib.llm_metrics_gpu.restype = ctypes.c_int
+        lib.llm_metrics_cpu.argtypes = [ctypes.c_int32, ctypes.POINTER(CpuMetrics)]
+        lib.llm_metrics_cpu.restype = ctypes.c_int
+        lib.llm_metrics_memory.argtypes = [ctypes.POINTER(MemoryMetrics)]
+        lib.llm_metrics_memory.restype = ctypes.c_int
+        lib.llm_metrics_cpu_topology.argtypes = [ctypes.POINTER(CpuTopology)]
+        lib.llm_metrics_cpu_topology.restype = ctypes.c_int
+        lib.llm_set_thread_qos.argtypes = [ctypes.c_int32]
+        lib.llm_set_thread_qos.restype = ctypes.c_int
+        paths_type = ctypes.POINTER(ctypes.c_char_p)
+        lib.llm_resident_bytes.argtypes = [paths_type, ctypes.c_int32, ctypes.POINTER(PrewarmProgress)]
+        lib.llm_resident_bytes.restype = ctypes.c_int
+        lib.llm_prewarm_files.argtypes = [paths_type, ctypes.c_int32, ctypes.c_int32, ctypes.POINTER(PrewarmProgress)]
+        lib.llm_prewarm_files.restype = ctypes.c_int
+        lib.llm_prewarm_cancel.argtypes = []
+        lib.llm_prewarm_cancel.restype = None
+        return lib
+    return None
+
+
+_lib = _load()
+
+
+def available() -> bool:
+    return _lib is not None
+
+
+def _optional(value: float):
+    """-1 (미지원/기준값 없음) 을 None 으로 변환"""
+    return None if value < 0 else value
+
+
+def gpu_metrics():
+    """VRAM(호출 프로세스의 Metal 할당량)과 IOAccelerator GPU 사용률"""
+    if _lib is None:
+        return None
+    out = GpuMetrics()
+    if _lib.llm_metrics_gpu(ctypes.byref(out)) != 0:
+        return None
+    return {
+        "vramTotal": out.vram_total,
+        "vramUsed": out.vram_used,
+        "gpuUsage": _optional(out.device_util),
+        "gpuRenderer": _optional(out.renderer_util),
+        "gpuTiler": _optional(out.tiler_util),
+        "gpuInUseSystemMemory": _optional(out.in_use_system_memory),
+    }
+
+
+def cpu_metrics(pid: int = 0):
+    """호스트 CPU 및 프로세스(pid<=0 이면 자신) CPU 사용률"""
+    if _lib is None:
+        return None
+    out = CpuMetrics()
+    if _lib.llm_metrics_cpu(pid, ctypes.byref(out)) != 0:
+        return None
+    return {
+        "cpuUsage": _optional(out.host_usage),
+        "procCpuUsage": _optional(out.process_usage),
+        "procCpuSec": out.process_cpu_seconds,
+        "procFootprint": out.process_footprint_bytes,
+        "cpuCores": out.cores,
+    }
+
+
+def memory_metrics():
+    """통합 메모리 상태 (vm_statistics64, swap, 메모리 압력 레벨)"""
+    if _lib is None:
+        return None
+    out = MemoryMetrics()
+    if _lib.llm_metrics_memory(ctypes.byref(out)) != 0:
+        return None
+    return {
+        "memTotal": out.total,
+        "memFree": out.free,
+        "memWired": out.wired,
+        "memCompressed": out.compressed,
+        "memApp": out.app,
+        "swapUsed": out.swap_used,
+        "swapTotal": out.swap_total,
+        "swapins": out.swapins,
+        "swapouts": out.swapouts,
+        "memoryPressure": out.pressure_level,
+    }
+
+
+def cpu_topology():
+    """P/E 코어 수 (hw.perflevel0/1.physicalcpu)"""
+    if _lib is None:
+        return None
+    out = CpuTopology()
+    if _lib.llm_metrics_cpu_topology(ctypes.byref(out)) != 0:
+        return None
+    return {
+        "performanceCores": out.performance_cores,
+        "efficiencyCores": out.efficiency_cores,
+        "logicalCores": out.logical_cores,
+    }
+
+
+def set_thread_qos(qos: int) -> bool:
+    """호출한 스레드의 QoS 클래스 설정 (user-interactive 스레드는 P 코어에 우선 배치)"""
+    if _lib is None:
+        return False
+    return _lib.llm_set_thread_qos(qos) == 0
+
+
+def _path_array(paths):
+    encoded = [os.fsencode(str(p)) for p in paths]
+    return (ctypes.c_char_p * len(encoded))(*encoded), len(encoded)
+
+
+def _progress_dict(out: PrewarmProgress):
+    return {"totalBytes": out.total_bytes, "residentBytes": out.resident_bytes, "readBytes": out.read_bytes}
+
+
+def resident_bytes(paths):
+    """파일들의 페이지 캐시 상주량 (mincore, 파일 내용은 읽지 않음)"""
+    if _lib is None or not paths:
+        return None
+    array, count = _path_array(paths)
+    out = PrewarmProgress()
+    if _lib.llm_resident_bytes(array, count, ctypes.byref(out)) != 0:
+        return None
+    return _progress_dict(out)
+
+
+def prewarm_files(paths, threads: int = 0):
+    """여러 스레드로 파일들을 페이지 캐시에 올림 (블로킹, 취소되면 cancelled=True)"""
+    if _lib is None or not paths:
+        return None
+    array, count = _path_array(paths)
+    out = PrewarmProgress()
+    status = _lib.llm_prewarm_files(array, count, threads, ctypes.byref(out))
+    if status < 0:
+        return None
+    return {**_progress_dict(out), "cancelled": status == 1}
+
+
+def cancel_prewarm():
+    """실행 중인 prewarm_files 를 모두 멈춤"""
+    if _lib is not None:
+        _lib.llm_prewarm_cancel()
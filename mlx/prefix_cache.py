@@ -0,0 +1,204 @@
+"""
+프롬프트 prefix KV 캐시 (토큰 ID 기반 radix tree)
+
+요청이 끝날 때 해당 시퀀스의 레이어별 KV 를 트리에 저장하고, 새 요청은 가장 긴
+공통 prefix 의 KV 를 복사해 시작한 뒤 나머지 토큰만 prefill 합니다.
+- 각 노드는 자신의 edge 에 해당하는 토큰 구간의 KV 만 보관하므로
+  공유 시스템 프롬프트나 이전 턴은 트리에 한 번만 저장됩니다.
+- 메모리 예산(바이트)을 넘으면 가장 오래 사용되지 않은 leaf 부터 제거합니다(LRU).
+  디스크 스냅샷에서 복원한 이름 있는 prefix 는 pinned 로 표시되어 제거되지 않습니다.
+
+스케줄러 스레드 전용입니다 (락 없음).
+"""
+import time
+from typing import List, Optional, Sequence, Tuple
+
+import mlx.core as mx
+
+# 레이어별 (keys, values). 각 배열 shape: [1, n_kv_heads, n_tokens, head_dim]
+LayerKV = List[Tuple[mx.array, mx.array]]
+
+
+def _detach(x: mx.array) -> mx.array:
+    """슬라이스가 원본(배치 KV 버퍼)을 붙잡지 않도록 별도 버퍼로 복사"""
+    if hasattr(mx, 'contiguous'):
+        return mx.contiguous(x)
+    return x * 1
+
+
+def _slice(kv: LayerKV, start: int, end: Optional[int] = None) -> LayerKV:
+    return [(_detach(k[:, :, start:end, :]), _detach(v[:, :, start:end, :])) for k, v in kv]
+
+
+def _nbytes(kv: LayerKV) -> int:
+    return sum(k.nbytes + v.nbytes for k, v in kv)
+
+
+class _Node:
+    __slots__ = ("tokens", "kv", "children", "parent", "last_access", "nbytes", "pinned")
+
+    def __init__(self, tokens: List[int], kv: Optional[LayerKV], parent: Optional["_Node"]):
+        self.tokens = tokens
+        self.kv = kv
+        self.children = {}
+        self.parent = parent
+        self.last_access = time.monotonic()
+        self.nbytes = _nbytes(kv) if kv else 0
+        self.pinned = False
+
+
+class PrefixCache:
+    def __init__(self, max_bytes: int, min_tokens: int = 16):
+        self.max_bytes = max_bytes
+        # 이보다 짧은 prefix 는 복사 비용 대비 이득이 적어 무시
+        self.min_tokens = min_tokens
+        self._root = _Node([], None, None)
+        self.total_bytes = 0
+        self.nodes = 0
+        self.hits = 0
+        self.misses = 0
+        self.hit_tokens = 0
+        self.evictions = 0
+
+    def match(self, tokens: Sequence[int]) -> Optional[Tuple[int, LayerKV]]:
+        """tokens 의 가장 긴 캐시된 prefix 와 그 KV 반환
+
+        logits 계산을 위해 마지막 토큰 하나는 항상 prefill 하도록 남겨둡니다.
+        """
+        limit = len(tokens) - 1
+        node = self._root
+        matched = 0
+        path = []  # (node, 사용한 토큰 수)
+        now = time.monotonic()
+        while matched < limit:
+            child = node.children.get(tokens[matched])
+            if child is None:
+                break
+            n = 0
+            edge = child.tokens
+            while n < len(edge) and matched + n < limit and edge[n] == tokens[matched + n]:
+                n += 1
+            child.last_access = now
+            path.append((child, n))
+            matched += n
+            if n < len(edge):
+                break
+            node = child
+
+        if matched < self.min_tokens:
+            self.misses += 1
+            return None
+
+        layers = []
+        for layer in range(len(path[0][0].kv)):
+            keys = [child.kv[layer][0][:, :, :n, :] for child, n in path]
+            values = [child.kv[layer][1][:, :, :n, :] for child, n in path]
+            if len(keys) == 1:
+                layers.append((keys[0], values[0]))
+            else:
+                layers.append((mx.concatenate(keys, axis=2), mx.concatenate(values, axis=2)))
+        self.hits += 1
+        self.hit_tokens += matched
+        return matched, layers
+
+    def insert(self, tokens: Sequence[int], kv: LayerKV, pinned: bool = False):
+        """tokens[0:n] 의 KV (n = kv 의 토큰 길이) 를 트리에 추가
+
+        pinned=True 이면 경로의 모든 노드를 LRU 제거 대상에서 제외합니다.
+        """
+        tokens = list(tokens)
+        if len(tokens) < self.min_tokens:
+            return
+        node = self._root
+        pos = 0
+        now = time.monotonic()
+        while pos < len(tokens):
+            child = node.children.get(tokens[pos])
+            if child is None:
+                suffix = _slice(kv, pos)
+                mx.eval([a for pair in suffix for a in pair])
+                child = self._add(node, tokens[pos:], suffix)
+                child.pinned = child.pinned or pinned
+                break
+            edge = child.tokens
+            n = 0
+            while n < len(edge) and pos + n < len(tokens) and edge[n] == tokens[pos + n]:
+                n += 1
+            child.last_access = now
+            if n < len(edge):
+                child = self._split(child, n)
+            child.pinned = child.pinned or pinned
+            node = child
+            pos += n
+        self._evict()
+
+    def _add(self, parent: _Node, tokens: List[int], kv: LayerKV) -> _Node:
+        node = _Node(tokens, kv, parent)
+        parent.children[tokens[0]] = node
+        self.total_bytes += node.nbytes
+        self.nodes += 1
+        return node
+
+    def _split(self, node: _Node, n: int) -> _Node:
+        """node 의 edge 를 n 위치에서 나눠 앞부분을 새 부모 노드로 만듦"""
+        parent = node.parent
+        head = _Node(node.tokens[:n], _slice(node.kv, 0, n), parent)
+        head.last_access = node.last_access
+        head.pinned = node.pinned
+        tail_kv = _slice(node.kv, n)
+        mx.eval([a for pair in head.kv + tail_kv for a in pair])
+
+        self.total_bytes -= node.nbytes
+        node.tokens = node.tokens[n:]
+        node.kv = tail_kv
+        node.nbytes = _nbytes(tail_kv)
+        node.parent = head
+        head.children[node.tokens[0]] = node
+        parent.children[head.tokens[0]] = head
+        self.total_bytes += head.nbytes + node.nbytes
+        self.nodes += 1
+        return head
+
+    def _evict(self):
+        while self.total_bytes > self.max_bytes and self.nodes > 0:
+            leaf = self._oldest_leaf()
+            if leaf is None:
+                break
+            del leaf.parent.children[leaf.tokens[0]]
+            self.total_bytes -= leaf.nbytes
+            self.nodes -= 1
+            self.evictions += 1
+
+    def _oldest_leaf(self) -> Optional[_Node]:
+        oldest = None
+        stack = list(self._root.children.values())
+        while stack:
+            node = stack.pop()
+            if node.children:
+                stack.extend(node.children.values())
+            elif node.pinned:
+                continue
+            elif oldest is None or node.last_access < oldest.last_access:
+                oldest = node
+        return oldest
+
+    def set_budget(self, max_bytes: int):
+        """메모리 예산 변경 (줄이면 LRU 순서로 즉시 제거, pinned 노드는 유지)"""
+        self.max_bytes = max(0, max_bytes)
+        self._evict()
+
+    def clear(self):
+        self._root = _Node([], None, None)
+        self.total_bytes = 0
+        self.nodes = 0
+
+    def stats(self) -> dict:
+        return {
+            "prefixCacheBytes": self.total_bytes,
+            "prefixCacheMaxBytes": self.max_bytes,
+            "prefixCacheNodes": self.nodes,
+            "prefixCacheHits": self.hits,
+            "prefixCacheMisses": self.misses,
+            "prefixCacheHitTokens": self.hit_tokens,
+            "prefixCacheEvictions": self.evictions,
+        }
@@ -0,0 +1,90 @@
+"""
+요청 단위 구간(span) 기록 (요청 본문의 trace_id 또는 X-Trace-Id 헤더가 있을 때만)
+
+핸들러는 파싱 / 토큰화 / 템플릿 적용 구간을, 배치 스케줄러는 대기열 대기 / prefill 청크 /
+디코드 스텝(mx.eval 로 동기화되므로 GPU 실행 시간에 해당) / 디토크나이즈 시간을 같은 RequestTrace 에 남깁니다.
+시각은 epoch 마이크로초라 같은 호스트의 관리자 / 프론트엔드 구간과 한 타임라인에 놓입니다.
+
+- GET /trace/{trace_id} 로 구간 목록을 가져갑니다 (관리자의 /api/traces/{id} 가 Chrome trace 로 합침).
+- 스트림의 최종 이벤트에는 단계별 합계(summary)를 "trace" 로 실어 보냅니다.
+"""
+import threading
+import time
+from collections import OrderedDict
+from typing import Optional
+
+MAX_TRACES = 200
+MAX_STEP_SPANS = 4096  # 요청당 디코드 스텝 구간 상한 (긴 생성은 이후 스텝을 합계로만 셈)
+
+
+def now_us() -> int:
+    return int(time.time() * 1_000_000)
+
+
+class RequestTrace:
+    """요청 하나의 구간 목록 (스케줄러 스레드와 이벤트 루프에서 함께 추가하므로 lock 사용)"""
+
+    def __init__(self, trace_id: str):
+        self.id = trace_id
+        self.started_us = now_us()
+        self.spans = []
+        self.totals = {}  # 단계 이름 → 누적 ms
+        self.step_spans = 0
+        self._lock = threading.Lock()
+
+    def add(self, name: str, start_s: float, end_s: float, cat: str = "mlx", **args):
+        """time.time() 기준 [start_s, end_s] 구간"""
+        dur_ms = max(0.0, (end_s - start_s) * 1000)
+        with self._lock:
+            self.totals[name] = self.totals.get(name, 0.0) + dur_ms
+            if name == "decode step":
+                self.step_spans += 1
+                if self.step_spans > MAX_STEP_SPANS:
+                    return
+            self.spans.append({"name": name, "cat": cat, "ts": int(start_s * 1_000_000),
+                               "dur": int(dur_ms * 1000), "args": args})
+
+    def total(self, name: str, ms: float):
+        """구간으로 남기지 않고 합계만 더함 (토큰마다 생기는 디토크나이즈 등)"""
+        with self._lock:
+            self.totals[name] = self.totals.get(name, 0.0) + ms
+
+    def summary(self) -> dict:
+        with self._lock:
+            return {name: round(ms, 2) for name, ms in self.totals.items()}
+
+    def to_dict(self) -> dict:
+        with self._lock:
+            return {"id": self.id, "startedUs": self.started_us, "spans": list(self.spans),
+                    "summary": {name: round(ms, 2) for name, ms in self.totals.items()}}
+
+
+class TraceStore:
+    """최근 MAX_TRACES 개 요청의 trace (오래된 것부터 버림)"""
+
+    def __init__(self, capacity: int = MAX_TRACES):
+        self.capacity = capacity
+        self._traces = OrderedDict()
+        self._lock = threading.Lock()
+
+    def start(self, trace_id) -> Optional[RequestTrace]:
+        if not trace_id:
+            return None
+        trace = RequestTrace(str(trace_id)[:64])
+        with self._lock:
+            self._traces[trace.id] = trace
+            while len(self._traces) > self.capacity:
+                self._traces.popitem(last=False)
+        return trace
+
+    def get(self, trace_id: str) -> Optional[RequestTrace]:
+        with self._lock:
+            return self._traces.get(trace_id)
+
+
+def trace_id_of(body: dict, headers=None) -> Optional[str]:
+    """본문의 trace_id (브라우저 WebSocket 은 헤더를 못 붙임) 또는 X-Trace-Id 헤더"""
+    trace_id = body.get("trace_id") if isinstance(body, dict) else None
+    if not trace_id and headers is not None:
+        trace_id = headers.get("x-trace-id")
+    return str(trace_id) if trace_id else None
@@ -9,11 +9,16 @@ import json
 import asyncio
 import time
 import psutil
-import re
 from pathlib import Path
 from typing import Optional, List
 from contextlib import asynccontextmanager
 
+import native_metrics
+import native_detok
+from event_hub import LogRing, MetricsBroadcaster, run_until_disconnect
+from stream_framing import StreamFormat, TokenCoalescer, json_frame, binary_frame
+from request_trace import TraceStore, trace_id_of
+
 try:
     from fastapi import FastAPI, Request, HTTPException, WebSocket, WebSocketDisconnect
     from fastapi.responses import StreamingResponse, JSONResponse
@@ -27,12 +32,12 @@ except ImportError:
 try:
     import mlx.core as mx
     from mlx_lm import load
-    try:
-        from mlx_lm.utils import generate_step
-    except ImportError:
-        # mlx_lm 0.29+ 버전에서는 generate_step이 generate 모듈에 있음
-        from mlx_lm.generate import generate_step
     from mlx_lm.sample_utils import make_sampler, make_repetition_penalty
+    from batch_scheduler import BatchScheduler, GenerationRequest
+    from prefix_cache import PrefixCache
+    import kv_snapshot
+    from context_window import ContextOverflow, TurnTokenCounter, model_context_size, prepare_messages
+    from token_cache import PieceTable, SegmentTokenizer, TokenizeCursors
 except ImportError as e:
     print(f"ERROR: MLX 라이브러리 미설치: {e}. 'pip install mlx-lm' 실행 필요", file=sys.stderr)
     sys.exit(1)
@@ -40,15 +45,33 @@ except ImportError as e:
 # 모델 경로
 MODEL_PATH = os.getenv("MLX_MODEL_PATH", "./models/deepseek-moe-16b-chat-mlx-q4_0")
 PORT = int(os.getenv("PORT", "8081"))
+# 한 번의 디코드 스텝에 묶을 최대 동시 요청 수
+MAX_BATCH_SIZE = int(os.getenv("MLX_MAX_BATCH_SIZE", "8"))
+# 프롬프트 prefix KV 캐시 메모리 예산 (MB, 0 이면 비활성화)
+PREFIX_CACHE_MB = int(os.getenv("MLX_PREFIX_CACHE_MB", "1024"))
+# 이름 있는 프롬프트 prefix 정의 파일과 KV 스냅샷 저장 디렉터리 (둘 다 있어야 사용)
+PROMPT_PREFIXES_PATH = os.getenv("MLX_PROMPT_PREFIXES", "")
+KV_SNAPSHOT_DIR = os.getenv("MLX_KV_SNAPSHOT_DIR", "")
+# messages 요청의 최대 컨텍스트 (0 이면 모델 설정의 max_position_embeddings)
+CONTEXT_SIZE = int(os.getenv("MLX_CONTEXT_SIZE", "0"))
+# 추측 디코딩용 draft 모델 (같은 토크나이저의 작은 모델, 비어 있으면 비활성화)
+DRAFT_MODEL_PATH = os.getenv("MLX_DRAFT_MODEL_PATH", "")
+NUM_DRAFT_TOKENS = int(os.getenv("MLX_NUM_DRAFT_TOKENS", "4"))
+# KV 캐시 양자화 비트 수 (8 또는 4, 0 이면 f16) — 모델 설정 kvCacheType 에서 전달됨 (kv-cache-type.js)
+KV_BITS = int(os.getenv("MLX_KV_BITS", "0"))
+KV_GROUP_SIZE = int(os.getenv("MLX_KV_GROUP_SIZE", "64"))
+# 디코드 중인 요청이 있을 때 스케줄러 스텝당 prefill 할 최대 토큰 수 (0 이면 프롬프트 전체를 한 번에)
+# — 모델 설정 performance.prefillChunkTokens 에서 전달됨 (perf-profile.js)
+PREFILL_CHUNK_TOKENS = int(os.getenv("MLX_PREFILL_CHUNK_TOKENS", "512"))
 
 # 전역 변수
 model = None
 tokenizer = None
 ready = False
-processing = False
-request_queue = []
-log_websockets = []  # WebSocket 연결 리스트
-metrics_websockets = []  # WebSocket 연결 리스트
+scheduler = None  # BatchScheduler (모델 로드 후 생성)
+piece_table = None  # 토큰 ID → piece 캐시 (token_cache.py)
+segment_tokenizer = None  # 스페셜 토큰 경계 단위 토큰화 캐시
+tokenize_cursors = TokenizeCursors()  # /tokenize cursor → 토큰 목록
 loading_progress = 0.0  # 로딩 프로그레스 (0-100)
 
 # 메트릭 추적 변수
@@ -59,44 +82,59 @@ last_token_time = None
 # 최근 토큰 생성 시간 추적 (슬라이딩 윈도우)
 recent_token_times = []  # 최근 토큰 생성 시간 리스트
 
-# 로그 브로드캐스트 (전역 로그 리스트에 추가)
-log_messages = []
+# 로그 링 버퍼 (최근 1000개, seq 단조 증가). /logs/stream 구독자는 새 항목이 들어올 때 깨어남
+log_ring = LogRing(capacity=1000)
+
+# trace_id 가 붙은 최근 요청의 구간 기록 (GET /trace/{trace_id})
+trace_store = TraceStore()
 
 def broadcast_log(message: str):
-    """로그를 전역 리스트에 추가하고 콘솔에 출력"""
-    log_messages.append(message)
+    """로그를 링 버퍼에 추가하고 콘솔에 출력 (스케줄러 스레드에서도 호출 가능)"""
+    log_ring.append({"type": "log", "text": message})
     print(f"[LOG] {message}", flush=True)
-    # 최근 1000개만 유지
-    if len(log_messages) > 1000:
-        log_messages.pop(0)
-    
-    # WebSocket 브로드캐스트는 각 WebSocket 핸들러에서 처리
-    # (비동기 컨텍스트에서만 가능하므로 여기서는 리스트에만 추가)
 
 async def broadcast_log_async(message: str):
-    """비동기 컨텍스트에서 로그 브로드캐스트"""
+    """비동기 컨텍스트에서 로그 브로드캐스트 (구독자 전송은 각 /logs/stream 태스크가 처리)"""
     broadcast_log(message)
-    # WebSocket으로 즉시 브로드캐스트
-    disconnected = []
-    for ws in log_websockets:
-        try:
-            await ws.send_json({"type": "log", "text": message})
-        except (WebSocketDisconnect, ConnectionResetError, BrokenPipeError):
-            disconnected.append(ws)
-        except Exception as e:
-            print(f"[ERROR] Failed to broadcast log to WebSocket: {e}", flush=True)
-            disconnected.append(ws)
-    
-    # 연결이 끊어진 WebSocket 제거
-    for ws in disconnected:
-        if ws in log_websockets:
-            log_websockets.remove(ws)
 
 def broadcast_metrics():
-    """메트릭 브로드캐스트 (WebSocket은 각 핸들러에서 처리)"""
-    # 메트릭은 각 WebSocket 핸들러에서 주기적으로 전송하므로
-    # 여기서는 별도 처리 불필요
-    pass
+    """상태가 바뀌었을 때 다음 주기를 기다리지 않고 메트릭을 다시 계산해 구독자에게 전달"""
+    metrics_broadcaster.kick()
+
+def encode_prompt_prefix(text: str) -> List[int]:
+    """prefix 텍스트 (Llama-3 형식, BOS 포함) 의 토큰 — messages 요청과 같은 encode_segment 라야 prefix 캐시에 걸림"""
+    return encode_segment(text)
+
+async def restore_prompt_prefixes(prefix_cache):
+    """prompt-prefixes.json 의 prefix KV 를 디스크 스냅샷에서 복원 (없으면 계산 후 저장)"""
+    if not BatchScheduler._model_has_plain_kv_cache(model):
+        await broadcast_log_async("KV snapshots skipped: model cache cannot be reused by prefix")
+        return
+    prefixes = [(p["name"], encode_prompt_prefix(p["text"]))
+                for p in kv_snapshot.load_prompt_prefixes(PROMPT_PREFIXES_PATH)]
+    if not prefixes:
+        return
+    start = time.time()
+    loop = asyncio.get_event_loop()
+    try:
+        # 스케줄러 시작 전이므로 executor 스레드에서 모델을 직접 사용해도 안전
+        await loop.run_in_executor(
+            None, kv_snapshot.warm_prefixes, model, prefixes, KV_SNAPSHOT_DIR, MODEL_PATH,
+            prefix_cache, broadcast_log
+        )
+        await broadcast_log_async(f"Prompt prefixes ready: {len(prefixes)} in {time.time() - start:.2f}s")
+    except Exception as e:
+        await broadcast_log_async(f"Prompt prefix restore failed: {e}")
+
+def model_weight_files(model_path: str) -> List[Path]:
+    """모델의 가중치 파일 (디렉토리면 *.safetensors, 없으면 모든 파일)"""
+    path = Path(model_path)
+    if not path.exists():
+        return []
+    if path.is_file():
+        return [path]
+    shards = sorted(path.glob("*.safetensors"))
+    return shards or sorted(f for f in path.rglob("*") if f.is_file())
 
 @asynccontextmanager
 async def lifespan(app: FastAPI):
@@ -105,7 +143,7 @@ async def lifespan(app: FastAPI):
     
     # 시작 시 모델 로드 (비동기로 실행하여 서버가 먼저 시작되도록)
     async def load_model_async():
-        global model, tokenizer, ready, loading_progress
+        global model, tokenizer, ready, loading_progress, scheduler, piece_table, segment_tokenizer
         loading_progress = 0.0  # 로딩 시작 시 초기화
         await broadcast_log_async(f"Loading model from {MODEL_PATH}...")
         try:
@@ -114,28 +152,28 @@ async def lifespan(app: FastAPI):
                 del os.environ['MLX_DEFAULT_DEVICE']
                 await broadcast_log_async("Ensuring GPU (Metal) usage...")
             
-            # 모델 디렉토리 크기 확인 (진행률 추정용)
-            model_path_obj = Path(MODEL_PATH)
-            total_size = 0
-            if model_path_obj.exists():
-                if model_path_obj.is_dir():
-                    # 디렉토리인 경우 모든 파일 크기 합산
-                    for file_path in model_path_obj.rglob('*'):
-                        if file_path.is_file():
-                            total_size += file_path.stat().st_size
-                else:
-                    # 파일인 경우
-                    total_size = model_path_obj.stat().st_size
+            # 가중치 파일 (진행률은 이 파일들의 페이지 캐시 상주량으로 계산)
+            weight_files = model_weight_files(MODEL_PATH)
+            total_size = sum(f.stat().st_size for f in weight_files)
             
             # 모델 로딩 시작 시간
             load_start_time = time.time()
-            last_progress_time = load_start_time
             
             # 모델 로딩을 별도 태스크로 실행 (진행률 모니터링 포함)
             async def load_with_progress():
                 global model, tokenizer, loading_progress
                 loop = asyncio.get_event_loop()
                 
+                # 페이지 캐시 프리웜: 여러 스레드가 shard 를 미리 읽어 load() 의 순차 읽기가 캐시 히트가 되도록
+                initial = native_metrics.resident_bytes(weight_files)
+                prewarm_task = None
+                if initial is not None and total_size > 0:
+                    await broadcast_log_async(
+                        f"Page cache: {initial['residentBytes'] / total_size * 100:.0f}% of "
+                        f"{total_size / 1024 / 1024:.0f} MB already resident, prewarming {len(weight_files)} file(s)"
+                    )
+                    prewarm_task = loop.run_in_executor(None, native_metrics.prewarm_files, weight_files)
+                
                 # 백그라운드에서 모델 로딩 시작
                 load_task = loop.run_in_executor(None, load, MODEL_PATH)
                 
@@ -147,12 +185,15 @@ async def lifespan(app: FastAPI):
                 
                 while not load_task.done():
                     await asyncio.sleep(0.5)
-                    current_memory = process.memory_info().rss
-                    loaded_size = current_memory - initial_memory
+                    resident = native_metrics.resident_bytes(weight_files) if prewarm_task is not None else None
+                    if resident is not None:
+                        # 실제로 페이지 캐시에 올라온 바이트 (mincore)
+                        loaded_size = resident["residentBytes"]
+                    else:
+                        # 네이티브 라이브러리가 없으면 메모리 증가량으로 추정
+                        loaded_size = process.memory_info().rss - initial_memory
                     
-                    # 메모리 증가량을 기반으로 진행률 추정
                     if total_size > 0:
-                        # 메모리 증가량이 전체 크기의 일부라고 가정 (압축 해제 등 고려)
                         estimated_progress = min(95, (loaded_size / total_size) * 100)
                         if estimated_progress > last_loaded_size:
                             progress_steps += 1
@@ -163,12 +204,8 @@ async def lifespan(app: FastAPI):
                                 bar = '█' * filled + '░' * (bar_length - filled)
                                 # 프로그레스 정보를 WebSocket으로 전송 (로그 패널에는 표시되지 않음)
                                 progress_message = f"Loading progress: [{bar}] {estimated_progress:.1f}% ({loaded_size / 1024 / 1024:.1f} MB loaded)"
-                                # server-log 이벤트만 발생 (로그 패널에는 추가하지 않음)
-                                for ws in log_websockets:
-                                    try:
-                                        await ws.send_json({"type": "progress", "text": progress_message, "progress": estimated_progress})
-                                    except:
-                                        pass
+                                # server-log 이벤트만 발생 (로그 패널에는 추가하지 않음, 새 구독자에게 재전송 안 함)
+                                log_ring.append({"type": "progress", "text": progress_message, "progress": estimated_progress})
                                 last_loaded_size = estimated_progress
                     else:
                         # 크기를 알 수 없는 경우 메모리 사용량만 표시
@@ -178,13 +215,43 @@ async def lifespan(app: FastAPI):
                                 await broadcast_log_async(f"Loading... ({loaded_size / 1024 / 1024:.1f} MB loaded)")
                                 last_loaded_size = loaded_size
                 
-                # 모델 로딩 완료 대기
-                model, tokenizer = await load_task
+                # 모델 로딩 완료 대기 (로드가 먼저 끝나면 남은 프리웜은 필요 없음)
+                try:
+                    model, tokenizer = await load_task
+                finally:
+                    if prewarm_task is not None:
+                        native_metrics.cancel_prewarm()
+                        result = await prewarm_task
+                        if result:
+                            await broadcast_log_async(f"Prewarm read {result['readBytes'] / 1024 / 1024:.0f} MB from disk")
                 loading_progress = 100.0  # 로딩 완료
             
             await load_with_progress()
             
+            draft_model = None
+            if DRAFT_MODEL_PATH:
+                try:
+                    await broadcast_log_async(f"Loading draft model from {DRAFT_MODEL_PATH}...")
+                    draft_model, _ = await asyncio.get_event_loop().run_in_executor(None, load, DRAFT_MODEL_PATH)
+                except Exception as e:
+                    await broadcast_log_async(f"⚠️  Draft model loading failed, speculative decoding disabled: {e}")
+            
             load_time = time.time() - load_start_time
+            piece_table = PieceTable(tokenizer)
+            segment_tokenizer = SegmentTokenizer(tokenizer)
+            prefix_cache = PrefixCache(PREFIX_CACHE_MB * 1024 * 1024) if PREFIX_CACHE_MB > 0 else None
+            if prefix_cache is not None and PROMPT_PREFIXES_PATH and KV_SNAPSHOT_DIR:
+                await restore_prompt_prefixes(prefix_cache)
+            scheduler = BatchScheduler(model, tokenizer, max_batch_size=MAX_BATCH_SIZE,
+                                       prefix_cache=prefix_cache,
+                                       decoder_factory=native_detok.decoder_factory(tokenizer, log=broadcast_log),
+                                       draft_model=draft_model, num_draft_tokens=NUM_DRAFT_TOKENS,
+                                       kv_bits=KV_BITS or None, kv_group_size=KV_GROUP_SIZE,
+                                       prefill_chunk_tokens=PREFILL_CHUNK_TOKENS,
+                                       # 디코드 루프는 P 코어에서 (UI/백그라운드 작업에 밀리지 않도록)
+                                       thread_init=lambda: native_metrics.set_thread_qos(native_metrics.QOS_USER_INTERACTIVE),
+                                       log=broadcast_log)
+            scheduler.start()
             ready = True
             loading_progress = 100.0  # 로딩 완료
             await broadcast_log_async("✅ Model loaded successfully")
@@ -198,6 +265,11 @@ async def lifespan(app: FastAPI):
             ready = False
             loading_progress = 0.0  # 로딩 실패 시 초기화
     
+    # 로그/메트릭 fan-out 은 이 이벤트 루프에서 동작
+    loop = asyncio.get_running_loop()
+    log_ring.bind(loop)
+    metrics_broadcaster.start(loop)
+    
     # 모델 로딩을 백그라운드에서 시작
     asyncio.create_task(load_model_async())
     
@@ -205,6 +277,9 @@ async def lifespan(app: FastAPI):
     
     # 종료 시 정리
     broadcast_log("Shutting down...")
+    metrics_broadcaster.stop()
+    if scheduler is not None:
+        scheduler.stop()
 
 # FastAPI 앱 생성
 app = FastAPI(lifespan=lifespan)
@@ -230,46 +305,62 @@ async def health():
 # Metrics endpoint
 @app.get("/metrics")
 async def metrics():
-    system_metrics = get_system_metrics()
+    # 주기마다 한 번 계산한 스냅샷을 WebSocket 구독자와 공유
+    return metrics_broadcaster.snapshot()
+
+def compute_metrics() -> dict:
     return {
         "ready": ready,
-        "processing": processing,
-        "queueLength": len(request_queue),
+        **get_scheduler_metrics(),
         "engine": "python-mlx-lm-direct",
-        **system_metrics
+        **get_system_metrics()
+    }
+
+def get_scheduler_metrics():
+    """배치 스케줄러 상태 (processing 은 기존 클라이언트 호환용)"""
+    if scheduler is None:
+        return {"processing": False, "queueLength": 0, "activeRequests": 0}
+    return {
+        "processing": scheduler.active_count > 0,
+        **scheduler.stats(),
+    }
+
+# cpu_percent() 는 이전 호출 대비 차이를 계산하므로 Process 객체를 재사용
+metrics_process = psutil.Process()
+metrics_process.cpu_percent(interval=None)
+psutil.cpu_percent(interval=None)
+
+def get_cpu_counters():
+    """호스트/프로세스 CPU 사용률 (Electron 매니저의 get-system-metrics 와 같은 기준)"""
+    cpu_usage = psutil.cpu_percent(interval=None)  # 전체 코어 평균 (host_processor_info)
+    cpu_cores = psutil.cpu_count() or 1
+    # Process.cpu_percent 는 코어 1개 = 100% 기준이므로 전체 코어 대비로 정규화
+    proc_cpu_usage = metrics_process.cpu_percent(interval=None) / cpu_cores
+    swap = psutil.swap_memory()
+    return {
+        "cpuUsage": cpu_usage,
+        "procCpuUsage": proc_cpu_usage,
+        "swapUsed": swap.used,
     }
 
 def get_system_metrics():
     """시스템 메트릭 수집"""
     try:
-        process = psutil.Process()
+        process = metrics_process
         
-        # VRAM 정보 (macOS Metal)
-        vram_total = 0
-        vram_used = 0
-        try:
-            # macOS에서 Metal VRAM 정보 가져오기 시도
-            import subprocess
-            result = subprocess.run(['system_profiler', 'SPDisplaysDataType'], 
-                                  capture_output=True, text=True, timeout=2)
-            # 프로세스 메모리 사용량을 VRAM으로 간주
-            process_memory = process.memory_info().rss
-            vram_used = process_memory
-            
-            # 시스템 전체 메모리에서 GPU 메모리 추정 (일반적으로 시스템 메모리의 일부가 GPU에 할당됨)
-            sys_mem = psutil.virtual_memory()
-            # macOS에서 일반적으로 시스템 메모리의 일부가 GPU에 할당되므로 추정값 사용
-            # 실제 GPU 메모리는 시스템 프로파일러에서 가져올 수 있지만 복잡함
-            # 여기서는 프로세스 메모리를 기반으로 추정
-            if process_memory > 0:
-                # 프로세스가 사용하는 메모리를 기반으로 전체 GPU 메모리 추정 (보수적으로 2배)
-                vram_total = max(process_memory * 2, sys_mem.total * 0.1)  # 최소 시스템 메모리의 10%
-        except Exception as e:
-            # 실패 시 프로세스 메모리만 사용
+        # VRAM / GPU 정보: libllm_metrics 의 Metal/IOKit 값 (fork 없음)
+        # currentAllocatedSize 는 호출 프로세스 기준이므로 이 프로세스의 모델 할당량과 같음
+        gpu = native_metrics.gpu_metrics()
+        if gpu is not None:
+            vram_total = gpu["vramTotal"]
+            vram_used = gpu["vramUsed"]
+        else:
+            # 네이티브 라이브러리가 없으면 프로세스 메모리 기반 추정값 사용
             process_memory = process.memory_info().rss
             vram_used = process_memory
-            sys_mem = psutil.virtual_memory()
-            vram_total = max(process_memory * 2, sys_mem.total * 0.1)
+            vram_total = max(process_memory * 2, psutil.virtual_memory().total * 0.1)
+            gpu = {}
+        memory = native_metrics.memory_metrics() or {}
         
         # 시스템 메모리
         sys_mem = psutil.virtual_memory()
@@ -311,7 +402,13 @@ def get_system_metrics():
             "cpuCores": cpu_cores,
             "procCpuSec": proc_cpu_sec,
             "tps": tps,
-            "predictedTotal": tokens_generated_total
+            "predictedTotal": tokens_generated_total,
+            "gpuUsage": gpu.get("gpuUsage"),
+            "gpuRenderer": gpu.get("gpuRenderer"),
+            "gpuTiler": gpu.get("gpuTiler"),
+            "memoryPressure": memory.get("memoryPressure"),
+            "compressedMemory": memory.get("memCompressed"),
+            **get_cpu_counters()
         }
     except Exception as e:
         print(f"[ERROR] Failed to get system metrics: {e}", flush=True)
@@ -326,491 +423,398 @@ def get_system_metrics():
             "predictedTotal": 0
         }
 
+# 메트릭은 producer 태스크 하나가 1초마다 (생성 완료 등 상태 변화 시 즉시) 계산해 모든 구독자와 공유
+metrics_broadcaster = MetricsBroadcaster(compute_metrics, interval=1.0)
+
 # Metrics WebSocket endpoint
 @app.websocket("/metrics/stream")
 async def metrics_stream(websocket: WebSocket):
     """WebSocket으로 메트릭 스트리밍"""
+    subscriber = None
     try:
-        # print(f"[DEBUG] WebSocket connection attempt from {websocket.client}", flush=True)
         await websocket.accept()
-        # print(f"[DEBUG] WebSocket accepted: {websocket.client}", flush=True)
-        metrics_websockets.append(websocket)
+        subscriber = metrics_broadcaster.subscribe()
         
-        # 초기 메트릭 전송
-        system_metrics = get_system_metrics()
-        metrics = {
-            "type": "metrics",
-            "ready": ready,
-            "processing": processing,
-            "queueLength": len(request_queue),
-            "engine": "python-mlx-lm-direct",
-            **system_metrics
-        }
-        try:
-            await websocket.send_json(metrics)
-            # print(f"[DEBUG] Initial metrics sent: {metrics}", flush=True)
-        except Exception as e:
-            print(f"[ERROR] Failed to send initial metrics: {e}", flush=True)
+        async def sender():
+            while True:
+                snapshot = await metrics_broadcaster.next(subscriber)
+                await websocket.send_json({"type": "metrics", **snapshot})
         
-        # 주기적으로 메트릭 전송 (1초마다 - 안정적인 업데이트)
-        while True:
-            await asyncio.sleep(1.0)
-            system_metrics = get_system_metrics()
-            metrics = {
-                "type": "metrics",
-                "ready": ready,
-                "processing": processing,
-                "queueLength": len(request_queue),
-                "engine": "python-mlx-lm-direct",
-                **system_metrics
-            }
-            try:
-                await websocket.send_json(metrics)
-            except (WebSocketDisconnect, ConnectionResetError, BrokenPipeError):
-                break
-            except Exception as e:
-                print(f"[ERROR] Metrics WebSocket send error: {e}", flush=True)
-                break
-    except WebSocketDisconnect:
+        await run_until_disconnect(websocket, sender)
+    except (WebSocketDisconnect, ConnectionResetError, BrokenPipeError):
         pass
     except Exception as e:
         print(f"[ERROR] Metrics WebSocket error: {e}", flush=True)
     finally:
-        if websocket in metrics_websockets:
-            metrics_websockets.remove(websocket)
+        if subscriber is not None:
+            metrics_broadcaster.unsubscribe(subscriber)
 
 # Logs WebSocket endpoint
 @app.websocket("/logs/stream")
 async def logs_stream(websocket: WebSocket):
-    """WebSocket으로 로그 스트리밍"""
+    """WebSocket으로 로그 스트리밍 (최근 100개 재전송 후 새 항목이 들어올 때마다 전송)"""
+    subscriber = None
     try:
         await websocket.accept()
-        log_websockets.append(websocket)
         
         # 초기 로그 전송
         await websocket.send_json({"type": "log", "text": "[Server] Connected to log stream"})
+        subscriber = log_ring.subscribe(replay=100)
         
-        # 기존 로그 전송 (최근 100개)
-        for msg in log_messages[-100:]:
-            try:
-                await websocket.send_json({"type": "log", "text": msg})
-            except (WebSocketDisconnect, ConnectionResetError, BrokenPipeError):
-                break
-            except Exception as e:
-                print(f"[ERROR] Logs WebSocket send error: {e}", flush=True)
-                break
+        async def sender():
+            while True:
+                await log_ring.wait(subscriber)
+                items, dropped = log_ring.read(subscriber)
+                if dropped:
+                    await websocket.send_json({"type": "log", "text": f"[Server] {dropped} log lines skipped (client too slow)"})
+                for item in items:
+                    await websocket.send_json(item)
         
-        # 새로운 로그 대기
-        last_index = len(log_messages)
-        while True:
-            await asyncio.sleep(0.5)  # 0.5초마다 체크
-            
-            # 새로운 로그 전송
-            if last_index < len(log_messages):
-                for msg in log_messages[last_index:]:
-                    try:
-                        await websocket.send_json({"type": "log", "text": msg})
-                    except (WebSocketDisconnect, ConnectionResetError, BrokenPipeError):
-                        break
-                    except Exception as e:
-                        print(f"[ERROR] Logs WebSocket send error: {e}", flush=True)
-                        break
-                last_index = len(log_messages)
-    except WebSocketDisconnect:
+        await run_until_disconnect(websocket, sender)
+    except (WebSocketDisconnect, ConnectionResetError, BrokenPipeError):
         pass
     except Exception as e:
         print(f"[ERROR] Logs WebSocket error: {e}", flush=True)
     finally:
-        if websocket in log_websockets:
-            log_websockets.remove(websocket)
+        if subscriber is not None:
+            log_ring.unsubscribe(subscriber)
+
+# 요청 파라미터 → 샘플러 / logits processor
+def parse_generation_params(body: dict, default_max_tokens: int = 512):
+    """요청 본문에서 생성 파라미터를 읽어 (max_tokens, sampler, logits_processors) 반환"""
+    max_tokens = body.get("max_tokens", body.get("n_predict", default_max_tokens))
+    if max_tokens is None or max_tokens <= 0:
+        max_tokens = 256
+    temperature = body.get("temperature", 0.7)
+    top_p = body.get("top_p", 0.95)
+    min_p = body.get("min_p", 0.0)
+    repeat_penalty = body.get("repeat_penalty", 1.1)
+    repeat_last_n = body.get("repeat_last_n", body.get("repetition_context_size", 64))
+    
+    # 샘플러 생성 (mlx_lm 0.29+ 버전용)
+    sampler = make_sampler(temp=temperature, top_p=top_p, min_p=min_p)
+    
+    # Repetition penalty를 logits processor로 생성
+    logits_processors = []
+    if repeat_penalty != 1.0:
+        logits_processors.append(make_repetition_penalty(penalty=repeat_penalty, context_size=repeat_last_n))
+    return max_tokens, sampler, logits_processors
+
+def encode_prompt(prompt: str, chat_template: bool) -> List[int]:
+    """프롬프트 토큰화 (chat_template=True 이면 채팅 템플릿 적용)"""
+    prompt_formatted = prompt
+    if chat_template:
+        try:
+            messages = [{"role": "user", "content": prompt}]
+            prompt_formatted = tokenizer.apply_chat_template(
+                messages, tokenize=False, add_generation_prompt=True
+            )
+        except:
+            prompt_formatted = prompt
+    prompt_tokens = tokenizer.encode(prompt_formatted)
+    return prompt_tokens.tolist() if hasattr(prompt_tokens, 'tolist') else list(prompt_tokens)
+
+def encode_segment(text: str) -> List[int]:
+    """이미 포맷팅된 텍스트의 토큰화 (BOS 등 특수 토큰 자동 추가 없이, 이전 턴은 캐시 히트)"""
+    return segment_tokenizer.encode(text, add_special=False)
+
+turn_token_counter = TurnTokenCounter()
+
+def prepare_prompt(body: dict, chat_template: bool):
+    """요청 본문 → (prompt_tokens, prompt_info)
+
+    messages 가 있으면 서버에서 컨텍스트 크기를 맞추고 (넘치면 오래된 턴부터 제거, context_overflow="reject"
+    이면 ContextOverflow) 토큰 수와 조정된 max_tokens 를 prompt_info 로 돌려줍니다.
+    messages 는 Llama-3 형식으로 직접 조립하므로 (BOS 포함) chat_template 과 무관하게 그대로 토큰화하고,
+    prompt 문자열만 있으면 prompt_info 는 None 입니다.
+    """
+    messages = body.get("messages")
+    if not isinstance(messages, list) or not messages:
+        prompt = body.get("prompt", "")
+        return (encode_prompt(prompt, chat_template) if prompt else None), None
+
+    limits = [c for c in (model_context_size(model, CONTEXT_SIZE), int(body.get("context_size") or 0)) if c]
+    context_size = min(limits) if limits else 4096
+    n_predict = body.get("max_tokens", body.get("n_predict", -1)) or -1
+    tokens, info = prepare_messages(
+        messages, encode_segment, encode_segment, turn_token_counter,
+        context_size, n_predict, body.get("context_overflow", "truncate")
+    )
+    if info["truncated_turns"]:
+        broadcast_log(f"Context: dropped {info['truncated_turns']} oldest turns to fit {context_size} tokens")
+    body["max_tokens"] = info["n_predict"]
+    return tokens, info
+
+def prompt_event(body: dict, prompt_tokens: List[int], prompt_info: Optional[dict]) -> Optional[dict]:
+    """스트림 첫 이벤트: 프롬프트 토큰 수 (+ return_tokens 이면 토큰 ID 와 piece)"""
+    return_tokens = bool(body.get("return_tokens"))
+    if not prompt_info and not return_tokens:
+        return None
+    event = dict(prompt_info or {"prompt_tokens": len(prompt_tokens)})
+    if return_tokens:
+        event["tokens"] = list(prompt_tokens)
+        event["pieces"] = piece_table.pieces(prompt_tokens)
+    return event
+
+def with_token(body: dict, event: dict, payload: dict) -> dict:
+    """return_tokens 이면 생성된 토큰 ID 와 piece 를 스트림 이벤트에 함께 실음 (TokenDebugPanel 용)"""
+    if body.get("return_tokens") and event["token"] is not None:
+        payload["tokens"] = [event["token"]]
+        payload["pieces"] = [piece_table.piece(event["token"])]
+    return payload
+
+def context_error(error: ContextOverflow) -> JSONResponse:
+    """llama-server 와 같은 형식의 컨텍스트 초과 오류"""
+    return JSONResponse(status_code=400, content={"error": {
+        "code": 400, "message": str(error), "type": "exceed_context_size_error",
+        "n_prompt_tokens": error.info["prompt_tokens"], "n_ctx": error.info["context_size"],
+    }})
+
+def record_generated_token():
+    """TPS 계산용 토큰 생성 시각 기록 (이벤트 루프에서만 호출)"""
+    global tokens_generated, tokens_generated_total, last_token_time
+    tokens_generated += 1
+    tokens_generated_total += 1
+    last_token_time = time.time()
+    recent_token_times.append(last_token_time)
+    # 2초 이전의 기록은 제거 (메모리 절약)
+    while recent_token_times and last_token_time - recent_token_times[0] > 2.0:
+        recent_token_times.pop(0)
+
+def start_trace(body: dict, headers, parse_start: float):
+    """trace_id 가 있으면 RequestTrace 를 만들고 본문 파싱 구간을 기록 (없으면 None)"""
+    trace = trace_store.start(trace_id_of(body, headers))
+    if trace:
+        trace.add("parse request", parse_start, time.time(), cat="http")
+    return trace
+
+def traced_prepare_prompt(trace, body: dict, chat_template: bool):
+    """prepare_prompt + 토큰화 / 템플릿 적용 구간 기록"""
+    started = time.time()
+    prompt_tokens, prompt_info = prepare_prompt(body, chat_template)
+    if trace:
+        trace.add("prepare prompt", started, time.time(), tokens=len(prompt_tokens or []),
+                  messages=isinstance(body.get("messages"), list), chat_template=chat_template)
+    return prompt_tokens, prompt_info
+
+def with_trace(event: dict, payload: dict) -> dict:
+    """done 이벤트에 단계별 합계가 있으면 최종 이벤트에 trace 로 실음"""
+    if event.get("trace"):
+        payload["trace"] = event["trace"]
+    return payload
+
+async def stream_generation(gen_request: GenerationRequest, coalescer: Optional[TokenCoalescer] = None):
+    """스케줄러에 요청을 제출하고 이벤트를 순서대로 yield
+
+    coalescer 가 있으면 token 이벤트 대신 모인 토큰을 {"type": "frame", "items": [...]} 로 yield 합니다
+    (done / error 앞에서는 남은 토큰을 먼저 flush).
+    소비자가 중간에 멈추면(클라이언트 연결 종료) finally 에서 요청을 취소합니다.
+    trace 가 있으면 스케줄러 스레드 → 이벤트 루프 전달 지연을 합산하고 done 이벤트에 합계를 붙입니다.
+    """
+    global generation_start_time, tokens_generated
+    trace = gen_request.trace
+    events = scheduler.submit(gen_request)
+    if generation_start_time is None:
+        generation_start_time = time.time()
+        tokens_generated = 0
+    try:
+        while True:
+            if coalescer is None:
+                event = await events.get()
+            else:
+                try:
+                    event = await asyncio.wait_for(events.get(), coalescer.timeout(time.time()))
+                except asyncio.TimeoutError:
+                    yield {"type": "frame", "items": coalescer.take()}
+                    continue
+            if event["type"] == "token":
+                if event["token"] is not None:
+                    record_generated_token()
+                if trace:
+                    trace.total("event loop handoff", (time.time() - event["at"]) * 1000)
+                if coalescer is not None:
+                    if coalescer.add(event):
+                        yield {"type": "frame", "items": coalescer.take()}
+                    continue
+            elif coalescer is not None and coalescer.items:
+                yield {"type": "frame", "items": coalescer.take()}
+            if event["type"] == "done" and trace:
+                trace.add("generate", gen_request.submitted_at, time.time(), cat="mlx",
+                          tokens=event["tokens"], cached_tokens=event["cached_tokens"])
+                event = {**event, "trace": trace.summary()}
+            yield event
+            if event["type"] in ("done", "error"):
+                if event["type"] == "done":
+                    cached = (f", prefix cache hit {event['cached_tokens']}/{len(gen_request.prompt_tokens)} prompt tokens"
+                              if event.get("cached_tokens") else "")
+                    if event.get("draft_tokens"):
+                        cached += f", draft {event['draft_accepted']}/{event['draft_tokens']} accepted"
+                    if coalescer is not None:
+                        cached += f", {coalescer.frames} {coalescer.format.mode} frames"
+                    broadcast_log(f"Generation completed: {event['tokens']} tokens ({event['finish_reason']}{cached})")
+                break
+    finally:
+        scheduler.cancel(gen_request)
+        if scheduler.active_count == 0 and scheduler.pending_count == 0:
+            generation_start_time = None
+        broadcast_metrics()
+
+def stream_coalescer(stream_format: StreamFormat, gen_request: GenerationRequest) -> Optional[TokenCoalescer]:
+    """협상된 형식이 프레이밍을 쓰면 요청용 coalescer (토큰 시각은 요청 제출 기준)"""
+    return TokenCoalescer(stream_format, gen_request.submitted_at) if stream_format.framed else None
+
+def sse_frame(body: dict, coalescer: TokenCoalescer, items) -> Optional[str]:
+    """coalesced 프레임 하나의 SSE 이벤트 (보낼 내용이 없으면 None)"""
+    frame = json_frame(coalescer, items, bool(body.get("return_tokens")), piece_table.piece)
+    return f"data: {json.dumps(frame, ensure_ascii=False)}\n\n" if frame else None
+
+def sse_headers(stream_format: StreamFormat) -> dict:
+    if not stream_format.framed:
+        return SSE_HEADERS
+    return {**SSE_HEADERS, "X-Stream-Format": stream_format.header(), "Access-Control-Expose-Headers": "X-Stream-Format"}
+
+def ensure_ready():
+    if not ready or scheduler is None:
+        raise HTTPException(status_code=503, detail="Model is loading...")
+
+SSE_HEADERS = {
+    "Cache-Control": "no-cache",
+    "Connection": "keep-alive",
+}
 
 # Chat endpoint
 @app.post("/chat")
 async def chat(request: Request):
     """채팅 요청 처리 (SSE 스트리밍)"""
-    global processing
-    
-    if not ready:
-        raise HTTPException(status_code=503, detail="Model is loading...")
-    
-    if processing:
-        raise HTTPException(status_code=503, detail="Server is busy")
+    ensure_ready()
     
     try:
+        parse_start = time.time()
         body = await request.json()
-        prompt = body.get("prompt", "")
-        max_tokens = body.get("max_tokens", body.get("n_predict", 512))
-        temperature = body.get("temperature", 0.7)
-        top_p = body.get("top_p", 0.95)
-        min_p = body.get("min_p", 0.0)
-        repeat_penalty = body.get("repeat_penalty", body.get("repeat_penalty", 1.1))
-        repeat_last_n = body.get("repeat_last_n", body.get("repetition_context_size", 64))
-        
-        if not prompt:
+        trace = start_trace(body, request.headers, parse_start)
+        prompt_tokens, prompt_info = traced_prepare_prompt(trace, body, chat_template=True)
+        if not prompt_tokens:
             raise HTTPException(status_code=400, detail="Prompt is required")
         
-        processing = True
-        broadcast_metrics()
-        
-        async def generate():
-            global processing, tokens_generated, tokens_generated_total, generation_start_time, last_token_time
-            try:
-                # 채팅 템플릿 적용
-                try:
-                    messages = [{"role": "user", "content": prompt}]
-                    prompt_formatted = tokenizer.apply_chat_template(
-                        messages, tokenize=False, add_generation_prompt=True
-                    )
-                except:
-                    prompt_formatted = prompt
-                
-                # 프롬프트 토큰화
-                prompt_tokens = tokenizer.encode(prompt_formatted)
-                prompt_tokens_list = prompt_tokens.tolist() if hasattr(prompt_tokens, 'tolist') else list(prompt_tokens)
-                prompt_array = mx.array(prompt_tokens)
-                
-                # 샘플러 생성 (mlx_lm 0.29+ 버전용)
-                sampler = make_sampler(
-                    temp=temperature,
-                    top_p=top_p,
-                    min_p=min_p
-                )
-                
-                # Repetition penalty를 logits processor로 생성
-                logits_processors = []
-                if repeat_penalty != 1.0:
-                    logits_processors.append(make_repetition_penalty(penalty=repeat_penalty, context_size=repeat_last_n))
-                
-                # generate_step으로 토큰 단위 생성
-                token_count = 0
-                generation_start_time = time.time()
-                tokens_generated = 0
-                eos_token_id = getattr(tokenizer, 'eos_token_id', None)
-                
-                # UTF-8 버퍼: 멀티바이트 문자 처리를 위한 토큰 누적 (최대 3개)
-                token_buffer = []
-                previous_text = ""
-                
-                step_generator = generate_step(
-                    prompt_array,
-                    model,
-                    sampler=sampler,
-                    logits_processors=logits_processors if logits_processors else None,
-                    max_tokens=max_tokens
-                )
-                
-                # 토큰 단위로 생성 및 스트리밍
-                while token_count < max_tokens:
-                    try:
-                        token_array, logits = next(step_generator)
-                    except StopIteration:
-                        break
-                    
-                    # 토큰 ID 추출
-                    if isinstance(token_array, mx.array):
-                        token_id = int(token_array.item())
-                    elif isinstance(token_array, (int, float)):
-                        token_id = int(token_array)
-                    else:
-                        try:
-                            token_id = int(token_array)
-                        except:
-                            if hasattr(token_array, 'item'):
-                                token_id = int(token_array.item())
-                            else:
-                                token_id = int(token_array)
-                    
-                    # EOS 토큰 체크
-                    if eos_token_id is not None and token_id == eos_token_id:
-                        # 버퍼에 남은 토큰 처리
-                        if token_buffer:
-                            try:
-                                buffered_text = tokenizer.decode(token_buffer, skip_special_tokens=True)
-                                buffered_text = re.sub(r'<\|[^>]*\|>', '', buffered_text)
-                                if buffered_text.startswith(previous_text):
-                                    final_text = buffered_text[len(previous_text):]
-                                    if final_text:
-                                        data = json.dumps({"content": final_text}, ensure_ascii=False)
-                                        yield f"data: {data}\n\n"
-                            except:
-                                pass
-                        break
-                    
-                    # 토큰을 버퍼에 추가
-                    token_buffer.append(token_id)
-                    
-                    # 버퍼가 최대 크기에 도달하거나, 완전한 문자로 디코딩 가능할 때 전송
-                    if len(token_buffer) >= 3:
-                        try:
-                            # 버퍼의 모든 토큰 디코딩
-                            current_text = tokenizer.decode(token_buffer, skip_special_tokens=True)
-                            current_text = re.sub(r'<\|[^>]*\|>', '', current_text)
-                            
-                            # 이전 텍스트와 비교하여 새로운 부분만 추출
-                            if current_text.startswith(previous_text):
-                                new_text = current_text[len(previous_text):]
-                                if new_text:
-                                    # 완전한 문자인지 확인 (replacement character가 없으면)
-                                    if '\ufffd' not in new_text:
-                                        data = json.dumps({"content": new_text}, ensure_ascii=False)
-                                        yield f"data: {data}\n\n"
-                                        previous_text = current_text
-                                        token_buffer = []
-                                    else:
-                                        # replacement character가 있으면 버퍼 유지 (다음 토큰 대기)
-                                        pass
-                            else:
-                                # 시작 부분이 다르면 전체 사용
-                                if '\ufffd' not in current_text:
-                                    data = json.dumps({"content": current_text}, ensure_ascii=False)
-                                    yield f"data: {data}\n\n"
-                                    previous_text = current_text
-                                    token_buffer = []
-                        except Exception as e:
-                            # 디코딩 실패 시 버퍼 비우기
-                            token_buffer = []
-                    
-                    token_count += 1
-                    tokens_generated += 1
-                    tokens_generated_total += 1
-                    last_token_time = time.time()
-                    # 최근 토큰 생성 시간 기록
-                    recent_token_times.append(last_token_time)
-                    # 2초 이전의 기록은 제거 (메모리 절약)
-                    current_time = time.time()
-                    recent_token_times = [t for t in recent_token_times if current_time - t <= 2.0]
-                    
-                    # 메트릭 업데이트 (5토큰마다)
-                    if token_count % 5 == 0:
-                        broadcast_metrics()
-                    
-                    # 토큰 생성 로그 (제거됨)
-                    # if token_count % 10 == 0:  # 10토큰마다 로그
-                    #     broadcast_log(f"Generated {token_count} tokens...")
-                
-                # 완료 신호
-                yield f"data: {json.dumps({'stop': True})}\n\n"
-                broadcast_log(f"Generation completed: {token_count} tokens")
-                
-            except Exception as e:
-                import traceback
-                error_msg = f"Generation failed: {str(e)}"
-                broadcast_log(error_msg)
-                broadcast_log(traceback.format_exc())
-                yield f"data: {json.dumps({'error': error_msg})}\n\n"
-            finally:
-                processing = False
-                tokens_generated = 0
-                generation_start_time = None
-                broadcast_metrics()
-        
-        return StreamingResponse(
-            generate(),
-            media_type="text/event-stream",
-            headers={
-                "Cache-Control": "no-cache",
-                "Connection": "keep-alive",
-            }
-        )
-        
+        max_tokens, sampler, logits_processors = parse_generation_params(body)
+        gen_request = GenerationRequest(prompt_tokens, max_tokens, sampler, logits_processors)
+        gen_request.trace = trace
+        stream_format = StreamFormat.parse(body, binary_allowed=False)
+    except ContextOverflow as e:
+        return context_error(e)
+    except HTTPException:
+        raise
     except Exception as e:
-        processing = False
-        broadcast_metrics()
         raise HTTPException(status_code=500, detail=str(e))
+    
+    first_event = prompt_event(body, prompt_tokens, prompt_info)
+    
+    async def generate():
+        try:
+            if first_event:
+                yield f"data: {json.dumps(first_event, ensure_ascii=False)}\n\n"
+            coalescer = stream_coalescer(stream_format, gen_request)
+            async for event in stream_generation(gen_request, coalescer):
+                if event["type"] == "frame":
+                    frame = sse_frame(body, coalescer, event["items"])
+                    if frame:
+                        yield frame
+                elif event["type"] == "token":
+                    payload = with_token(body, event, {"content": event["text"]})
+                    if event["text"] or "tokens" in payload:
+                        data = json.dumps(payload, ensure_ascii=False)
+                        yield f"data: {data}\n\n"
+                elif event["type"] == "error":
+                    broadcast_log(event["message"])
+                    yield f"data: {json.dumps({'error': event['message']})}\n\n"
+                else:
+                    # 완료 신호 (토큰 수는 llama.cpp 의 최종 청크와 같은 필드 이름)
+                    final = {
+                        "stop": True,
+                        "tokens_predicted": event["tokens"],
+                        "tokens_evaluated": len(gen_request.prompt_tokens),
+                        "tokens_cached": event["cached_tokens"],
+                        "draft_n": event.get("draft_tokens", 0),
+                        "draft_n_accepted": event.get("draft_accepted", 0),
+                    }
+                    yield f"data: {json.dumps(with_trace(event, final))}\n\n"
+        except Exception as e:
+            error_msg = f"Generation failed: {str(e)}"
+            broadcast_log(error_msg)
+            yield f"data: {json.dumps({'error': error_msg})}\n\n"
+    
+    return StreamingResponse(generate(), media_type="text/event-stream", headers=sse_headers(stream_format))
 
 # Chat WebSocket endpoint
 @app.websocket("/chat/ws")
 async def chat_websocket(websocket: WebSocket):
     """WebSocket으로 채팅 요청 처리 (실시간 스트리밍)"""
-    global processing
-    
     await websocket.accept()
     
-    if not ready:
+    if not ready or scheduler is None:
         await websocket.send_json({"type": "error", "message": "Model is loading..."})
         await websocket.close()
         return
     
-    if processing:
-        await websocket.send_json({"type": "error", "message": "Server is busy"})
-        await websocket.close()
-        return
-    
-    global tokens_generated, tokens_generated_total, generation_start_time, last_token_time, recent_token_times
     try:
         # 요청 수신
+        parse_start = time.time()
         data = await websocket.receive_json()
-        prompt = data.get("prompt", "")
-        max_tokens = data.get("max_tokens", data.get("n_predict", 512))
-        temperature = data.get("temperature", 0.7)
-        top_p = data.get("top_p", 0.95)
-        min_p = data.get("min_p", 0.0)
-        repeat_penalty = data.get("repeat_penalty", data.get("repeat_penalty", 1.1))
-        repeat_last_n = data.get("repeat_last_n", data.get("repetition_context_size", 64))
-        
-        if not prompt:
+        trace = start_trace(data, None, parse_start)
+        try:
+            prompt_tokens, prompt_info = traced_prepare_prompt(trace, data, chat_template=True)
+        except ContextOverflow as e:
+            await websocket.send_json({"type": "error", "message": str(e), **e.info})
+            await websocket.close()
+            return
+        if not prompt_tokens:
             await websocket.send_json({"type": "error", "message": "Prompt is required"})
             await websocket.close()
             return
         
-        processing = True
-        broadcast_metrics()
+        max_tokens, sampler, logits_processors = parse_generation_params(data)
+        gen_request = GenerationRequest(prompt_tokens, max_tokens, sampler, logits_processors,
+                                        ignore_eos=bool(data.get("ignore_eos", False)))
+        gen_request.trace = trace
+        stream_format = StreamFormat.parse(data, binary_allowed=True)
+        if stream_format.framed:
+            # 협상 결과: 이후 토큰은 tokens 메시지 (coalesced) 또는 binary 프레임으로 옴
+            await websocket.send_json({"type": "stream_format", **stream_format.describe()})
+        first_event = prompt_event(data, prompt_tokens, prompt_info)
+        if first_event:
+            # 첫 이벤트: 서버가 센 프롬프트 토큰 수 (클라이언트의 /tokenize 호출 대체)
+            await websocket.send_json({"type": "prompt", **first_event})
         
-        try:
-            # 채팅 템플릿 적용
-            try:
-                messages = [{"role": "user", "content": prompt}]
-                prompt_formatted = tokenizer.apply_chat_template(
-                    messages, tokenize=False, add_generation_prompt=True
-                )
-            except:
-                prompt_formatted = prompt
-            
-            # 프롬프트 토큰화
-            prompt_tokens = tokenizer.encode(prompt_formatted)
-            prompt_tokens_list = prompt_tokens.tolist() if hasattr(prompt_tokens, 'tolist') else list(prompt_tokens)
-            prompt_array = mx.array(prompt_tokens)
-            
-            # 샘플러 생성 (mlx_lm 0.29+ 버전용)
-            sampler = make_sampler(
-                temp=temperature,
-                top_p=top_p,
-                min_p=min_p
-            )
-            
-            # Repetition penalty를 logits processor로 생성
-            logits_processors = []
-            if repeat_penalty != 1.0:
-                logits_processors.append(make_repetition_penalty(penalty=repeat_penalty, context_size=repeat_last_n))
-            
-            # generate_step으로 토큰 단위 생성
-            token_count = 0
-            eos_token_id = getattr(tokenizer, 'eos_token_id', None)
-            
-            # UTF-8 버퍼: 멀티바이트 문자 처리를 위한 토큰 누적 (최대 3개)
-            token_buffer = []
-            previous_text = ""
-            
-            step_generator = generate_step(
-                prompt_array,
-                model,
-                sampler=sampler,
-                logits_processors=logits_processors if logits_processors else None,
-                max_tokens=max_tokens
-            )
-            
-            # 토큰 단위로 생성 및 WebSocket으로 실시간 전송
-            while token_count < max_tokens:
-                try:
-                    token_array, logits = next(step_generator)
-                except StopIteration:
-                    break
-                
-                # 토큰 ID 추출
-                if isinstance(token_array, mx.array):
-                    token_id = int(token_array.item())
-                elif isinstance(token_array, (int, float)):
-                    token_id = int(token_array)
+        coalescer = stream_coalescer(stream_format, gen_request)
+        async for event in stream_generation(gen_request, coalescer):
+            if event["type"] == "frame":
+                if stream_format.mode == "binary":
+                    await websocket.send_bytes(binary_frame(coalescer, event["items"]))
                 else:
-                    try:
-                        token_id = int(token_array)
-                    except:
-                        if hasattr(token_array, 'item'):
-                            token_id = int(token_array.item())
-                        else:
-                            token_id = int(token_array)
-                
-                # EOS 토큰 체크
-                if eos_token_id is not None and token_id == eos_token_id:
-                    # 버퍼에 남은 토큰 처리
-                    if token_buffer:
-                        try:
-                            buffered_text = tokenizer.decode(token_buffer, skip_special_tokens=True)
-                            buffered_text = re.sub(r'<\|[^>]*\|>', '', buffered_text)
-                            if buffered_text.startswith(previous_text):
-                                final_text = buffered_text[len(previous_text):]
-                                if final_text:
-                                    await websocket.send_json({"type": "token", "content": final_text})
-                        except:
-                            pass
-                    break
-                
-                # 토큰을 버퍼에 추가
-                token_buffer.append(token_id)
-                
-                # 버퍼가 최대 크기에 도달하거나, 완전한 문자로 디코딩 가능할 때 전송
-                if len(token_buffer) >= 3:
-                    try:
-                        # 버퍼의 모든 토큰 디코딩
-                        current_text = tokenizer.decode(token_buffer, skip_special_tokens=True)
-                        current_text = re.sub(r'<\|[^>]*\|>', '', current_text)
-                        
-                        # 이전 텍스트와 비교하여 새로운 부분만 추출
-                        if current_text.startswith(previous_text):
-                            new_text = current_text[len(previous_text):]
-                            if new_text:
-                                # 완전한 문자인지 확인 (replacement character가 없으면)
-                                if '\ufffd' not in new_text:
-                                    await websocket.send_json({"type": "token", "content": new_text})
-                                    previous_text = current_text
-                                    token_buffer = []
-                                else:
-                                    # replacement character가 있으면 버퍼 유지 (다음 토큰 대기)
-                                    pass
-                        else:
-                            # 시작 부분이 다르면 전체 사용
-                            if '\ufffd' not in current_text:
-                                await websocket.send_json({"type": "token", "content": current_text})
-                                previous_text = current_text
-                                token_buffer = []
-                    except Exception as e:
-                        # 디코딩 실패 시 버퍼 비우기
-                        token_buffer = []
-                
-                token_count += 1
-                tokens_generated += 1
-                tokens_generated_total += 1
-                last_token_time = time.time()
-                # 최근 토큰 생성 시간 기록
-                recent_token_times.append(last_token_time)
-                # 2초 이전의 기록은 제거 (메모리 절약)
-                current_time = time.time()
-                recent_token_times = [t for t in recent_token_times if current_time - t <= 2.0]
-                
-                # 메트릭 업데이트 (5토큰마다)
-                if token_count % 5 == 0:
-                    broadcast_metrics()
-                
-                # EOS 토큰 체크
-                if eos_token_id is not None and token_id == eos_token_id:
-                    break
-                
-                # 토큰 생성 로그 (제거됨)
-                # if token_count % 10 == 0:
-                #     broadcast_log(f"Generated {token_count} tokens...")
-            
-            # 완료 신호
-            await websocket.send_json({"type": "done", "stop": True})
-            broadcast_log(f"Generation completed: {token_count} tokens")
-            
-        except Exception as e:
-            import traceback
-            error_msg = f"Generation failed: {str(e)}"
-            broadcast_log(error_msg)
-            broadcast_log(traceback.format_exc())
-            await websocket.send_json({"type": "error", "message": error_msg})
-        finally:
-            processing = False
-            tokens_generated = 0
-            generation_start_time = None
-            broadcast_metrics()
+                    frame = json_frame(coalescer, event["items"], bool(data.get("return_tokens")), piece_table.piece)
+                    if frame:
+                        await websocket.send_json({"type": "tokens", **frame})
+            elif event["type"] == "token":
+                payload = with_token(data, event, {"type": "token", "content": event["text"]})
+                if event["text"] or "tokens" in payload:
+                    await websocket.send_json(payload)
+            elif event["type"] == "error":
+                broadcast_log(event["message"])
+                await websocket.send_json({"type": "error", "message": event["message"]})
+            else:
+                # 완료 신호 (토큰 수는 SSE 최종 청크와 같은 필드 이름)
+                await websocket.send_json(with_trace(event, {
+                    "type": "done",
+                    "stop": True,
+                    "tokens_predicted": event["tokens"],
+                    "tokens_evaluated": len(gen_request.prompt_tokens),
+                    "tokens_cached": event["cached_tokens"],
+                }))
             
     except WebSocketDisconnect:
         pass
     except Exception as e:
         print(f"[ERROR] Chat WebSocket error: {e}", flush=True)
-        processing = False
-        broadcast_metrics()
     finally:
         try:
             await websocket.close()
@@ -821,188 +825,117 @@ async def chat_websocket(websocket: WebSocket):
 @app.post("/completion")
 async def completion(request: Request):
     """Completion 요청 처리 (SSE 스트리밍, llama.cpp 호환)"""
-    global processing
-    
-    if not ready:
-        raise HTTPException(status_code=503, detail="Model is loading...")
-    
-    if processing:
-        raise HTTPException(status_code=503, detail="Server is busy")
+    ensure_ready()
     
     try:
+        parse_start = time.time()
         body = await request.json()
-        prompt = body.get("prompt", "")
+        trace = start_trace(body, request.headers, parse_start)
         stream = body.get("stream", True)
-        n_predict = body.get("n_predict", body.get("max_tokens", 512))
-        temperature = body.get("temperature", 0.7)
-        top_p = body.get("top_p", 0.95)
-        top_k = body.get("top_k", 40)  # MLX는 top_k를 직접 지원하지 않지만 무시
-        min_p = body.get("min_p", 0.0)
-        repeat_penalty = body.get("repeat_penalty", 1.1)
-        repeat_last_n = body.get("repeat_last_n", body.get("repetition_context_size", 64))
         stop = body.get("stop", [])
+        # top_k 는 MLX 샘플러가 직접 지원하지 않으므로 무시
         
-        if not prompt:
+        # 프롬프트를 그대로 사용 (이미 포맷팅되어 있을 수 있음)
+        prompt_tokens, prompt_info = traced_prepare_prompt(trace, body, chat_template=False)
+        if not prompt_tokens:
             raise HTTPException(status_code=400, detail="Prompt is required")
         
         if not stream:
             # 비스트리밍 응답 (구현 필요)
             raise HTTPException(status_code=501, detail="Non-streaming completion not implemented")
         
-        processing = True
-        broadcast_metrics()
-        
-        async def generate():
+        max_tokens, sampler, logits_processors = parse_generation_params(body)
+        stop_tokens = []
+        if stop:
             try:
-                # 프롬프트를 그대로 사용 (이미 포맷팅되어 있을 수 있음)
-                prompt_formatted = prompt
-                
-                # 프롬프트 토큰화
-                prompt_tokens = tokenizer.encode(prompt_formatted)
-                prompt_tokens_list = prompt_tokens.tolist() if hasattr(prompt_tokens, 'tolist') else list(prompt_tokens)
-                prompt_array = mx.array(prompt_tokens)
-                
-                # 샘플러 생성 (mlx_lm 0.29+ 버전용)
-                sampler = make_sampler(
-                    temp=temperature,
-                    top_p=top_p,
-                    min_p=min_p
-                )
-                
-                # Repetition penalty를 logits processor로 생성
-                logits_processors = []
-                if repeat_penalty != 1.0:
-                    logits_processors.append(make_repetition_penalty(penalty=repeat_penalty, context_size=repeat_last_n))
-                
-                # generate_step으로 토큰 단위 생성
-                global tokens_generated, tokens_generated_total, generation_start_time, last_token_time
-                token_count = 0
-                generation_start_time = time.time()
-                tokens_generated = 0
-                eos_token_id = getattr(tokenizer, 'eos_token_id', None)
-                stop_tokens = []
-                if stop:
-                    try:
-                        stop_tokens = [tokenizer.encode(s)[0] for s in stop if s]
-                    except:
-                        pass
-                
-                step_generator = generate_step(
-                    prompt_array,
-                    model,
-                    sampler=sampler,
-                    logits_processors=logits_processors if logits_processors else None,
-                    max_tokens=n_predict if n_predict > 0 else 256
-                )
-                
-                # 토큰 단위로 생성 및 SSE 스트리밍
-                while token_count < n_predict or n_predict < 0:
-                    try:
-                        token_array, logits = next(step_generator)
-                    except StopIteration:
-                        break
-                    
-                    # 토큰 ID 추출
-                    if isinstance(token_array, mx.array):
-                        token_id = int(token_array.item())
-                    elif isinstance(token_array, (int, float)):
-                        token_id = int(token_array)
-                    else:
-                        try:
-                            token_id = int(token_array)
-                        except:
-                            if hasattr(token_array, 'item'):
-                                token_id = int(token_array.item())
-                            else:
-                                token_id = int(token_array)
-                    
-                    # Stop 토큰 체크
-                    if stop_tokens and token_id in stop_tokens:
-                        yield f"data: {json.dumps({'stop': True, 'stop_reason': 'stop'})}\n\n"
-                        break
-                    
-                    # EOS 토큰 체크
-                    if eos_token_id is not None and token_id == eos_token_id:
-                        yield f"data: {json.dumps({'stop': True, 'stop_reason': 'eos'})}\n\n"
-                        break
-                    
-                    # 개별 토큰 디코딩 (누적 방식 제거)
-                    try:
-                        # 현재 토큰만 디코딩
-                        token_text = tokenizer.decode([token_id], skip_special_tokens=True)
-                        
-                        # 스페셜 토큰 패턴 제거
-                        token_text = re.sub(r'<\|[^>]*\|>', '', token_text)
-                        
-                        # UTF-8 인코딩 보장
-                        if isinstance(token_text, bytes):
-                            token_text = token_text.decode('utf-8', errors='ignore')
-                        
-                        # 깨진 문자 제거 (replacement character 및 기타 제어 문자)
-                        token_text = token_text.replace('\ufffd', '')  # replacement character
-                        token_text = ''.join(char for char in token_text if char.isprintable() or char.isspace() or ord(char) >= 0x10000)
-                        
-                    except Exception as e:
-                        # 디코딩 실패 시 빈 문자열 사용
-                        token_text = ""
-                    
-                    # llama.cpp 형식으로 SSE 전송 (ensure_ascii=False로 한글 등 유니코드 문자 보존)
-                    if token_text:  # 빈 문자열이 아닐 때만 전송
-                        data = json.dumps({"content": token_text}, ensure_ascii=False)
-                        yield f"data: {data}\n\n"
-                    
-                    token_count += 1
-                    tokens_generated += 1
-                    tokens_generated_total += 1
-                    last_token_time = time.time()
-                    # 최근 토큰 생성 시간 기록
-                    recent_token_times.append(last_token_time)
-                    # 2초 이전의 기록은 제거 (메모리 절약)
-                    current_time = time.time()
-                    recent_token_times = [t for t in recent_token_times if current_time - t <= 2.0]
-                    
-                    # 메트릭 업데이트 (5토큰마다)
-                    if token_count % 5 == 0:
-                        broadcast_metrics()
-                    
-                    # 토큰 생성 로그 (제거됨)
-                    # if token_count % 10 == 0:
-                    #     broadcast_log(f"Generated {token_count} tokens...")
-                
-                # 완료 신호
-                yield f"data: {json.dumps({'stop': True})}\n\n"
-                broadcast_log(f"Generation completed: {token_count} tokens")
-                
-            except Exception as e:
-                import traceback
-                error_msg = f"Generation failed: {str(e)}"
-                broadcast_log(error_msg)
-                broadcast_log(traceback.format_exc())
-                yield f"data: {json.dumps({'error': error_msg})}\n\n"
-            finally:
-                global processing
-                processing = False
-                broadcast_metrics()
+                stop_tokens = [tokenizer.encode(s)[0] for s in stop if s]
+            except:
+                pass
         
-        return StreamingResponse(
-            generate(),
-            media_type="text/event-stream",
-            headers={
-                "Cache-Control": "no-cache",
-                "Connection": "keep-alive",
-            }
+        gen_request = GenerationRequest(
+            prompt_tokens, max_tokens, sampler, logits_processors,
+            stop_token_ids=stop_tokens, ignore_eos=bool(body.get("ignore_eos", False))
         )
-        
+        gen_request.trace = trace
+        stream_format = StreamFormat.parse(body, binary_allowed=False)
+    except ContextOverflow as e:
+        return context_error(e)
+    except HTTPException:
+        raise
     except Exception as e:
-        processing = False
-        broadcast_metrics()
         raise HTTPException(status_code=500, detail=str(e))
+    
+    first_event = prompt_event(body, prompt_tokens, prompt_info)
+    
+    async def generate():
+        try:
+            if first_event:
+                yield f"data: {json.dumps(first_event, ensure_ascii=False)}\n\n"
+            coalescer = stream_coalescer(stream_format, gen_request)
+            async for event in stream_generation(gen_request, coalescer):
+                if event["type"] == "frame":
+                    frame = sse_frame(body, coalescer, event["items"])
+                    if frame:
+                        yield frame
+                elif event["type"] == "token":
+                    # llama.cpp 형식으로 SSE 전송 (ensure_ascii=False로 한글 등 유니코드 문자 보존)
+                    payload = with_token(body, event, {"content": event["text"]})
+                    if event["text"] or "tokens" in payload:
+                        data = json.dumps(payload, ensure_ascii=False)
+                        yield f"data: {data}\n\n"
+                elif event["type"] == "error":
+                    broadcast_log(event["message"])
+                    yield f"data: {json.dumps({'error': event['message']})}\n\n"
+                else:
+                    if event["finish_reason"] in ("stop", "eos"):
+                        # 클라이언트는 보통 첫 stop 에서 읽기를 멈추므로 trace 합계도 여기에 실음
+                        early = with_trace(event, {'stop': True, 'stop_reason': event['finish_reason']})
+                        yield f"data: {json.dumps(early)}\n\n"
+                    # 완료 신호 (토큰 수는 llama.cpp 의 최종 청크와 같은 필드 이름)
+                    final = {
+                        "stop": True,
+                        "tokens_predicted": event["tokens"],
+                        "tokens_evaluated": len(gen_request.prompt_tokens),
+                        "tokens_cached": event["cached_tokens"],
+                        "draft_n": event.get("draft_tokens", 0),
+                        "draft_n_accepted": event.get("draft_accepted", 0),
+                    }
+                    yield f"data: {json.dumps(with_trace(event, final))}\n\n"
+        except Exception as e:
+            error_msg = f"Generation failed: {str(e)}"
+            broadcast_log(error_msg)
+            yield f"data: {json.dumps({'error': error_msg})}\n\n"
+    
+    return StreamingResponse(generate(), media_type="text/event-stream", headers=sse_headers(stream_format))
+
+@app.post("/memory-pressure")
+async def memory_pressure(request: Request):
+    """통합 메모리 압력 단계 전달 (manager 의 memory-pressure.js)
+
+    warn: 새로 받는 동시 요청을 절반으로, prefix 캐시 예산을 절반으로
+    critical: 한 번에 한 요청만, pinned 가 아닌 prefix 캐시를 모두 비움
+    """
+    body = await request.json()
+    level = body.get("level", "normal")
+    if scheduler is None:
+        raise HTTPException(status_code=503, detail="Model is loading...")
+    try:
+        scheduler.set_memory_pressure(level)
+    except ValueError as e:
+        raise HTTPException(status_code=400, detail=str(e))
+    return {"level": level, "admitLimit": scheduler.admit_limit, "maxBatchSize": scheduler.max_batch_size}
 
 # Tokenize endpoint
 @app.post("/tokenize")
 async def tokenize(request: Request):
-    """토큰화 요청 처리"""
+    """토큰화 요청 처리
+
+    cursor: 이전 응답의 cursor 를 보내면 그때와 같은 앞부분 토큰은 생략하고
+    달라지는 위치(start)부터만 돌려줍니다 (count 는 전체 토큰 수).
+    """
+    parse_start = time.time()
     body = await request.json()
+    trace = start_trace(body, request.headers, parse_start)
     content = body.get("content", "")
     with_pieces = body.get("with_pieces", False)
     add_special = body.get("add_special", True)
@@ -1015,84 +948,38 @@ async def tokenize(request: Request):
         raise HTTPException(status_code=503, detail="Model is loading...")
     
     try:
-        # 토큰화 (스페셜 토큰 포함)
-        # mlx_lm tokenizer는 add_special_tokens 파라미터를 지원하지 않을 수 있으므로
-        # 직접 encode를 호출하고, 필요시 스페셜 토큰을 수동으로 추가
-        try:
-            tokens = tokenizer.encode(content, add_special_tokens=add_special)
-        except TypeError:
-            # add_special_tokens 파라미터를 지원하지 않는 경우
-            tokens = tokenizer.encode(content)
-        
-        token_list = tokens.tolist() if hasattr(tokens, 'tolist') else list(tokens)
+        # 스페셜 토큰 경계 단위로 캐시된 토큰화 (이전 요청에서 본 구간은 다시 토큰화하지 않음)
+        encode_start = time.time()
+        token_list = segment_tokenizer.encode(content, add_special=add_special, parse_special=parse_special)
+        if trace:
+            trace.add("tokenize", encode_start, time.time(), cat="mlx", tokens=len(token_list), chars=len(content))
+        start = tokenize_cursors.resume(body.get("cursor"), token_list)
+        cursor = tokenize_cursors.store(token_list)
+        delta = token_list[start:]
         
         if with_pieces:
-            # 각 토큰의 piece(텍스트) 정보 포함
-            token_data = []
-            # 전체 시퀀스를 먼저 디코딩하여 올바른 UTF-8 처리를 보장
-            try:
-                full_decoded = tokenizer.decode(token_list, skip_special_tokens=False)
-            except Exception:
-                full_decoded = ""
-            
-            # 각 토큰을 개별적으로 디코딩 시도
-            for idx, token_id in enumerate(token_list):
-                try:
-                    # 개별 토큰 디코딩 (스페셜 토큰 포함)
-                    piece = tokenizer.decode([token_id], skip_special_tokens=False)
-                    
-                    # UTF-8 인코딩 보장 (재인코딩 제거 - 이미 올바른 UTF-8 문자열)
-                    if isinstance(piece, bytes):
-                        piece = piece.decode('utf-8', errors='replace')
-                    # str 타입이면 그대로 사용 (불필요한 재인코딩 제거)
-                    
-                    token_data.append({
-                        "id": token_id,
-                        "piece": piece
-                    })
-                except Exception as e:
-                    # 개별 토큰 디코딩 실패 시, 전체 시퀀스에서 해당 위치 추출 시도
-                    try:
-                        # 이전 토큰까지 디코딩
-                        prev_tokens = token_list[:idx]
-                        # 현재 토큰 포함 디코딩
-                        curr_tokens = token_list[:idx+1]
-                        if prev_tokens:
-                            prev_text = tokenizer.decode(prev_tokens, skip_special_tokens=False)
-                            curr_text = tokenizer.decode(curr_tokens, skip_special_tokens=False)
-                            piece = curr_text[len(prev_text):]
-                        else:
-                            piece = tokenizer.decode([token_id], skip_special_tokens=False)
-                        
-                        # UTF-8 인코딩 보장
-                        if isinstance(piece, bytes):
-                            piece = piece.decode('utf-8', errors='replace')
-                        elif isinstance(piece, str):
-                            piece = piece.encode('utf-8', errors='replace').decode('utf-8', errors='replace')
-                        
-                        token_data.append({
-                            "id": token_id,
-                            "piece": piece
-                        })
-                    except Exception:
-                        # 모든 디코딩 실패 시 토큰 ID만 포함
-                        token_data.append({
-                            "id": token_id,
-                            "piece": f"<token_{token_id}>"
-                        })
-            
-            return {
-                "tokens": token_data,
-                "count": len(token_list)
-            }
+            # 각 토큰의 piece(텍스트) 정보 포함 (ID 별로 한 번만 디코딩)
+            token_data = [{"id": token_id, "piece": piece_table.piece(token_id)} for token_id in delta]
         else:
-            return {
-                "tokens": token_list,
-                "count": len(token_list)
-            }
+            token_data = delta
+        result = {
+            "tokens": token_data,
+            "count": len(token_list),
+            "start": start,
+            "cursor": cursor,
+        }
+        return with_trace({"trace": trace.summary() if trace else None}, result)
     except Exception as e:
         raise HTTPException(status_code=500, detail=str(e))
 
+@app.get("/trace/{trace_id}")
+async def get_trace(trace_id: str):
+    """trace_id 요청의 구간 목록 (관리자의 /api/traces/{id} 가 Chrome trace 로 합침)"""
+    trace = trace_store.get(trace_id)
+    if trace is None:
+        raise HTTPException(status_code=404, detail="Trace not found")
+    return trace.to_dict()
+
 if __name__ == "__main__":
     broadcast_log(f"Starting MLX Python HTTP server on port {PORT}...")
     uvicorn.run(
@@ -0,0 +1,140 @@
+"""
+토큰 스트림 프레이밍 (요청의 stream_format 으로 협상)
+
+기본은 토큰마다 이벤트 하나 (이전과 같음). 요청에 stream_format 이 있으면
+토큰을 모아 interval_ms 마다 또는 max_tokens 개가 모이면 프레임 하나로 보냅니다.
+첫 토큰은 TTFT 가 늘지 않도록 바로 보냅니다.
+
+  "stream_format": "coalesced" | "binary" | {"mode": ..., "interval_ms": 50, "max_tokens": 32}
+
+- coalesced (SSE / WebSocket): {"content": 합친 텍스트, "n": 토큰 수, "times": [토큰별 ms, ...]}
+  (+ return_tokens 이면 "tokens" / "pieces"). times 는 요청 제출 시각 기준으로 토큰이 생성된 시각이라
+  프레임이 늦게 도착해도 클라이언트가 토큰 간 간격(ITL)을 복원할 수 있습니다.
+- binary (WebSocket 만, SSE 는 coalesced 로 대체): 리틀 엔디언
+    u8 version | u8 flags | u16 n | u32 text_bytes
+    | u32 token_id × n (flags & HAS_TOKEN_IDS, 디코더 flush 로 남은 텍스트는 NO_TOKEN)
+    | u32 time_us × n | u16 text_bytes × n | UTF-8 텍스트
+  토큰별 텍스트는 전체 텍스트를 앞의 길이로 잘라 얻습니다.
+"""
+import struct
+from typing import List, Optional, Tuple
+
+MODES = ("token", "coalesced", "binary")
+DEFAULT_INTERVAL_MS = 50
+DEFAULT_MAX_TOKENS = 32
+MAX_INTERVAL_MS = 1000
+MAX_FRAME_TOKENS = 1024
+
+BINARY_VERSION = 1
+HAS_TOKEN_IDS = 0x01
+NO_TOKEN = 0xFFFFFFFF
+_HEADER = struct.Struct("<BBHI")
+
+
+class StreamFormat:
+    """협상된 스트림 형식 (mode 가 token 이면 프레이밍 없음)"""
+
+    def __init__(self, mode: str = "token", interval_ms: int = DEFAULT_INTERVAL_MS,
+                 max_tokens: int = DEFAULT_MAX_TOKENS):
+        self.mode = mode
+        self.interval_ms = interval_ms
+        self.max_tokens = max_tokens
+
+    @classmethod
+    def parse(cls, body: dict, binary_allowed: bool) -> "StreamFormat":
+        """요청 본문의 stream_format → StreamFormat (알 수 없는 값은 token, SSE 의 binary 는 coalesced)"""
+        spec = body.get("stream_format")
+        if isinstance(spec, str):
+            spec = {"mode": spec}
+        if not isinstance(spec, dict):
+            return cls()
+        mode = spec.get("mode", "coalesced")
+        if mode not in MODES:
+            return cls()
+        if mode == "binary" and not binary_allowed:
+            mode = "coalesced"
+        try:
+            interval_ms = int(spec.get("interval_ms", DEFAULT_INTERVAL_MS))
+            max_tokens = int(spec.get("max_tokens", DEFAULT_MAX_TOKENS))
+        except (TypeError, ValueError):
+            interval_ms, max_tokens = DEFAULT_INTERVAL_MS, DEFAULT_MAX_TOKENS
+        return cls(mode, min(max(interval_ms, 1), MAX_INTERVAL_MS), min(max(max_tokens, 1), MAX_FRAME_TOKENS))
+
+    @property
+    def framed(self) -> bool:
+        return self.mode != "token"
+
+    def describe(self) -> dict:
+        """클라이언트에 알려주는 협상 결과 (WebSocket 첫 메시지 / SSE 의 X-Stream-Format 헤더)"""
+        return {"mode": self.mode, "interval_ms": self.interval_ms, "max_tokens": self.max_tokens}
+
+    def header(self) -> str:
+        return f"{self.mode}; interval_ms={self.interval_ms}; max_tokens={self.max_tokens}"
+
+
+class TokenCoalescer:
+    """토큰 이벤트를 모아 프레임 단위로 내보냄 (이벤트 루프에서만 사용)
+
+    add() 가 True 를 돌려주거나 timeout() 초가 지나면 take() 로 모인 토큰을 가져갑니다.
+    """
+
+    def __init__(self, stream_format: StreamFormat, started_at: float):
+        self.format = stream_format
+        self.started_at = started_at
+        self.items: List[Tuple[Optional[int], str, float]] = []  # (token_id, text, 생성 시각)
+        self.first_at: Optional[float] = None  # 버퍼의 첫 토큰이 생성된 시각
+        self.sent_first = False
+        self.frames = 0
+
+    def add(self, event: dict) -> bool:
+        at = event.get("at") or self.started_at
+        if not self.items:
+            self.first_at = at
+        self.items.append((event["token"], event["text"], at))
+        if not self.sent_first:
+            return True
+        return len(self.items) >= self.format.max_tokens
+
+    def timeout(self, now: float) -> Optional[float]:
+        """다음 flush 까지 남은 초 (모인 토큰이 없으면 None = 무한 대기)"""
+        if not self.items:
+            return None
+        return max(0.0, self.first_at + self.format.interval_ms / 1000 - now)
+
+    def take(self) -> List[Tuple[Optional[int], str, float]]:
+        items, self.items = self.items, []
+        self.first_at = None
+        self.sent_first = True
+        self.frames += 1
+        return items
+
+    def times_ms(self, items) -> List[float]:
+        """토큰 ID 가 있는 항목의 생성 시각 (요청 제출 기준 ms)"""
+        return [round((at - self.started_at) * 1000, 2) for token, _, at in items if token is not None]
+
+
+def json_frame(coalescer: TokenCoalescer, items, return_tokens: bool, piece_of) -> Optional[dict]:
+    """coalesced 프레임 (보낼 텍스트도 토큰 ID 도 없으면 None)"""
+    content = "".join(text for _, text, _ in items)
+    ids = [token for token, _, _ in items if token is not None]
+    if not content and not (return_tokens and ids):
+        return None
+    frame = {"content": content, "n": len(ids), "times": coalescer.times_ms(items)}
+    if return_tokens and ids:
+        frame["tokens"] = ids
+        frame["pieces"] = [piece_of(token) for token in ids]
+    return frame
+
+
+def binary_frame(coalescer: TokenCoalescer, items) -> bytes:
+    """binary 프레임 (형식은 모듈 설명, 토큰 ID 는 항상 포함)"""
+    texts = [text.encode("utf-8") for _, text, _ in items]
+    text = b"".join(texts)
+    n = len(items)
+    return b"".join([
+        _HEADER.pack(BINARY_VERSION, HAS_TOKEN_IDS, n, len(text)),
+        struct.pack(f"<{n}I", *(NO_TOKEN if token is None else token for token, _, _ in items)),
+        struct.pack(f"<{n}I", *(max(0, round((at - coalescer.started_at) * 1e6)) & 0xFFFFFFFF for _, _, at in items)),
+        struct.pack(f"<{n}H", *(min(len(t), 0xFFFF) for t in texts)),
+        text,
+    ])
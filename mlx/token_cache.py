@@ -0,0 +1,136 @@
+"""
+토큰화 / 토큰 piece 캐시 (TokenDebugPanel 과 /tokenize 용)
+
+- PieceTable: 토큰 ID → piece 문자열. 어휘는 고정이므로 한 번 디코딩한 ID 는 다시 디코딩하지 않습니다.
+  생성 스트림에 토큰 ID 와 piece 를 함께 실어 보낼 때도 같은 테이블을 씁니다.
+- SegmentTokenizer: 프롬프트를 스페셜 토큰 경계에서 나눠 구간별 토큰화 결과를 LRU 로 캐시합니다.
+  긴 대화에서 이전 턴은 캐시 히트이므로 새로 추가된 구간만 토큰화합니다.
+- TokenizeCursors: /tokenize 응답의 cursor(해시) → 토큰 ID 목록. 다음 요청이 cursor 를 보내면
+  앞부분이 같은 토큰은 생략하고 달라지는 위치(start)부터만 돌려줍니다.
+"""
+import hashlib
+import re
+from collections import OrderedDict
+from typing import Dict, List, Optional, Tuple
+
+SEGMENT_CACHE_MAX_ENTRIES = 4096
+CURSOR_MAX_ENTRIES = 64
+
+
+def _to_list(tokens) -> List[int]:
+    return tokens.tolist() if hasattr(tokens, 'tolist') else list(tokens)
+
+
+class PieceTable:
+    """토큰 ID → piece (스페셜 토큰 포함, 불완전한 UTF-8 바이트는 U+FFFD)"""
+
+    def __init__(self, tokenizer):
+        self.tokenizer = tokenizer
+        self._pieces: Dict[int, str] = {}
+
+    def piece(self, token_id: int) -> str:
+        piece = self._pieces.get(token_id)
+        if piece is None:
+            try:
+                piece = self.tokenizer.decode([token_id], skip_special_tokens=False)
+                if isinstance(piece, bytes):
+                    piece = piece.decode('utf-8', errors='replace')
+            except Exception:
+                piece = f"<token_{token_id}>"
+            self._pieces[token_id] = piece
+        return piece
+
+    def pieces(self, token_ids: List[int]) -> List[str]:
+        return [self.piece(token_id) for token_id in token_ids]
+
+
+class SegmentTokenizer:
+    """스페셜 토큰 경계 단위로 캐시하는 토큰화
+
+    HF 토크나이저는 추가(스페셜) 토큰을 pre-tokenize 전에 먼저 분리하므로,
+    경계에서 나눈 구간을 따로 토큰화해 이어 붙이면 전체 토큰화와 같습니다.
+    """
+
+    def __init__(self, tokenizer, max_entries: int = SEGMENT_CACHE_MAX_ENTRIES):
+        self.tokenizer = tokenizer
+        self.max_entries = max_entries
+        self._segments: "OrderedDict[str, Tuple[int, ...]]" = OrderedDict()
+        hf = getattr(tokenizer, "_tokenizer", tokenizer)
+        special = {}
+        for token_id, added in (getattr(hf, "added_tokens_decoder", None) or {}).items():
+            content = getattr(added, "content", None)
+            if content:
+                special[content] = token_id
+        self._special = special
+        self._pattern = re.compile(
+            "(" + "|".join(re.escape(s) for s in sorted(special, key=len, reverse=True)) + ")"
+        ) if special else None
+        self._prefix = self._encode("", True)  # add_special 시 앞에 붙는 토큰 (BOS 등)
+        self.hits = 0
+        self.misses = 0
+
+    def _encode(self, text: str, add_special: bool) -> List[int]:
+        try:
+            return _to_list(self.tokenizer.encode(text, add_special_tokens=add_special))
+        except TypeError:
+            return _to_list(self.tokenizer.encode(text))
+
+    def _segment(self, text: str) -> Tuple[int, ...]:
+        cached = self._segments.get(text)
+        if cached is not None:
+            self._segments.move_to_end(text)
+            self.hits += 1
+            return cached
+        self.misses += 1
+        tokens = tuple(self._encode(text, False))
+        self._segments[text] = tokens
+        if len(self._segments) > self.max_entries:
+            self._segments.popitem(last=False)
+        return tokens
+
+    def encode(self, content: str, add_special: bool = True, parse_special: bool = True) -> List[int]:
+        if not parse_special or self._pattern is None:
+            return self._encode(content, add_special)
+        tokens = list(self._prefix) if add_special else []
+        for part in self._pattern.split(content):
+            if not part:
+                continue
+            special_id = self._special.get(part)
+            if special_id is not None:
+                tokens.append(special_id)
+            else:
+                tokens.extend(self._segment(part))
+        return tokens
+
+
+class TokenizeCursors:
+    """/tokenize cursor → 그때 돌려준 토큰 ID 목록 (LRU)"""
+
+    def __init__(self, max_entries: int = CURSOR_MAX_ENTRIES):
+        self.max_entries = max_entries
+        self._entries: "OrderedDict[str, List[int]]" = OrderedDict()
+
+    def resume(self, cursor: Optional[str], tokens: List[int]) -> int:
+        """cursor 시점의 토큰과 공통인 앞부분 길이 (모르는 cursor 면 0)"""
+        previous = self._entries.get(cursor) if cursor else None
+        if previous is None:
+            return 0
+        n = min(len(previous), len(tokens))
+        start = 0
+        while start < n and previous[start] == tokens[start]:
+            start += 1
+        return start
+
+    def store(self, tokens: List[int]) -> str:
+        digest = hashlib.sha1()
+        for token_id in tokens:
+            digest.update(token_id.to_bytes(4, "little", signed=True))
+        cursor = digest.hexdigest()[:16]
+        self._entries[cursor] = tokens
+        self._entries.move_to_end(cursor)
+        if len(self._entries) > self.max_entries:
+            self._entries.popitem(last=False)
+        return cursor
+
+    def clear(self):
+        self._entries.clear()
@@ -0,0 +1,169 @@
+// 모델 파일 페이지 캐시 프리웜 (native prewarmFiles / getResidentBytes)
+//
+// - 로드 시: llama-server 를 띄우는 동시에 여러 스레드로 GGUF(분할 shard, draft 포함)를 미리 읽어
+//   llama-server 의 단일 스레드 순차 읽기가 페이지 캐시 히트가 되도록 합니다.
+// - 유휴 시: 요청이 idleMs 동안 없으면 다음에 쓰일 가능성이 가장 높은 모델 하나를 미리 읽어 둡니다
+//   (listCandidates 순서, 이미 상주 중이거나 메모리 여유보다 큰 모델은 건너뜀).
+//   요청이 들어오면 유휴 프리웜은 즉시 멈춥니다.
+// 진행률은 mincore 로 센 실제 상주 바이트입니다 (stats() / /api/model-pool 의 prewarm).
+const os = require('os');
+const fs = require('fs');
+const path = require('path');
+const { resolveModelFile } = require('./gguf-planner');
+const speculative = require('./speculative');
+
+let nativeAddon = null;
+try {
+  nativeAddon = require('./native');
+} catch (error) {
+  // 빌드되지 않은 환경: 프리웜 없이 콜드 로드
+}
+
+const DEFAULT_IDLE_MS = Number(process.env.PREWARM_IDLE_MS || 30000);
+const CHECK_INTERVAL_MS = 5000;
+const WARM_RATIO = 0.95; // 이 비율 이상 상주하면 이미 따뜻한 것으로 봄
+const HEADROOM_BYTES = 4 * 1024 * 1024 * 1024; // 유휴 프리웜이 남겨 둘 메모리
+const SHARD_PATTERN = /-(\d{5})-of-(\d{5})\.gguf$/;
+
+// 분할 GGUF (name-00001-of-00003.gguf) 는 모든 shard
+function ggufShards(file) {
+  const match = SHARD_PATTERN.exec(file);
+  if (!match) return [file];
+  const count = Number(match[2]);
+  const prefix = file.slice(0, match.index);
+  const shards = [];
+  for (let i = 1; i <= count; i++) {
+    const shard = `${prefix}-${String(i).padStart(5, '0')}-of-${match[2]}.gguf`;
+    if (fs.existsSync(shard)) shards.push(shard);
+  }
+  return shards;
+}
+
+// 모델이 읽을 파일 목록 (GGUF: 모델 + draft, MLX: 디렉터리의 *.safetensors)
+function modelFiles(modelConfig) {
+  if (!modelConfig || !modelConfig.modelPath) return [];
+  if (modelConfig.modelFormat === 'mlx') {
+    const dir = path.isAbsolute(modelConfig.modelPath)
+      ? modelConfig.modelPath
+      : path.join(__dirname, 'mlx', 'models', modelConfig.modelPath);
+    try {
+      return fs.readdirSync(dir).filter(name => name.endsWith('.safetensors')).sort().map(name => path.join(dir, name));
+    } catch (error) {
+      return [];
+    }
+  }
+  const file = resolveModelFile(modelConfig.modelPath);
+  if (!file) return [];
+  const files = ggufShards(file);
+  const draft = speculative.draftSettings(modelConfig);
+  const draftFile = draft ? resolveModelFile(draft.modelPath, path.dirname(file)) : null;
+  if (draftFile) files.push(draftFile);
+  return files;
+}
+
+class ModelPrewarmer {
+  // listCandidates: () => [modelConfig] (가능성 높은 순), isIdle: () => boolean (로컬 요청/로딩 없음)
+  // reservedBytes: () => 상주 중인 모델이 쓰는 메모리
+  constructor({ listCandidates = () => [], isIdle = () => true, reservedBytes = () => 0, idleMs = DEFAULT_IDLE_MS, log = console.log }) {
+    this.listCandidates = listCandidates;
+    this.isIdle = isIdle;
+    this.reservedBytes = reservedBytes;
+    this.idleMs = idleMs;
+    this.log = log;
+    this.lastActivity = Date.now();
+    this.current = null; // { id, reason, startedAt, totalBytes, residentBytes, readBytes }
+    this.last = null;
+    this.timer = null;
+  }
+
+  available() {
+    return Boolean(nativeAddon && nativeAddon.prewarmFiles);
+  }
+
+  // { totalBytes, residentBytes } (mincore, 네이티브가 없으면 null)
+  residency(modelConfig) {
+    if (!this.available()) return null;
+    const files = modelFiles(modelConfig);
+    if (files.length === 0) return null;
+    return nativeAddon.getResidentBytes(files);
+  }
+
+  // 요청이 들어옴: 유휴 타이머 리셋, 유휴 프리웜은 멈춤 (로드용 프리웜은 계속)
+  noteActivity() {
+    this.lastActivity = Date.now();
+    this.cancelIdle();
+  }
+
+  cancelIdle() {
+    if (this.current && this.current.reason === 'idle') nativeAddon.cancelPrewarm();
+  }
+
+  async prewarm(modelConfig, reason = 'load') {
+    if (!this.available()) return null;
+    const files = modelFiles(modelConfig);
+    if (files.length === 0) return null;
+    // 로드용 프리웜이 우선 (유휴 프리웜이 돌고 있으면 멈추고 시작)
+    if (this.current) {
+      if (reason !== 'load' || this.current.reason === 'load') return null;
+      nativeAddon.cancelPrewarm();
+      await this.currentPromise;
+    }
+    const current = { id: modelConfig.id, reason, startedAt: Date.now(), totalBytes: 0, residentBytes: 0, readBytes: 0 };
+    this.current = current;
+    this.currentPromise = nativeAddon.prewarmFiles(files, {}, (progress) => Object.assign(current, progress));
+    try {
+      const result = await this.currentPromise;
+      if (result && result.ok) {
+        Object.assign(current, { totalBytes: result.totalBytes, residentBytes: result.residentBytes, readBytes: result.readBytes });
+        this.log(`[Prewarm] ${modelConfig.id} (${reason}): ${formatMb(result.readBytes)} read, ` +
+          `${formatMb(result.residentBytes)} / ${formatMb(result.totalBytes)} resident in ${(result.elapsedMs / 1000).toFixed(1)}s` +
+          (result.cancelled ? ' (cancelled)' : ''));
+      } else if (result) {
+        this.log(`[Prewarm] ${modelConfig.id} failed: ${result.error}`);
+      }
+      this.last = { ...current, finishedAt: Date.now(), cancelled: Boolean(result && result.cancelled) };
+      return result;
+    } finally {
+      this.current = null;
+      this.currentPromise = null;
+    }
+  }
+
+  // 유휴 상태면 후보 중 가장 앞의, 아직 차갑고 메모리에 들어가는 모델 하나를 프리웜
+  checkIdle() {
+    if (!this.available() || this.current) return;
+    if (Date.now() - this.lastActivity < this.idleMs || !this.isIdle()) return;
+    const budget = Number(process.env.PREWARM_MAX_MB || 0) * 1024 * 1024 ||
+      os.totalmem() - this.reservedBytes() - HEADROOM_BYTES;
+    for (const modelConfig of this.listCandidates()) {
+      const residency = this.residency(modelConfig);
+      if (!residency || residency.totalBytes === 0) continue;
+      if (residency.residentBytes >= residency.totalBytes * WARM_RATIO) return; // 가장 유력한 모델이 이미 따뜻함
+      if (residency.totalBytes > budget) continue;
+      this.prewarm(modelConfig, 'idle').catch((error) => this.log(`[Prewarm] ${modelConfig.id} failed: ${error.message}`));
+      return;
+    }
+  }
+
+  start() {
+    if (this.timer || !this.available()) return;
+    this.timer = setInterval(() => this.checkIdle(), CHECK_INTERVAL_MS);
+    this.timer.unref();
+  }
+
+  stop() {
+    if (this.timer) clearInterval(this.timer);
+    this.timer = null;
+    if (this.current) nativeAddon.cancelPrewarm();
+  }
+
+  stats() {
+    return { available: this.available(), idleMs: this.idleMs, current: this.current, last: this.last };
+  }
+}
+
+function formatMb(bytes) {
+  return `${(bytes / 1024 / 1024).toFixed(0)} MB`;
+}
+
+module.exports = { ModelPrewarmer, modelFiles };
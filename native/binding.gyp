@@ -3,7 +3,20 @@
     {
       "target_name": "metal_vram",
       "sources": [
-        "src/metal_vram.mm"
+        "src/metal_vram.mm",
+        "src/metal_device.mm",
+        "src/vram_sampler.mm",
+        "src/vram_sampler_addon.cc",
+        "src/system_counters.cc",
+        "src/system_counters_addon.cc",
+        "src/cpu_topology.cc",
+        "src/cpu_topology_addon.cc",
+        "src/page_cache.cc",
+        "src/page_cache_addon.cc",
+        "src/memory_pressure.cc",
+        "src/memory_pressure_addon.cc",
+        "src/gguf_reader.cc",
+        "src/gguf_addon.cc"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")"
@@ -11,7 +24,9 @@
       "link_settings": {
         "libraries": [
           "-framework Metal",
-          "-framework Foundation"
+          "-framework Foundation",
+          "-framework IOKit",
+          "-framework CoreFoundation"
         ]
       },
       "cflags!": [ "-fno-exceptions" ],
@@ -22,6 +37,43 @@
         "MACOSX_DEPLOYMENT_TARGET": "10.13"
       },
       "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS" ]
+    },
+    {
+      "target_name": "llm_metrics",
+      "type": "shared_library",
+      "sources": [
+        "src/llm_metrics.cc",
+        "src/metal_device.mm",
+        "src/system_counters.cc",
+        "src/cpu_topology.cc",
+        "src/page_cache.cc"
+      ],
+      "link_settings": {
+        "libraries": [
+          "-framework Metal",
+          "-framework Foundation",
+          "-framework IOKit",
+          "-framework CoreFoundation"
+        ]
+      },
+      "xcode_settings": {
+        "CLANG_CXX_LIBRARY": "libc++",
+        "MACOSX_DEPLOYMENT_TARGET": "10.13",
+        "LD_DYLIB_INSTALL_NAME": "@rpath/libllm_metrics.dylib"
+      }
+    },
+    {
+      "target_name": "llm_detok",
+      "type": "shared_library",
+      "sources": [
+        "src/llm_detok.cc",
+        "src/detokenizer.cc"
+      ],
+      "xcode_settings": {
+        "CLANG_CXX_LIBRARY": "libc++",
+        "MACOSX_DEPLOYMENT_TARGET": "10.13",
+        "LD_DYLIB_INSTALL_NAME": "@rpath/libllm_detok.dylib"
+      }
     }
   ]
 }
@@ -1,12 +1,146 @@
-const { getVRAMInfo } = require('./build/Release/metal_vram.node');
+const native = require('./build/Release/metal_vram.node');
 
 module.exports = {
   getVRAMInfo: () => {
     try {
-      return getVRAMInfo();
+      return native.getVRAMInfo();
     } catch (error) {
       console.error('[Metal VRAM] Error:', error);
       return { error: error.message, total: 0, used: 0 };
     }
+  },
+
+  // 백그라운드 VRAM/GPU 샘플러 (링 버퍼에 intervalMs 주기로 기록)
+  startVRAMSampler: (intervalMs) => {
+    try {
+      return native.startVRAMSampler(intervalMs);
+    } catch (error) {
+      console.error('[Metal VRAM] Sampler error:', error);
+      return { running: false, error: error.message };
+    }
+  },
+
+  stopVRAMSampler: () => {
+    try {
+      native.stopVRAMSampler();
+    } catch (error) {
+      console.error('[Metal VRAM] Sampler error:', error);
+    }
+  },
+
+  // sinceTs(ms) 이후의 샘플 배열: [{ ts, total, used, gpuUtil }]
+  getVRAMSamples: (sinceTs = 0) => {
+    try {
+      return native.getVRAMSamples(sinceTs);
+    } catch (error) {
+      console.error('[Metal VRAM] Sampler error:', error);
+      return [];
+    }
+  },
+
+  // 호스트/프로세스 CPU, IOAccelerator GPU 사용률, 통합 메모리 압력
+  // consumer: CPU 사용률 기준값 이름 (호출 주기가 다른 곳마다 다르게 — 같으면 서로의 측정 구간을 줄임)
+  getSystemCounters: (pids = [], consumer = 'default') => {
+    try {
+      return native.getSystemCounters(pids, consumer);
+    } catch (error) {
+      console.error('[Metal VRAM] System counters error:', error);
+      return { error: error.message, cpu: null, processes: [], gpu: null, memory: null };
+    }
+  },
+
+  // P/E 코어 수 (hw.perflevel0/1): { performanceCores, efficiencyCores, logicalCores, levels }
+  getCpuTopology: () => {
+    try {
+      return native.getCpuTopology();
+    } catch (error) {
+      console.error('[Metal VRAM] CPU topology error:', error);
+      return null;
+    }
+  },
+
+  // 다른 프로세스의 QoS: 'background' 면 PRIO_DARWIN_BG 설정, 그 외 클래스면 해제
+  setProcessQos: (pid, qos) => {
+    try {
+      return native.setProcessQos(pid, qos);
+    } catch (error) {
+      return { ok: false, error: error.message };
+    }
+  },
+
+  // 호출한 JS 스레드의 QoS 클래스 ('user-interactive' | 'user-initiated' | 'default' | 'utility' | 'background')
+  setThreadQos: (qos) => {
+    try {
+      return native.setThreadQos(qos);
+    } catch (error) {
+      return { ok: false, error: error.message };
+    }
+  },
+
+  // 통합 메모리 압력 감시 (dispatch MEMORYPRESSURE + swapout/압축 속도)
+  // callback({ level: 'normal' | 'warn' | 'critical', reason, swapoutBytesPerSec, compressBytesPerSec, ... })
+  startMemoryPressureMonitor: (callback, options = {}) => {
+    try {
+      return native.startMemoryPressureMonitor(callback, options);
+    } catch (error) {
+      console.error('[Metal VRAM] Memory pressure error:', error);
+      return { running: false, error: error.message };
+    }
+  },
+
+  stopMemoryPressureMonitor: () => {
+    try {
+      native.stopMemoryPressureMonitor();
+    } catch (error) {
+      console.error('[Metal VRAM] Memory pressure error:', error);
+    }
+  },
+
+  // 마지막 측정값 (모니터가 꺼져 있으면 null)
+  getMemoryPressure: () => {
+    try {
+      return native.getMemoryPressure();
+    } catch (error) {
+      return null;
+    }
+  },
+
+  // 모델 파일을 여러 스레드로 페이지 캐시에 올림 (F_RDADVISE + pread, Promise 반환)
+  // options: { threads, chunkBytes, progressIntervalMs }, onProgress({ totalBytes, residentBytes, readBytes })
+  prewarmFiles: async (paths, options = {}, onProgress = null) => {
+    try {
+      return await native.prewarmFiles(paths, options, onProgress || undefined);
+    } catch (error) {
+      return { ok: false, error: error.message || String(error) };
+    }
+  },
+
+  // mincore 로 센 페이지 캐시 상주량: { totalBytes, residentBytes, files: [{ path, size, resident, error? }] }
+  getResidentBytes: (paths) => {
+    try {
+      return native.getResidentBytes(paths);
+    } catch (error) {
+      console.error('[Metal VRAM] Page cache error:', error);
+      return null;
+    }
+  },
+
+  // 실행 중인 prewarmFiles 를 모두 멈춤 (결과의 cancelled 가 true)
+  cancelPrewarm: () => {
+    try {
+      native.cancelPrewarm();
+    } catch (error) {
+      console.error('[Metal VRAM] Page cache error:', error);
+    }
+  },
+
+  // GGUF 헤더/메타데이터 파싱 (mmap + 워커 스레드, Promise 반환)
+  // options: { tensors: true } 텐서 테이블, { metadata: true } 스칼라 KV 메타데이터 포함
+  getGgufInfo: async (filePath, options = {}) => {
+    try {
+      return await native.getGgufInfo(filePath, options);
+    } catch (error) {
+      return { ok: false, error: error.message || String(error) };
+    }
   }
 };
@@ -0,0 +1,22 @@
+// 각 기능 모듈의 N-API export 등록 함수 (metal_vram.mm 의 Init 에서 호출)
+#pragma once
+
+#include <napi.h>
+
+// getGgufInfo(path) -> Promise<GgufInfo>
+void InitGgufReader(Napi::Env env, Napi::Object exports);
+
+// startVRAMSampler(intervalMs?) / stopVRAMSampler() / getVRAMSamples(sinceTs?)
+void InitVRAMSampler(Napi::Env env, Napi::Object exports);
+
+// getSystemCounters(pids?, consumer?) -> { cpu, processes, gpu, memory } (CPU 사용률 기준값은 consumer 별)
+void InitSystemCounters(Napi::Env env, Napi::Object exports);
+
+// getCpuTopology() / setProcessQos(pid, qos) / setThreadQos(qos)
+void InitCpuTopology(Napi::Env env, Napi::Object exports);
+
+// prewarmFiles(paths, options?, onProgress?) / getResidentBytes(paths) / cancelPrewarm()
+void InitPageCache(Napi::Env env, Napi::Object exports);
+
+// startMemoryPressureMonitor(callback, options?) / stopMemoryPressureMonitor() / getMemoryPressure()
+void InitMemoryPressure(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,96 @@
+#include "cpu_topology.h"
+
+#include <pthread.h>
+#include <pthread/qos.h>
+#include <sys/resource.h>
+#include <sys/sysctl.h>
+
+#include <cerrno>
+
+namespace {
+
+bool SysctlU32(const std::string& name, uint32_t* out) {
+  int value = 0;
+  size_t len = sizeof(value);
+  if (sysctlbyname(name.c_str(), &value, &len, nullptr, 0) != 0 || value < 0) return false;
+  *out = static_cast<uint32_t>(value);
+  return true;
+}
+
+bool SysctlU64(const std::string& name, uint64_t* out) {
+  uint64_t value = 0;
+  size_t len = sizeof(value);
+  if (sysctlbyname(name.c_str(), &value, &len, nullptr, 0) != 0) return false;
+  // 일부 키는 32비트 정수
+  *out = len == sizeof(uint32_t) ? static_cast<uint32_t>(value) : value;
+  return true;
+}
+
+std::string SysctlString(const std::string& name) {
+  char buffer[64] = {0};
+  size_t len = sizeof(buffer) - 1;
+  if (sysctlbyname(name.c_str(), buffer, &len, nullptr, 0) != 0) return std::string();
+  return std::string(buffer);
+}
+
+qos_class_t ToQosClass(QosClass qos) {
+  switch (qos) {
+    case QosClass::kUserInteractive: return QOS_CLASS_USER_INTERACTIVE;
+    case QosClass::kUserInitiated: return QOS_CLASS_USER_INITIATED;
+    case QosClass::kUtility: return QOS_CLASS_UTILITY;
+    case QosClass::kBackground: return QOS_CLASS_BACKGROUND;
+    case QosClass::kDefault: break;
+  }
+  return QOS_CLASS_DEFAULT;
+}
+
+}  // namespace
+
+bool QueryCpuTopology(CpuTopology* out) {
+  if (out == nullptr) return false;
+  *out = CpuTopology();
+  if (!SysctlU32("hw.logicalcpu", &out->logical_cores) || out->logical_cores == 0) return false;
+
+  uint32_t nlevels = 0;
+  if (SysctlU32("hw.nperflevels", &nlevels)) {
+    for (uint32_t i = 0; i < nlevels; i++) {
+      const std::string prefix = "hw.perflevel" + std::to_string(i) + ".";
+      PerfLevel level;
+      level.name = SysctlString(prefix + "name");
+      SysctlU32(prefix + "physicalcpu", &level.physical);
+      SysctlU32(prefix + "logicalcpu", &level.logical);
+      SysctlU64(prefix + "l2cachesize", &level.l2_cache_bytes);
+      if (i == 0) {
+        out->performance_cores = level.physical;
+      } else {
+        out->efficiency_cores += level.physical;
+      }
+      out->levels.push_back(level);
+    }
+  }
+  if (out->performance_cores == 0) {
+    // perflevel 미지원: 물리 코어 전체를 P 코어로 취급
+    uint32_t physical = 0;
+    out->performance_cores = SysctlU32("hw.physicalcpu", &physical) && physical > 0 ? physical : out->logical_cores;
+    out->efficiency_cores = 0;
+  }
+  return true;
+}
+
+bool ParseQosClass(const std::string& name, QosClass* out) {
+  if (name == "user-interactive") *out = QosClass::kUserInteractive;
+  else if (name == "user-initiated") *out = QosClass::kUserInitiated;
+  else if (name == "default") *out = QosClass::kDefault;
+  else if (name == "utility") *out = QosClass::kUtility;
+  else if (name == "background") *out = QosClass::kBackground;
+  else return false;
+  return true;
+}
+
+int SetCurrentThreadQos(QosClass qos) {
+  return pthread_set_qos_class_self_np(ToQosClass(qos), 0);
+}
+
+int SetProcessBackground(int pid, bool background) {
+  return setpriority(PRIO_DARWIN_PROCESS, pid, background ? PRIO_DARWIN_BG : 0) == 0 ? 0 : errno;
+}
@@ -0,0 +1,38 @@
+// Apple Silicon 코어 토폴로지 (hw.perflevelN.*) 와 QoS 설정
+//
+// perflevel0 이 성능(P) 코어, perflevel1 이 효율(E) 코어입니다. perflevel 이 없는
+// 시스템(Intel Mac 등)에서는 모든 코어를 P 코어로 보고합니다.
+//
+// QoS:
+// - SetCurrentThreadQos: 호출한 스레드의 QoS 클래스 (pthread_set_qos_class_self_np).
+//   user-interactive / user-initiated 스레드는 스케줄러가 P 코어에 우선 배치합니다.
+// - SetProcessBackground: 다른 프로세스는 QoS 클래스를 직접 바꿀 수 없으므로
+//   PRIO_DARWIN_BG(백그라운드: E 코어 + I/O 스로틀) 를 켜거나 끄는 것만 가능합니다.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct PerfLevel {
+  std::string name;           // "Performance" / "Efficiency"
+  uint32_t physical = 0;
+  uint32_t logical = 0;
+  uint64_t l2_cache_bytes = 0;
+};
+
+struct CpuTopology {
+  std::vector<PerfLevel> levels;
+  uint32_t performance_cores = 0;  // perflevel0 물리 코어
+  uint32_t efficiency_cores = 0;   // 나머지 perflevel 물리 코어 합
+  uint32_t logical_cores = 0;
+};
+
+enum class QosClass { kUserInteractive, kUserInitiated, kDefault, kUtility, kBackground };
+
+bool QueryCpuTopology(CpuTopology* out);
+// "user-interactive" | "user-initiated" | "default" | "utility" | "background"
+bool ParseQosClass(const std::string& name, QosClass* out);
+// 성공하면 0, 실패하면 오류 코드 (pthread_set_qos_class_self_np 는 errno 를 설정하지 않고 반환값으로 알림)
+int SetCurrentThreadQos(QosClass qos);
+int SetProcessBackground(int pid, bool background);
@@ -0,0 +1,71 @@
+#include <cstring>
+#include <string>
+
+#include "addon.h"
+#include "cpu_topology.h"
+
+namespace {
+
+// getCpuTopology() -> { performanceCores, efficiencyCores, logicalCores, levels: [...] } | null
+Napi::Value GetCpuTopology(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CpuTopology topology;
+  if (!QueryCpuTopology(&topology)) return env.Null();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("performanceCores", Napi::Number::New(env, topology.performance_cores));
+  result.Set("efficiencyCores", Napi::Number::New(env, topology.efficiency_cores));
+  result.Set("logicalCores", Napi::Number::New(env, topology.logical_cores));
+  Napi::Array levels = Napi::Array::New(env, topology.levels.size());
+  for (size_t i = 0; i < topology.levels.size(); i++) {
+    const PerfLevel& level = topology.levels[i];
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("name", Napi::String::New(env, level.name));
+    obj.Set("physicalCpu", Napi::Number::New(env, level.physical));
+    obj.Set("logicalCpu", Napi::Number::New(env, level.logical));
+    obj.Set("l2CacheBytes", Napi::Number::New(env, static_cast<double>(level.l2_cache_bytes)));
+    levels.Set(static_cast<uint32_t>(i), obj);
+  }
+  result.Set("levels", levels);
+  return result;
+}
+
+// error: SetCurrentThreadQos / SetProcessBackground 가 돌려준 오류 코드 (0 이면 성공)
+Napi::Value QosResult(Napi::Env env, int error) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("ok", Napi::Boolean::New(env, error == 0));
+  if (error != 0) result.Set("error", Napi::String::New(env, std::strerror(error)));
+  return result;
+}
+
+// setProcessQos(pid, qos) -> { ok, error? }
+// 다른 프로세스는 "background" 면 PRIO_DARWIN_BG 설정, 그 외 클래스면 해제
+Napi::Value SetProcessQos(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  QosClass qos;
+  if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsString() ||
+      !ParseQosClass(info[1].As<Napi::String>().Utf8Value(), &qos)) {
+    Napi::TypeError::New(env, "setProcessQos(pid, qos): unknown arguments").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return QosResult(env, SetProcessBackground(info[0].As<Napi::Number>().Int32Value(), qos == QosClass::kBackground));
+}
+
+// setThreadQos(qos) -> { ok, error? }  (호출한 JS 스레드 자신)
+Napi::Value SetThreadQos(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  QosClass qos;
+  if (info.Length() < 1 || !info[0].IsString() || !ParseQosClass(info[0].As<Napi::String>().Utf8Value(), &qos)) {
+    Napi::TypeError::New(env, "setThreadQos(qos): unknown QoS class").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return QosResult(env, SetCurrentThreadQos(qos));
+}
+
+}  // namespace
+
+void InitCpuTopology(Napi::Env env, Napi::Object exports) {
+  exports.Set(Napi::String::New(env, "getCpuTopology"), Napi::Function::New(env, GetCpuTopology));
+  exports.Set(Napi::String::New(env, "setProcessQos"), Napi::Function::New(env, SetProcessQos));
+  exports.Set(Napi::String::New(env, "setThreadQos"), Napi::Function::New(env, SetThreadQos));
+}
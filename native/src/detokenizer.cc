@@ -0,0 +1,106 @@
+#include "detokenizer.h"
+
+namespace detok {
+
+namespace {
+
+// 선행 바이트 → 시퀀스 길이 (0: 선행 바이트로 올 수 없음)
+int SequenceLength(uint8_t lead) {
+  if (lead < 0x80) return 1;
+  if (lead >= 0xC2 && lead <= 0xDF) return 2;
+  if (lead >= 0xE0 && lead <= 0xEF) return 3;
+  if (lead >= 0xF0 && lead <= 0xF4) return 4;
+  return 0;
+}
+
+// 두 번째 바이트의 허용 범위는 선행 바이트에 따라 좁아짐 (overlong, surrogate, U+10FFFF 초과 차단)
+bool ValidSecondByte(uint8_t lead, uint8_t byte) {
+  switch (lead) {
+    case 0xE0: return byte >= 0xA0 && byte <= 0xBF;
+    case 0xED: return byte >= 0x80 && byte <= 0x9F;
+    case 0xF0: return byte >= 0x90 && byte <= 0xBF;
+    case 0xF4: return byte >= 0x80 && byte <= 0x8F;
+    default: return byte >= 0x80 && byte <= 0xBF;
+  }
+}
+
+}  // namespace
+
+bool Vocab::Init(const uint8_t* data, const uint32_t* offsets, uint32_t n_tokens, const uint8_t* special) {
+  if (offsets == nullptr || (data == nullptr && offsets[n_tokens] > 0)) return false;
+  offsets_.assign(offsets, offsets + n_tokens + 1);
+  max_piece_len_ = 0;
+  for (uint32_t i = 0; i < n_tokens; i++) {
+    if (offsets_[i + 1] < offsets_[i]) return false;
+    const uint32_t len = offsets_[i + 1] - offsets_[i];
+    if (len > max_piece_len_) max_piece_len_ = len;
+  }
+  bytes_.assign(data, data + offsets_[n_tokens]);
+  if (special != nullptr) {
+    special_.assign(special, special + n_tokens);
+  } else {
+    special_.assign(n_tokens, 0);
+  }
+  return true;
+}
+
+const uint8_t* Vocab::Piece(int32_t id, uint32_t* len) const {
+  const uint32_t index = static_cast<uint32_t>(id);
+  *len = offsets_[index + 1] - offsets_[index];
+  return bytes_.data() + offsets_[index];
+}
+
+void Stream::Add(int32_t id, std::string* out) {
+  if (!vocab_->Contains(id) || vocab_->IsSpecial(id)) return;
+  uint32_t len = 0;
+  const uint8_t* piece = vocab_->Piece(id, &len);
+  for (uint32_t i = 0; i < len; i++) {
+    if (at_start_) {
+      at_start_ = false;
+      if (strip_leading_space_ && piece[i] == ' ') continue;
+    }
+    PushByte(piece[i], out);
+  }
+}
+
+void Stream::PushByte(uint8_t byte, std::string* out) {
+  if (pending_len_ > 0) {
+    const bool valid = pending_len_ == 1 ? ValidSecondByte(pending_[0], byte) : (byte >= 0x80 && byte <= 0xBF);
+    if (valid) {
+      pending_[pending_len_++] = byte;
+      if (pending_len_ == expected_len_) {
+        out->append(reinterpret_cast<const char*>(pending_), pending_len_);
+        pending_len_ = 0;
+      }
+      return;
+    }
+    // 끊긴 시퀀스: 지금까지의 부분을 U+FFFD 하나로 바꾸고 이 바이트는 새로 해석
+    EmitReplacement(out);
+    pending_len_ = 0;
+  }
+
+  const int length = SequenceLength(byte);
+  if (length == 1) {
+    out->push_back(static_cast<char>(byte));
+  } else if (length == 0) {
+    EmitReplacement(out);
+  } else {
+    pending_[0] = byte;
+    pending_len_ = 1;
+    expected_len_ = length;
+  }
+}
+
+void Stream::EmitReplacement(std::string* out) { out->append("\xEF\xBF\xBD"); }
+
+void Stream::Finish(std::string* out) {
+  if (pending_len_ > 0) EmitReplacement(out);
+  Reset();
+}
+
+void Stream::Reset() {
+  at_start_ = true;
+  pending_len_ = 0;
+}
+
+}  // namespace detok
@@ -0,0 +1,61 @@
+// 스트리밍 디토크나이저: 토큰 ID → 바이트 piece 를 평탄한 테이블에서 꺼내
+// UTF-8 경계 상태 기계로 완성된 문자만 내보냅니다.
+//
+// 토큰 하나의 비용은 그 piece 의 바이트 수에만 비례하고 지금까지의 출력 길이와 무관합니다.
+// 스페셜 토큰은 ID 로 걸러내며, 잘못된 UTF-8 은 (Python 의 errors="replace" 와 같이)
+// 최대 부분 시퀀스마다 U+FFFD 하나로 바꿉니다.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace detok {
+
+class Vocab {
+ public:
+  // data: 모든 piece 바이트를 이어 붙인 버퍼, offsets: n_tokens + 1 개의 경계,
+  // special: 토큰별 플래그 (0 이 아니면 출력하지 않음, nullptr 이면 없음)
+  bool Init(const uint8_t* data, const uint32_t* offsets, uint32_t n_tokens, const uint8_t* special);
+
+  uint32_t size() const { return static_cast<uint32_t>(special_.size()); }
+  bool IsSpecial(int32_t id) const { return special_[static_cast<uint32_t>(id)] != 0; }
+  bool Contains(int32_t id) const { return id >= 0 && static_cast<uint32_t>(id) < size(); }
+  const uint8_t* Piece(int32_t id, uint32_t* len) const;
+
+  // Stream::Add 한 번이 만들 수 있는 최대 출력 바이트 (대기 중 바이트 + piece 전체가 U+FFFD 인 경우)
+  uint32_t max_output() const { return 3 * (max_piece_len_ + 4); }
+
+ private:
+  std::vector<uint8_t> bytes_;
+  std::vector<uint32_t> offsets_;
+  std::vector<uint8_t> special_;
+  uint32_t max_piece_len_ = 0;
+};
+
+class Stream {
+ public:
+  // strip_leading_space: 출력 맨 앞 공백 하나 제거 (SentencePiece 디코더의 Strip 규칙)
+  Stream(const Vocab* vocab, bool strip_leading_space)
+      : vocab_(vocab), strip_leading_space_(strip_leading_space) {}
+
+  // 완성된 UTF-8 바이트를 out 뒤에 붙임. 범위 밖 ID 와 스페셜 토큰은 무시
+  void Add(int32_t id, std::string* out);
+  // 생성이 끝났을 때: 남은 미완성 바이트를 U+FFFD 하나로 out 뒤에 붙이고 처음 상태로
+  void Finish(std::string* out);
+  // 미완성 바이트를 버리고 처음 상태로 (다음 출력의 맨 앞 공백 규칙도 다시 적용)
+  void Reset();
+
+ private:
+  void PushByte(uint8_t byte, std::string* out);
+  void EmitReplacement(std::string* out);
+
+  const Vocab* vocab_;
+  bool strip_leading_space_;
+  bool at_start_ = true;
+  uint8_t pending_[4] = {0, 0, 0, 0};
+  int pending_len_ = 0;
+  int expected_len_ = 0;
+};
+
+}  // namespace detok
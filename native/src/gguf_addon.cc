@@ -0,0 +1,176 @@
+#include <map>
+#include <string>
+
+#include "addon.h"
+#include "gguf_reader.h"
+
+namespace {
+
+// 이름 패턴으로 Q/K/V 가중치 텐서를 식별 (main.js 의 정규식과 동일한 규칙, 대소문자 무시)
+bool ContainsAnyIgnoreCase(std::string_view name, std::initializer_list<std::string_view> needles) {
+  std::string lower(name);
+  for (char& ch : lower) {
+    if (ch >= 'A' && ch <= 'Z') ch = static_cast<char>(ch - 'A' + 'a');
+  }
+  for (std::string_view needle : needles) {
+    if (lower.find(needle) != std::string::npos) return true;
+  }
+  return false;
+}
+
+std::string TypeName(int32_t type) {
+  const char* name = gguf::GgmlTypeName(type);
+  return name != nullptr ? name : "TYPE_" + std::to_string(type);
+}
+
+// mmap 과 파싱은 워커 스레드에서 수행하고, JS 객체 변환만 메인 스레드(OnOK)에서 수행
+class GgufInfoWorker : public Napi::AsyncWorker {
+ public:
+  struct Options {
+    bool tensors = false;   // 텐서 테이블(이름/타입/shape/크기) 포함
+    bool metadata = false;  // 스칼라 KV 메타데이터 포함
+  };
+
+  GgufInfoWorker(Napi::Env env, std::string path, Options options)
+      : Napi::AsyncWorker(env),
+        path_(std::move(path)),
+        options_(options),
+        deferred_(Napi::Promise::Deferred::New(env)) {}
+
+  Napi::Promise Promise() { return deferred_.Promise(); }
+
+  void Execute() override {
+    std::string error;
+    if (!file_.Open(path_, &error) || !file_.Parse(&info_, &error)) {
+      SetError(error);
+      return;
+    }
+
+    // 텐서 타입 집계와 Q/K/V 식별도 워커 스레드에서 끝내둔다
+    for (const gguf::TensorInfo& t : info_.tensors) {
+      const std::string type_name = TypeName(t.type);
+      type_counts_[type_name]++;
+      if (q_.empty() && ContainsAnyIgnoreCase(t.name, {"attn_q", "q_proj", "wq", "query"})) q_ = type_name;
+      if (k_.empty() && ContainsAnyIgnoreCase(t.name, {"attn_k", "k_proj", "wk", "key"})) k_ = type_name;
+      if (v_.empty() && ContainsAnyIgnoreCase(t.name, {"attn_v", "v_proj", "wv", "value"})) v_ = type_name;
+    }
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("ok", Napi::Boolean::New(env, true));
+    result.Set("filePath", Napi::String::New(env, path_));
+    result.Set("ggufVersion", Napi::Number::New(env, info_.version));
+
+    if (info_.file_type >= 0) {
+      const char* ftype = gguf::LlamaFtypeName(info_.file_type);
+      result.Set("fileTypeId", Napi::Number::New(env, static_cast<double>(info_.file_type)));
+      result.Set("fileTypeName", Napi::String::New(
+          env, ftype != nullptr ? ftype : "FTYPE_" + std::to_string(info_.file_type)));
+    } else {
+      result.Set("fileTypeId", env.Null());
+      result.Set("fileTypeName", env.Null());
+    }
+
+    Napi::Object tensor_types = Napi::Object::New(env);
+    for (const auto& entry : type_counts_) {
+      tensor_types.Set(entry.first, Napi::Number::New(env, entry.second));
+    }
+    result.Set("tensorTypes", tensor_types);
+
+    Napi::Object qkv = Napi::Object::New(env);
+    qkv.Set("q", q_.empty() ? env.Null() : Napi::String::New(env, q_));
+    qkv.Set("k", k_.empty() ? env.Null() : Napi::String::New(env, k_));
+    qkv.Set("v", v_.empty() ? env.Null() : Napi::String::New(env, v_));
+    result.Set("qkv", qkv);
+
+    Napi::Array keys = Napi::Array::New(env, info_.kv_keys_sample.size());
+    for (size_t i = 0; i < info_.kv_keys_sample.size(); i++) {
+      const std::string_view key = info_.kv_keys_sample[i];
+      keys.Set(static_cast<uint32_t>(i), Napi::String::New(env, key.data(), key.size()));
+    }
+    result.Set("kvKeysSample", keys);
+
+    result.Set("nTensors", Napi::Number::New(env, static_cast<double>(info_.n_tensors)));
+    result.Set("nKv", Napi::Number::New(env, static_cast<double>(info_.n_kv)));
+    result.Set("fileSize", Napi::Number::New(env, static_cast<double>(info_.file_size)));
+
+    if (options_.metadata) result.Set("metadata", MetadataObject(env));
+    if (options_.tensors) result.Set("tensors", TensorArray(env));
+
+    deferred_.Resolve(result);
+  }
+
+  void OnError(const Napi::Error& error) override { deferred_.Reject(error.Value()); }
+
+ private:
+  // 스칼라 KV 를 { key: number | string | boolean } 로 변환 (배열 값은 포함하지 않음)
+  Napi::Object MetadataObject(Napi::Env env) const {
+    Napi::Object metadata = Napi::Object::New(env);
+    for (const gguf::KvScalar& kv : info_.kv_scalars) {
+      const std::string key(kv.key);
+      if (kv.type == gguf::kString) {
+        metadata.Set(key, Napi::String::New(env, kv.str.data(), kv.str.size()));
+      } else if (kv.type == gguf::kBool) {
+        metadata.Set(key, Napi::Boolean::New(env, kv.number != 0.0));
+      } else {
+        metadata.Set(key, Napi::Number::New(env, kv.number));
+      }
+    }
+    return metadata;
+  }
+
+  Napi::Array TensorArray(Napi::Env env) const {
+    Napi::Array tensors = Napi::Array::New(env, info_.tensors.size());
+    for (size_t i = 0; i < info_.tensors.size(); i++) {
+      const gguf::TensorInfo& t = info_.tensors[i];
+      Napi::Object tensor = Napi::Object::New(env);
+      tensor.Set("name", Napi::String::New(env, t.name.data(), t.name.size()));
+      tensor.Set("type", Napi::Number::New(env, t.type));
+      tensor.Set("typeName", Napi::String::New(env, TypeName(t.type)));
+      Napi::Array ne = Napi::Array::New(env, t.n_dims);
+      for (uint32_t d = 0; d < t.n_dims; d++) {
+        ne.Set(d, Napi::Number::New(env, static_cast<double>(t.ne[d])));
+      }
+      tensor.Set("ne", ne);
+      tensor.Set("offset", Napi::Number::New(env, static_cast<double>(t.offset)));
+      tensor.Set("size", Napi::Number::New(env, static_cast<double>(t.size)));
+      tensors.Set(static_cast<uint32_t>(i), tensor);
+    }
+    return tensors;
+  }
+
+  std::string path_;
+  Options options_;
+  Napi::Promise::Deferred deferred_;
+  gguf::File file_;
+  gguf::Info info_;
+  std::map<std::string, uint32_t> type_counts_;
+  std::string q_, k_, v_;
+};
+
+Napi::Value GetGgufInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    deferred.Reject(Napi::TypeError::New(env, "modelPath must be a string").Value());
+    return deferred.Promise();
+  }
+  GgufInfoWorker::Options options;
+  if (info.Length() >= 2 && info[1].IsObject()) {
+    Napi::Object opts = info[1].As<Napi::Object>();
+    options.tensors = opts.Get("tensors").ToBoolean().Value();
+    options.metadata = opts.Get("metadata").ToBoolean().Value();
+  }
+  auto* worker = new GgufInfoWorker(env, info[0].As<Napi::String>().Utf8Value(), options);
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+}  // namespace
+
+void InitGgufReader(Napi::Env env, Napi::Object exports) {
+  exports.Set(Napi::String::New(env, "getGgufInfo"), Napi::Function::New(env, GetGgufInfo));
+}
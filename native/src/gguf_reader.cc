@@ -0,0 +1,374 @@
+#include "gguf_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace gguf {
+
+namespace {
+
+constexpr uint64_t kMaxStringBytes = 4ull * 1024 * 1024;  // 4MB safeguard
+
+// 매핑된 영역 위를 이동하는 리더. 모든 읽기는 경계 검사를 거침
+class Cursor {
+ public:
+  Cursor(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  size_t pos() const { return pos_; }
+  const std::string& error() const { return error_; }
+
+  bool Skip(uint64_t n) {
+    if (n > size_ - pos_) {
+      return Fail("Unexpected EOF while skipping " + std::to_string(n) + " bytes");
+    }
+    pos_ += static_cast<size_t>(n);
+    return true;
+  }
+
+  template <typename T>
+  bool Read(T* out) {
+    if (sizeof(T) > size_ - pos_) {
+      return Fail("Unexpected EOF while reading " + std::to_string(sizeof(T)) + " bytes");
+    }
+    std::memcpy(out, data_ + pos_, sizeof(T));  // GGUF 는 little-endian (arm64/x86_64 와 동일)
+    pos_ += sizeof(T);
+    return true;
+  }
+
+  bool ReadString(std::string_view* out) {
+    uint64_t len = 0;
+    if (!Read(&len)) return false;
+    if (len > kMaxStringBytes) {
+      return Fail("String length out of range: " + std::to_string(len));
+    }
+    if (len > size_ - pos_) {
+      return Fail("Unexpected EOF while reading string");
+    }
+    *out = std::string_view(reinterpret_cast<const char*>(data_ + pos_), static_cast<size_t>(len));
+    pos_ += static_cast<size_t>(len);
+    return true;
+  }
+
+  bool Fail(std::string message) {
+    if (error_.empty()) error_ = std::move(message);
+    return false;
+  }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t pos_ = 0;
+  std::string error_;
+};
+
+size_t SizeOfScalar(int32_t type) {
+  switch (type) {
+    case kUint8:
+    case kInt8:
+    case kBool:
+      return 1;
+    case kUint16:
+    case kInt16:
+      return 2;
+    case kUint32:
+    case kInt32:
+    case kFloat32:
+      return 4;
+    case kUint64:
+    case kInt64:
+    case kFloat64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+template <typename T>
+bool ReadNumber(Cursor* c, double* out) {
+  T v{};
+  if (!c->Read(&v)) return false;
+  *out = static_cast<double>(v);
+  return true;
+}
+
+bool ReadScalar(Cursor* c, int32_t type, KvScalar* out) {
+  out->type = type;
+  switch (type) {
+    case kUint8: return ReadNumber<uint8_t>(c, &out->number);
+    case kInt8: return ReadNumber<int8_t>(c, &out->number);
+    case kBool: return ReadNumber<uint8_t>(c, &out->number);
+    case kUint16: return ReadNumber<uint16_t>(c, &out->number);
+    case kInt16: return ReadNumber<int16_t>(c, &out->number);
+    case kUint32: return ReadNumber<uint32_t>(c, &out->number);
+    case kInt32: return ReadNumber<int32_t>(c, &out->number);
+    case kFloat32: return ReadNumber<float>(c, &out->number);
+    case kUint64: return ReadNumber<uint64_t>(c, &out->number);
+    case kInt64: return ReadNumber<int64_t>(c, &out->number);
+    case kFloat64: return ReadNumber<double>(c, &out->number);
+    case kString: return c->ReadString(&out->str);
+    default:
+      return c->Fail("Unsupported GGUF value type: " + std::to_string(type));
+  }
+}
+
+// 배열 값 건너뛰기. 고정 크기 원소는 한 번에 건너뛰고 문자열 배열만 순회
+bool SkipArray(Cursor* c) {
+  int32_t elem_type = 0;
+  uint64_t n = 0;
+  if (!c->Read(&elem_type) || !c->Read(&n)) return false;
+  if (elem_type == kString) {
+    for (uint64_t i = 0; i < n; i++) {
+      std::string_view ignored;
+      if (!c->ReadString(&ignored)) return false;
+    }
+    return true;
+  }
+  const size_t elem_size = SizeOfScalar(elem_type);
+  if (elem_size == 0) {
+    return c->Fail("Unsupported array element type: " + std::to_string(elem_type));
+  }
+  if (n > UINT64_MAX / elem_size) {
+    return c->Fail("Array length out of range: " + std::to_string(n));
+  }
+  return c->Skip(n * elem_size);
+}
+
+}  // namespace
+
+File::~File() { Close(); }
+
+void File::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  size_ = 0;
+}
+
+bool File::Open(const std::string& path, std::string* error) {
+  Close();
+  fd_ = open(path.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    *error = "Failed to open file: " + std::string(std::strerror(errno));
+    return false;
+  }
+  struct stat st {};
+  if (fstat(fd_, &st) != 0) {
+    *error = "Failed to stat file: " + std::string(std::strerror(errno));
+    Close();
+    return false;
+  }
+  if (st.st_size <= 0) {
+    *error = "File is empty";
+    Close();
+    return false;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (addr == MAP_FAILED) {
+    *error = "Failed to mmap file: " + std::string(std::strerror(errno));
+    size_ = 0;
+    Close();
+    return false;
+  }
+  data_ = static_cast<const uint8_t*>(addr);
+  // 헤더 구간만 순차 접근하므로 readahead 힌트만 준다 (텐서 데이터는 건드리지 않음)
+  madvise(addr, size_, MADV_SEQUENTIAL);
+  return true;
+}
+
+bool File::Parse(Info* info, std::string* error) const {
+  if (data_ == nullptr) {
+    *error = "File is not open";
+    return false;
+  }
+  Cursor c(data_, size_);
+  info->file_size = size_;
+
+  char magic[4];
+  if (!c.Read(&magic)) {
+    *error = c.error();
+    return false;
+  }
+  if (std::memcmp(magic, "GGUF", 4) != 0) {
+    *error = "Not a GGUF file (magic=" + std::string(magic, 4) + ")";
+    return false;
+  }
+
+  // GGUF spec: n_tensors, n_kv are uint64
+  if (!c.Read(&info->version) || !c.Read(&info->n_tensors) || !c.Read(&info->n_kv)) {
+    *error = c.error();
+    return false;
+  }
+
+  for (uint64_t i = 0; i < info->n_kv; i++) {
+    std::string_view key;
+    int32_t value_type = 0;
+    if (!c.ReadString(&key) || !c.Read(&value_type)) {
+      *error = c.error();
+      return false;
+    }
+    if (info->kv_keys_sample.size() < kMaxKvKeysSample) {
+      info->kv_keys_sample.push_back(key);
+    }
+
+    if (value_type == kArray) {
+      if (!SkipArray(&c)) {
+        *error = c.error();
+        return false;
+      }
+      continue;
+    }
+
+    KvScalar kv;
+    kv.key = key;
+    if (!ReadScalar(&c, value_type, &kv)) {
+      *error = c.error();
+      return false;
+    }
+    if (key == "general.file_type" && (value_type == kUint32 || value_type == kInt32)) {
+      info->file_type = static_cast<int64_t>(kv.number);
+    } else if (key == "general.alignment" && value_type == kUint32 && kv.number > 0) {
+      info->alignment = static_cast<uint32_t>(kv.number);
+    }
+    info->kv_scalars.push_back(kv);
+  }
+
+  // n_tensors 는 파일 크기로 상한을 검사한 뒤 예약 (손상된 헤더로 인한 과도한 할당 방지)
+  if (info->n_tensors > size_ / 24) {
+    *error = "Tensor count out of range: " + std::to_string(info->n_tensors);
+    return false;
+  }
+  info->tensors.reserve(static_cast<size_t>(info->n_tensors));
+
+  for (uint64_t i = 0; i < info->n_tensors; i++) {
+    TensorInfo t;
+    if (!c.ReadString(&t.name) || !c.Read(&t.n_dims)) {
+      *error = c.error();
+      return false;
+    }
+    if (t.n_dims > kMaxDims) {
+      *error = "Tensor has too many dimensions: " + std::to_string(t.n_dims);
+      return false;
+    }
+    for (uint32_t d = 0; d < t.n_dims; d++) {
+      if (!c.Read(&t.ne[d])) {
+        *error = c.error();
+        return false;
+      }
+    }
+    if (!c.Read(&t.type) || !c.Read(&t.offset)) {
+      *error = c.error();
+      return false;
+    }
+    info->tensors.push_back(t);
+  }
+
+  const uint64_t align = info->alignment;
+  info->data_offset = (static_cast<uint64_t>(c.pos()) + align - 1) / align * align;
+
+  // 텐서 크기 = 오프셋 순으로 정렬했을 때 다음 텐서 시작까지의 거리
+  // (ggml 타입별 블록 크기 테이블 없이도 패딩 포함 실제 점유 바이트를 얻을 수 있음)
+  const uint64_t data_size = info->file_size > info->data_offset ? info->file_size - info->data_offset : 0;
+  std::vector<size_t> order(info->tensors.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::sort(order.begin(), order.end(), [info](size_t a, size_t b) {
+    return info->tensors[a].offset < info->tensors[b].offset;
+  });
+  for (size_t i = 0; i < order.size(); i++) {
+    TensorInfo& t = info->tensors[order[i]];
+    const uint64_t end = i + 1 < order.size() ? info->tensors[order[i + 1]].offset : data_size;
+    t.size = end > t.offset ? end - t.offset : 0;
+  }
+  return true;
+}
+
+const char* GgmlTypeName(int32_t type) {
+  switch (type) {
+    case 0: return "F32";
+    case 1: return "F16";
+    case 2: return "Q4_0";
+    case 3: return "Q4_1";
+    case 6: return "Q5_0";
+    case 7: return "Q5_1";
+    case 8: return "Q8_0";
+    case 9: return "Q8_1";
+    case 10: return "Q2_K";
+    case 11: return "Q3_K";
+    case 12: return "Q4_K";
+    case 13: return "Q5_K";
+    case 14: return "Q6_K";
+    case 15: return "Q8_K";
+    case 16: return "IQ2_XXS";
+    case 17: return "IQ2_XS";
+    case 18: return "IQ3_XXS";
+    case 19: return "IQ1_S";
+    case 20: return "IQ4_NL";
+    case 21: return "IQ3_S";
+    case 22: return "IQ2_S";
+    case 23: return "IQ4_XS";
+    case 24: return "I8";
+    case 25: return "I16";
+    case 26: return "I32";
+    case 27: return "I64";
+    case 28: return "F64";
+    case 29: return "IQ1_M";
+    case 30: return "BF16";
+    case 34: return "TQ1_0";
+    case 35: return "TQ2_0";
+    case 39: return "MXFP4";
+    default: return nullptr;
+  }
+}
+
+// subset of llama_ftype values (llama.cpp/include/llama.h)
+const char* LlamaFtypeName(int64_t ftype) {
+  switch (ftype & ~1024) {  // LLAMA_FTYPE_GUESSED 비트 제거
+    case 0: return "ALL_F32";
+    case 1: return "MOSTLY_F16";
+    case 2: return "MOSTLY_Q4_0";
+    case 3: return "MOSTLY_Q4_1";
+    case 7: return "MOSTLY_Q8_0";
+    case 8: return "MOSTLY_Q5_0";
+    case 9: return "MOSTLY_Q5_1";
+    case 10: return "MOSTLY_Q2_K";
+    case 11: return "MOSTLY_Q3_K_S";
+    case 12: return "MOSTLY_Q3_K_M";
+    case 13: return "MOSTLY_Q3_K_L";
+    case 14: return "MOSTLY_Q4_K_S";
+    case 15: return "MOSTLY_Q4_K_M";
+    case 16: return "MOSTLY_Q5_K_S";
+    case 17: return "MOSTLY_Q5_K_M";
+    case 18: return "MOSTLY_Q6_K";
+    case 19: return "MOSTLY_IQ2_XXS";
+    case 20: return "MOSTLY_IQ2_XS";
+    case 21: return "MOSTLY_Q2_K_S";
+    case 22: return "MOSTLY_IQ3_XS";
+    case 23: return "MOSTLY_IQ3_XXS";
+    case 24: return "MOSTLY_IQ1_S";
+    case 25: return "MOSTLY_IQ4_NL";
+    case 26: return "MOSTLY_IQ3_S";
+    case 27: return "MOSTLY_IQ3_M";
+    case 28: return "MOSTLY_IQ2_S";
+    case 29: return "MOSTLY_IQ2_M";
+    case 30: return "MOSTLY_IQ4_XS";
+    case 31: return "MOSTLY_IQ1_M";
+    case 32: return "MOSTLY_BF16";
+    case 36: return "MOSTLY_TQ1_0";
+    case 37: return "MOSTLY_TQ2_0";
+    case 38: return "MOSTLY_MXFP4_MOE";
+    default: return nullptr;
+  }
+}
+
+}  // namespace gguf
@@ -0,0 +1,92 @@
+// GGUF 헤더/메타데이터 리더 (mmap 기반, 텐서 데이터는 읽지 않음)
+//
+// 파일 전체를 mmap 한 뒤 KV 섹션과 텐서 정보 테이블만 순회합니다.
+// 문자열(키, 텐서 이름)은 복사하지 않고 매핑된 영역을 가리키는 string_view 로
+// 보관하므로, File 객체가 살아있는 동안에만 Info 의 view 들이 유효합니다.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gguf {
+
+// GGUF 스펙의 값 타입 (gguf_type)
+enum ValueType : int32_t {
+  kUint8 = 0,
+  kInt8 = 1,
+  kUint16 = 2,
+  kInt16 = 3,
+  kUint32 = 4,
+  kInt32 = 5,
+  kFloat32 = 6,
+  kBool = 7,
+  kString = 8,
+  kArray = 9,
+  kUint64 = 10,
+  kInt64 = 11,
+  kFloat64 = 12,
+};
+
+constexpr uint32_t kMaxDims = 4;          // GGML_MAX_DIMS
+constexpr uint32_t kDefaultAlignment = 32; // GGUF_DEFAULT_ALIGNMENT
+constexpr size_t kMaxKvKeysSample = 64;
+
+struct TensorInfo {
+  std::string_view name;
+  uint32_t n_dims = 0;
+  uint64_t ne[kMaxDims] = {1, 1, 1, 1};
+  int32_t type = -1;    // ggml_type
+  uint64_t offset = 0;  // 데이터 섹션 기준 오프셋
+  uint64_t size = 0;    // 다음 텐서 오프셋(또는 파일 끝)까지의 바이트 수
+};
+
+// 스칼라 KV 값 (배열은 건너뛰고 보관하지 않음)
+struct KvScalar {
+  std::string_view key;
+  int32_t type = -1;
+  double number = 0.0;     // 숫자/불리언 타입일 때
+  std::string_view str;    // kString 일 때
+};
+
+struct Info {
+  uint32_t version = 0;
+  uint64_t n_tensors = 0;
+  uint64_t n_kv = 0;
+  int64_t file_type = -1;  // general.file_type (없으면 -1)
+  uint32_t alignment = kDefaultAlignment;
+  uint64_t data_offset = 0;  // 텐서 데이터 섹션 시작 위치
+  uint64_t file_size = 0;
+  std::vector<std::string_view> kv_keys_sample;  // 앞쪽 kMaxKvKeysSample 개
+  std::vector<KvScalar> kv_scalars;
+  std::vector<TensorInfo> tensors;
+};
+
+class File {
+ public:
+  File() = default;
+  ~File();
+  File(const File&) = delete;
+  File& operator=(const File&) = delete;
+
+  // 파일을 읽기 전용으로 mmap. 실패 시 false 와 함께 error 설정
+  bool Open(const std::string& path, std::string* error);
+
+  // 헤더, KV 섹션, 텐서 정보 테이블을 파싱
+  bool Parse(Info* info, std::string* error) const;
+
+ private:
+  void Close();
+
+  int fd_ = -1;
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// ggml_type / llama_ftype 이름 (알 수 없으면 nullptr)
+const char* GgmlTypeName(int32_t type);
+const char* LlamaFtypeName(int64_t ftype);
+
+}  // namespace gguf
@@ -0,0 +1,70 @@
+#include "llm_detok.h"
+
+#include <cstring>
+#include <string>
+
+#include "detokenizer.h"
+
+struct llm_detok_vocab {
+  detok::Vocab vocab;
+};
+
+struct llm_detok_stream {
+  detok::Stream stream;
+  std::string buffer;  // 호출마다 재사용 (capacity 유지)
+};
+
+extern "C" {
+
+int llm_detok_abi_version(void) { return LLM_DETOK_ABI_VERSION; }
+
+llm_detok_vocab* llm_detok_vocab_new(const uint8_t* data, const uint32_t* offsets, uint32_t n_tokens,
+                                     const uint8_t* special) {
+  auto* handle = new llm_detok_vocab();
+  if (!handle->vocab.Init(data, offsets, n_tokens, special)) {
+    delete handle;
+    return nullptr;
+  }
+  return handle;
+}
+
+void llm_detok_vocab_free(llm_detok_vocab* vocab) { delete vocab; }
+
+uint32_t llm_detok_vocab_max_output(const llm_detok_vocab* vocab) {
+  return vocab != nullptr ? vocab->vocab.max_output() : 0;
+}
+
+llm_detok_stream* llm_detok_stream_new(const llm_detok_vocab* vocab, int strip_leading_space) {
+  if (vocab == nullptr) return nullptr;
+  auto* handle = new llm_detok_stream{detok::Stream(&vocab->vocab, strip_leading_space != 0), std::string()};
+  handle->buffer.reserve(vocab->vocab.max_output());
+  return handle;
+}
+
+void llm_detok_stream_free(llm_detok_stream* stream) { delete stream; }
+
+int32_t llm_detok_stream_add(llm_detok_stream* stream, int32_t token_id, char* out, int32_t out_cap) {
+  if (stream == nullptr || out == nullptr) return -1;
+  stream->buffer.clear();
+  stream->stream.Add(token_id, &stream->buffer);
+  const size_t n = stream->buffer.size();
+  if (n > static_cast<size_t>(out_cap)) return -1;
+  std::memcpy(out, stream->buffer.data(), n);
+  return static_cast<int32_t>(n);
+}
+
+int32_t llm_detok_stream_finish(llm_detok_stream* stream, char* out, int32_t out_cap) {
+  if (stream == nullptr || out == nullptr) return -1;
+  stream->buffer.clear();
+  stream->stream.Finish(&stream->buffer);
+  const size_t n = stream->buffer.size();
+  if (n > static_cast<size_t>(out_cap)) return -1;
+  std::memcpy(out, stream->buffer.data(), n);
+  return static_cast<int32_t>(n);
+}
+
+void llm_detok_stream_reset(llm_detok_stream* stream) {
+  if (stream != nullptr) stream->stream.Reset();
+}
+
+}  // extern "C"
@@ -0,0 +1,47 @@
+/*
+ * llm_detok: 스트리밍 디토크나이저의 C ABI (libllm_detok.dylib)
+ *
+ * MLX Python 서버가 ctypes 로 사용합니다 (mlx/native_detok.py).
+ * 어휘는 토큰별 바이트 piece 를 이어 붙인 평탄한 테이블로 한 번 넘기고,
+ * 요청마다 stream 을 만들어 토큰을 하나씩 넣으면 완성된 UTF-8 바이트만 돌려받습니다.
+ * stream 은 스레드 안전하지 않으므로 한 스레드에서만 사용해야 합니다.
+ */
+#ifndef LLM_DETOK_H
+#define LLM_DETOK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LLM_DETOK_ABI_VERSION 2
+
+typedef struct llm_detok_vocab llm_detok_vocab;
+typedef struct llm_detok_stream llm_detok_stream;
+
+int llm_detok_abi_version(void);
+
+/* data: piece 바이트, offsets: n_tokens + 1 개 경계, special: 토큰별 0/1 (NULL 가능). 실패 시 NULL */
+llm_detok_vocab* llm_detok_vocab_new(const uint8_t* data, const uint32_t* offsets, uint32_t n_tokens,
+                                     const uint8_t* special);
+void llm_detok_vocab_free(llm_detok_vocab* vocab);
+/* llm_detok_stream_add 출력 버퍼에 필요한 최대 크기 */
+uint32_t llm_detok_vocab_max_output(const llm_detok_vocab* vocab);
+
+/* vocab 은 stream 보다 오래 살아 있어야 함 */
+llm_detok_stream* llm_detok_stream_new(const llm_detok_vocab* vocab, int strip_leading_space);
+void llm_detok_stream_free(llm_detok_stream* stream);
+
+/* 토큰 하나를 넣고 새로 완성된 UTF-8 바이트 수를 반환 (out_cap 이 부족하면 -1) */
+int32_t llm_detok_stream_add(llm_detok_stream* stream, int32_t token_id, char* out, int32_t out_cap);
+/* 생성 끝: 남은 미완성 바이트를 U+FFFD 로 out 에 쓰고 (바이트 수 반환, 없으면 0) stream 을 처음 상태로 */
+int32_t llm_detok_stream_finish(llm_detok_stream* stream, char* out, int32_t out_cap);
+/* 미완성 바이트를 버리고 stream 을 처음 상태로 되돌림 */
+void llm_detok_stream_reset(llm_detok_stream* stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LLM_DETOK_H */
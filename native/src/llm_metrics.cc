@@ -0,0 +1,121 @@
+#include "llm_metrics.h"
+
+#include <unistd.h>
+
+#include "cpu_topology.h"
+#include "metal_device.h"
+#include "page_cache.h"
+#include "system_counters.h"
+
+namespace {
+
+// C ABI 로 사용하는 쪽(MLX 서버의 /metrics)의 CPU 사용률 기준값 (Node addon 의 샘플러와 별개)
+CpuSampler& MetricsSampler() {
+  static CpuSampler sampler;
+  return sampler;
+}
+
+}  // namespace
+
+extern "C" {
+
+int llm_metrics_abi_version(void) { return LLM_METRICS_ABI_VERSION; }
+
+int llm_metrics_gpu(llm_gpu_metrics* out) {
+  if (out == nullptr) return -1;
+  VRAMInfo vram;
+  if (!QueryVRAMInfo(&vram)) return -1;
+  out->vram_total = vram.total;
+  out->vram_used = vram.used;
+
+  GpuStats gpu;
+  QueryGpuStats(&gpu);  // 미지원이면 -1 그대로
+  out->device_util = gpu.device_util;
+  out->renderer_util = gpu.renderer_util;
+  out->tiler_util = gpu.tiler_util;
+  out->in_use_system_memory = gpu.in_use_system_memory;
+  return 0;
+}
+
+int llm_metrics_cpu(int32_t pid, llm_cpu_metrics* out) {
+  if (out == nullptr) return -1;
+  HostCpuLoad host;
+  if (!MetricsSampler().QueryHostCpuLoad(&host)) return -1;
+  ProcessCpu proc;
+  if (!MetricsSampler().QueryProcessCpu(pid > 0 ? pid : getpid(), &proc)) return -1;
+  out->host_usage = host.usage;
+  out->cores = host.cores;
+  out->process_usage = proc.usage;
+  out->process_cpu_seconds = proc.cpu_seconds;
+  out->process_resident_bytes = proc.resident_bytes;
+  out->process_footprint_bytes = proc.footprint_bytes;
+  return 0;
+}
+
+int llm_metrics_memory(llm_memory_metrics* out) {
+  if (out == nullptr) return -1;
+  MemoryStats mem;
+  if (!QueryMemoryStats(&mem)) return -1;
+  out->total = mem.total;
+  out->free = mem.free;
+  out->active = mem.active;
+  out->inactive = mem.inactive;
+  out->wired = mem.wired;
+  out->compressed = mem.compressed;
+  out->app = mem.app;
+  out->swap_used = mem.swap_used;
+  out->swap_total = mem.swap_total;
+  out->swapins = mem.swapins;
+  out->swapouts = mem.swapouts;
+  out->pressure_level = mem.pressure_level;
+  return 0;
+}
+
+int llm_metrics_cpu_topology(llm_cpu_topology* out) {
+  if (out == nullptr) return -1;
+  CpuTopology topology;
+  if (!QueryCpuTopology(&topology)) return -1;
+  out->performance_cores = topology.performance_cores;
+  out->efficiency_cores = topology.efficiency_cores;
+  out->logical_cores = topology.logical_cores;
+  return 0;
+}
+
+int llm_set_thread_qos(int32_t qos) {
+  if (qos < LLM_QOS_USER_INTERACTIVE || qos > LLM_QOS_BACKGROUND) return -1;
+  // LLM_QOS_* 는 QosClass 와 같은 순서
+  return SetCurrentThreadQos(static_cast<QosClass>(qos)) == 0 ? 0 : -1;
+}
+
+int llm_resident_bytes(const char* const* paths, int32_t count, llm_prewarm_progress* out) {
+  if (out == nullptr || paths == nullptr || count < 0) return -1;
+  *out = llm_prewarm_progress{};
+  for (int32_t i = 0; i < count; i++) {
+    FileResidency file;
+    if (paths[i] == nullptr || !QueryResidentBytes(paths[i], &file)) continue;
+    out->total_bytes += file.size;
+    out->resident_bytes += file.resident;
+  }
+  return 0;
+}
+
+int llm_prewarm_files(const char* const* paths, int32_t count, int32_t threads, llm_prewarm_progress* out) {
+  if (paths == nullptr || count < 0) return -1;
+  std::vector<std::string> files;
+  for (int32_t i = 0; i < count; i++) {
+    if (paths[i] != nullptr) files.emplace_back(paths[i]);
+  }
+  PrewarmOptions options;
+  options.threads = threads > 0 ? static_cast<uint32_t>(threads) : 0;
+  const PrewarmResult result = PrewarmFiles(files, options, nullptr);
+  if (out != nullptr) {
+    out->total_bytes = result.progress.total_bytes;
+    out->resident_bytes = result.progress.resident_bytes;
+    out->read_bytes = result.progress.read_bytes;
+  }
+  return result.cancelled ? 1 : 0;
+}
+
+void llm_prewarm_cancel(void) { CancelPrewarm(); }
+
+}  // extern "C"
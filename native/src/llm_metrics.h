@@ -0,0 +1,95 @@
+/*
+ * llm_metrics: Metal/IOKit/Mach 메트릭의 C ABI (libllm_metrics.dylib)
+ *
+ * Node addon 과 같은 소스(metal_device.mm, system_counters.cc)로 빌드되며,
+ * Python(ctypes) 등 N-API 를 쓸 수 없는 프로세스에서 fork 없이 호출할 수 있습니다.
+ * 모든 함수는 성공 시 0, 해당 정보를 얻을 수 없으면 -1 을 반환합니다.
+ * 값이 없는 double 필드는 -1 입니다.
+ *
+ * 주의: vram_used(currentAllocatedSize)는 "호출한 프로세스"의 Metal 할당량입니다.
+ * 추론 프로세스 안에서 호출해야 해당 모델의 실제 사용량이 됩니다.
+ */
+#ifndef LLM_METRICS_H
+#define LLM_METRICS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LLM_METRICS_ABI_VERSION 3
+
+typedef struct {
+  uint64_t vram_total;  /* recommendedMaxWorkingSetSize */
+  uint64_t vram_used;   /* currentAllocatedSize (호출 프로세스 기준) */
+  double device_util;   /* IOAccelerator "Device Utilization %" */
+  double renderer_util; /* "Renderer Utilization %" */
+  double tiler_util;    /* "Tiler Utilization %" */
+  double in_use_system_memory; /* "In use system memory" (bytes, 시스템 전체) */
+} llm_gpu_metrics;
+
+typedef struct {
+  double host_usage;    /* 전체 코어 평균 %, 이전 호출 대비 (첫 호출 -1) */
+  double process_usage; /* 전체 코어 대비 %, 이전 호출 대비 (첫 호출 -1) */
+  double process_cpu_seconds;
+  uint64_t process_resident_bytes;
+  uint64_t process_footprint_bytes;
+  uint32_t cores;
+} llm_cpu_metrics;
+
+typedef struct {
+  uint64_t total;
+  uint64_t free;
+  uint64_t active;
+  uint64_t inactive;
+  uint64_t wired;
+  uint64_t compressed;
+  uint64_t app;
+  uint64_t swap_used;
+  uint64_t swap_total;
+  uint64_t swapins;
+  uint64_t swapouts;
+  int32_t pressure_level; /* 1 normal, 2 warn, 4 critical */
+} llm_memory_metrics;
+
+typedef struct {
+  uint32_t performance_cores; /* hw.perflevel0.physicalcpu */
+  uint32_t efficiency_cores;  /* 나머지 perflevel 합 */
+  uint32_t logical_cores;
+} llm_cpu_topology;
+
+typedef struct {
+  uint64_t total_bytes;
+  uint64_t resident_bytes; /* mincore 기준 페이지 캐시 상주 바이트 */
+  uint64_t read_bytes;     /* llm_prewarm_files 가 실제로 읽은 바이트 */
+} llm_prewarm_progress;
+
+/* llm_set_thread_qos 의 QoS 클래스 */
+#define LLM_QOS_USER_INTERACTIVE 0
+#define LLM_QOS_USER_INITIATED 1
+#define LLM_QOS_DEFAULT 2
+#define LLM_QOS_UTILITY 3
+#define LLM_QOS_BACKGROUND 4
+
+int llm_metrics_abi_version(void);
+int llm_metrics_gpu(llm_gpu_metrics* out);
+/* pid <= 0 이면 호출한 프로세스 자신. 사용률은 이 함수의 이전 호출 대비 (한 곳에서만 주기적으로 호출) */
+int llm_metrics_cpu(int32_t pid, llm_cpu_metrics* out);
+int llm_metrics_memory(llm_memory_metrics* out);
+int llm_metrics_cpu_topology(llm_cpu_topology* out);
+/* 호출한 스레드의 QoS 클래스 설정 (LLM_QOS_*) */
+int llm_set_thread_qos(int32_t qos);
+/* 파일들의 페이지 캐시 상주량 (내용은 읽지 않음, read_bytes 는 0) */
+int llm_resident_bytes(const char* const* paths, int32_t count, llm_prewarm_progress* out);
+/* 병렬 readahead + pread 로 파일들을 페이지 캐시에 올림 (블로킹, threads <= 0 이면 자동).
+ * 진행률은 다른 스레드에서 llm_resident_bytes 로 조회합니다. 취소되면 1 을 반환합니다. */
+int llm_prewarm_files(const char* const* paths, int32_t count, int32_t threads, llm_prewarm_progress* out);
+/* 실행 중인 모든 llm_prewarm_files 를 다음 chunk 에서 멈춤 */
+void llm_prewarm_cancel(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LLM_METRICS_H */
@@ -0,0 +1,206 @@
+#include "memory_pressure.h"
+
+#include <dispatch/dispatch.h>
+#include <sys/sysctl.h>
+
+#include <chrono>
+
+#include "system_counters.h"
+
+namespace {
+
+double NowMs() {
+  using namespace std::chrono;
+  return static_cast<double>(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+}
+
+// DISPATCH_MEMORYPRESSURE_* / kern.memorystatus_vm_pressure_level (1, 2, 4) → 0, 1, 2
+int KernelLevel(unsigned long flags) {
+  if (flags & DISPATCH_MEMORYPRESSURE_CRITICAL) return 2;
+  if (flags & DISPATCH_MEMORYPRESSURE_WARN) return 1;
+  return 0;
+}
+
+double Rate(uint64_t current, uint64_t previous, uint64_t page_size, double seconds) {
+  if (seconds <= 0 || current < previous) return 0;
+  return static_cast<double>(current - previous) * static_cast<double>(page_size) / seconds;
+}
+
+void Noop(void*) {}
+
+}  // namespace
+
+MemoryPressureMonitor& MemoryPressureMonitor::Instance() {
+  static MemoryPressureMonitor instance;
+  return instance;
+}
+
+bool MemoryPressureMonitor::Start(const MemoryPressureOptions& options, Callback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  options_ = options;
+  callback_ = std::move(callback);
+  if (running_.load(std::memory_order_acquire)) {
+    dispatch_source_set_timer(static_cast<dispatch_source_t>(timer_source_), dispatch_time(DISPATCH_TIME_NOW, 0),
+                              static_cast<uint64_t>(options_.interval_ms) * NSEC_PER_MSEC, NSEC_PER_MSEC * 50);
+    return true;
+  }
+
+  dispatch_queue_t queue = dispatch_queue_create("llm.memory-pressure", DISPATCH_QUEUE_SERIAL);
+  dispatch_source_t pressure = dispatch_source_create(
+      DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+      DISPATCH_MEMORYPRESSURE_NORMAL | DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL, queue);
+  dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
+  if (queue == nullptr || pressure == nullptr || timer == nullptr) {
+    if (pressure != nullptr) dispatch_release(pressure);
+    if (timer != nullptr) dispatch_release(timer);
+    if (queue != nullptr) dispatch_release(queue);
+    return false;
+  }
+
+  // 시작 단계는 sysctl 로 (dispatch source 는 변화가 있을 때만 알림)
+  int sysctl_level = 0;
+  size_t len = sizeof(sysctl_level);
+  if (sysctlbyname("kern.memorystatus_vm_pressure_level", &sysctl_level, &len, nullptr, 0) == 0) {
+    kernel_level_ = KernelLevel(static_cast<unsigned long>(sysctl_level));
+  }
+  level_ = 0;
+  calm_samples_ = 0;
+  have_previous_ = false;
+
+  dispatch_set_context(pressure, this);
+  dispatch_source_set_event_handler_f(pressure, &MemoryPressureMonitor::OnKernelEvent);
+  dispatch_set_context(timer, this);
+  dispatch_source_set_event_handler_f(timer, &MemoryPressureMonitor::OnTimer);
+  dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, 0),
+                            static_cast<uint64_t>(options_.interval_ms) * NSEC_PER_MSEC, NSEC_PER_MSEC * 50);
+
+  queue_ = queue;
+  pressure_source_ = pressure;
+  timer_source_ = timer;
+  running_.store(true, std::memory_order_release);
+  dispatch_resume(pressure);
+  dispatch_resume(timer);
+  return true;
+}
+
+void MemoryPressureMonitor::Stop() {
+  dispatch_queue_t queue;
+  dispatch_source_t pressure;
+  dispatch_source_t timer;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_.load(std::memory_order_acquire)) return;
+    running_.store(false, std::memory_order_release);
+    queue = static_cast<dispatch_queue_t>(queue_);
+    pressure = static_cast<dispatch_source_t>(pressure_source_);
+    timer = static_cast<dispatch_source_t>(timer_source_);
+    callback_ = nullptr;
+  }
+  dispatch_source_cancel(pressure);
+  dispatch_source_cancel(timer);
+  // 직렬 큐: 실행 중인 핸들러가 끝날 때까지 대기 (콜백 안에서 Stop 을 부르면 안 됨)
+  dispatch_sync_f(queue, nullptr, &Noop);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_ = pressure_source_ = timer_source_ = nullptr;
+  }
+  dispatch_release(pressure);
+  dispatch_release(timer);
+  dispatch_release(queue);
+}
+
+MemoryPressureEvent MemoryPressureMonitor::Latest() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return latest_;
+}
+
+void MemoryPressureMonitor::OnKernelEvent(void* context) {
+  auto* self = static_cast<MemoryPressureMonitor*>(context);
+  dispatch_source_t source = static_cast<dispatch_source_t>(self->pressure_source_);
+  if (source == nullptr) return;
+  self->kernel_level_ = KernelLevel(dispatch_source_get_data(source));
+  self->Sample("kernel");
+}
+
+void MemoryPressureMonitor::OnTimer(void* context) {
+  static_cast<MemoryPressureMonitor*>(context)->Sample(nullptr);
+}
+
+// 큐 스레드에서만 실행 (previous_* / level_ 은 락 없이 사용)
+void MemoryPressureMonitor::Sample(const char* trigger) {
+  MemoryStats mem;
+  if (!QueryMemoryStats(&mem)) return;
+  MemoryPressureOptions options;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    options = options_;
+  }
+
+  const double now = NowMs();
+  MemoryPressureEvent event;
+  event.timestamp_ms = now;
+  event.kernel_level = kernel_level_;
+  event.total = mem.total;
+  event.free = mem.free;
+  event.compressed = mem.compressed;
+  event.swap_used = mem.swap_used;
+  // 커널 알림이 타이머 직후에 오면 구간이 너무 짧으므로 직전 변화율을 그대로 사용
+  if (have_previous_ && now - previous_ms_ < options.interval_ms / 2.0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    event.swapin_bytes_per_sec = latest_.swapin_bytes_per_sec;
+    event.swapout_bytes_per_sec = latest_.swapout_bytes_per_sec;
+    event.compress_bytes_per_sec = latest_.compress_bytes_per_sec;
+    event.decompress_bytes_per_sec = latest_.decompress_bytes_per_sec;
+  } else {
+    if (have_previous_) {
+      const double seconds = (now - previous_ms_) / 1000.0;
+      event.swapin_bytes_per_sec = Rate(mem.swapins, previous_swapins_, mem.page_size, seconds);
+      event.swapout_bytes_per_sec = Rate(mem.swapouts, previous_swapouts_, mem.page_size, seconds);
+      event.compress_bytes_per_sec = Rate(mem.compressions, previous_compressions_, mem.page_size, seconds);
+      event.decompress_bytes_per_sec = Rate(mem.decompressions, previous_decompressions_, mem.page_size, seconds);
+    }
+    have_previous_ = true;
+    previous_ms_ = now;
+    previous_swapins_ = mem.swapins;
+    previous_swapouts_ = mem.swapouts;
+    previous_compressions_ = mem.compressions;
+    previous_decompressions_ = mem.decompressions;
+  }
+
+  int level = kernel_level_;
+  std::string reason = level > 0 ? "kernel" : "";
+  if (event.swapout_bytes_per_sec >= options.swapout_critical_bytes_per_sec && level < 2) {
+    level = 2;
+    reason = "swap";
+  } else if (event.compress_bytes_per_sec >= options.compress_warn_bytes_per_sec && level < 1) {
+    level = 1;
+    reason = "compressor";
+  }
+
+  // 올라갈 때는 즉시, 내려갈 때는 recovery_samples 번 연속 낮을 때
+  bool changed = false;
+  if (level > level_) {
+    level_ = level;
+    calm_samples_ = 0;
+    changed = true;
+  } else if (level < level_) {
+    if (++calm_samples_ >= options.recovery_samples || trigger != nullptr) {
+      level_ = level;
+      calm_samples_ = 0;
+      changed = true;
+      if (reason.empty()) reason = "recovered";
+    }
+  } else {
+    calm_samples_ = 0;
+  }
+  event.level = level_;
+  event.reason = reason.empty() ? (trigger != nullptr ? trigger : "") : reason;
+
+  Callback callback;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    latest_ = event;
+    if (changed || trigger != nullptr) callback = callback_;
+  }
+  if (callback) callback(event);
+}
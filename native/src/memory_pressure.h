@@ -0,0 +1,78 @@
+// 통합 메모리 압력 감시 (DISPATCH_SOURCE_TYPE_MEMORYPRESSURE + vm_statistics64 변화율)
+//
+// 커널의 메모리 압력 알림은 이미 스왑이 시작된 뒤에 오는 경우가 많아,
+// 같은 dispatch 큐의 타이머가 interval 마다 vm_statistics64 를 읽어
+// swapout / 압축 속도로 한 단계 먼저 압력을 판단합니다.
+//
+// 단계: 0 normal, 1 warn, 2 critical
+// - 커널 알림 (dispatch source, 또는 kern.memorystatus_vm_pressure_level)
+// - swapout 속도 >= swapout_critical_bytes_per_sec → critical
+// - 압축 속도 >= compress_warn_bytes_per_sec → warn
+// 단계가 바뀔 때 (내려갈 때는 recovery_samples 번 연속 낮은 값이 나온 뒤) 콜백을 호출합니다.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+struct MemoryPressureEvent {
+  double timestamp_ms = 0;
+  int level = 0;              // 0 normal, 1 warn, 2 critical
+  int kernel_level = 0;       // 커널이 보고한 단계 (같은 0/1/2 기준)
+  std::string reason;         // "kernel" | "swap" | "compressor" | "recovered"
+  double swapin_bytes_per_sec = 0;
+  double swapout_bytes_per_sec = 0;
+  double compress_bytes_per_sec = 0;
+  double decompress_bytes_per_sec = 0;
+  uint64_t total = 0;
+  uint64_t free = 0;
+  uint64_t compressed = 0;
+  uint64_t swap_used = 0;
+};
+
+struct MemoryPressureOptions {
+  uint32_t interval_ms = 1000;
+  double swapout_critical_bytes_per_sec = 1.0 * 1024 * 1024;
+  double compress_warn_bytes_per_sec = 64.0 * 1024 * 1024;
+  uint32_t recovery_samples = 5;
+};
+
+class MemoryPressureMonitor {
+ public:
+  using Callback = std::function<void(const MemoryPressureEvent&)>;
+
+  static MemoryPressureMonitor& Instance();
+
+  // 이미 실행 중이면 옵션과 콜백만 교체
+  bool Start(const MemoryPressureOptions& options, Callback callback);
+  void Stop();
+
+  bool running() const { return running_.load(std::memory_order_acquire); }
+  MemoryPressureEvent Latest() const;
+
+ private:
+  MemoryPressureMonitor() = default;
+  static void OnKernelEvent(void* context);
+  static void OnTimer(void* context);
+  void Sample(const char* trigger);
+
+  mutable std::mutex mutex_;
+  std::atomic<bool> running_{false};
+  MemoryPressureOptions options_;
+  Callback callback_;
+  MemoryPressureEvent latest_;
+  void* queue_ = nullptr;          // dispatch_queue_t
+  void* pressure_source_ = nullptr; // dispatch_source_t
+  void* timer_source_ = nullptr;    // dispatch_source_t
+  int kernel_level_ = 0;
+  int level_ = 0;
+  uint32_t calm_samples_ = 0;
+  bool have_previous_ = false;
+  double previous_ms_ = 0;
+  uint64_t previous_swapins_ = 0;
+  uint64_t previous_swapouts_ = 0;
+  uint64_t previous_compressions_ = 0;
+  uint64_t previous_decompressions_ = 0;
+};
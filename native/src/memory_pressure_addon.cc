@@ -0,0 +1,114 @@
+#include <algorithm>
+
+#include "addon.h"
+#include "memory_pressure.h"
+
+namespace {
+
+const char* LevelName(int level) {
+  return level >= 2 ? "critical" : level == 1 ? "warn" : "normal";
+}
+
+Napi::Object EventToObject(Napi::Env env, const MemoryPressureEvent& e) {
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("ts", Napi::Number::New(env, e.timestamp_ms));
+  obj.Set("level", Napi::String::New(env, LevelName(e.level)));
+  obj.Set("kernelLevel", Napi::String::New(env, LevelName(e.kernel_level)));
+  obj.Set("reason", Napi::String::New(env, e.reason));
+  obj.Set("swapinBytesPerSec", Napi::Number::New(env, e.swapin_bytes_per_sec));
+  obj.Set("swapoutBytesPerSec", Napi::Number::New(env, e.swapout_bytes_per_sec));
+  obj.Set("compressBytesPerSec", Napi::Number::New(env, e.compress_bytes_per_sec));
+  obj.Set("decompressBytesPerSec", Napi::Number::New(env, e.decompress_bytes_per_sec));
+  obj.Set("totalBytes", Napi::Number::New(env, static_cast<double>(e.total)));
+  obj.Set("freeBytes", Napi::Number::New(env, static_cast<double>(e.free)));
+  obj.Set("compressedBytes", Napi::Number::New(env, static_cast<double>(e.compressed)));
+  obj.Set("swapUsedBytes", Napi::Number::New(env, static_cast<double>(e.swap_used)));
+  return obj;
+}
+
+// dispatch 큐 → JS 스레드 전달 (이벤트 루프를 붙잡지 않도록 unref)
+Napi::ThreadSafeFunction g_tsfn;
+bool g_tsfn_active = false;
+
+void ReleaseCallback() {
+  if (g_tsfn_active) {
+    g_tsfn.Release();
+    g_tsfn_active = false;
+  }
+}
+
+// startMemoryPressureMonitor(callback, options?) -> { running }
+// options: { intervalMs, swapoutCriticalBytesPerSec, compressWarnBytesPerSec, recoverySamples }
+// callback(event) 는 단계가 바뀔 때와 커널 알림마다 호출
+Napi::Value StartMemoryPressureMonitor(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsFunction()) {
+    Napi::TypeError::New(env, "callback must be a function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  MemoryPressureOptions options;
+  if (info.Length() >= 2 && info[1].IsObject()) {
+    Napi::Object opts = info[1].As<Napi::Object>();
+    if (opts.Get("intervalMs").IsNumber()) {
+      options.interval_ms = std::max<uint32_t>(100, opts.Get("intervalMs").As<Napi::Number>().Uint32Value());
+    }
+    if (opts.Get("swapoutCriticalBytesPerSec").IsNumber()) {
+      options.swapout_critical_bytes_per_sec = opts.Get("swapoutCriticalBytesPerSec").As<Napi::Number>().DoubleValue();
+    }
+    if (opts.Get("compressWarnBytesPerSec").IsNumber()) {
+      options.compress_warn_bytes_per_sec = opts.Get("compressWarnBytesPerSec").As<Napi::Number>().DoubleValue();
+    }
+    if (opts.Get("recoverySamples").IsNumber()) {
+      options.recovery_samples = opts.Get("recoverySamples").As<Napi::Number>().Uint32Value();
+    }
+  }
+
+  MemoryPressureMonitor& monitor = MemoryPressureMonitor::Instance();
+  monitor.Stop();
+  ReleaseCallback();
+  g_tsfn = Napi::ThreadSafeFunction::New(env, info[0].As<Napi::Function>(), "memoryPressure", 0, 1);
+  g_tsfn.Unref(env);
+  g_tsfn_active = true;
+
+  Napi::ThreadSafeFunction tsfn = g_tsfn;
+  const bool started = monitor.Start(options, [tsfn](const MemoryPressureEvent& event) mutable {
+    auto* data = new MemoryPressureEvent(event);
+    napi_status status = tsfn.NonBlockingCall(data, [](Napi::Env env, Napi::Function fn, MemoryPressureEvent* e) {
+      if (env != nullptr) fn.Call({EventToObject(env, *e)});
+      delete e;
+    });
+    if (status != napi_ok) delete data;
+  });
+  if (!started) ReleaseCallback();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("running", Napi::Boolean::New(env, started));
+  return result;
+}
+
+Napi::Value StopMemoryPressureMonitor(const Napi::CallbackInfo& info) {
+  MemoryPressureMonitor::Instance().Stop();
+  ReleaseCallback();
+  return info.Env().Undefined();
+}
+
+// getMemoryPressure() -> 마지막 측정 이벤트 | null (모니터가 꺼져 있으면)
+Napi::Value GetMemoryPressure(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  MemoryPressureMonitor& monitor = MemoryPressureMonitor::Instance();
+  if (!monitor.running()) return env.Null();
+  return EventToObject(env, monitor.Latest());
+}
+
+}  // namespace
+
+void InitMemoryPressure(Napi::Env env, Napi::Object exports) {
+  exports.Set(Napi::String::New(env, "startMemoryPressureMonitor"), Napi::Function::New(env, StartMemoryPressureMonitor));
+  exports.Set(Napi::String::New(env, "stopMemoryPressureMonitor"), Napi::Function::New(env, StopMemoryPressureMonitor));
+  exports.Set(Napi::String::New(env, "getMemoryPressure"), Napi::Function::New(env, GetMemoryPressure));
+  // 프로세스/워커 종료 시 dispatch source 정리
+  env.AddCleanupHook([] {
+    MemoryPressureMonitor::Instance().Stop();
+    ReleaseCallback();
+  });
+}
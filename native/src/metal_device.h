@@ -0,0 +1,26 @@
+// Metal 디바이스 / IOKit GPU 통계 공용 헬퍼
+//
+// MTLCreateSystemDefaultDevice() 는 호출마다 비용이 크므로 프로세스당 한 번만 생성해
+// 캐시하고, 모든 쿼리(getVRAMInfo, 샘플러 스레드 등)가 같은 디바이스를 공유합니다.
+#pragma once
+
+#include <cstdint>
+
+struct VRAMInfo {
+  uint64_t total = 0;  // recommendedMaxWorkingSetSize
+  uint64_t used = 0;   // currentAllocatedSize
+};
+
+// 캐시된 기본 Metal 디바이스에서 VRAM 정보 조회 (디바이스가 없으면 false)
+bool QueryVRAMInfo(VRAMInfo* out);
+
+// IOAccelerator PerformanceStatistics (값이 없는 항목은 -1)
+struct GpuStats {
+  double device_util = -1;    // "Device Utilization %"
+  double renderer_util = -1;  // "Renderer Utilization %"
+  double tiler_util = -1;     // "Tiler Utilization %"
+  double in_use_system_memory = -1;  // "In use system memory" (bytes)
+};
+
+// 지원하지 않는 환경(IOAccelerator 없음)이면 false
+bool QueryGpuStats(GpuStats* out);
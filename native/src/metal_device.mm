@@ -0,0 +1,80 @@
+#include "metal_device.h"
+
+#import <Foundation/Foundation.h>
+#import <IOKit/IOKitLib.h>
+#import <Metal/Metal.h>
+
+#include <mutex>
+
+namespace {
+
+id<MTLDevice> SharedDevice() {
+  static id<MTLDevice> device = nil;
+  static std::once_flag once;
+  std::call_once(once, [] {
+    @autoreleasepool {
+      device = MTLCreateSystemDefaultDevice();  // 프로세스 종료까지 유지
+    }
+  });
+  return device;
+}
+
+// PerformanceStatistics 를 제공하는 첫 번째 IOAccelerator 서비스 (한 번만 탐색)
+io_registry_entry_t SharedAccelerator() {
+  static io_registry_entry_t accelerator = IO_OBJECT_NULL;
+  static std::once_flag once;
+  std::call_once(once, [] {
+    io_iterator_t iterator = IO_OBJECT_NULL;
+    // MACH_PORT_NULL = 기본 main port (kIOMainPortDefault 는 macOS 12+ 전용)
+    if (IOServiceGetMatchingServices(MACH_PORT_NULL, IOServiceMatching("IOAccelerator"), &iterator) != KERN_SUCCESS) {
+      return;
+    }
+    io_registry_entry_t service;
+    while ((service = IOIteratorNext(iterator)) != IO_OBJECT_NULL) {
+      CFTypeRef stats = IORegistryEntryCreateCFProperty(service, CFSTR("PerformanceStatistics"), kCFAllocatorDefault, 0);
+      if (stats != nullptr) {
+        CFRelease(stats);
+        accelerator = service;  // retain 유지
+        break;
+      }
+      IOObjectRelease(service);
+    }
+    IOObjectRelease(iterator);
+  });
+  return accelerator;
+}
+
+bool ReadNumber(CFDictionaryRef dict, CFStringRef key, double* out) {
+  CFTypeRef value = CFDictionaryGetValue(dict, key);
+  if (value == nullptr || CFGetTypeID(value) != CFNumberGetTypeID()) return false;
+  return CFNumberGetValue(static_cast<CFNumberRef>(value), kCFNumberDoubleType, out);
+}
+
+}  // namespace
+
+bool QueryVRAMInfo(VRAMInfo* out) {
+  id<MTLDevice> device = SharedDevice();
+  if (device == nil) return false;
+  out->total = [device recommendedMaxWorkingSetSize];
+  out->used = [device currentAllocatedSize];
+  return true;
+}
+
+bool QueryGpuStats(GpuStats* out) {
+  io_registry_entry_t accelerator = SharedAccelerator();
+  if (accelerator == IO_OBJECT_NULL) return false;
+
+  CFTypeRef stats = IORegistryEntryCreateCFProperty(accelerator, CFSTR("PerformanceStatistics"), kCFAllocatorDefault, 0);
+  if (stats == nullptr) return false;
+
+  bool ok = false;
+  if (CFGetTypeID(stats) == CFDictionaryGetTypeID()) {
+    CFDictionaryRef dict = static_cast<CFDictionaryRef>(stats);
+    ok = ReadNumber(dict, CFSTR("Device Utilization %"), &out->device_util);
+    ReadNumber(dict, CFSTR("Renderer Utilization %"), &out->renderer_util);
+    ReadNumber(dict, CFSTR("Tiler Utilization %"), &out->tiler_util);
+    ReadNumber(dict, CFSTR("In use system memory"), &out->in_use_system_memory);
+  }
+  CFRelease(stats);
+  return ok;
+}
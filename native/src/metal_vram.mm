@@ -1,33 +1,25 @@
 #include <napi.h>
-#import <Metal/Metal.h>
-#import <Foundation/Foundation.h>
+#include "addon.h"
+#include "metal_device.h"
 
 Napi::Object GetVRAMInfo(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
   Napi::Object result = Napi::Object::New(env);
   
-  @autoreleasepool {
-    // Metal 디바이스 가져오기
-    id<MTLDevice> device = MTLCreateSystemDefaultDevice();
-    
-    if (device == nil) {
-      result.Set("error", Napi::String::New(env, "No Metal device found"));
-      result.Set("total", Napi::Number::New(env, 0));
-      result.Set("used", Napi::Number::New(env, 0));
-      return result;
-    }
-    
-    // 권장 최대 작업 세트 크기 (대략적인 VRAM 총량)
-    uint64_t recommendedSize = [device recommendedMaxWorkingSetSize];
-    
-    // 현재 할당된 메모리 크기
-    uint64_t allocatedSize = [device currentAllocatedSize];
-    
-    result.Set("total", Napi::Number::New(env, static_cast<double>(recommendedSize)));
-    result.Set("used", Napi::Number::New(env, static_cast<double>(allocatedSize)));
-    result.Set("error", env.Null());
+  // 캐시된 Metal 디바이스 사용 (호출마다 MTLCreateSystemDefaultDevice() 를 하지 않음)
+  VRAMInfo vram;
+  if (!QueryVRAMInfo(&vram)) {
+    result.Set("error", Napi::String::New(env, "No Metal device found"));
+    result.Set("total", Napi::Number::New(env, 0));
+    result.Set("used", Napi::Number::New(env, 0));
+    return result;
   }
   
+  // 권장 최대 작업 세트 크기 (대략적인 VRAM 총량) / 현재 할당된 메모리 크기
+  result.Set("total", Napi::Number::New(env, static_cast<double>(vram.total)));
+  result.Set("used", Napi::Number::New(env, static_cast<double>(vram.used)));
+  result.Set("error", env.Null());
+  
   return result;
 }
 
@@ -36,6 +28,12 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
     Napi::String::New(env, "getVRAMInfo"),
     Napi::Function::New(env, GetVRAMInfo)
   );
+  InitGgufReader(env, exports);
+  InitVRAMSampler(env, exports);
+  InitSystemCounters(env, exports);
+  InitCpuTopology(env, exports);
+  InitPageCache(env, exports);
+  InitMemoryPressure(env, exports);
   return exports;
 }
 
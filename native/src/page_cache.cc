@@ -0,0 +1,245 @@
+#include "page_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+#ifdef __APPLE__
+using MincoreVec = char*;
+#else
+using MincoreVec = unsigned char*;
+#endif
+
+constexpr uint32_t kMaxThreads = 8;
+constexpr size_t kReadBufferBytes = 1024 * 1024;
+
+// CancelPrewarm 이 올리는 세대 번호 (시작 시점과 다르면 중단)
+std::atomic<uint64_t> g_generation{0};
+
+size_t PageSize() {
+  static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return page;
+}
+
+// 읽기 전용 매핑 (mincore 용, 내용은 건드리지 않음)
+struct MappedFile {
+  std::string path;
+  int fd = -1;
+  uint64_t size = 0;
+  void* base = nullptr;
+  std::string error;
+
+  bool Open(const std::string& file_path) {
+    path = file_path;
+    fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      error = std::strerror(errno);
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      error = std::strerror(errno);
+      return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    if (size == 0) return true;
+    base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      base = nullptr;
+      error = std::strerror(errno);
+      return false;
+    }
+    return true;
+  }
+
+  ~MappedFile() {
+    if (base != nullptr) munmap(base, size);
+    if (fd >= 0) close(fd);
+  }
+
+  // [offset, offset + length) 중 상주 바이트 (offset 은 페이지 경계)
+  uint64_t Resident(uint64_t offset, uint64_t length, std::vector<unsigned char>* vec) const {
+    if (base == nullptr || length == 0) return 0;
+    const size_t page = PageSize();
+    const size_t pages = static_cast<size_t>((length + page - 1) / page);
+    vec->resize(pages);
+    char* start = static_cast<char*>(base) + offset;
+    if (mincore(start, static_cast<size_t>(length), reinterpret_cast<MincoreVec>(vec->data())) != 0) return 0;
+    uint64_t resident = 0;
+    for (size_t i = 0; i < pages; i++) {
+      if ((*vec)[i] & 1) resident += std::min<uint64_t>(page, length - i * page);
+    }
+    return resident;
+  }
+};
+
+struct Chunk {
+  size_t file = 0;
+  uint64_t offset = 0;
+  uint64_t length = 0;
+};
+
+// 비동기 readahead 요청 (F_RDADVISE 는 macOS, 그 외 posix_fadvise; 실패하면 madvise)
+void AdviseRead(const MappedFile& file, const Chunk& chunk) {
+  bool advised = false;
+#ifdef F_RDADVISE
+  struct radvisory advice;
+  advice.ra_offset = static_cast<off_t>(chunk.offset);
+  advice.ra_count = static_cast<int>(chunk.length);
+  advised = fcntl(file.fd, F_RDADVISE, &advice) != -1;
+#elif defined(POSIX_FADV_WILLNEED)
+  advised = posix_fadvise(file.fd, static_cast<off_t>(chunk.offset), static_cast<off_t>(chunk.length),
+                          POSIX_FADV_WILLNEED) == 0;
+#endif
+  if (!advised && file.base != nullptr) {
+    madvise(static_cast<char*>(file.base) + chunk.offset, static_cast<size_t>(chunk.length), MADV_WILLNEED);
+  }
+}
+
+// readahead 를 건 뒤 pread 로 끝까지 읽어 페이지 캐시에 올림 (읽은 바이트 반환)
+uint64_t ReadChunk(const MappedFile& file, const Chunk& chunk, std::vector<char>* buffer) {
+  AdviseRead(file, chunk);
+  uint64_t done = 0;
+  while (done < chunk.length) {
+    const size_t want = static_cast<size_t>(std::min<uint64_t>(buffer->size(), chunk.length - done));
+    const ssize_t n = pread(file.fd, buffer->data(), want, static_cast<off_t>(chunk.offset + done));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    done += static_cast<uint64_t>(n);
+  }
+  return done;
+}
+
+uint32_t ThreadCount(const PrewarmOptions& options, size_t chunks) {
+  uint32_t threads = options.threads;
+  if (threads == 0) threads = std::max(1u, std::min(kMaxThreads, std::thread::hardware_concurrency()));
+  return static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(threads, chunks)));
+}
+
+}  // namespace
+
+bool QueryResidentBytes(const std::string& path, FileResidency* out) {
+  MappedFile file;
+  out->path = path;
+  if (!file.Open(path)) {
+    out->error = file.error;
+    return false;
+  }
+  std::vector<unsigned char> vec;
+  out->size = file.size;
+  out->resident = file.Resident(0, file.size, &vec);
+  return true;
+}
+
+PrewarmResult PrewarmFiles(const std::vector<std::string>& paths, const PrewarmOptions& options,
+                           const std::function<void(const PrewarmProgress&)>& on_progress) {
+  const auto started = std::chrono::steady_clock::now();
+  const uint64_t generation = g_generation.load(std::memory_order_acquire);
+  PrewarmResult result;
+
+  std::vector<std::unique_ptr<MappedFile>> files;
+  std::vector<Chunk> chunks;
+  // chunk 크기는 페이지 배수 (mincore 의 시작 주소 정렬), F_RDADVISE 의 ra_count(int) 를 넘지 않게 INT_MAX 이하
+  const uint64_t page = PageSize();
+  const uint64_t max_chunk_bytes = static_cast<uint64_t>(INT_MAX) / page * page;
+  const uint64_t chunk_bytes =
+      std::max<uint64_t>(page, std::min<uint64_t>(options.chunk_bytes, max_chunk_bytes) / page * page);
+  for (const std::string& path : paths) {
+    auto file = std::make_unique<MappedFile>();
+    if (file->Open(path)) {
+      for (uint64_t offset = 0; offset < file->size; offset += chunk_bytes) {
+        chunks.push_back({files.size(), offset, std::min(chunk_bytes, file->size - offset)});
+      }
+      result.progress.total_bytes += file->size;
+    }
+    files.push_back(std::move(file));
+  }
+
+  auto cancelled = [&]() { return g_generation.load(std::memory_order_acquire) != generation; };
+  auto resident_total = [&]() {
+    std::vector<unsigned char> vec;
+    uint64_t resident = 0;
+    for (const auto& file : files) resident += file->Resident(0, file->size, &vec);
+    return resident;
+  };
+
+  std::atomic<size_t> next{0};
+  std::atomic<uint64_t> read_bytes{0};
+  std::atomic<size_t> handled{0};
+  std::atomic<uint32_t> running{0};
+  std::mutex mutex;
+  std::condition_variable finished;
+
+  const uint32_t thread_count = ThreadCount(options, chunks.size());
+  std::vector<std::thread> threads;
+  running.store(chunks.empty() ? 0 : thread_count);
+  for (uint32_t t = 0; t < thread_count && !chunks.empty(); t++) {
+    threads.emplace_back([&]() {
+      std::vector<char> buffer(kReadBufferBytes);
+      std::vector<unsigned char> vec;
+      for (size_t i = next.fetch_add(1); i < chunks.size() && !cancelled(); i = next.fetch_add(1)) {
+        const Chunk& chunk = chunks[i];
+        const MappedFile& file = *files[chunk.file];
+        // 이미 전부 상주 중인 chunk 는 읽지 않음 (두 번째 프리웜은 mincore 비용만 듦)
+        if (file.Resident(chunk.offset, chunk.length, &vec) < chunk.length) {
+          read_bytes.fetch_add(ReadChunk(file, chunk, &buffer), std::memory_order_relaxed);
+        }
+        handled.fetch_add(1, std::memory_order_relaxed);
+      }
+      if (running.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.notify_all();
+      }
+    });
+  }
+
+  // 호출한 스레드는 주기적으로 실제 상주량을 세어 보고
+  const auto interval = std::chrono::milliseconds(std::max<uint32_t>(10, options.progress_interval_ms));
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running.load() > 0) {
+      finished.wait_for(lock, interval, [&]() { return running.load() == 0; });
+      if (on_progress && running.load() > 0) {
+        lock.unlock();
+        PrewarmProgress progress = result.progress;
+        progress.resident_bytes = resident_total();
+        progress.read_bytes = read_bytes.load(std::memory_order_relaxed);
+        on_progress(progress);
+        lock.lock();
+      }
+    }
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  std::vector<unsigned char> vec;
+  for (const auto& file : files) {
+    FileResidency residency;
+    residency.path = file->path;
+    residency.size = file->size;
+    residency.error = file->error;
+    residency.resident = file->Resident(0, file->size, &vec);
+    result.progress.resident_bytes += residency.resident;
+    result.files.push_back(std::move(residency));
+  }
+  result.progress.read_bytes = read_bytes.load();
+  result.cancelled = handled.load() < chunks.size();
+  result.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  if (on_progress) on_progress(result.progress);
+  return result;
+}
+
+void CancelPrewarm() { g_generation.fetch_add(1, std::memory_order_acq_rel); }
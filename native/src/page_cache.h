@@ -0,0 +1,50 @@
+// 모델 파일 페이지 캐시 프리웜과 상주량(mincore) 조회
+//
+// 콜드 스타트에서 llama-server / MLX 는 mmap 한 가중치를 단일 스레드로 순서대로 읽습니다.
+// PrewarmFiles 는 파일들을 chunk 단위로 나눠 여러 스레드가 나눠 가져가고, 각 chunk 에
+// F_RDADVISE(macOS, 그 외 posix_fadvise WILLNEED)로 비동기 readahead 를 건 뒤 pread 로
+// 페이지 캐시에 올립니다. 이미 상주 중인 chunk 는 mincore 로 확인해 건너뜁니다.
+//
+// 진행률은 추정이 아니라 mincore 로 센 실제 상주 바이트입니다 (QueryResidentBytes).
+// CancelPrewarm 은 실행 중인 모든 프리웜을 다음 chunk 경계에서 멈춥니다.
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct FileResidency {
+  std::string path;
+  uint64_t size = 0;
+  uint64_t resident = 0;  // 페이지 캐시에 있는 바이트 (페이지 단위)
+  std::string error;      // 비어 있으면 성공
+};
+
+struct PrewarmOptions {
+  uint32_t threads = 0;                      // 0 이면 논리 코어 수 (최대 8)
+  uint64_t chunk_bytes = 64ull * 1024 * 1024;  // 페이지 배수로 내림, 최대 INT_MAX
+  uint32_t progress_interval_ms = 250;
+};
+
+struct PrewarmProgress {
+  uint64_t total_bytes = 0;
+  uint64_t resident_bytes = 0;  // mincore 기준
+  uint64_t read_bytes = 0;      // 이번 호출에서 실제로 읽은 바이트 (이미 상주한 chunk 제외)
+};
+
+struct PrewarmResult {
+  std::vector<FileResidency> files;  // 종료 시점의 상주량
+  PrewarmProgress progress;
+  double elapsed_ms = 0;
+  bool cancelled = false;
+};
+
+// 파일 하나의 상주량 (mmap + mincore, 파일 내용은 읽지 않음)
+bool QueryResidentBytes(const std::string& path, FileResidency* out);
+
+// on_progress 는 progress_interval_ms 마다 호출한 스레드에서 불립니다 (nullptr 가능)
+PrewarmResult PrewarmFiles(const std::vector<std::string>& paths, const PrewarmOptions& options,
+                           const std::function<void(const PrewarmProgress&)>& on_progress);
+
+void CancelPrewarm();
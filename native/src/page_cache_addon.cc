@@ -0,0 +1,155 @@
+#include <string>
+#include <vector>
+
+#include "addon.h"
+#include "page_cache.h"
+
+namespace {
+
+Napi::Object ResidencyObject(Napi::Env env, const FileResidency& file) {
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("path", Napi::String::New(env, file.path));
+  obj.Set("size", Napi::Number::New(env, static_cast<double>(file.size)));
+  obj.Set("resident", Napi::Number::New(env, static_cast<double>(file.resident)));
+  if (!file.error.empty()) obj.Set("error", Napi::String::New(env, file.error));
+  return obj;
+}
+
+Napi::Object ProgressObject(Napi::Env env, const PrewarmProgress& progress) {
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("totalBytes", Napi::Number::New(env, static_cast<double>(progress.total_bytes)));
+  obj.Set("residentBytes", Napi::Number::New(env, static_cast<double>(progress.resident_bytes)));
+  obj.Set("readBytes", Napi::Number::New(env, static_cast<double>(progress.read_bytes)));
+  return obj;
+}
+
+bool ReadPaths(const Napi::Value& value, std::vector<std::string>* out) {
+  if (value.IsString()) {
+    out->push_back(value.As<Napi::String>().Utf8Value());
+    return true;
+  }
+  if (!value.IsArray()) return false;
+  Napi::Array array = value.As<Napi::Array>();
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    Napi::Value item = array.Get(i);
+    if (!item.IsString()) return false;
+    out->push_back(item.As<Napi::String>().Utf8Value());
+  }
+  return true;
+}
+
+// 읽기 스레드와 mincore 집계는 워커에서, 진행률 콜백과 결과 변환만 메인 스레드에서
+class PrewarmWorker : public Napi::AsyncProgressWorker<PrewarmProgress> {
+ public:
+  PrewarmWorker(Napi::Env env, std::vector<std::string> paths, PrewarmOptions options, Napi::Function on_progress)
+      : Napi::AsyncProgressWorker<PrewarmProgress>(env),
+        paths_(std::move(paths)),
+        options_(options),
+        deferred_(Napi::Promise::Deferred::New(env)) {
+    if (!on_progress.IsEmpty()) on_progress_ = Napi::Persistent(on_progress);
+  }
+
+  Napi::Promise Promise() { return deferred_.Promise(); }
+
+  void Execute(const ExecutionProgress& progress) override {
+    result_ = PrewarmFiles(paths_, options_, [&progress](const PrewarmProgress& p) { progress.Send(&p, 1); });
+  }
+
+  void OnProgress(const PrewarmProgress* data, size_t count) override {
+    if (on_progress_.IsEmpty() || data == nullptr || count == 0) return;
+    Napi::Env env = Env();
+    Napi::HandleScope scope(env);
+    on_progress_.Call({ProgressObject(env, data[count - 1])});
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    Napi::Object result = ProgressObject(env, result_.progress);
+    result.Set("ok", Napi::Boolean::New(env, true));
+    result.Set("elapsedMs", Napi::Number::New(env, result_.elapsed_ms));
+    result.Set("cancelled", Napi::Boolean::New(env, result_.cancelled));
+    Napi::Array files = Napi::Array::New(env, result_.files.size());
+    for (size_t i = 0; i < result_.files.size(); i++) {
+      files.Set(static_cast<uint32_t>(i), ResidencyObject(env, result_.files[i]));
+    }
+    result.Set("files", files);
+    deferred_.Resolve(result);
+  }
+
+  void OnError(const Napi::Error& error) override { deferred_.Reject(error.Value()); }
+
+ private:
+  std::vector<std::string> paths_;
+  PrewarmOptions options_;
+  Napi::Promise::Deferred deferred_;
+  Napi::FunctionReference on_progress_;
+  PrewarmResult result_;
+};
+
+// prewarmFiles(paths, options?, onProgress?) -> Promise<{ ok, totalBytes, residentBytes, readBytes, elapsedMs, cancelled, files }>
+// options: { threads, chunkBytes, progressIntervalMs }
+Napi::Value PrewarmFilesJs(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::vector<std::string> paths;
+  if (info.Length() < 1 || !ReadPaths(info[0], &paths)) {
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    deferred.Reject(Napi::TypeError::New(env, "paths must be a string or an array of strings").Value());
+    return deferred.Promise();
+  }
+  PrewarmOptions options;
+  if (info.Length() >= 2 && info[1].IsObject()) {
+    Napi::Object opts = info[1].As<Napi::Object>();
+    if (opts.Get("threads").IsNumber()) options.threads = opts.Get("threads").As<Napi::Number>().Uint32Value();
+    if (opts.Get("chunkBytes").IsNumber()) {
+      options.chunk_bytes = static_cast<uint64_t>(opts.Get("chunkBytes").As<Napi::Number>().DoubleValue());
+    }
+    if (opts.Get("progressIntervalMs").IsNumber()) {
+      options.progress_interval_ms = opts.Get("progressIntervalMs").As<Napi::Number>().Uint32Value();
+    }
+  }
+  Napi::Function on_progress;
+  if (info.Length() >= 3 && info[2].IsFunction()) on_progress = info[2].As<Napi::Function>();
+  auto* worker = new PrewarmWorker(env, std::move(paths), options, on_progress);
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+// getResidentBytes(paths) -> { totalBytes, residentBytes, files: [{ path, size, resident, error? }] }
+Napi::Value GetResidentBytes(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::vector<std::string> paths;
+  if (info.Length() < 1 || !ReadPaths(info[0], &paths)) {
+    Napi::TypeError::New(env, "paths must be a string or an array of strings").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  uint64_t total = 0;
+  uint64_t resident = 0;
+  Napi::Array files = Napi::Array::New(env, paths.size());
+  for (size_t i = 0; i < paths.size(); i++) {
+    FileResidency file;
+    QueryResidentBytes(paths[i], &file);
+    total += file.size;
+    resident += file.resident;
+    files.Set(static_cast<uint32_t>(i), ResidencyObject(env, file));
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("totalBytes", Napi::Number::New(env, static_cast<double>(total)));
+  result.Set("residentBytes", Napi::Number::New(env, static_cast<double>(resident)));
+  result.Set("files", files);
+  return result;
+}
+
+// cancelPrewarm(): 실행 중인 모든 프리웜을 다음 chunk 에서 멈춤
+Napi::Value CancelPrewarmJs(const Napi::CallbackInfo& info) {
+  CancelPrewarm();
+  return info.Env().Undefined();
+}
+
+}  // namespace
+
+void InitPageCache(Napi::Env env, Napi::Object exports) {
+  exports.Set(Napi::String::New(env, "prewarmFiles"), Napi::Function::New(env, PrewarmFilesJs));
+  exports.Set(Napi::String::New(env, "getResidentBytes"), Napi::Function::New(env, GetResidentBytes));
+  exports.Set(Napi::String::New(env, "cancelPrewarm"), Napi::Function::New(env, CancelPrewarmJs));
+}
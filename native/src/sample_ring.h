@@ -0,0 +1,81 @@
+// 고정 크기 lock-free 링 버퍼 (단일 생산자 / 다중 소비자)
+//
+// 생산자(샘플러 스레드)는 락 없이 슬롯을 덮어쓰고, 소비자(JS 스레드)는 슬롯별
+// seqlock 으로 쓰는 도중이거나 덮어써진 슬롯을 건너뜁니다. 필드는 모두 atomic 이라
+// 동시 접근이 data race 가 되지 않습니다.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+template <typename Sample, size_t Capacity>
+class SampleRing {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+ public:
+  // 생산자 전용 (동시에 하나의 스레드에서만 호출)
+  void Push(const Sample& sample) {
+    const uint64_t index = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[index & (Capacity - 1)];
+    slot.seq.store(index * 2 + 1, std::memory_order_relaxed);  // 홀수 = 쓰는 중
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.value.Store(sample);
+    slot.seq.store(index * 2 + 2, std::memory_order_release);
+    head_.store(index + 1, std::memory_order_release);
+  }
+
+  // pred(sample) 가 true 인 샘플을 오래된 순서로 out 에 추가. 반환값은 추가된 개수
+  template <typename Pred>
+  size_t Snapshot(std::vector<Sample>* out, Pred pred) const {
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t begin = head > Capacity ? head - Capacity : 0;
+    size_t added = 0;
+    for (uint64_t index = begin; index < head; index++) {
+      const Slot& slot = slots_[index & (Capacity - 1)];
+      const uint64_t before = slot.seq.load(std::memory_order_acquire);
+      if (before != index * 2 + 2) continue;  // 쓰는 중이거나 이미 덮어써짐
+      Sample sample = slot.value.Load();
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) != before) continue;
+      if (pred(sample)) {
+        out->push_back(sample);
+        added++;
+      }
+    }
+    return added;
+  }
+
+  bool Latest(Sample* out) const {
+    for (int attempt = 0; attempt < 4; attempt++) {
+      const uint64_t head = head_.load(std::memory_order_acquire);
+      if (head == 0) return false;
+      const uint64_t index = head - 1;
+      const Slot& slot = slots_[index & (Capacity - 1)];
+      const uint64_t before = slot.seq.load(std::memory_order_acquire);
+      if (before != index * 2 + 2) continue;
+      Sample sample = slot.value.Load();
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) == before) {
+        *out = sample;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint64_t size() const {
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    return head > Capacity ? Capacity : head;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> seq{0};
+    typename Sample::Atomic value;
+  };
+
+  Slot slots_[Capacity];
+  std::atomic<uint64_t> head_{0};
+};
@@ -0,0 +1,152 @@
+#include "system_counters.h"
+
+#include <libproc.h>
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <sys/sysctl.h>
+
+#include <chrono>
+#include <iterator>
+
+namespace {
+
+mach_port_t HostPort() {
+  static const mach_port_t port = mach_host_self();  // 호출마다 send right 가 늘지 않도록 캐시
+  return port;
+}
+
+double MachTicksToSeconds(uint64_t ticks) {
+  static mach_timebase_info_data_t timebase = [] {
+    mach_timebase_info_data_t tb{};
+    mach_timebase_info(&tb);
+    return tb;
+  }();
+  return static_cast<double>(ticks) * timebase.numer / timebase.denom / 1e9;
+}
+
+double NowSeconds() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t LogicalCpuCount() {
+  static const uint32_t count = [] {
+    int ncpu = 0;
+    size_t len = sizeof(ncpu);
+    if (sysctlbyname("hw.logicalcpu", &ncpu, &len, nullptr, 0) != 0 || ncpu <= 0) ncpu = 1;
+    return static_cast<uint32_t>(ncpu);
+  }();
+  return count;
+}
+
+}  // namespace
+
+bool CpuSampler::QueryHostCpuLoad(HostCpuLoad* out) {
+  natural_t ncpu = 0;
+  processor_info_array_t info = nullptr;
+  mach_msg_type_number_t count = 0;
+  if (host_processor_info(HostPort(), PROCESSOR_CPU_LOAD_INFO, &ncpu, &info, &count) != KERN_SUCCESS) {
+    return false;
+  }
+  const auto* load = reinterpret_cast<processor_cpu_load_info_t>(info);
+
+  std::vector<CoreTicks> cores(ncpu);
+  for (natural_t i = 0; i < ncpu; i++) {
+    const unsigned int* ticks = load[i].cpu_ticks;
+    cores[i].busy = static_cast<uint64_t>(ticks[CPU_STATE_USER]) + ticks[CPU_STATE_SYSTEM] + ticks[CPU_STATE_NICE];
+    cores[i].total = cores[i].busy + ticks[CPU_STATE_IDLE];
+  }
+  vm_deallocate(mach_task_self(), reinterpret_cast<vm_address_t>(info), count * sizeof(integer_t));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  out->cores = ncpu;
+  out->per_core.assign(ncpu, -1);
+  out->usage = -1;
+  if (prev_cores_.size() == cores.size()) {
+    uint64_t busy_sum = 0;
+    uint64_t total_sum = 0;
+    for (natural_t i = 0; i < ncpu; i++) {
+      const uint64_t busy = cores[i].busy - prev_cores_[i].busy;
+      const uint64_t total = cores[i].total - prev_cores_[i].total;
+      out->per_core[i] = total > 0 ? 100.0 * busy / total : 0;
+      busy_sum += busy;
+      total_sum += total;
+    }
+    out->usage = total_sum > 0 ? 100.0 * busy_sum / total_sum : 0;
+  }
+  prev_cores_ = std::move(cores);
+  return true;
+}
+
+bool CpuSampler::QueryProcessCpu(int pid, ProcessCpu* out) {
+  // task_for_pid 는 다른 프로세스에 대해 권한이 필요하므로 libproc 의 rusage 를 사용
+  rusage_info_v2 ri{};
+  if (proc_pid_rusage(pid, RUSAGE_INFO_V2, reinterpret_cast<rusage_info_t*>(&ri)) != 0) {
+    return false;
+  }
+  const double now = NowSeconds();
+  out->pid = pid;
+  out->cpu_seconds = MachTicksToSeconds(ri.ri_user_time + ri.ri_system_time);
+  out->resident_bytes = ri.ri_resident_size;
+  out->footprint_bytes = ri.ri_phys_footprint;
+  out->usage = -1;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = prev_processes_.find(pid);
+  if (it != prev_processes_.end()) {
+    const double dt = now - it->second.wall_seconds;
+    const double dcpu = out->cpu_seconds - it->second.cpu_seconds;
+    if (dt > 0 && dcpu >= 0) {
+      out->usage = 100.0 * dcpu / dt / LogicalCpuCount();
+    }
+  }
+  prev_processes_[pid] = ProcessSample{out->cpu_seconds, now};
+  // 종료된 프로세스(재시작된 서버 등)의 오래된 기준값 정리
+  if (prev_processes_.size() > 64) {
+    for (auto prev = prev_processes_.begin(); prev != prev_processes_.end();) {
+      prev = now - prev->second.wall_seconds > 60 ? prev_processes_.erase(prev) : std::next(prev);
+    }
+  }
+  return true;
+}
+
+bool QueryMemoryStats(MemoryStats* out) {
+  vm_statistics64_data_t vm{};
+  mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
+  if (host_statistics64(HostPort(), HOST_VM_INFO64, reinterpret_cast<host_info64_t>(&vm), &count) != KERN_SUCCESS) {
+    return false;
+  }
+  const uint64_t page = vm_kernel_page_size;
+
+  uint64_t memsize = 0;
+  size_t len = sizeof(memsize);
+  sysctlbyname("hw.memsize", &memsize, &len, nullptr, 0);
+
+  out->total = memsize;
+  out->free = static_cast<uint64_t>(vm.free_count) * page;
+  out->active = static_cast<uint64_t>(vm.active_count) * page;
+  out->inactive = static_cast<uint64_t>(vm.inactive_count) * page;
+  out->wired = static_cast<uint64_t>(vm.wire_count) * page;
+  out->compressed = static_cast<uint64_t>(vm.compressor_page_count) * page;
+  out->app = vm.internal_page_count > vm.purgeable_count
+      ? static_cast<uint64_t>(vm.internal_page_count - vm.purgeable_count) * page
+      : 0;
+  out->swapins = vm.swapins;
+  out->swapouts = vm.swapouts;
+  out->compressions = vm.compressions;
+  out->decompressions = vm.decompressions;
+  out->page_size = page;
+
+  xsw_usage swap{};
+  len = sizeof(swap);
+  if (sysctlbyname("vm.swapusage", &swap, &len, nullptr, 0) == 0) {
+    out->swap_used = swap.xsu_used;
+    out->swap_total = swap.xsu_total;
+  }
+
+  int level = 0;
+  len = sizeof(level);
+  if (sysctlbyname("kern.memorystatus_vm_pressure_level", &level, &len, nullptr, 0) == 0) {
+    out->pressure_level = level;
+  }
+  return true;
+}
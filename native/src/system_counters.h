@@ -0,0 +1,66 @@
+// 호스트/프로세스 CPU 및 통합 메모리 카운터 (Mach / libproc / sysctl)
+//
+// 사용률은 같은 CpuSampler 의 이전 호출 대비 누적 tick/CPU 시간의 차이로 계산합니다. 첫 호출은
+// 기준값만 기록하므로 usage 가 -1 입니다. 기준값은 샘플러마다 따로 두므로, 주기가 다른 호출자
+// (메트릭 tick, 모델 풀 메모리 갱신 등)는 각자의 샘플러를 써야 서로의 구간을 줄이지 않습니다.
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct HostCpuLoad {
+  double usage = -1;              // 전체 코어 평균 (0-100)
+  std::vector<double> per_core;   // 코어별 (0-100)
+  uint32_t cores = 0;
+};
+
+struct ProcessCpu {
+  int pid = 0;
+  double cpu_seconds = 0;  // user + system 누적
+  double usage = -1;       // 전체 코어 대비 (0-100)
+  uint64_t resident_bytes = 0;
+  uint64_t footprint_bytes = 0;  // phys_footprint (Activity Monitor 의 "메모리")
+};
+
+struct MemoryStats {
+  uint64_t total = 0;
+  uint64_t free = 0;
+  uint64_t active = 0;
+  uint64_t inactive = 0;
+  uint64_t wired = 0;
+  uint64_t compressed = 0;  // 압축기가 점유한 물리 메모리
+  uint64_t app = 0;         // internal - purgeable (Activity Monitor 의 "앱 메모리")
+  uint64_t swap_used = 0;
+  uint64_t swap_total = 0;
+  uint64_t swapins = 0;     // 부팅 이후 누적
+  uint64_t swapouts = 0;
+  uint64_t compressions = 0;    // 부팅 이후 누적 (페이지)
+  uint64_t decompressions = 0;
+  uint64_t page_size = 0;
+  int pressure_level = 0;   // kern.memorystatus_vm_pressure_level: 1 normal, 2 warn, 4 critical
+};
+
+// 호출자 하나의 이전 샘플 (스레드 안전: JS 스레드와 샘플러 스레드에서 함께 불러도 됨)
+class CpuSampler {
+ public:
+  bool QueryHostCpuLoad(HostCpuLoad* out);
+  bool QueryProcessCpu(int pid, ProcessCpu* out);
+
+ private:
+  struct CoreTicks {
+    uint64_t busy = 0;
+    uint64_t total = 0;
+  };
+  struct ProcessSample {
+    double cpu_seconds = 0;
+    double wall_seconds = 0;
+  };
+
+  std::mutex mutex_;
+  std::vector<CoreTicks> prev_cores_;
+  std::unordered_map<int, ProcessSample> prev_processes_;
+};
+
+bool QueryMemoryStats(MemoryStats* out);
@@ -0,0 +1,111 @@
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "addon.h"
+#include "metal_device.h"
+#include "system_counters.h"
+
+namespace {
+
+constexpr size_t kMaxConsumers = 16;
+
+// consumer 이름 → CPU 사용률 기준값 (JS 스레드에서만 접근)
+std::map<std::string, std::unique_ptr<CpuSampler>> g_samplers;
+
+CpuSampler* SamplerFor(const std::string& consumer) {
+  auto it = g_samplers.find(consumer);
+  if (it != g_samplers.end()) return it->second.get();
+  if (g_samplers.size() >= kMaxConsumers) return g_samplers.begin()->second.get();
+  return g_samplers.emplace(consumer, std::make_unique<CpuSampler>()).first->second.get();
+}
+
+Napi::Value NumberOrNull(Napi::Env env, double value) {
+  return value >= 0 ? Napi::Number::New(env, value) : env.Null();
+}
+
+// getSystemCounters(pids?: number[], consumer?: string) -> { cpu, processes, gpu, memory }
+// 사용률(usage)은 같은 consumer 의 이전 호출 대비 차이이므로 consumer 별 첫 호출에서는 null
+// (호출 주기가 다른 곳끼리 기준값을 공유하면 서로의 측정 구간이 짧아짐)
+Napi::Value GetSystemCounters(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::Object result = Napi::Object::New(env);
+  CpuSampler* sampler =
+      SamplerFor(info.Length() > 1 && info[1].IsString() ? info[1].As<Napi::String>().Utf8Value() : "default");
+
+  HostCpuLoad cpu;
+  if (sampler->QueryHostCpuLoad(&cpu)) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("usage", NumberOrNull(env, cpu.usage));
+    obj.Set("cores", Napi::Number::New(env, cpu.cores));
+    Napi::Array per_core = Napi::Array::New(env, cpu.per_core.size());
+    for (size_t i = 0; i < cpu.per_core.size(); i++) {
+      per_core.Set(static_cast<uint32_t>(i), NumberOrNull(env, cpu.per_core[i]));
+    }
+    obj.Set("perCore", per_core);
+    result.Set("cpu", obj);
+  } else {
+    result.Set("cpu", env.Null());
+  }
+
+  Napi::Array processes = Napi::Array::New(env);
+  if (info.Length() > 0 && info[0].IsArray()) {
+    Napi::Array pids = info[0].As<Napi::Array>();
+    uint32_t out_index = 0;
+    for (uint32_t i = 0; i < pids.Length(); i++) {
+      Napi::Value pid_value = pids.Get(i);
+      if (!pid_value.IsNumber()) continue;
+      ProcessCpu proc;
+      if (!sampler->QueryProcessCpu(pid_value.As<Napi::Number>().Int32Value(), &proc)) continue;
+      Napi::Object obj = Napi::Object::New(env);
+      obj.Set("pid", Napi::Number::New(env, proc.pid));
+      obj.Set("cpuSeconds", Napi::Number::New(env, proc.cpu_seconds));
+      obj.Set("usage", NumberOrNull(env, proc.usage));
+      obj.Set("residentBytes", Napi::Number::New(env, static_cast<double>(proc.resident_bytes)));
+      obj.Set("footprintBytes", Napi::Number::New(env, static_cast<double>(proc.footprint_bytes)));
+      processes.Set(out_index++, obj);
+    }
+  }
+  result.Set("processes", processes);
+
+  GpuStats gpu;
+  if (QueryGpuStats(&gpu)) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("device", NumberOrNull(env, gpu.device_util));
+    obj.Set("renderer", NumberOrNull(env, gpu.renderer_util));
+    obj.Set("tiler", NumberOrNull(env, gpu.tiler_util));
+    obj.Set("inUseSystemMemory", NumberOrNull(env, gpu.in_use_system_memory));
+    result.Set("gpu", obj);
+  } else {
+    result.Set("gpu", env.Null());
+  }
+
+  MemoryStats mem;
+  if (QueryMemoryStats(&mem)) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("total", Napi::Number::New(env, static_cast<double>(mem.total)));
+    obj.Set("free", Napi::Number::New(env, static_cast<double>(mem.free)));
+    obj.Set("active", Napi::Number::New(env, static_cast<double>(mem.active)));
+    obj.Set("inactive", Napi::Number::New(env, static_cast<double>(mem.inactive)));
+    obj.Set("wired", Napi::Number::New(env, static_cast<double>(mem.wired)));
+    obj.Set("compressed", Napi::Number::New(env, static_cast<double>(mem.compressed)));
+    obj.Set("app", Napi::Number::New(env, static_cast<double>(mem.app)));
+    obj.Set("swapUsed", Napi::Number::New(env, static_cast<double>(mem.swap_used)));
+    obj.Set("swapTotal", Napi::Number::New(env, static_cast<double>(mem.swap_total)));
+    obj.Set("swapins", Napi::Number::New(env, static_cast<double>(mem.swapins)));
+    obj.Set("swapouts", Napi::Number::New(env, static_cast<double>(mem.swapouts)));
+    obj.Set("pressureLevel", Napi::Number::New(env, mem.pressure_level));
+    result.Set("memory", obj);
+  } else {
+    result.Set("memory", env.Null());
+  }
+
+  return result;
+}
+
+}  // namespace
+
+void InitSystemCounters(Napi::Env env, Napi::Object exports) {
+  exports.Set(Napi::String::New(env, "getSystemCounters"), Napi::Function::New(env, GetSystemCounters));
+}
@@ -0,0 +1,78 @@
+// 백그라운드 VRAM/GPU 텔레메트리 샘플러
+//
+// 전용 스레드가 설정된 주기로 캐시된 MTLDevice 와 IOAccelerator 를 조회해
+// lock-free 링 버퍼에 기록합니다. JS 스레드는 락 없이 구간 단위로 읽어갑니다.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sample_ring.h"
+
+struct VRAMSample {
+  double timestamp_ms = 0;  // Unix epoch 기준 ms (JS Date.now() 와 동일 기준)
+  uint64_t total = 0;
+  uint64_t used = 0;
+  double gpu_util = -1;  // Device Utilization %, 지원하지 않으면 -1
+
+  struct Atomic {
+    std::atomic<double> timestamp_ms{0};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> used{0};
+    std::atomic<double> gpu_util{-1};
+
+    void Store(const VRAMSample& s) {
+      timestamp_ms.store(s.timestamp_ms, std::memory_order_relaxed);
+      total.store(s.total, std::memory_order_relaxed);
+      used.store(s.used, std::memory_order_relaxed);
+      gpu_util.store(s.gpu_util, std::memory_order_relaxed);
+    }
+    VRAMSample Load() const {
+      VRAMSample s;
+      s.timestamp_ms = timestamp_ms.load(std::memory_order_relaxed);
+      s.total = total.load(std::memory_order_relaxed);
+      s.used = used.load(std::memory_order_relaxed);
+      s.gpu_util = gpu_util.load(std::memory_order_relaxed);
+      return s;
+    }
+  };
+};
+
+class VRAMSampler {
+ public:
+  static constexpr size_t kCapacity = 2048;
+  static constexpr uint32_t kDefaultIntervalMs = 250;
+  static constexpr uint32_t kMinIntervalMs = 10;
+
+  static VRAMSampler& Instance();
+
+  // 이미 실행 중이면 주기만 변경
+  void Start(uint32_t interval_ms);
+  void Stop();
+
+  bool running() const { return running_.load(std::memory_order_acquire); }
+  uint32_t interval_ms() const { return interval_ms_.load(std::memory_order_relaxed); }
+
+  // timestamp_ms > since_ms 인 샘플을 오래된 순서로 추가
+  size_t SamplesSince(double since_ms, std::vector<VRAMSample>* out) const;
+  bool Latest(VRAMSample* out) const { return ring_.Latest(out); }
+
+  // 현재 값을 즉시 측정 (버퍼에는 기록하지 않음)
+  static bool Measure(VRAMSample* out);
+
+ private:
+  VRAMSampler() = default;
+  void Run();
+
+  SampleRing<VRAMSample, kCapacity> ring_;
+  std::atomic<bool> running_{false};
+  std::atomic<uint32_t> interval_ms_{kDefaultIntervalMs};
+  std::mutex mutex_;  // Start/Stop 과 대기용 (샘플 경로에는 사용하지 않음)
+  std::condition_variable wake_;
+  bool stop_requested_ = false;
+  std::thread thread_;
+};
@@ -0,0 +1,72 @@
+#include "vram_sampler.h"
+
+#import <Foundation/Foundation.h>
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "metal_device.h"
+
+VRAMSampler& VRAMSampler::Instance() {
+  // 정적 소멸 순서 문제(joinable std::thread 소멸)를 피하기 위해 의도적으로 해제하지 않음
+  static VRAMSampler* instance = new VRAMSampler();
+  return *instance;
+}
+
+bool VRAMSampler::Measure(VRAMSample* out) {
+  @autoreleasepool {
+    VRAMInfo vram;
+    if (!QueryVRAMInfo(&vram)) return false;
+    out->timestamp_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    out->total = vram.total;
+    out->used = vram.used;
+    GpuStats gpu;
+    out->gpu_util = QueryGpuStats(&gpu) ? gpu.device_util : -1;
+    return true;
+  }
+}
+
+void VRAMSampler::Start(uint32_t interval_ms) {
+  interval_ms_.store(std::max(interval_ms, kMinIntervalMs), std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (thread_.joinable()) {
+    return;  // 새 주기는 다음 샘플부터 적용
+  }
+  stop_requested_ = false;
+  running_.store(true, std::memory_order_release);
+  thread_ = std::thread(&VRAMSampler::Run, this);
+}
+
+void VRAMSampler::Stop() {
+  std::thread thread;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!thread_.joinable()) return;
+    stop_requested_ = true;
+    thread = std::move(thread_);
+  }
+  wake_.notify_all();
+  thread.join();
+  running_.store(false, std::memory_order_release);
+}
+
+void VRAMSampler::Run() {
+  pthread_setname_np("llm-vram-sampler");
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_requested_) {
+    lock.unlock();
+    VRAMSample sample;
+    if (Measure(&sample)) {
+      ring_.Push(sample);
+    }
+    lock.lock();
+    wake_.wait_for(lock, std::chrono::milliseconds(interval_ms()), [this] { return stop_requested_; });
+  }
+}
+
+size_t VRAMSampler::SamplesSince(double since_ms, std::vector<VRAMSample>* out) const {
+  return ring_.Snapshot(out, [since_ms](const VRAMSample& s) { return s.timestamp_ms > since_ms; });
+}
@@ -0,0 +1,65 @@
+#include <vector>
+
+#include "addon.h"
+#include "vram_sampler.h"
+
+namespace {
+
+Napi::Object SampleToObject(Napi::Env env, const VRAMSample& s) {
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("ts", Napi::Number::New(env, s.timestamp_ms));
+  obj.Set("total", Napi::Number::New(env, static_cast<double>(s.total)));
+  obj.Set("used", Napi::Number::New(env, static_cast<double>(s.used)));
+  obj.Set("gpuUtil", s.gpu_util >= 0 ? Napi::Number::New(env, s.gpu_util) : env.Null());
+  return obj;
+}
+
+// startVRAMSampler(intervalMs?) -> { running, intervalMs }
+Napi::Value StartVRAMSampler(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint32_t interval_ms = VRAMSampler::kDefaultIntervalMs;
+  if (info.Length() > 0 && info[0].IsNumber()) {
+    const double requested = info[0].As<Napi::Number>().DoubleValue();
+    if (requested > 0) interval_ms = static_cast<uint32_t>(requested);
+  }
+  VRAMSampler& sampler = VRAMSampler::Instance();
+  sampler.Start(interval_ms);
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("running", Napi::Boolean::New(env, sampler.running()));
+  result.Set("intervalMs", Napi::Number::New(env, sampler.interval_ms()));
+  return result;
+}
+
+Napi::Value StopVRAMSampler(const Napi::CallbackInfo& info) {
+  VRAMSampler::Instance().Stop();
+  return info.Env().Undefined();
+}
+
+// getVRAMSamples(sinceTs?) -> [{ ts, total, used, gpuUtil }] (ts > sinceTs, 오래된 순)
+Napi::Value GetVRAMSamples(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  double since_ms = 0;
+  if (info.Length() > 0 && info[0].IsNumber()) {
+    since_ms = info[0].As<Napi::Number>().DoubleValue();
+  }
+  std::vector<VRAMSample> samples;
+  samples.reserve(VRAMSampler::kCapacity);
+  VRAMSampler::Instance().SamplesSince(since_ms, &samples);
+
+  Napi::Array result = Napi::Array::New(env, samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    result.Set(static_cast<uint32_t>(i), SampleToObject(env, samples[i]));
+  }
+  return result;
+}
+
+}  // namespace
+
+void InitVRAMSampler(Napi::Env env, Napi::Object exports) {
+  exports.Set(Napi::String::New(env, "startVRAMSampler"), Napi::Function::New(env, StartVRAMSampler));
+  exports.Set(Napi::String::New(env, "stopVRAMSampler"), Napi::Function::New(env, StopVRAMSampler));
+  exports.Set(Napi::String::New(env, "getVRAMSamples"), Napi::Function::New(env, GetVRAMSamples));
+  // 프로세스/워커 종료 시 샘플러 스레드 정리
+  env.AddCleanupHook([] { VRAMSampler::Instance().Stop(); });
+}
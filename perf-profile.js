@@ -0,0 +1,201 @@
+// llama-server 성능 프로필: models-config.json 의 모델별 "performance" → 실행 인자
+//
+// models-config.json 예:
+//   "llama31-banyaa-q4_k_m": {
+//     "contextSize": 8192,
+//     "performance": { "parallel": 4, "kvUnified": true, "threads": "auto", "batchSize": 2048,
+//                      "ubatchSize": 512, "prefillChunkTokens": 512, "flashAttn": "auto", "mlock": true }
+//   }
+// config.json 모델 항목의 "performance" 가 있으면 같은 키를 덮어씁니다.
+//
+// - parallel: 슬롯 수 (--parallel). kvUnified(기본 true)면 슬롯들이 -c 크기의 KV 를 함께 써서
+//   메모리는 단일 슬롯과 같고, 동시 사용자가 없을 때는 한 요청이 컨텍스트 전체를 씁니다.
+// - contBatching: 기본 true (--cont-batching / --no-cont-batching)
+// - threads / threadsBatch: 'auto' 면 성능(P) 코어 수. E 코어에 걸린 스레드가 스텝 전체를 늦추므로
+//   P 코어만 사용합니다 (토폴로지는 native getCpuTopology, 없으면 sysctl hw.perflevel0/1).
+// - batchSize / ubatchSize: -b / -ub (ubatchSize 는 gguf-planner.js 의 compute 버퍼 추정에도 반영)
+// - prefillChunkTokens: 디코드 스텝 사이에 처리할 prefill 토큰 수. 긴 프롬프트가 들어와도 진행 중인
+//   스트림의 토큰 간격(ITL)이 크게 벌어지지 않도록 합니다. llama-server 는 스텝마다 최대 n_batch 개의
+//   프롬프트 토큰을 디코드와 함께 처리하므로 batchSize 가 없을 때 -b 로 전달하고,
+//   MLX 서버에는 MLX_PREFILL_CHUNK_TOKENS 로 전달합니다 (0 이면 프롬프트 전체를 한 번에, 기본 512).
+// - flashAttn: 'auto' | 'on' | 'off' (양자화된 V 캐시는 항상 on)
+// - mlock: 가중치를 RAM 에 고정 (--mlock)
+// - priority: 'normal' | 'medium'(기본) | 'high' | 'realtime' → ggml 워커 스레드 우선순위 (--prio / --prio-batch)
+//
+// 추론 프로세스는 spawn 직후 promoteProcess() 로 백그라운드 QoS 를 해제하고,
+// 보조 서버(auth 등)는 demoteCurrentProcess() 로 백그라운드 QoS 로 내려 P 코어를 양보합니다.
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { execFileSync } = require('child_process');
+
+let nativeAddon = null;
+try {
+  nativeAddon = require('./native');
+} catch (error) {
+  // 빌드되지 않은 환경: sysctl 명령으로 토폴로지 조회, QoS 설정 생략
+}
+
+const MODELS_CONFIG_PATH = path.join(__dirname, 'models-config.json');
+const DEFAULT_PROFILE = {
+  parallel: 1,
+  kvUnified: true,
+  contBatching: true,
+  threads: 'auto',
+  threadsBatch: 'auto',
+  batchSize: null,
+  ubatchSize: null,
+  prefillChunkTokens: null,
+  flashAttn: null,
+  mlock: false,
+  priority: 'medium'
+};
+const PRIORITY_LEVELS = { normal: 0, medium: 1, high: 2, realtime: 3 };
+
+let modelsConfigCache = { path: null, mtimeMs: 0, data: {} };
+let topologyCache = null;
+
+// models-config.json (파일이 바뀌었을 때만 다시 읽음)
+function loadModelsConfig(configPath = MODELS_CONFIG_PATH) {
+  try {
+    const { mtimeMs } = fs.statSync(configPath);
+    if (modelsConfigCache.path !== configPath || modelsConfigCache.mtimeMs !== mtimeMs) {
+      modelsConfigCache = { path: configPath, mtimeMs, data: JSON.parse(fs.readFileSync(configPath, 'utf-8')) };
+    }
+    return modelsConfigCache.data;
+  } catch (error) {
+    if (error.code !== 'ENOENT') console.error('[Perf Profile] Failed to load models-config.json:', error.message);
+    return {};
+  }
+}
+
+// models-config.json 의 키는 모델 이름 (modelPath 의 파일명, .gguf 제외) 또는 모델 ID
+function modelsConfigEntry(modelConfig, modelsConfig) {
+  if (!modelConfig) return null;
+  const name = modelConfig.modelPath ? path.basename(String(modelConfig.modelPath)).replace(/\.gguf$/i, '') : null;
+  for (const key of [modelConfig.modelPath, name, modelConfig.id]) {
+    if (key && modelsConfig[key]) return modelsConfig[key];
+  }
+  return null;
+}
+
+function resolveProfile(modelConfig, configPath) {
+  const entry = modelsConfigEntry(modelConfig, loadModelsConfig(configPath)) || {};
+  return { ...DEFAULT_PROFILE, ...(entry.performance || {}), ...((modelConfig && modelConfig.performance) || {}) };
+}
+
+function sysctlNumber(name) {
+  try {
+    const value = Number(execFileSync('sysctl', ['-n', name], { encoding: 'utf8', stdio: ['ignore', 'pipe', 'ignore'] }).trim());
+    return Number.isFinite(value) && value > 0 ? value : 0;
+  } catch (error) {
+    return 0;
+  }
+}
+
+// { performanceCores, efficiencyCores, logicalCores } (Apple Silicon 이 아니면 전부 P 코어로 취급)
+function cpuTopology() {
+  if (topologyCache) return topologyCache;
+  const native = nativeAddon && nativeAddon.getCpuTopology ? nativeAddon.getCpuTopology() : null;
+  if (native && native.performanceCores > 0) {
+    topologyCache = {
+      performanceCores: native.performanceCores,
+      efficiencyCores: native.efficiencyCores,
+      logicalCores: native.logicalCores
+    };
+    return topologyCache;
+  }
+  const logicalCores = os.cpus().length || 1;
+  let performanceCores = 0;
+  let efficiencyCores = 0;
+  if (process.platform === 'darwin') {
+    performanceCores = sysctlNumber('hw.perflevel0.physicalcpu');
+    efficiencyCores = sysctlNumber('hw.perflevel1.physicalcpu');
+  }
+  if (!performanceCores) {
+    performanceCores = logicalCores;
+    efficiencyCores = 0;
+  }
+  topologyCache = { performanceCores, efficiencyCores, logicalCores };
+  return topologyCache;
+}
+
+function threadCount(value, topology) {
+  if (value === undefined || value === null || value === 'auto') return topology.performanceCores;
+  const n = Number(value);
+  return Number.isFinite(n) && n > 0 ? Math.floor(n) : topology.performanceCores;
+}
+
+// 프로필 → llama-server 인자. existingArgs 에 이미 있는 플래그(계획의 --flash-attn on 등)는 다시 넣지 않음
+function ggufArgs(profile, existingArgs = [], topology = cpuTopology()) {
+  const args = [];
+  const parallel = Math.max(1, Number(profile.parallel) || 1);
+  args.push('--parallel', String(parallel));
+  if (parallel > 1 && profile.kvUnified !== false) args.push('--kv-unified');
+  args.push(profile.contBatching === false ? '--no-cont-batching' : '--cont-batching');
+  args.push('--threads', String(threadCount(profile.threads, topology)));
+  args.push('--threads-batch', String(threadCount(profile.threadsBatch, topology)));
+  const batchSize = profile.batchSize || profile.prefillChunkTokens;
+  if (batchSize) args.push('--batch-size', String(batchSize));
+  // llama-server 는 ubatch 를 batch 이하로 자름 (명시한 값만 전달)
+  if (profile.ubatchSize) args.push('--ubatch-size', String(profile.ubatchSize));
+  if (profile.flashAttn && !existingArgs.includes('--flash-attn')) {
+    args.push('--flash-attn', profile.flashAttn === true ? 'on' : profile.flashAttn === false ? 'off' : String(profile.flashAttn));
+  }
+  if (profile.mlock) args.push('--mlock');
+  const priority = PRIORITY_LEVELS[profile.priority];
+  if (priority) args.push('--prio', String(priority), '--prio-batch', String(priority));
+  return args;
+}
+
+// 프로필 → MLX 서버 환경변수
+function mlxEnv(profile) {
+  const env = {};
+  const chunk = Number(profile.prefillChunkTokens);
+  if (profile.prefillChunkTokens !== null && profile.prefillChunkTokens !== undefined && Number.isFinite(chunk) && chunk >= 0) {
+    env.MLX_PREFILL_CHUNK_TOKENS = String(Math.floor(chunk));
+  }
+  return env;
+}
+
+// 추론 프로세스: 백그라운드 QoS 해제 (UI 가 바쁠 때 E 코어로 밀려나지 않도록)
+function promoteProcess(pid) {
+  if (!nativeAddon || !nativeAddon.setProcessQos || !pid) return false;
+  const result = nativeAddon.setProcessQos(pid, 'user-interactive');
+  if (!result || !result.ok) {
+    console.warn(`[Perf Profile] Failed to set QoS for pid ${pid}: ${result ? result.error : 'unknown'}`);
+    return false;
+  }
+  return true;
+}
+
+// 보조 서버 자신을 백그라운드 QoS 로 (E 코어 + I/O 스로틀)
+function demoteCurrentProcess(label) {
+  if (!nativeAddon || !nativeAddon.setProcessQos) return false;
+  const result = nativeAddon.setProcessQos(process.pid, 'background');
+  if (result && result.ok) console.log(`[Perf Profile] ${label} running at background QoS`);
+  return Boolean(result && result.ok);
+}
+
+function describeProfile(profile, topology = cpuTopology()) {
+  const parallel = Math.max(1, Number(profile.parallel) || 1);
+  return `parallel=${parallel}${parallel > 1 && profile.kvUnified !== false ? ' (unified KV)' : ''} ` +
+    `threads=${threadCount(profile.threads, topology)}/${threadCount(profile.threadsBatch, topology)} ` +
+    `(P ${topology.performanceCores} + E ${topology.efficiencyCores})` +
+    (profile.batchSize ? ` batch=${profile.batchSize}` : '') +
+    (profile.ubatchSize ? ` ubatch=${profile.ubatchSize}` : '') +
+    (profile.prefillChunkTokens ? ` prefillChunk=${profile.prefillChunkTokens}` : '') +
+    (profile.mlock ? ' mlock' : '') +
+    (PRIORITY_LEVELS[profile.priority] ? ` prio=${profile.priority}` : '');
+}
+
+module.exports = {
+  loadModelsConfig,
+  resolveProfile,
+  cpuTopology,
+  ggufArgs,
+  mlxEnv,
+  describeProfile,
+  promoteProcess,
+  demoteCurrentProcess
+};
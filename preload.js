@@ -7,13 +7,32 @@ contextBridge.exposeInMainWorld('electronAPI', {
   
   // Listener for receiving logs from the main process
   onLogMessage: (callback) => ipcRenderer.on('log-message', (_event, value) => callback(value)),
+
+  // Batched log lines { lines, levels, dropped }; acknowledged after the callback so the main process can apply backpressure
+  onLogBatch: (callback) => ipcRenderer.on('log-batch', (_event, batch) => {
+    try {
+      callback(batch);
+    } finally {
+      ipcRenderer.send('log-ack', batch.lastSeq);
+    }
+  }),
+
+  // Recent log lines kept in the main process ring buffer, and pipeline counters (dropped / filtered)
+  getLogHistory: (limit) => ipcRenderer.invoke('get-log-history', limit),
+  getLogStats: () => ipcRenderer.invoke('get-log-stats'),
   
   // Function to remove the listener
-  removeLogListener: () => ipcRenderer.removeAllListeners('log-message'),
+  removeLogListener: () => {
+    ipcRenderer.removeAllListeners('log-message');
+    ipcRenderer.removeAllListeners('log-batch');
+  },
   
   // Get system metrics
   getSystemMetrics: () => ipcRenderer.invoke('get-system-metrics'),
 
+  // VRAM/GPU sample history from the native sampler (samples newer than sinceTs)
+  getVramSamples: (sinceTs) => ipcRenderer.invoke('get-vram-samples', sinceTs),
+
   // Read GGUF metadata (quantization, tensor types, etc.)
   getGgufInfo: (modelPath) => ipcRenderer.invoke('get-gguf-info', modelPath),
   
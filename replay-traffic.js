@@ -0,0 +1,318 @@
+// 트래픽 재생: traffic-recorder.js 가 기록한 트레이스(JSON Lines)를 원래 도착 간격(또는 배율)대로
+// 다시 보내고, 요청별 TTFT / ITL / 전체 시간을 기록값과 비교해 JSON/CSV 로 저장합니다.
+//
+// 사용 예:
+//   node replay-traffic.js --trace traces/traffic-2026-10-14T09-00-00-000Z.jsonl
+//   node replay-traffic.js --trace traces/a.jsonl,traces/b.jsonl --speed 2 --limit 500
+//   node replay-traffic.js --trace traces/a.jsonl --gguf-url http://10.0.0.5:8080 --bypass-cache
+//
+// - 요청은 기록된 경로와 본문 그대로 보냅니다 (GGUF 는 --gguf-url, MLX 는 --mlx-url).
+//   X-User-Id 에 기록된 클라이언트를 넣어 클라이언트별 대기열 한도가 같게 적용됩니다.
+// - prompts: false 로 기록된 요청은 같은 토큰 수(pt, 없으면 est - n_predict)의 합성 프롬프트로 대체합니다.
+// - --speed 2 는 도착 간격을 절반으로 (부하 2배), 0.5 는 두 배로 늘립니다.
+const fs = require('fs');
+const path = require('path');
+const http = require('http');
+const { parseArgs, parseList } = require('./cli-args');
+const { countStreamTokens } = require('./metrics-hub');
+
+const DEFAULTS = {
+  trace: '',
+  ggufUrl: 'http://localhost:8080',
+  mlxUrl: 'http://localhost:8081',
+  speed: 1,
+  start: 0, // 건너뛸 기록 수
+  limit: 0, // 재생할 기록 수 (0 이면 전부)
+  paths: '', // 재생할 경로 (쉼표 구분, 비우면 전부)
+  bypassCache: 'false',
+  label: '',
+  out: path.join(__dirname, 'bench-results'),
+  timeoutMs: 10 * 60 * 1000
+};
+const FILLER = 'The quick brown fox jumps over the lazy dog while the curious cat watches from the old wooden fence. ';
+const CSV_COLUMNS = [
+  'index', 'offsetMs', 'lagMs', 'backend', 'path', 'model', 'client', 'status', 'cache', 'error',
+  'ttftMs', 'recordedTtftMs', 'itlMsP50', 'recordedItlMsP50', 'itlMsP99', 'recordedItlMsP99',
+  'durationMs', 'recordedDurationMs', 'tokens', 'recordedTokens', 'promptTokens', 'predictedTokens', 'synthetic'
+];
+
+function percentile(sorted, p) {
+  if (sorted.length === 0) return null;
+  const index = Math.min(sorted.length - 1, Math.max(0, Math.ceil((p / 100) * sorted.length) - 1));
+  return sorted[index];
+}
+
+function round(value, digits = 1) {
+  return value === null || value === undefined || Number.isNaN(value) ? null : Number(value.toFixed(digits));
+}
+
+// 트레이스 파일들 → 도착 순으로 정렬한 기록 (깨진 줄은 건너뜀)
+function loadTrace(files) {
+  const records = [];
+  let skipped = 0;
+  for (const file of files) {
+    for (const line of fs.readFileSync(file, 'utf-8').split('\n')) {
+      if (!line.trim()) continue;
+      try {
+        const record = JSON.parse(line);
+        if (record.req && record.p && Number.isFinite(record.t)) records.push(record);
+        else skipped++;
+      } catch (error) {
+        skipped++;
+      }
+    }
+  }
+  records.sort((a, b) => a.t - b.t);
+  return { records, skipped };
+}
+
+function postTokenize(baseUrl, content) {
+  return new Promise((resolve) => {
+    const payload = JSON.stringify({ content, add_special: false });
+    const req = http.request(new URL('/tokenize', baseUrl), {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(payload) }
+    }, (res) => {
+      let data = '';
+      res.on('data', (chunk) => { data += chunk; });
+      res.on('end', () => {
+        try {
+          const tokens = JSON.parse(data).tokens;
+          resolve(Array.isArray(tokens) ? tokens.length : null);
+        } catch (error) {
+          resolve(null);
+        }
+      });
+    });
+    req.on('error', () => resolve(null));
+    req.setTimeout(5000, () => req.destroy());
+    req.end(payload);
+  });
+}
+
+// 프롬프트 없이 기록된 요청용 합성 프롬프트 (대상 서버의 /tokenize 로 FILLER 의 토큰 수를 한 번 잼)
+async function makeSynthesizer(baseUrl) {
+  const measured = await postTokenize(baseUrl, FILLER.repeat(8));
+  const perRepeat = measured ? measured / 8 : 22;
+  return (tokens, index) => `[replay ${index}] ${FILLER.repeat(Math.max(1, Math.round(tokens / perRepeat)))}`;
+}
+
+function promptTokensOf(record) {
+  if (record.pt > 0) return record.pt;
+  const predict = Number(record.req.n_predict ?? record.req.max_tokens) || 0;
+  return Math.max(16, (record.est || 0) - Math.max(0, predict));
+}
+
+// 기록 → 보낼 본문 (synthetic: 합성 프롬프트 사용 여부)
+function requestBody(record, index, synthesize) {
+  if (record.pc === undefined) return { body: record.req, synthetic: false };
+  const prompt = synthesize(promptTokensOf(record), index);
+  const body = { ...record.req };
+  if (record.p === '/chat' || record.p.endsWith('/chat/completions')) body.messages = [{ role: 'user', content: prompt }];
+  else if (record.p === '/tokenize') body.content = prompt;
+  else body.prompt = prompt;
+  return { body, synthetic: true };
+}
+
+// 요청 하나 보내고 첫 토큰 / 토큰 간격 / 전체 시간 측정
+function sendRecord(baseUrl, record, body, options) {
+  return new Promise((resolve) => {
+    const payload = JSON.stringify(body);
+    const headers = { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(payload) };
+    if (record.c) headers['X-User-Id'] = record.c;
+    if (record.m) headers['X-Model-Id'] = record.m;
+    if (options.bypassCache === 'true') headers['Cache-Control'] = 'no-cache';
+    const startedAt = performance.now();
+    const result = { status: null, cache: null, error: null, ttftMs: null, gaps: [], tokens: 0, promptTokens: null, predictedTokens: null };
+    let lastAt = 0;
+    let tail = '';
+    const req = http.request(new URL(record.p, baseUrl), { method: 'POST', headers }, (res) => {
+      result.status = res.statusCode;
+      result.cache = res.headers['x-response-cache'] || null;
+      const sse = (res.headers['content-type'] || '').includes('text/event-stream');
+      res.on('data', (chunk) => {
+        const now = performance.now();
+        const text = chunk.toString('utf8');
+        tail = (tail + text).slice(-4096);
+        if (!sse) return;
+        const events = countStreamTokens(text);
+        if (events === 0) return;
+        if (result.ttftMs === null) {
+          result.ttftMs = now - startedAt;
+        } else {
+          const gap = (now - lastAt) / events;
+          for (let k = 0; k < events; k++) result.gaps.push(gap);
+        }
+        result.tokens += events;
+        lastAt = now;
+      });
+      res.on('end', () => {
+        const evaluated = /"tokens_evaluated":\s*(\d+)/.exec(tail);
+        const predicted = /"tokens_predicted":\s*(\d+)/.exec(tail);
+        if (evaluated) result.promptTokens = Number(evaluated[1]);
+        if (predicted) result.predictedTokens = Number(predicted[1]);
+        if (res.statusCode !== 200) result.error = `HTTP ${res.statusCode}`;
+        else if (/data: \{"error"/.test(tail)) result.error = 'stream error';
+        result.durationMs = performance.now() - startedAt;
+        resolve(result);
+      });
+    });
+    req.on('error', (error) => {
+      result.error = error.message;
+      result.durationMs = performance.now() - startedAt;
+      resolve(result);
+    });
+    req.setTimeout(options.timeoutMs, () => req.destroy(new Error('timeout')));
+    req.end(payload);
+  });
+}
+
+function summarize(rows, field) {
+  const values = rows.map(r => r[field]).filter(v => v !== null && v !== undefined).sort((a, b) => a - b);
+  return { p50: round(percentile(values, 50)), p90: round(percentile(values, 90)), p99: round(percentile(values, 99)) };
+}
+
+function toCsv(rows) {
+  const escape = (value) => {
+    if (value === null || value === undefined) return '';
+    const text = String(value);
+    return /[",\n]/.test(text) ? `"${text.replace(/"/g, '""')}"` : text;
+  };
+  return [CSV_COLUMNS.join(','), ...rows.map(row => CSV_COLUMNS.map(c => escape(row[c])).join(','))].join('\n') + '\n';
+}
+
+function printUsage() {
+  console.log(`Usage: node replay-traffic.js --trace FILE[,FILE...] [options]
+  --trace FILES               trace files written by the manager (traces/traffic-*.jsonl)
+  --gguf-url URL              target for GGUF records (default: ${DEFAULTS.ggufUrl})
+  --mlx-url URL               target for MLX records (default: ${DEFAULTS.mlxUrl})
+  --speed X                   inter-arrival scale: 2 = twice the load, 0.5 = half (default: ${DEFAULTS.speed})
+  --start N                   skip the first N records (default: ${DEFAULTS.start})
+  --limit N                   replay at most N records (default: all)
+  --paths /completion,/chat   only replay these paths (default: all)
+  --bypass-cache              send Cache-Control: no-cache (skip the router response cache)
+  --label NAME                run label stored in the report
+  --out DIR                   output directory (default: bench-results/)`);
+}
+
+async function main() {
+  const options = parseArgs(process.argv.slice(2), DEFAULTS);
+  if (options.help || !options.trace) {
+    printUsage();
+    if (!options.help) process.exitCode = 1;
+    return;
+  }
+  const { records: all, skipped } = loadTrace(parseList(options.trace));
+  const paths = parseList(options.paths);
+  let records = all.filter(r => paths.length === 0 || paths.includes(r.p)).slice(options.start);
+  if (options.limit > 0) records = records.slice(0, options.limit);
+  if (records.length === 0) {
+    console.error('[Replay] ❌ No replayable records (requests recorded without a JSON body are skipped)');
+    process.exitCode = 1;
+    return;
+  }
+  const speed = options.speed > 0 ? options.speed : 1;
+  const urlOf = (record) => (record.b === 'mlx' ? options.mlxUrl : options.ggufUrl);
+  const synthesizers = new Map();
+  for (const record of records) {
+    const baseUrl = urlOf(record);
+    if (record.pc !== undefined && !synthesizers.has(baseUrl)) synthesizers.set(baseUrl, await makeSynthesizer(baseUrl));
+  }
+  const spanMs = (records[records.length - 1].t - records[0].t) / speed;
+  console.log(`[Replay] ${records.length} records (${skipped} skipped) over ${(spanMs / 1000).toFixed(1)}s at ${speed}x`);
+
+  const t0 = records[0].t;
+  const startedAt = performance.now();
+  const rows = [];
+  const pending = [];
+  let inFlight = 0;
+  let peakInFlight = 0;
+  for (let index = 0; index < records.length; index++) {
+    const record = records[index];
+    const offsetMs = (record.t - t0) / speed;
+    const wait = offsetMs - (performance.now() - startedAt);
+    if (wait > 0) await new Promise(r => setTimeout(r, wait));
+    const lagMs = Math.max(0, performance.now() - startedAt - offsetMs);
+    const { body, synthetic } = requestBody(record, index, synthesizers.get(urlOf(record)));
+    inFlight++;
+    peakInFlight = Math.max(peakInFlight, inFlight);
+    pending.push(sendRecord(urlOf(record), record, body, options).then((result) => {
+      inFlight--;
+      const gaps = result.gaps.sort((a, b) => a - b);
+      rows[index] = {
+        index,
+        offsetMs: round(offsetMs),
+        lagMs: round(lagMs),
+        backend: record.b,
+        path: record.p,
+        model: record.m,
+        client: record.c,
+        status: result.status,
+        cache: result.cache,
+        error: result.error,
+        ttftMs: round(result.ttftMs),
+        recordedTtftMs: record.ttft ?? null,
+        itlMsP50: round(percentile(gaps, 50), 2),
+        recordedItlMsP50: record.itl ? record.itl[0] : null,
+        itlMsP99: round(percentile(gaps, 99), 2),
+        recordedItlMsP99: record.itl ? record.itl[2] : null,
+        durationMs: round(result.durationMs),
+        recordedDurationMs: record.d ?? null,
+        tokens: result.tokens,
+        recordedTokens: record.n ?? null,
+        promptTokens: result.promptTokens,
+        predictedTokens: result.predictedTokens,
+        synthetic
+      };
+    }));
+  }
+  await Promise.all(pending);
+  const elapsedSec = (performance.now() - startedAt) / 1000;
+
+  const errors = rows.filter(r => r.error);
+  const statuses = {};
+  for (const row of rows) statuses[row.status ?? 'error'] = (statuses[row.status ?? 'error'] || 0) + 1;
+  const summary = {
+    requests: rows.length,
+    errors: errors.length,
+    statuses,
+    cacheHits: rows.filter(r => r.cache === 'hit').length,
+    elapsedSec: round(elapsedSec),
+    peakInFlight,
+    maxLagMs: round(Math.max(...rows.map(r => r.lagMs))),
+    outputTokensPerSec: round(rows.reduce((sum, r) => sum + (r.predictedTokens ?? r.tokens), 0) / Math.max(elapsedSec, 0.001)),
+    ttftMs: summarize(rows, 'ttftMs'),
+    recordedTtftMs: summarize(rows, 'recordedTtftMs'),
+    itlMsP50: summarize(rows, 'itlMsP50'),
+    recordedItlMsP50: summarize(rows, 'recordedItlMsP50'),
+    durationMs: summarize(rows, 'durationMs'),
+    recordedDurationMs: summarize(rows, 'recordedDurationMs')
+  };
+  console.log(`[Replay] ${summary.requests} requests in ${summary.elapsedSec}s, ${summary.errors} errors, ` +
+    `${summary.cacheHits} cache hits, peak ${peakInFlight} in flight, ${summary.outputTokensPerSec} output t/s`);
+  console.log(`[Replay] TTFT p50/p99 ${summary.ttftMs.p50}/${summary.ttftMs.p99}ms (recorded ${summary.recordedTtftMs.p50}/${summary.recordedTtftMs.p99}ms), ` +
+    `duration p50/p99 ${summary.durationMs.p50}/${summary.durationMs.p99}ms (recorded ${summary.recordedDurationMs.p50}/${summary.recordedDurationMs.p99}ms)`);
+  if (errors.length > 0) console.log(`[Replay] First error: #${errors[0].index} ${errors[0].path}: ${errors[0].error}`);
+
+  fs.mkdirSync(options.out, { recursive: true });
+  const stamp = new Date().toISOString().replace(/[:.]/g, '-');
+  const base = path.join(options.out, `replay-${stamp}`);
+  const report = {
+    label: options.label || new Date().toISOString(),
+    createdAt: new Date().toISOString(),
+    options: {
+      trace: parseList(options.trace), speed, start: options.start, limit: options.limit, paths,
+      bypassCache: options.bypassCache === 'true', ggufUrl: options.ggufUrl, mlxUrl: options.mlxUrl
+    },
+    summary,
+    results: rows
+  };
+  fs.writeFileSync(`${base}.json`, JSON.stringify(report, null, 2));
+  fs.writeFileSync(`${base}.csv`, toCsv(rows));
+  console.log(`[Replay] ✅ Results written to ${base}.json and ${base}.csv`);
+}
+
+main().catch((error) => {
+  console.error('[Replay] ❌', error);
+  process.exitCode = 1;
+});
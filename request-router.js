@@ -0,0 +1,508 @@
+// 요청 라우터: 모델 요청을 여러 백엔드(로컬 풀의 llama-server / MLX 서버, 다른 호스트의 worker)로 분산
+//
+// config.json 예:
+//   "workers": [
+//     { "id": "studio-2", "url": "http://10.0.0.12:8080", "format": "gguf", "models": ["llama31-banyaa-q4_k_m"] },
+//     { "id": "studio-2-mlx", "url": "http://10.0.0.12:8081", "format": "mlx", "weight": 2, "capacityTokens": 65536 }
+//   ],
+//   "routing": { "policy": "affinity", "affinitySlackTokens": 4096 }
+//
+// - worker 의 url 은 다른 호스트의 클라이언트 서버 관리자 라우터(8080/8081) 또는 llama-server / MLX 서버.
+//   models 를 생략하면 모든 모델을 받는 것으로 취급합니다. capacityTokens 는 승인 제어(admission-queue.js)가
+//   쓰는 KV 용량이며, 생략하면 제한 없이 보냅니다 (관리자 라우터라면 그쪽 대기열에서 기다림).
+//   (messages 요청의 컨텍스트 맞춤은 로컬 풀에서만 하므로, 원격 GGUF worker 가 messages 를 받으려면 관리자 라우터여야 합니다)
+// - 원격 worker 는 /health 를 주기적으로 확인하고, 연결이 실패하면 다음 확인까지 라우팅에서 뺍니다.
+// - policy 'least-tokens': 처리 중인 토큰 추정치(프롬프트 + n_predict)가 가장 적은 worker
+//   policy 'affinity'(기본): 같은 프롬프트 접두사(시스템 프롬프트 + 첫 턴)는 KV/prefix 캐시가 남아 있는
+//   같은 worker 로 보내되, 그 worker 의 부하가 최소보다 affinitySlackTokens 이상 많으면 least-tokens 로 전환
+// - 라우터끼리 서로를 worker 로 등록해도 돌지 않도록, 전달한 요청에는 X-Router-Hop 헤더를 붙이고
+//   이 헤더가 있는 요청은 로컬 백엔드로만 보냅니다.
+const http = require('http');
+const net = require('net');
+const crypto = require('crypto');
+const path = require('path');
+
+const HOP_HEADER = 'x-router-hop';
+const HEALTH_INTERVAL_MS = 5000;
+const HEALTH_TIMEOUT_MS = 2000;
+const METRICS_TIMEOUT_MS = 3000;
+const DEFAULT_PREDICT_TOKENS = 256;
+const CHARS_PER_TOKEN = 4; // 토큰화 전 추정용
+const PREFIX_CHARS = 512;
+const PREFIX_TOKENS = 128;
+const AFFINITY_MAX_ENTRIES = 4096;
+const DEFAULT_AFFINITY_SLACK_TOKENS = 4096;
+const POLICIES = ['affinity', 'least-tokens'];
+
+// 요청 본문 → 처리할 토큰 수 추정 (프롬프트 + 생성)
+function estimateRequestTokens(json) {
+  if (!json) return DEFAULT_PREDICT_TOKENS;
+  let promptTokens = 0;
+  if (Array.isArray(json.prompt)) {
+    promptTokens = json.prompt.length;
+  } else if (typeof json.prompt === 'string') {
+    promptTokens = Math.ceil(json.prompt.length / CHARS_PER_TOKEN);
+  } else if (Array.isArray(json.messages)) {
+    const chars = json.messages.reduce((sum, m) => sum + String((m && m.content) || '').length, 0);
+    promptTokens = Math.ceil(chars / CHARS_PER_TOKEN);
+  }
+  const predict = Number(json.n_predict ?? json.max_tokens);
+  return promptTokens + (predict > 0 ? predict : DEFAULT_PREDICT_TOKENS);
+}
+
+// 같은 KV 접두사를 공유할 요청끼리 같은 키 (모델 + 시스템 프롬프트 + 첫 턴 / 프롬프트 앞부분)
+function prefixKey(modelKey, json) {
+  if (!json) return null;
+  let prefix = null;
+  if (Array.isArray(json.messages) && json.messages.length > 0) {
+    prefix = json.messages.slice(0, 2).map(m => `${(m && m.role) || ''}:${(m && m.content) || ''}`).join('\u0000');
+  } else if (Array.isArray(json.prompt) && json.prompt.length > 0) {
+    prefix = json.prompt.slice(0, PREFIX_TOKENS).join(',');
+  } else if (typeof json.prompt === 'string' && json.prompt) {
+    prefix = json.prompt.slice(0, PREFIX_CHARS);
+  }
+  if (!prefix) return null;
+  return crypto.createHash('sha1').update(`${modelKey || ''}\u0000${prefix}`).digest('hex');
+}
+
+function servesModel(worker, modelKey) {
+  if (!modelKey || !worker.models || worker.models.length === 0) return true;
+  const key = String(modelKey).trim().replace(/\.gguf$/, '');
+  return worker.models.some(m => {
+    const name = String(m).replace(/\.gguf$/, '');
+    return name === key || path.basename(name) === key;
+  });
+}
+
+class WorkerRegistry {
+  constructor({ log = console.log } = {}) {
+    this.log = log;
+    this.remote = new Map(); // id -> worker
+    this.local = new Map(); // `${format}:${id}` -> worker
+    this.affinity = new Map(); // prefix key -> worker id (LRU)
+    this.policy = 'affinity';
+    this.affinitySlackTokens = DEFAULT_AFFINITY_SLACK_TOKENS;
+    this.affinityHits = 0;
+    this.timer = null;
+  }
+
+  start() {
+    if (this.timer) return;
+    this.timer = setInterval(() => this.checkAll(), HEALTH_INTERVAL_MS);
+    this.timer.unref();
+  }
+
+  stop() {
+    if (this.timer) clearInterval(this.timer);
+    this.timer = null;
+  }
+
+  // config.json 의 workers / routing 적용 (API 로 등록한 worker 는 유지)
+  configure(workers, routing = {}) {
+    if (routing.policy) {
+      if (POLICIES.includes(routing.policy)) this.policy = routing.policy;
+      else this.log(`[Router] ⚠️  Unknown routing policy "${routing.policy}", using ${this.policy}`);
+    }
+    if (routing.affinitySlackTokens >= 0) this.affinitySlackTokens = Number(routing.affinitySlackTokens);
+
+    const ids = new Set();
+    for (const def of Array.isArray(workers) ? workers : []) {
+      const result = this.register(def, 'config');
+      if (result.ok) ids.add(result.worker.id);
+    }
+    for (const worker of [...this.remote.values()]) {
+      if (worker.source === 'config' && !ids.has(worker.id)) this.unregister(worker.id);
+    }
+  }
+
+  // { id, url, format, models, weight } → { ok, worker } | { ok: false, error }
+  register(def, source = 'api') {
+    let parsed;
+    try {
+      parsed = new URL(def && def.url);
+    } catch (error) {
+      return { ok: false, error: `Invalid worker url: ${def && def.url}` };
+    }
+    if (parsed.protocol !== 'http:') return { ok: false, error: `Only http:// workers are supported: ${def.url}` };
+    const format = def.format === 'mlx' ? 'mlx' : 'gguf';
+    const id = String(def.id || `${parsed.host}/${format}`);
+    const existing = this.remote.get(id);
+    const sameTarget = existing && existing.url === parsed.origin && existing.format === format;
+    const worker = sameTarget ? existing : {
+      id,
+      url: parsed.origin,
+      host: parsed.hostname,
+      port: Number(parsed.port) || 80,
+      format,
+      local: false,
+      healthy: false,
+      lastCheck: 0,
+      lastError: null,
+      inFlight: 0,
+      outstandingTokens: 0,
+      requests: 0,
+      failures: 0
+    };
+    worker.models = Array.isArray(def.models) && def.models.length > 0 ? def.models.map(String) : null;
+    worker.weight = Number(def.weight) > 0 ? Number(def.weight) : 1;
+    worker.capacityTokens = Number(def.capacityTokens) > 0 ? Number(def.capacityTokens) : null;
+    worker.source = source;
+    this.remote.set(id, worker);
+    if (!sameTarget) {
+      this.log(`[Router] Registered ${format} worker ${id} (${worker.url})`);
+      this.check(worker);
+    }
+    return { ok: true, worker };
+  }
+
+  unregister(id) {
+    if (!this.remote.delete(id)) return false;
+    for (const [key, workerId] of this.affinity) {
+      if (workerId === id) this.affinity.delete(key);
+    }
+    this.log(`[Router] Removed worker ${id}`);
+    return true;
+  }
+
+  // 로컬 백엔드 (풀 엔트리 / MLX 서버): 상태는 프로세스를 띄운 쪽이 관리하고 부하만 여기서 누적
+  localWorker(format, id, port, models, backend = null) {
+    const key = `${format}:${id}`;
+    let worker = this.local.get(key);
+    if (!worker || worker.port !== port) {
+      worker = {
+        id: `local/${id}`,
+        host: '127.0.0.1',
+        port,
+        url: `http://127.0.0.1:${port}`,
+        format,
+        local: true,
+        healthy: true,
+        weight: 1,
+        inFlight: 0,
+        outstandingTokens: 0,
+        requests: 0,
+        failures: 0
+      };
+      this.local.set(key, worker);
+    }
+    worker.models = models;
+    worker.backend = backend;
+    return worker;
+  }
+
+  // 상태가 정상이고 modelKey 를 서비스하는 원격 worker
+  candidates(format, modelKey) {
+    return [...this.remote.values()].filter(w => w.format === format && w.healthy && servesModel(w, modelKey));
+  }
+
+  pick(candidates, { affinityKey = null } = {}) {
+    if (candidates.length === 0) return null;
+    const load = (w) => w.outstandingTokens / w.weight;
+    // 부하가 같으면 앞쪽(로컬) 우선
+    const least = candidates.reduce((best, w) => (load(w) < load(best) ? w : best), candidates[0]);
+    if (this.policy !== 'affinity' || !affinityKey) return least;
+
+    const sticky = candidates.find(w => w.id === this.affinity.get(affinityKey));
+    const chosen = sticky && load(sticky) - load(least) <= this.affinitySlackTokens ? sticky : least;
+    if (chosen === sticky) this.affinityHits++;
+    this.affinity.delete(affinityKey);
+    this.affinity.set(affinityKey, chosen.id);
+    if (this.affinity.size > AFFINITY_MAX_ENTRIES) {
+      this.affinity.delete(this.affinity.keys().next().value);
+    }
+    return chosen;
+  }
+
+  // 요청 시작: 부하 누적, 반환된 함수로 해제 (여러 번 호출해도 한 번만 반영)
+  begin(worker, tokens) {
+    worker.inFlight++;
+    worker.outstandingTokens += tokens;
+    worker.requests++;
+    let done = false;
+    return () => {
+      if (done) return;
+      done = true;
+      worker.inFlight--;
+      worker.outstandingTokens -= tokens;
+    };
+  }
+
+  // 전달 실패: 원격 worker 는 다음 health check 가 성공할 때까지 제외
+  markDown(worker, error) {
+    worker.failures++;
+    if (worker.local) return;
+    if (worker.healthy) this.log(`[Router] ⚠️  Worker ${worker.id} marked down: ${error.message}`);
+    worker.healthy = false;
+    worker.lastError = error.message;
+  }
+
+  checkAll() {
+    return Promise.all([...this.remote.values()].map(w => this.check(w)));
+  }
+
+  async check(worker) {
+    let healthy = false;
+    let error = null;
+    try {
+      const res = await fetchText(worker, '/health', HEALTH_TIMEOUT_MS);
+      let status = null;
+      try {
+        status = JSON.parse(res.body).status;
+      } catch (parseError) {
+        // 본문이 JSON 이 아니면 상태 코드만 봄
+      }
+      // llama-server 는 로딩 중 503, MLX 서버는 200 + status "loading"
+      healthy = res.statusCode === 200 && status !== 'loading';
+      if (!healthy) error = `health ${res.statusCode}${status ? ` (${status})` : ''}`;
+    } catch (checkError) {
+      error = checkError.message;
+    }
+    if (this.remote.get(worker.id) !== worker) return;
+    if (healthy !== worker.healthy || (!healthy && !worker.lastCheck)) {
+      this.log(healthy ? `[Router] ✅ Worker ${worker.id} is healthy` : `[Router] ⚠️  Worker ${worker.id} is unhealthy: ${error}`);
+    }
+    worker.healthy = healthy;
+    worker.lastError = error;
+    worker.lastCheck = Date.now();
+  }
+
+  stats() {
+    const describe = (w) => ({
+      id: w.id,
+      format: w.format,
+      url: w.url,
+      local: w.local,
+      models: w.models ? w.models.map(m => (typeof m === 'string' ? m : m.id)) : null,
+      weight: w.weight,
+      capacityTokens: w.capacityTokens || null,
+      healthy: w.healthy,
+      lastCheck: w.lastCheck || null,
+      lastError: w.lastError || null,
+      inFlight: w.inFlight,
+      outstandingTokens: w.outstandingTokens,
+      requests: w.requests,
+      failures: w.failures
+    });
+    return {
+      policy: this.policy,
+      affinitySlackTokens: this.affinitySlackTokens,
+      affinityEntries: this.affinity.size,
+      affinityHits: this.affinityHits,
+      workers: [...this.local.values(), ...this.remote.values()].map(describe)
+    };
+  }
+}
+
+function fetchText(worker, pathname, timeoutMs) {
+  return new Promise((resolve, reject) => {
+    const req = http.request({
+      host: worker.host,
+      port: worker.port,
+      method: 'GET',
+      path: pathname,
+      headers: { [HOP_HEADER]: '1' }
+    }, (res) => {
+      let body = '';
+      res.setEncoding('utf8');
+      res.on('data', (chunk) => { body += chunk; });
+      res.on('end', () => resolve({ statusCode: res.statusCode, headers: res.headers, body }));
+      res.on('error', reject);
+    });
+    req.on('error', reject);
+    req.setTimeout(timeoutMs, () => req.destroy(new Error(`GET ${pathname} timeout`)));
+    req.end();
+  });
+}
+
+function upstreamHeaders(worker, headers, bodyLength) {
+  const result = { ...headers, host: `${worker.host}:${worker.port}`, [HOP_HEADER]: '1' };
+  delete result['transfer-encoding'];
+  if (bodyLength !== null) result['content-length'] = bodyLength;
+  return result;
+}
+
+// JSON 오류 응답. 대기열 위치를 보내느라 SSE 헤더가 이미 나갔으면 같은 스트림의 error 이벤트로 보냄
+function sendError(res, statusCode, error, headers = {}) {
+  const payload = { error: { code: statusCode, ...error } };
+  if (res.headersSent) {
+    res.end(`data: ${JSON.stringify(payload)}\n\n`);
+    return;
+  }
+  res.writeHead(statusCode, { 'Content-Type': 'application/json', 'Access-Control-Allow-Origin': '*', ...headers });
+  res.end(JSON.stringify(payload));
+}
+
+// SSE 헤더를 먼저 보낸 요청에 upstream 의 오류 응답(JSON)을 error 이벤트로 전달
+function relayErrorEvent(upstreamRes, res, done) {
+  let text = '';
+  upstreamRes.setEncoding('utf8');
+  upstreamRes.on('data', (chunk) => { text += chunk; });
+  upstreamRes.on('end', () => {
+    let error = null;
+    try {
+      const parsed = JSON.parse(text);
+      error = parsed.error && typeof parsed.error === 'object' ? parsed.error : { message: parsed.detail || parsed.error || text };
+    } catch (parseError) {
+      error = { message: text || `upstream status ${upstreamRes.statusCode}` };
+    }
+    sendError(res, upstreamRes.statusCode, error);
+    done();
+  });
+  upstreamRes.on('error', done);
+}
+
+// body(버퍼)를 worker 로 전달하고 응답을 그대로 스트리밍 (SSE 포함, 버퍼링 없음)
+// 응답 헤더를 받기 전에 연결이 실패하면 reject 하므로 호출한 쪽이 다른 worker 로 재시도할 수 있습니다.
+// res 의 헤더가 이미 나갔으면 (대기열 SSE 이벤트) 상태/헤더 없이 본문만 이어 붙입니다.
+function forwardRequest(worker, req, res, body, { beforePipe = null } = {}) {
+  return new Promise((resolve, reject) => {
+    let responded = false;
+    const upstream = http.request({
+      host: worker.host,
+      port: worker.port,
+      method: req.method,
+      path: req.url,
+      headers: upstreamHeaders(worker, req.headers, body.length)
+    }, (upstreamRes) => {
+      responded = true;
+      if (res.headersSent) {
+        if (upstreamRes.statusCode !== 200) {
+          relayErrorEvent(upstreamRes, res, resolve);
+          return;
+        }
+      } else {
+        res.writeHead(upstreamRes.statusCode, upstreamRes.headers);
+      }
+      if (beforePipe) beforePipe(upstreamRes);
+      upstreamRes.pipe(res);
+      upstreamRes.on('end', resolve);
+      upstreamRes.on('error', resolve);
+    });
+    upstream.on('error', (error) => {
+      if (!responded) {
+        reject(error);
+      } else {
+        res.end();
+        resolve();
+      }
+    });
+    // 클라이언트가 끊으면 upstream 요청도 취소 (백엔드가 생성 중단)
+    res.on('close', () => {
+      if (!res.writableFinished) upstream.destroy();
+      resolve();
+    });
+    upstream.end(body);
+  });
+}
+
+// WebSocket 등 upgrade 요청을 worker 로 연결 (핸드셰이크부터 바이트 그대로 중계)
+// 연결 자체가 실패하면 reject, 연결된 뒤에는 양쪽 중 하나가 닫힐 때 resolve
+function forwardUpgrade(worker, req, socket, head) {
+  return new Promise((resolve, reject) => {
+    const upstream = net.connect(worker.port, worker.host);
+    let connected = false;
+    upstream.once('connect', () => {
+      connected = true;
+      const headers = upstreamHeaders(worker, req.headers, null);
+      const lines = [`${req.method} ${req.url} HTTP/1.1`];
+      for (const [name, value] of Object.entries(headers)) {
+        for (const v of Array.isArray(value) ? value : [value]) lines.push(`${name}: ${v}`);
+      }
+      upstream.write(`${lines.join('\r\n')}\r\n\r\n`);
+      if (head && head.length > 0) upstream.write(head);
+      upstream.pipe(socket);
+      socket.pipe(upstream);
+    });
+    const close = () => {
+      upstream.destroy();
+      socket.destroy();
+      resolve();
+    };
+    upstream.on('error', (error) => {
+      if (!connected) reject(error);
+      else close();
+    });
+    // 한쪽이 끝나면 반대쪽도 닫음 (http 서버 소켓은 half-open 을 허용하므로 end 도 확인)
+    upstream.on('end', () => { if (connected) close(); });
+    upstream.on('close', () => { if (connected) close(); });
+    socket.on('error', close);
+    socket.on('end', close);
+    socket.on('close', close);
+  });
+}
+
+// 여러 worker 의 Prometheus 텍스트 → 하나로 합침
+// 원래 샘플에는 worker / model 레이블을 붙이고, 레이블 없는 원래 이름으로 전체 합계
+// (비율·평균 값인 *ratio* / *_seconds 게이지는 평균)도 함께 내보내 기존 파서가 그대로 읽을 수 있게 합니다.
+function mergePrometheus(sources) {
+  const metrics = new Map(); // name -> { meta: [], samples: [], totals: Map }
+  const metricFor = (name) => {
+    if (!metrics.has(name)) metrics.set(name, { meta: [], samples: [], totals: new Map() });
+    return metrics.get(name);
+  };
+  for (const { labels, text } of sources) {
+    const extra = Object.entries(labels)
+      .filter(([, value]) => value)
+      .map(([key, value]) => `${key}="${String(value).replace(/\\/g, '\\\\').replace(/"/g, '\\"')}"`)
+      .join(',');
+    for (const rawLine of String(text || '').split('\n')) {
+      const line = rawLine.trim();
+      if (!line) continue;
+      if (line.startsWith('#')) {
+        const meta = /^#\s+(HELP|TYPE)\s+(\S+)/.exec(line);
+        if (meta) {
+          const metric = metricFor(meta[2]);
+          if (!metric.meta.some(l => l.startsWith(`# ${meta[1]} `))) metric.meta.push(line);
+        }
+        continue;
+      }
+      const sample = /^([a-zA-Z_:][a-zA-Z0-9_:]*)(\{[^}]*\})?\s+(\S+)/.exec(line);
+      if (!sample) continue;
+      const [, name, rawLabels = '', value] = sample;
+      const metric = metricFor(name);
+      const inner = rawLabels.slice(1, -1);
+      metric.samples.push(`${name}{${[inner, extra].filter(Boolean).join(',')}} ${value}`);
+      const number = Number(value);
+      if (Number.isFinite(number)) {
+        const total = metric.totals.get(rawLabels) || { sum: 0, count: 0 };
+        total.sum += number;
+        total.count++;
+        metric.totals.set(rawLabels, total);
+      }
+    }
+  }
+  const lines = [];
+  for (const [name, metric] of metrics) {
+    lines.push(...metric.meta);
+    const average = /ratio|_seconds$/.test(name);
+    for (const [rawLabels, total] of metric.totals) {
+      lines.push(`${name}${rawLabels} ${average ? total.sum / total.count : total.sum}`);
+    }
+    if (sources.length > 1) lines.push(...metric.samples);
+  }
+  return lines.length > 0 ? `${lines.join('\n')}\n` : '';
+}
+
+// worker 들의 /metrics 를 동시에 수집 → [{ worker, ok, statusCode, body | error }]
+function collectMetrics(workers) {
+  return Promise.all(workers.map(async (worker) => {
+    try {
+      const res = await fetchText(worker, '/metrics', METRICS_TIMEOUT_MS);
+      return { worker, ok: res.statusCode === 200, statusCode: res.statusCode, body: res.body };
+    } catch (error) {
+      return { worker, ok: false, error: error.message };
+    }
+  }));
+}
+
+module.exports = {
+  HOP_HEADER,
+  WorkerRegistry,
+  estimateRequestTokens,
+  prefixKey,
+  sendError,
+  forwardRequest,
+  forwardUpgrade,
+  mergePrometheus,
+  collectMetrics
+};
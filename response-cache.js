@@ -0,0 +1,294 @@
+// 결정적 요청의 응답 캐시 (GGUF 8080 / MLX 8081 라우터)
+//
+// config.json 예:
+//   "responseCache": { "enabled": true, "maxEntries": 1000, "maxMB": 64, "ttlSec": 600, "maxEntryKB": 1024 }
+//
+// - 대상: POST /completion, /chat 중 결과가 정해진 요청만 (temperature <= 0 또는 top_k == 1 의 greedy 디코딩,
+//   또는 seed 를 고정한 GGUF 샘플링 — MLX 서버는 seed 를 읽지 않으므로 MLX 의 seed 요청은 캐시하지 않음). mirostat 요청, 본문의 response_cache: false,
+//   Cache-Control: no-cache / no-store 헤더는 캐시를 건너뜁니다.
+// - 키: 모델 ID + 모델 파일 정체(경로, 크기, 수정 시각 → 가중치 양자화) + KV 캐시 타입 + 엔드포인트 +
+//   프롬프트(토큰 ID 배열, 문자열, 또는 messages 와 컨텍스트 설정) + 나머지 샘플링 파라미터 전체.
+//   라우터는 프롬프트를 토큰화하지 않으므로 토큰화 입력을 키로 씁니다 (같은 모델에서는 같은 토큰 시퀀스).
+// - 저장: 로컬 백엔드가 끝까지 보낸 200 응답만 (SSE 는 stop 이벤트가 있고 오류 이벤트가 없어야 함).
+//   크기(maxEntries / maxMB)와 TTL 을 넘으면 LRU 로 버립니다.
+// - 적중: 승인 대기열과 백엔드를 거치지 않고 저장된 응답을 그대로 돌려줍니다
+//   (SSE 는 같은 이벤트 스트림, X-Response-Cache: hit).
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+
+const DEFAULTS = {
+  enabled: true,
+  maxEntries: 1000,
+  maxMB: 64,
+  ttlSec: 600,
+  maxEntryKB: 1024
+};
+const CACHEABLE_PATHS = new Set(['/completion', '/chat']);
+// 출력에 영향이 없는 필드 (model 은 모델 정체로 대체, trace_id 는 요청마다 다름)
+const IGNORED_FIELDS = new Set(['model', 'cache_prompt', 'id_slot', 'slot_id', 'response_cache', 'trace_id']);
+const RANDOM_SEEDS = new Set([-1, 4294967295]); // llama.cpp 의 "매번 새 시드"
+const QUANT_PATTERN = /(IQ\d_[A-Z0-9]+|Q\d_K(_[SML])?|Q\d_\d|BF16|F16|F32)/i;
+
+// 키 순서와 무관한 JSON (같은 파라미터면 같은 문자열)
+function canonicalJson(value) {
+  if (Array.isArray(value)) return `[${value.map(canonicalJson).join(',')}]`;
+  if (value && typeof value === 'object') {
+    return `{${Object.keys(value).sort().map(k => `${JSON.stringify(k)}:${canonicalJson(value[k])}`).join(',')}}`;
+  }
+  return JSON.stringify(value === undefined ? null : value);
+}
+
+// 결정적이면 'greedy' | 'seeded', 아니면 null (seed 는 llama-server 만 따르므로 'seeded' 는 GGUF 에서만)
+function determinism(json, format) {
+  if (Number(json.mirostat) > 0) return null;
+  const temperature = json.temperature === undefined ? null : Number(json.temperature);
+  if ((temperature !== null && temperature <= 0) || Number(json.top_k) === 1) return 'greedy';
+  const seed = json.seed === undefined ? null : Number(json.seed);
+  if (format === 'gguf' && Number.isInteger(seed) && !RANDOM_SEEDS.has(seed)) return 'seeded';
+  return null;
+}
+
+// 디렉터리(MLX) 또는 파일(GGUF)의 정체 + 양자화 표시
+const identityCache = new Map(); // target → { mtimeMs, size, quantization }
+function fileIdentity(format, target) {
+  let stat;
+  try {
+    stat = fs.statSync(target);
+  } catch (error) {
+    return null;
+  }
+  const cached = identityCache.get(target);
+  if (cached && cached.mtimeMs === stat.mtimeMs && cached.size === stat.size) return cached;
+  let quantization = null;
+  if (format === 'mlx') {
+    try {
+      const config = JSON.parse(fs.readFileSync(path.join(target, 'config.json'), 'utf-8'));
+      const quant = config.quantization || config.quantization_config;
+      quantization = quant && quant.bits ? `${quant.bits}bit` : 'f16';
+    } catch (error) {
+      quantization = 'unknown';
+    }
+  } else {
+    const match = QUANT_PATTERN.exec(path.basename(target));
+    quantization = match ? match[1].toUpperCase() : 'unknown';
+  }
+  const identity = { mtimeMs: stat.mtimeMs, size: stat.size, quantization };
+  identityCache.set(target, identity);
+  return identity;
+}
+
+class ResponseCache {
+  constructor({ log = console.log } = {}) {
+    this.log = log;
+    this.options = { ...DEFAULTS };
+    this.entries = new Map(); // key → entry (삽입 순서 = LRU 순서)
+    this.bytes = 0;
+    this.counters = { hits: 0, misses: 0, bypassed: 0, stores: 0, rejected: 0, evictions: 0, expired: 0, savedTokens: 0 };
+    this.replayMicros = 0; // 적중 응답을 보내는 데 걸린 시간 합계
+  }
+
+  // config.json 의 responseCache 적용
+  configure(options = {}) {
+    const next = { ...DEFAULTS };
+    for (const key of Object.keys(DEFAULTS)) {
+      if (options[key] === undefined) continue;
+      next[key] = typeof DEFAULTS[key] === 'boolean' ? Boolean(options[key]) : Number(options[key]) || DEFAULTS[key];
+    }
+    this.options = next;
+    if (!next.enabled) this.clear();
+    this.evict();
+  }
+
+  // 모델 정체: { id, format, quantization, kvCacheType, key } (모델 파일을 찾을 수 없으면 null)
+  identity(format, modelConfig, target, kvCacheType) {
+    if (!modelConfig || !target) return null;
+    const file = fileIdentity(format, target);
+    if (!file) return null;
+    return {
+      id: modelConfig.id,
+      format,
+      quantization: file.quantization,
+      kvCacheType: kvCacheType || 'auto',
+      key: `${format}|${modelConfig.id}|${target}|${file.size}|${file.mtimeMs}|kv=${kvCacheType || 'auto'}`
+    };
+  }
+
+  // 캐시할 수 있는 요청이면 키, 아니면 null (건너뛴 이유는 bypassed 로 셈)
+  keyFor(req, pathname, json, identity) {
+    if (!this.options.enabled || req.method !== 'POST' || !CACHEABLE_PATHS.has(pathname) || !json) return null;
+    const cacheControl = String(req.headers['cache-control'] || '');
+    const mode = identity ? determinism(json, identity.format) : null;
+    if (json.response_cache === false || /no-cache|no-store/i.test(cacheControl) || !mode) {
+      this.counters.bypassed++;
+      return null;
+    }
+    const material = {};
+    for (const [key, value] of Object.entries(json)) {
+      if (IGNORED_FIELDS.has(key)) continue;
+      // greedy 디코딩에서는 seed 가 결과를 바꾸지 않음
+      if (key === 'seed' && mode === 'greedy') continue;
+      material[key] = value;
+    }
+    return crypto.createHash('sha256')
+      .update(identity.key).update('\u0000')
+      .update(pathname).update('\u0000')
+      .update(canonicalJson(material))
+      .digest('hex');
+  }
+
+  get(key) {
+    const entry = this.entries.get(key);
+    if (!entry) {
+      this.counters.misses++;
+      return null;
+    }
+    if (Date.now() - entry.createdAt > this.options.ttlSec * 1000) {
+      this.delete(key);
+      this.counters.expired++;
+      this.counters.misses++;
+      return null;
+    }
+    // LRU: 최근 사용으로 이동
+    this.entries.delete(key);
+    this.entries.set(key, entry);
+    entry.hits++;
+    this.counters.hits++;
+    this.counters.savedTokens += entry.tokens;
+    return entry;
+  }
+
+  // 저장된 응답 전송 (SSE 도 한 번에 씀: 이벤트 경계는 그대로라 클라이언트는 스트림으로 읽음)
+  replay(entry, res) {
+    const started = process.hrtime.bigint();
+    res.writeHead(entry.status, {
+      'Content-Type': entry.contentType,
+      'Cache-Control': 'no-cache',
+      'Access-Control-Allow-Origin': '*',
+      'Access-Control-Expose-Headers': 'X-Response-Cache, X-Response-Cache-Age',
+      'X-Response-Cache': 'hit',
+      'X-Response-Cache-Age': String(Math.round((Date.now() - entry.createdAt) / 1000))
+    });
+    res.end(entry.body);
+    this.replayMicros += Number(process.hrtime.bigint() - started) / 1000;
+  }
+
+  // res 로 나가는 응답을 기록하기 시작 (승인 후, 로컬 백엔드로 보내기 직전)
+  // 헤더를 이미 보냈으면 (대기열 이벤트를 보낸 스트리밍 요청) 200 SSE 로 봄
+  record(key, res, identity) {
+    const chunks = [];
+    let size = 0;
+    let overflow = false;
+    let status = res.headersSent ? 200 : null;
+    let contentType = res.headersSent ? 'text/event-stream' : null;
+    const limit = this.options.maxEntryKB * 1024;
+    const capture = (chunk, encoding) => {
+      if (overflow || chunk === undefined || chunk === null || typeof chunk === 'function') return;
+      const buffer = Buffer.isBuffer(chunk) ? chunk : Buffer.from(String(chunk), typeof encoding === 'string' ? encoding : 'utf8');
+      size += buffer.length;
+      if (size > limit) {
+        overflow = true;
+        chunks.length = 0;
+        return;
+      }
+      chunks.push(buffer);
+    };
+    const writeHead = res.writeHead;
+    const write = res.write;
+    const end = res.end;
+    res.writeHead = function (statusCode, ...args) {
+      status = statusCode;
+      const headers = args.find(a => a && typeof a === 'object');
+      if (headers) {
+        const name = Object.keys(headers).find(h => h.toLowerCase() === 'content-type');
+        if (name) contentType = String(headers[name]);
+      }
+      return writeHead.call(this, statusCode, ...args);
+    };
+    res.write = function (chunk, encoding, ...rest) {
+      capture(chunk, encoding);
+      return write.call(this, chunk, encoding, ...rest);
+    };
+    res.end = (chunk, encoding, ...rest) => {
+      capture(chunk, encoding);
+      res.writeHead = writeHead;
+      res.write = write;
+      res.end = end;
+      const result = end.call(res, chunk, encoding, ...rest);
+      if (!overflow) this.store(key, status || res.statusCode, contentType || res.getHeader('content-type'), Buffer.concat(chunks), identity);
+      else this.counters.rejected++;
+      return result;
+    };
+  }
+
+  store(key, status, contentType, body, identity) {
+    if (!this.options.enabled) return;
+    const text = body.toString('utf8');
+    const sse = String(contentType || '').includes('text/event-stream');
+    const complete = status === 200 && body.length > 0 &&
+      (!sse || (/"stop":\s*true/.test(text) && !/data: \{"error"/.test(text)));
+    if (!complete) {
+      this.counters.rejected++;
+      return;
+    }
+    const tokens = Number((/"tokens_predicted":\s*(\d+)/.exec(text) || [])[1]) || 0;
+    this.delete(key);
+    this.entries.set(key, {
+      status,
+      contentType: String(contentType || 'application/json'),
+      body,
+      bytes: body.length,
+      tokens,
+      model: identity ? identity.id : null,
+      quantization: identity ? identity.quantization : null,
+      createdAt: Date.now(),
+      hits: 0
+    });
+    this.bytes += body.length;
+    this.counters.stores++;
+    this.evict();
+  }
+
+  delete(key) {
+    const entry = this.entries.get(key);
+    if (!entry) return;
+    this.entries.delete(key);
+    this.bytes -= entry.bytes;
+  }
+
+  evict() {
+    const maxBytes = this.options.maxMB * 1024 * 1024;
+    for (const key of this.entries.keys()) {
+      if (this.entries.size <= this.options.maxEntries && this.bytes <= maxBytes) break;
+      this.delete(key);
+      this.counters.evictions++;
+    }
+  }
+
+  clear() {
+    const count = this.entries.size;
+    this.entries.clear();
+    this.bytes = 0;
+    return count;
+  }
+
+  stats() {
+    const lookups = this.counters.hits + this.counters.misses;
+    const models = {};
+    for (const entry of this.entries.values()) {
+      const id = `${entry.model}${entry.quantization ? ` (${entry.quantization})` : ''}`;
+      models[id] = (models[id] || 0) + 1;
+    }
+    return {
+      ...this.options,
+      entries: this.entries.size,
+      bytes: this.bytes,
+      ...this.counters,
+      hitRate: lookups > 0 ? Number((this.counters.hits / lookups).toFixed(3)) : null,
+      avgReplayMicros: this.counters.hits > 0 ? Math.round(this.replayMicros / this.counters.hits) : null,
+      models
+    };
+  }
+}
+
+module.exports = { ResponseCache, determinism, canonicalJson };
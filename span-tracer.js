@@ -0,0 +1,225 @@
+// 요청 단위 구간(span) 기록과 Chrome trace 내보내기 (GGUF 8080 / MLX 8081 라우터, 관리자 8083)
+//
+// - 대상: trace_id 가 붙은 요청만 (JSON 본문의 "trace_id", X-Trace-Id 헤더, 또는 ?trace_id= — 브라우저
+//   WebSocket 은 헤더를 못 붙이므로 /chat/ws 는 쿼리로). 없으면 NOOP trace 라 비용이 없습니다.
+// - 관리자 구간: 라우팅 / 모델 로드 (llama-server 실행 포함), 응답 캐시 조회, 승인 대기, messages 컨텍스트 맞춤,
+//   upstream 연결 → 첫 바이트 → 첫 토큰 → 끝.
+// - llama-server 내부는 최종 이벤트의 timings (prompt_ms / predicted_ms) 로 prefill / decode 구간을
+//   첫 토큰 시각에 맞춰 세웁니다 (args.derived = true). MLX 서버의 구간은 GET /trace/<id> 로 가져와 합칩니다.
+// - 시각은 모두 epoch 마이크로초 (같은 호스트의 프론트엔드 performance.timeOrigin 기준 시각과 맞음).
+//
+// GET /api/traces            최근 요청 목록과 단계별 ms
+// GET /api/traces/<id>       Chrome trace JSON (chrome://tracing, ui.perfetto.dev 에서 열기)
+// POST /api/traces/<id>      { spans: [...] } 프론트엔드 구간을 함께 넣은 Chrome trace JSON
+const { countStreamTokens } = require('./metrics-hub');
+
+const MAX_TRACES = 200;
+const MAX_SPANS = 256; // 요청당 관리자 구간 상한
+
+// Chrome trace 프로세스 레인
+const LANES = {
+  frontend: { pid: 1, name: 'Frontend (api.js)' },
+  manager: { pid: 2, name: 'Manager (start-client-server.js)' },
+  llama: { pid: 3, name: 'llama-server' },
+  mlx: { pid: 4, name: 'MLX server' },
+  gpu: { pid: 5, name: 'GPU (IOAccelerator)' }
+};
+
+function nowUs() {
+  return Math.round((performance.timeOrigin + performance.now()) * 1000);
+}
+
+function traceIdOf(req, json, query) {
+  const id = (json && json.trace_id) || req.headers['x-trace-id'] || (query && query.trace_id);
+  return id ? String(id).slice(0, 64) : null;
+}
+
+class RequestTrace {
+  constructor(id, meta) {
+    this.id = id;
+    this.meta = meta;
+    this.startedUs = nowUs();
+    this.endedUs = null;
+    this.spans = [];
+    this.stages = {}; // 단계 이름 → 누적 ms
+    this.status = null;
+  }
+
+  span(name, startUs, endUs, args = {}, lane = 'manager') {
+    const dur = Math.max(0, endUs - startUs);
+    this.stages[name] = (this.stages[name] || 0) + dur / 1000;
+    if (this.spans.length < MAX_SPANS) this.spans.push({ name, lane, ts: startUs, dur, args });
+  }
+
+  // 구간 시작 → 끝낼 때 부르는 함수 (추가 args 를 넘길 수 있음)
+  begin(name, args = {}) {
+    const startUs = nowUs();
+    return (extra = {}) => this.span(name, startUs, nowUs(), { ...args, ...extra });
+  }
+
+  mark(name, args = {}) {
+    if (this.spans.length < MAX_SPANS) this.spans.push({ name, lane: 'manager', ts: nowUs(), dur: 0, args, instant: true });
+  }
+
+  // upstream 응답: 첫 바이트 / 첫 토큰 시각, 끝나면 llama-server timings 로 내부 구간 추정
+  observeUpstream(upstreamRes, worker, sentUs) {
+    const headersUs = nowUs();
+    this.span('upstream headers', sentUs, headersUs, { worker: worker.id, status: upstreamRes.statusCode });
+    let firstTokenUs = 0;
+    let lastUs = headersUs;
+    let tail = '';
+    upstreamRes.on('data', (chunk) => {
+      const text = chunk.toString('utf8');
+      lastUs = nowUs();
+      // 첫 토큰: 메트릭과 같은 기준 (내용이 있는 content 이벤트 — 프롬프트 정보 / 빈 이벤트 제외)
+      if (!firstTokenUs && countStreamTokens(text) > 0) {
+        firstTokenUs = lastUs;
+        this.span('upstream first token', headersUs, firstTokenUs, { worker: worker.id });
+      }
+      tail = (tail + text).slice(-8192);
+    });
+    upstreamRes.on('end', () => {
+      this.span('upstream stream', firstTokenUs || headersUs, lastUs, { worker: worker.id });
+      if (worker.format === 'gguf') this.addLlamaTimings(tail, firstTokenUs || lastUs);
+    });
+  }
+
+  addLlamaTimings(tail, firstTokenUs) {
+    const match = /"timings":\s*(\{[^}]*\})/.exec(tail);
+    if (!match) return;
+    let timings;
+    try {
+      timings = JSON.parse(match[1]);
+    } catch (error) {
+      return;
+    }
+    const promptUs = Math.round((Number(timings.prompt_ms) || 0) * 1000);
+    const predictedUs = Math.round((Number(timings.predicted_ms) || 0) * 1000);
+    if (promptUs > 0) {
+      this.span('prefill', firstTokenUs - promptUs, firstTokenUs,
+        { tokens: timings.prompt_n, per_token_ms: timings.prompt_per_token_ms, derived: true }, 'llama');
+    }
+    if (predictedUs > 0) {
+      this.span('decode', firstTokenUs, firstTokenUs + predictedUs,
+        { tokens: timings.predicted_n, per_token_ms: timings.predicted_per_token_ms, derived: true }, 'llama');
+    }
+  }
+
+  finish(status) {
+    if (this.endedUs) return;
+    this.endedUs = nowUs();
+    this.status = status;
+    this.span('request', this.startedUs, this.endedUs, { ...this.meta, status });
+  }
+
+  summary() {
+    return {
+      id: this.id,
+      ...this.meta,
+      status: this.status,
+      startedAt: Math.round(this.startedUs / 1000),
+      durationMs: this.endedUs ? Math.round((this.endedUs - this.startedUs) / 100) / 10 : null,
+      stages: Object.fromEntries(Object.entries(this.stages)
+        .filter(([name]) => name !== 'request')
+        .map(([name, ms]) => [name, Math.round(ms * 100) / 100]))
+    };
+  }
+}
+
+// trace_id 가 없는 요청용: 모든 호출이 아무것도 하지 않음
+const NOOP_TRACE = {
+  id: null,
+  span() {},
+  begin() { return () => {}; },
+  mark() {},
+  observeUpstream() {},
+  finish() {}
+};
+
+class SpanTracer {
+  constructor({ capacity = MAX_TRACES } = {}) {
+    this.capacity = capacity;
+    this.traces = new Map(); // id → RequestTrace (삽입 순서 = 오래된 순)
+    this.byRequest = new WeakMap(); // req → RequestTrace
+  }
+
+  // 요청 본문을 읽은 뒤 호출 (trace_id 가 없으면 NOOP), res / socket 이 닫히면 자동으로 finish
+  begin(req, res, { json = null, query = null, meta = {}, arrivedUs = null } = {}) {
+    const id = traceIdOf(req, json, query);
+    if (!id) return NOOP_TRACE;
+    const trace = new RequestTrace(id, meta);
+    if (arrivedUs) {
+      trace.startedUs = arrivedUs;
+      trace.span('read body', arrivedUs, nowUs(), { bytes: Number(req.headers['content-length']) || 0 });
+    }
+    this.traces.delete(id);
+    this.traces.set(id, trace);
+    for (const key of this.traces.keys()) {
+      if (this.traces.size <= this.capacity) break;
+      this.traces.delete(key);
+    }
+    this.byRequest.set(req, trace);
+    if (res) res.on('close', () => trace.finish(res.statusCode));
+    return trace;
+  }
+
+  of(req) {
+    return this.byRequest.get(req) || NOOP_TRACE;
+  }
+
+  get(id) {
+    return this.traces.get(id) || null;
+  }
+
+  list(limit = 50) {
+    return [...this.traces.values()].slice(-limit).reverse().map(t => t.summary());
+  }
+}
+
+function laneEvents(lane, spans, tid = 1) {
+  const { pid } = LANES[lane];
+  return spans.map(s => s.instant
+    ? { name: s.name, cat: lane, ph: 'i', s: 't', ts: s.ts, pid, tid, args: s.args || {} }
+    : { name: s.name, cat: s.cat || lane, ph: 'X', ts: s.ts, dur: s.dur, pid, tid: s.cat === 'gpu' ? 2 : tid, args: s.args || {} });
+}
+
+// 관리자 trace + (선택) MLX 서버 trace / 프론트엔드 구간 / GPU 사용률 샘플 → Chrome trace JSON
+function chromeTrace({ trace = null, mlx = null, client = [], gpuSamples = [] }) {
+  const events = [];
+  const used = new Set();
+  const add = (lane, list) => {
+    if (list.length === 0) return;
+    used.add(lane);
+    events.push(...list);
+  };
+  add('frontend', laneEvents('frontend', client));
+  if (trace) {
+    add('manager', laneEvents('manager', trace.spans.filter(s => s.lane === 'manager')));
+    add('llama', laneEvents('llama', trace.spans.filter(s => s.lane === 'llama')));
+  }
+  if (mlx && Array.isArray(mlx.spans)) add('mlx', laneEvents('mlx', mlx.spans));
+  add('gpu', gpuSamples.filter(s => s.gpuUtil !== null && s.gpuUtil !== undefined).map(s => ({
+    name: 'GPU utilization', ph: 'C', ts: Math.round(s.ts * 1000), pid: LANES.gpu.pid, tid: 1,
+    args: { percent: s.gpuUtil, usedMB: Math.round(s.used / 1024 / 1024) }
+  })));
+  for (const lane of used) {
+    const { pid, name } = LANES[lane];
+    events.push({ name: 'process_name', ph: 'M', pid, tid: 1, args: { name } });
+    events.push({ name: 'process_sort_index', ph: 'M', pid, tid: 1, args: { sort_index: pid } });
+  }
+  if (used.has('mlx')) {
+    events.push({ name: 'thread_name', ph: 'M', pid: LANES.mlx.pid, tid: 1, args: { name: 'handler / scheduler' } });
+    events.push({ name: 'thread_name', ph: 'M', pid: LANES.mlx.pid, tid: 2, args: { name: 'GPU steps (mx.eval)' } });
+  }
+  return {
+    traceEvents: events,
+    displayTimeUnit: 'ms',
+    metadata: {
+      trace_id: trace ? trace.id : (mlx ? mlx.id : null),
+      summary: trace ? trace.summary() : null,
+      mlx_summary: mlx ? mlx.summary : null
+    }
+  };
+}
+
+module.exports = { SpanTracer, RequestTrace, NOOP_TRACE, chromeTrace, traceIdOf, nowUs };
@@ -0,0 +1,96 @@
+// 추측 디코딩(speculative decoding) 설정: 모델별 draftModel
+//
+// models-config.json 예:
+//   "llama31-banyaa-q4_k_m": { "draftModel": "llama-3.2-1b-instruct-q4_k_m", "draftMax": 16 }
+//   "draftModel": { "modelPath": "...", "draftMax": 16, "draftMin": 1, "draftPMin": 0.75, "gpuLayers": 99 }
+//
+// GGUF: llama-server -md / --draft-max / --draft-min / --draft-p-min / -ngld 로 전달
+//       (상대 경로는 대상 모델과 같은 디렉터리 기준, 메모리 예산은 gguf-planner.js 가 함께 계산)
+// MLX:  MLX_DRAFT_MODEL_PATH / MLX_NUM_DRAFT_TOKENS 환경변수로 서버의 draft-and-verify 루프 활성화
+// draft 모델은 대상 모델과 같은 토크나이저(어휘)를 써야 합니다.
+const fs = require('fs');
+const path = require('path');
+
+const DEFAULT_GGUF_DRAFT_MAX = 16;
+const DEFAULT_GGUF_DRAFT_MIN = 1;
+const DEFAULT_GGUF_DRAFT_P_MIN = 0.75;
+const DEFAULT_MLX_DRAFT_TOKENS = 4;
+
+// modelConfig → { modelPath, draftMax, draftMin, draftPMin, gpuLayers } | null
+function draftSettings(modelConfig) {
+  const draft = modelConfig && modelConfig.draftModel;
+  if (!draft) return null;
+  const settings = typeof draft === 'string' ? { modelPath: draft } : { ...draft };
+  if (!settings.modelPath) return null;
+  // 최상위 draftMax 등도 허용 (문자열 draftModel 과 함께 쓰기 위함)
+  for (const key of ['draftMax', 'draftMin', 'draftPMin']) {
+    if (settings[key] === undefined && modelConfig[key] !== undefined) settings[key] = modelConfig[key];
+  }
+  if (settings.gpuLayers === undefined && modelConfig.draftGpuLayers !== undefined) {
+    settings.gpuLayers = modelConfig.draftGpuLayers;
+  }
+  return settings;
+}
+
+function ggufDraftArgs(draftFile, settings) {
+  const args = [
+    '-md', draftFile,
+    '--draft-max', String(settings.draftMax || DEFAULT_GGUF_DRAFT_MAX),
+    '--draft-min', String(settings.draftMin ?? DEFAULT_GGUF_DRAFT_MIN),
+    '--draft-p-min', String(settings.draftPMin ?? DEFAULT_GGUF_DRAFT_P_MIN)
+  ];
+  // draft 모델은 작으므로 기본적으로 전부 GPU 에 올림
+  const gpuLayers = settings.gpuLayers === undefined || settings.gpuLayers === 'auto' || settings.gpuLayers < 0
+    ? 99
+    : settings.gpuLayers;
+  args.push('-ngld', String(gpuLayers));
+  return args;
+}
+
+// MLX 서버 환경변수 (draft 모델이 없으면 빈 객체)
+function mlxDraftEnv(modelConfig, modelsDir) {
+  const settings = draftSettings(modelConfig);
+  if (!settings) return {};
+  const draftPath = path.isAbsolute(settings.modelPath) ? settings.modelPath : path.join(modelsDir, settings.modelPath);
+  if (!fs.existsSync(draftPath)) {
+    console.warn(`[Speculative] MLX draft model not found: ${draftPath} (speculative decoding disabled)`);
+    return {};
+  }
+  return {
+    MLX_DRAFT_MODEL_PATH: draftPath,
+    MLX_NUM_DRAFT_TOKENS: String(settings.draftMax || DEFAULT_MLX_DRAFT_TOKENS)
+  };
+}
+
+// llama-server 로그의 요청별 통계 누적
+// "draft acceptance rate = 0.57143 (   40 accepted /    70 generated)"
+const ACCEPTANCE_LINE = /draft acceptance rate = [\d.]+ \(\s*(\d+) accepted \/\s*(\d+) generated\)/g;
+
+class DraftStats {
+  constructor() {
+    this.requests = 0;
+    this.accepted = 0;
+    this.drafted = 0;
+  }
+
+  parse(output) {
+    ACCEPTANCE_LINE.lastIndex = 0;
+    let match;
+    while ((match = ACCEPTANCE_LINE.exec(output)) !== null) {
+      this.requests++;
+      this.accepted += Number(match[1]);
+      this.drafted += Number(match[2]);
+    }
+  }
+
+  toJSON() {
+    return {
+      requests: this.requests,
+      draftTokens: this.drafted,
+      draftAccepted: this.accepted,
+      acceptanceRate: this.drafted > 0 ? this.accepted / this.drafted : null
+    };
+  }
+}
+
+module.exports = { draftSettings, ggufDraftArgs, mlxDraftEnv, DraftStats };
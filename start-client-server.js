@@ -1,19 +1,155 @@
 const { spawn } = require('child_process');
+const os = require('os');
 const path = require('path');
 const fs = require('fs');
 const http = require('http');
 const url = require('url');
+const kvSnapshot = require('./kv-snapshot');
+const { GgufModelPool, matchesModel } = require('./gguf-model-pool');
+const ggufPlanner = require('./gguf-planner');
+const speculative = require('./speculative');
+const kvCacheType = require('./kv-cache-type');
+const perfProfile = require('./perf-profile');
+const contextWindow = require('./context-window');
+const requestRouter = require('./request-router');
+const { MetricsHub } = require('./metrics-hub');
+const { ModelPrewarmer } = require('./model-prewarm');
+const { MemoryPressureWatcher } = require('./memory-pressure');
+const { AdmissionQueue, clientOf } = require('./admission-queue');
+const { ResponseCache } = require('./response-cache');
+const { TrafficRecorder } = require('./traffic-recorder');
+const { SpanTracer, NOOP_TRACE, chromeTrace, nowUs } = require('./span-tracer');
+
+let nativeAddon = null;
+try {
+  nativeAddon = require('./native');
+} catch (error) {
+  // 빌드되지 않은 환경: 호스트 CPU/GPU 카운터 없이 메트릭 제공
+}
 
 // 설정 파일 경로
 // 클라이언트 모드에서는 프로젝트 루트의 config.json 사용
 const CONFIG_PATH = path.join(__dirname, 'config.json');
 const MODELS_CONFIG_PATH = path.join(__dirname, 'models-config.json');
 
-let llamaServerProcess = null;
+// GGUF: 외부 포트(8080)는 라우터가 받고, 모델별 llama-server 는 내부 포트(8090~)에서 실행
+const GGUF_ROUTER_PORT = 8080;
+const GGUF_POOL_BASE_PORT = 8090;
+const GGUF_POOL_MAX_MODELS = Number(process.env.MODEL_POOL_SIZE || 2);
+// MLX: 외부 포트(8081)는 라우터가 받고, 로컬 MLX 서버는 내부 포트에서 실행
+const MLX_ROUTER_PORT = 8081;
+const MLX_LOCAL_PORT = 8089;
+const MLX_MAX_BATCH_SIZE = Number(process.env.MLX_MAX_BATCH_SIZE || 8); // MLX 서버와 같은 환경변수
+
+let ggufPool = null; // GgufModelPool (아래에서 생성)
 let mlxServerInstance = null;
-let ggufModelConfig = null; // 현재 GGUF 서버에 로드된 모델
 let mlxModelConfig = null; // 현재 MLX 서버에 로드된 모델
 
+// 다른 호스트의 worker (config.json 의 workers) 와 로컬 백엔드의 부하 추적
+const workerRegistry = new requestRouter.WorkerRegistry({ log: (msg) => console.log(`[Client Server] ${msg}`) });
+
+// 승인 제어: 예상 토큰 수를 worker 의 KV 용량과 비교해 넘치면 우선순위 대기열에서 기다림 (config.json 의 admission)
+// - 로컬 GGUF: -c (통합 KV 에서는 모든 슬롯이 나눠 씀), 로컬 MLX: contextSize × MLX_MAX_BATCH_SIZE
+// - 원격 worker: workers 항목의 capacityTokens (없으면 제한 없음)
+function workerCapacityTokens(worker) {
+  if (worker.capacityTokens > 0) return worker.capacityTokens;
+  if (!worker.local) return Infinity;
+  if (worker.format === 'gguf' && worker.backend) {
+    return (worker.backend.plan && worker.backend.plan.contextSize) || Number(worker.backend.modelConfig.contextSize) || 2048;
+  }
+  if (worker.format === 'mlx' && mlxModelConfig) return (Number(mlxModelConfig.contextSize) || 4096) * MLX_MAX_BATCH_SIZE;
+  return Infinity;
+}
+const admissionQueue = new AdmissionQueue({
+  registry: workerRegistry,
+  capacityOf: workerCapacityTokens,
+  log: (msg) => console.log(`[Client Server] ${msg}`)
+});
+
+// 결정적(greedy / 고정 seed) 요청의 응답 캐시 (config.json 의 responseCache)
+const responseCache = new ResponseCache({ log: (msg) => console.log(`[Client Server] ${msg}`) });
+
+// 요청 트레이스 기록 (config.json 의 trafficRecording, replay-traffic.js 로 재생)
+const trafficRecorder = new TrafficRecorder({ log: (msg) => console.log(`[Client Server] ${msg}`) });
+
+// trace_id 가 붙은 요청의 구간 기록 (GET /api/traces, Chrome trace 내보내기)
+const spanTracer = new SpanTracer();
+// trace 에 GPU 사용률 카운터를 함께 싣기 위한 네이티브 샘플러 주기 (링 버퍼 2048개 = 최근 약 200초)
+const TRACE_GPU_SAMPLE_INTERVAL_MS = 100;
+if (nativeAddon && nativeAddon.startVRAMSampler) nativeAddon.startVRAMSampler(TRACE_GPU_SAMPLE_INTERVAL_MS);
+
+// 응답 캐시 키의 모델 정체: 로컬 후보의 모델 파일(GGUF) / 디렉터리(MLX)와 KV 캐시 타입 (로컬 후보가 없으면 null)
+function localModelIdentity(candidates) {
+  const local = candidates.find(w => w.local);
+  if (!local) return null;
+  if (local.format === 'gguf' && local.backend) {
+    const { modelConfig, plan } = local.backend;
+    return responseCache.identity('gguf', modelConfig, ggufPlanner.resolveModelFile(modelConfig.modelPath),
+      plan ? plan.cacheType : kvCacheType.kvCacheType(modelConfig));
+  }
+  if (local.format === 'mlx' && mlxModelConfig) {
+    const modelDir = path.isAbsolute(mlxModelConfig.modelPath)
+      ? mlxModelConfig.modelPath
+      : path.join(__dirname, 'mlx', 'models', mlxModelConfig.modelPath);
+    return responseCache.identity('mlx', mlxModelConfig, modelDir, kvCacheType.kvCacheType(mlxModelConfig));
+  }
+  return null;
+}
+
+// 통합 메트릭 (GET /metrics, /metrics/stream on 8083): 로컬 풀 / MLX 서버 / 원격 worker 를 한 스키마로
+function metricsSources() {
+  const sources = [...ggufPool.entries.values()].filter(e => e.ready).map(e => ({
+    id: `local/${e.id}`,
+    backend: 'gguf',
+    model: e.id,
+    modelPath: e.modelConfig.modelPath,
+    host: '127.0.0.1',
+    port: e.port,
+    kvCache: e.plan ? e.plan.kvCache : null
+  }));
+  if (mlxServerInstance && mlxModelConfig) {
+    sources.push({ id: `local/${mlxModelConfig.id}`, backend: 'mlx', model: mlxModelConfig.id, modelPath: mlxModelConfig.modelPath, host: '127.0.0.1', port: MLX_LOCAL_PORT });
+  }
+  for (const worker of workerRegistry.remote.values()) {
+    if (worker.healthy) sources.push({ id: worker.id, backend: worker.format, model: worker.models ? worker.models.join(',') : null, host: worker.host, port: worker.port, remote: true });
+  }
+  return sources;
+}
+
+// 이 호스트의 CPU / GPU / 메모리 (추론 프로세스 기준 CPU 는 procCpuUsage)
+function readHostMetrics() {
+  const sysMemTotal = os.totalmem();
+  const host = { sysMemTotal, sysMemUsed: sysMemTotal - os.freemem(), cpuCores: os.cpus().length };
+  if (!nativeAddon) return host;
+  const pids = [...ggufPool.entries.values()].map(e => e.process.pid);
+  if (mlxServerInstance && mlxServerInstance.process) pids.push(mlxServerInstance.process.pid);
+  const counters = nativeAddon.getSystemCounters(pids.filter(Boolean), 'host-metrics');
+  if (counters.cpu) host.cpuUsage = counters.cpu.usage;
+  if (counters.processes && counters.processes.length > 0) host.procCpuUsage = counters.processes.reduce((sum, p) => sum + (p.usage || 0), 0);
+  if (counters.gpu) {
+    host.gpuUsage = counters.gpu.device;
+    host.gpuRenderer = counters.gpu.renderer;
+    host.gpuTiler = counters.gpu.tiler;
+  }
+  if (counters.memory) {
+    host.memoryPressure = counters.memory.pressureLevel;
+    host.swapUsed = counters.memory.swapUsed;
+    host.compressedMemory = counters.memory.compressed;
+  }
+  const vram = nativeAddon.getVRAMInfo();
+  if (vram && vram.total > 0) {
+    host.vramTotal = vram.total;
+    host.vramUsed = vram.used;
+  }
+  return host;
+}
+
+const metricsHub = new MetricsHub({
+  listSources: metricsSources,
+  readSystem: readHostMetrics,
+  requestHeaders: { [requestRouter.HOP_HEADER]: '1' }
+});
+
 // 설정 로드
 function loadConfig() {
   try {
@@ -27,76 +163,11 @@ function loadConfig() {
   return { models: [], activeModelId: null };
 }
 
-// GGUF 서버 종료
+// GGUF 서버 종료 (풀의 모든 llama-server)
 function stopGgufServer() {
-  return new Promise((resolve) => {
-    if (llamaServerProcess) {
-      console.log(`[Client Server] Stopping GGUF server`);
-      try {
-          const processToKill = llamaServerProcess;
-          console.log(`[Client Server] Attempting to kill GGUF server process`);
-          console.log(`[Client Server]   Process type: ${typeof processToKill}`);
-          console.log(`[Client Server]   Has kill method: ${typeof processToKill?.kill === 'function'}`);
-          console.log(`[Client Server]   Process PID: ${processToKill?.pid || 'unknown'}`);
-          
-          if (processToKill && typeof processToKill.kill === 'function') {
-            let resolved = false;
-            const resolveOnce = () => {
-              if (!resolved) {
-                resolved = true;
-                console.log(`[Client Server] ✅ llama.cpp server process terminated`);
-                llamaServerProcess = null;
-                ggufModelConfig = null;
-                resolve();
-              }
-            };
-            
-            processToKill.once('close', (code) => {
-              console.log(`[Client Server] Process close event, code: ${code}`);
-              resolveOnce();
-            });
-            
-            processToKill.once('exit', (code) => {
-              console.log(`[Client Server] Process exit event, code: ${code}`);
-              resolveOnce();
-            });
-            
-            console.log(`[Client Server] Sending SIGTERM to process ${processToKill.pid}`);
-            processToKill.kill('SIGTERM');
-            
-            setTimeout(() => {
-              if (processToKill && !processToKill.killed && !resolved) {
-                console.log(`[Client Server] ⚠️  Process not terminated, sending SIGKILL`);
-                try {
-                  processToKill.kill('SIGKILL');
-                } catch (err) {
-                  console.error(`[Client Server] Error killing process:`, err);
-                }
-              }
-              setTimeout(() => {
-                if (!resolved) {
-                  console.log(`[Client Server] ⚠️  Force resolving after timeout`);
-                  resolveOnce();
-                }
-              }, 500);
-            }, 2000);
-          } else {
-            console.log(`[Client Server] ⚠️  Process object invalid, clearing state`);
-            setTimeout(() => {
-              llamaServerProcess = null;
-              ggufModelConfig = null;
-              resolve();
-            }, 500);
-          }
-      } catch (error) {
-        console.error(`[Client Server] Error stopping GGUF server:`, error);
-        llamaServerProcess = null;
-        ggufModelConfig = null;
-        resolve();
-      }
-    } else {
-      resolve();
-    }
+  console.log(`[Client Server] Stopping GGUF servers`);
+  return ggufPool.stopAll().then(() => {
+    console.log(`[Client Server] ✅ llama.cpp server processes terminated`);
   });
 }
 
@@ -139,8 +210,8 @@ function stopMlxServer() {
   });
 }
 
-// GGUF 서버 시작
-function startGgufServer(modelConfig) {
+// llama-server 프로세스 하나를 지정한 포트에서 실행 (모델 풀에서 호출)
+function spawnGgufServer(modelConfig, port, plan = null) {
   console.log(`[Client Server] ===== GGUF SERVER START =====`);
   const { modelPath, id, contextSize, gpuLayers } = modelConfig;
   
@@ -191,64 +262,172 @@ function startGgufServer(modelConfig) {
   
   console.log(`[Client Server] ✅ Server executable found: ${serverExecutable}`);
   
-  const args = ['-m', absoluteModelPath, '--metrics', '--port', '8080'];
-  if (contextSize) args.push('-c', contextSize.toString());
-  if (gpuLayers !== undefined && gpuLayers !== null && gpuLayers >= 0) {
-    args.push('-ngl', gpuLayers.toString());
+  // 이름 있는 prompt prefix 의 슬롯 KV 스냅샷 저장 위치
+  const slotSavePath = kvSnapshot.snapshotDir('gguf', id);
+  const args = ['-m', absoluteModelPath, '--metrics', '--port', port.toString(), '--slot-save-path', slotSavePath];
+  if (plan) {
+    // 메모리 예산에 맞춘 -ngl / -c / KV 캐시 타입
+    console.log(`[Client Server] 📐 Auto-fit plan: ${ggufPlanner.describePlan(plan)}`);
+    args.push(...ggufPlanner.planArgs(plan));
+  } else {
+    if (contextSize && contextSize !== 'auto') args.push('-c', contextSize.toString());
+    if (gpuLayers !== undefined && gpuLayers !== null && gpuLayers >= 0) {
+      args.push('-ngl', gpuLayers.toString());
+    }
+    args.push(...ggufPlanner.kvArgs(modelConfig));
+    args.push(...ggufPlanner.draftArgs(modelConfig, absoluteModelPath));
   }
+  // 모델별 성능 프로필 (슬롯 수, P 코어 스레드, 배치 크기 등)
+  const profile = perfProfile.resolveProfile(modelConfig);
+  console.log(`[Client Server] ⚙️  Performance profile: ${perfProfile.describeProfile(profile)}`);
+  args.push(...perfProfile.ggufArgs(profile, args));
 
   console.log(`[Client Server] 🚀 Spawning process: ${serverExecutable}`);
   console.log(`[Client Server]    Args: ${args.join(' ')}`);
   
-  llamaServerProcess = spawn(serverExecutable, args);
+  // llama-server 의 순차 읽기와 동시에 여러 스레드로 가중치를 페이지 캐시에 올림
+  modelPrewarmer.prewarm(modelConfig, 'load').catch((error) => {
+    console.error(`[Client Server] Prewarm failed for ${id}:`, error.message);
+  });
+  const serverProcess = spawn(serverExecutable, args);
+  perfProfile.promoteProcess(serverProcess.pid);
+  // 추측 디코딩 수락률 (요청이 끝날 때 llama-server 가 출력하는 통계를 누적)
+  const draftStats = args.includes('-md') ? new speculative.DraftStats() : null;
   
   // 프로세스가 즉시 종료되는 경우 감지
   let processStarted = false;
   const startTimeout = setTimeout(() => {
-    if (!processStarted && llamaServerProcess && llamaServerProcess.killed) {
+    if (!processStarted && serverProcess.killed) {
       console.error(`[Client Server] llama-server process failed to start`);
     }
   }, 3000);
 
-  llamaServerProcess.stdout.on('data', (data) => {
+  serverProcess.stdout.on('data', (data) => {
     processStarted = true;
     clearTimeout(startTimeout);
     const output = data.toString();
-    console.log(`[GGUF Server] ${output}`);
+    console.log(`[GGUF Server:${port}] ${output}`);
+    if (draftStats) draftStats.parse(output);
     // 서버가 시작되었는지 확인
-    if (output.includes('listening') || output.includes('port') || output.includes('HTTP server listening')) {
-      console.log(`[Client Server] ✅ GGUF server started successfully and listening on port 8080`);
+    if (output.includes('listening') || output.includes('HTTP server listening')) {
+      console.log(`[Client Server] ✅ GGUF server started successfully and listening on port ${port}`);
       console.log(`[Client Server]    Model: ${id}`);
       console.log(`[Client Server]    Path: ${absoluteModelPath}`);
     }
   });
   
-  llamaServerProcess.stderr.on('data', (data) => {
+  serverProcess.stderr.on('data', (data) => {
     processStarted = true;
     clearTimeout(startTimeout);
     const output = data.toString();
-    console.error(`[GGUF Server] ${output}`);
+    console.error(`[GGUF Server:${port}] ${output}`);
+    if (draftStats) draftStats.parse(output);
   });
   
-  llamaServerProcess.on('close', (code) => {
+  serverProcess.on('close', (code) => {
     clearTimeout(startTimeout);
-    console.log(`[Client Server] ⚠️  llama-server process exited with code ${code}`);
-    llamaServerProcess = null;
-    ggufModelConfig = null;
-    console.log(`[Client Server]    Server state cleared`);
+    console.log(`[Client Server] ⚠️  llama-server (${id}, port ${port}) exited with code ${code}`);
   });
   
-  llamaServerProcess.on('error', (error) => {
+  serverProcess.on('error', (error) => {
     clearTimeout(startTimeout);
     console.error(`[Client Server] ❌ Failed to spawn llama-server:`, error);
-    llamaServerProcess = null;
-    ggufModelConfig = null;
   });
 
-  ggufModelConfig = modelConfig;
-  console.log(`[Client Server] ✅ Server state updated: type=gguf, model=${id}`);
-  console.log(`[Client Server]    Process PID: ${llamaServerProcess.pid || 'unknown'}`);
+  // 모델 로드가 끝나면 시스템 프롬프트 KV 를 스냅샷에서 복원 (없으면 prefill 후 저장)
+  kvSnapshot.warmGgufPrefixes({
+    port,
+    modelPath: absoluteModelPath,
+    slotSavePath,
+    isAlive: () => serverProcess.exitCode === null && !serverProcess.killed,
+    log: (msg) => console.log(`[Client Server] ${msg}`)
+  }).catch((error) => {
+    console.error(`[Client Server] KV snapshot warmup failed:`, error.message);
+  });
+
+  console.log(`[Client Server]    Process PID: ${serverProcess.pid || 'unknown'}`);
   console.log(`[Client Server] ===== GGUF SERVER START COMPLETE =====`);
+  return { process: serverProcess, absoluteModelPath, draftStats };
+}
+
+ggufPool = new GgufModelPool({
+  spawnServer: spawnGgufServer,
+  planModel: planGgufModel,
+  maxModels: GGUF_POOL_MAX_MODELS,
+  basePort: GGUF_POOL_BASE_PORT,
+  log: (msg) => console.log(`[Client Server] ${msg}`)
+});
+
+// 통합 메모리 압력: 스왑이 시작되기 전에 부하를 줄여 작업 세트를 recommendedMaxWorkingSetSize 안에 유지
+// - warn/critical: 가장 최근에 쓴 모델 하나만 남기고 유휴 GGUF 모델을 내림, 유휴 프리웜 중단,
+//   MLX 서버에 단계 전달 (동시 배치 축소, prefix KV 캐시 축소/비움)
+// - critical: 예상 토큰 수가 MEMORY_PRESSURE_MAX_TOKENS 를 넘는 새 요청은 원격 worker 로만 보내고, 없으면 503
+const MEMORY_PRESSURE_MAX_TOKENS = Number(process.env.MEMORY_PRESSURE_MAX_TOKENS || 4096);
+const memoryPressure = new MemoryPressureWatcher({ log: (msg) => console.log(`[Client Server] ${msg}`) });
+memoryPressure.on('change', (level) => {
+  if (level !== 'normal') {
+    modelPrewarmer.cancelIdle();
+    ggufPool.shed(1).catch((error) => console.error(`[Client Server] Memory pressure eviction failed:`, error.message));
+  }
+  if (mlxServerInstance) notifyMlxMemoryPressure(level);
+});
+
+function notifyMlxMemoryPressure(level) {
+  const payload = JSON.stringify({ level });
+  const req = http.request({
+    hostname: '127.0.0.1',
+    port: MLX_LOCAL_PORT,
+    path: '/memory-pressure',
+    method: 'POST',
+    headers: { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(payload) },
+    timeout: 2000
+  }, (res) => {
+    res.resume();
+    if (res.statusCode !== 200) console.warn(`[Client Server] MLX memory pressure update returned ${res.statusCode}`);
+  });
+  req.on('timeout', () => req.destroy(new Error('timeout')));
+  req.on('error', (error) => console.warn(`[Client Server] MLX memory pressure update failed:`, error.message));
+  req.end(payload);
+}
+
+// 유휴 시 다음에 쓰일 모델을 페이지 캐시에 미리 올림 (활성 모델 → 최근 사용 → 설정 순서, 상주 중인 모델 제외)
+const modelLastUsed = new Map(); // model id -> 마지막 요청 시각 (풀에서 내려간 모델 포함)
+const modelPrewarmer = new ModelPrewarmer({
+  listCandidates: () => {
+    const config = loadConfig();
+    const models = config.models || [];
+    const resident = (m) => ggufPool.entries.has(m.id) || (mlxModelConfig && mlxModelConfig.id === m.id);
+    const recent = [...modelLastUsed.entries()].sort((a, b) => b[1] - a[1]).map(([id]) => id);
+    const ordered = [config.activeModelId, ...recent, ...models.map(m => m.id)];
+    return [...new Set(ordered)].map(id => models.find(m => m.id === id)).filter(m => m && !resident(m));
+  },
+  isIdle: () => memoryPressure.isNormal() && ggufPool.starting.size === 0 &&
+    [...ggufPool.entries.values()].every(e => e.ready && e.inFlight === 0),
+  reservedBytes: () => ggufPool.memoryUsed(),
+  log: (msg) => console.log(`[Client Server] ${msg}`)
+});
+
+// 통합 메모리 예산 안에서 -ngl / -c / KV 캐시 타입 결정 (실패하면 설정값 그대로 실행)
+async function planGgufModel(modelConfig, budgetBytes) {
+  try {
+    const plan = await ggufPlanner.planGgufLaunch(modelConfig, { budgetBytes });
+    if (!plan.ok) console.log(`[Client Server] Auto-fit skipped for ${modelConfig.id}: ${plan.error}`);
+    return plan;
+  } catch (error) {
+    console.error(`[Client Server] Auto-fit failed for ${modelConfig.id}:`, error.message);
+    return null;
+  }
+}
+
+// GGUF 모델을 풀에 올림 (이미 상주 중이면 재사용, 자리가 없으면 LRU 모델을 내림)
+function startGgufServer(modelConfig) {
+  return ggufPool.acquire(modelConfig).then((entry) => {
+    console.log(`[Client Server] ✅ GGUF model ${entry.id} resident on port ${entry.port}`);
+    return entry;
+  }).catch((error) => {
+    console.error(`[Client Server] ❌ Failed to start GGUF model ${modelConfig.id}:`, error.message);
+    return null;
+  });
 }
 
 // MLX 서버 시작 (Python 기반)
@@ -294,10 +473,15 @@ async function startMlxServer(modelConfig) {
       stdio: 'pipe',
       env: {
         ...process.env,
+        ...kvSnapshot.mlxSnapshotEnv(modelConfig.id),
+        ...speculative.mlxDraftEnv(modelConfig, path.join(__dirname, 'mlx', 'models')),
+        ...kvCacheType.mlxKvEnv(modelConfig),
+        ...perfProfile.mlxEnv(perfProfile.resolveProfile(modelConfig)),
         MLX_MODEL_PATH: modelPath,
-        PORT: '8081'
+        PORT: String(MLX_LOCAL_PORT)
       }
     });
+    perfProfile.promoteProcess(mlxServerProcess.pid);
     
     let serverOutput = '';
     let serverStarted = false;
@@ -382,7 +566,7 @@ async function startMlxServer(modelConfig) {
     const checkHealth = setInterval(async () => {
       try {
         const response = await new Promise((resolve, reject) => {
-          const req = http.get('http://localhost:8081/health', (res) => {
+          const req = http.get(`http://localhost:${MLX_LOCAL_PORT}/health`, (res) => {
             let data = '';
             res.on('data', (chunk) => { data += chunk; });
             res.on('end', () => {
@@ -451,18 +635,21 @@ async function startAllServers(config) {
     return;
   }
 
-  // GGUF 모델 찾기
-  const ggufModel = config.models.find(m => (m.modelFormat || 'gguf') === 'gguf');
+  // GGUF 모델 찾기 (활성 모델이 GGUF 이면 그 모델 우선)
+  const activeModel = config.models.find(m => m.id === config.activeModelId);
+  const ggufModel = activeModel && (activeModel.modelFormat || 'gguf') === 'gguf'
+    ? activeModel
+    : config.models.find(m => (m.modelFormat || 'gguf') === 'gguf');
   // MLX 모델 찾기
   const mlxModel = config.models.find(m => m.modelFormat === 'mlx');
 
-  // GGUF 서버 시작
+  // GGUF 서버 시작 (풀에 이미 상주 중이면 재사용)
   if (ggufModel) {
-    if (!llamaServerProcess) {
+    if (!ggufPool.findEntry(ggufModel.id)) {
       console.log(`[Client Server] 🚀 Starting GGUF server for model: ${ggufModel.id}`);
       startGgufServer(ggufModel);
     } else {
-      console.log(`[Client Server] ⏭️  GGUF server already running`);
+      console.log(`[Client Server] ⏭️  GGUF model already resident: ${ggufModel.id}`);
     }
   } else {
     console.log(`[Client Server] ⚠️  No GGUF model found in config`);
@@ -489,6 +676,10 @@ function watchConfigAndStartServer() {
   console.log('[Client Server] ===== Config Watch Triggered =====');
   console.log('[Client Server][DEBUG] watchConfigAndStartServer called at:', new Date().toISOString());
   const config = loadConfig();
+  workerRegistry.configure(config.workers, config.routing);
+  admissionQueue.configure(config.admission);
+  responseCache.configure(config.responseCache);
+  trafficRecorder.configure(config.trafficRecording);
   console.log('[Client Server] Config loaded:');
   console.log('[Client Server]    Active Model ID:', config.activeModelId);
   console.log('[Client Server]    Models count:', config.models?.length || 0);
@@ -500,7 +691,14 @@ function watchConfigAndStartServer() {
     startAllServers(config);
     isInitialLoad = false;
   } else {
-    console.log('[Client Server] ⏭️  Config changed, but skipping server restart (servers already running)');
+    // 활성 GGUF 모델을 미리 올려 둠 (다른 상주 모델은 메모리 예산을 넘을 때만 내림)
+    const activeModel = config.models?.find(m => m.id === config.activeModelId);
+    if (activeModel && (activeModel.modelFormat || 'gguf') === 'gguf') {
+      console.log(`[Client Server] 🔥 Config changed, warming active GGUF model: ${activeModel.id}`);
+      startGgufServer(activeModel);
+    } else {
+      console.log('[Client Server] ⏭️  Config changed, but skipping server restart (servers already running)');
+    }
   }
   
   console.log('[Client Server][DEBUG] watchConfigAndStartServer completed');
@@ -544,6 +742,7 @@ process.on('SIGTERM', () => {
   if (configWatcher) {
     fs.unwatchFile(CONFIG_PATH);
   }
+  trafficRecorder.close();
   Promise.all([stopGgufServer(), stopMlxServer()]).then(() => {
     process.exit(0);
   });
@@ -554,6 +753,7 @@ process.on('SIGINT', () => {
   if (configWatcher) {
     fs.unwatchFile(CONFIG_PATH);
   }
+  trafficRecorder.close();
   Promise.all([stopGgufServer(), stopMlxServer()]).then(() => {
     process.exit(0);
   });
@@ -563,7 +763,7 @@ process.on('SIGINT', () => {
 const httpServer = http.createServer((req, res) => {
   // CORS 헤더 설정
   res.setHeader('Access-Control-Allow-Origin', '*');
-  res.setHeader('Access-Control-Allow-Methods', 'GET, POST, OPTIONS');
+  res.setHeader('Access-Control-Allow-Methods', 'GET, POST, DELETE, OPTIONS');
   res.setHeader('Access-Control-Allow-Headers', 'Content-Type');
 
   if (req.method === 'OPTIONS') {
@@ -610,7 +810,7 @@ const httpServer = http.createServer((req, res) => {
         // config 저장 후 서버 시작
         console.log('[Client Server][DEBUG] Config saved, checking if servers need to be started...');
         console.log('[Client Server][DEBUG]   Active model ID:', config.activeModelId);
-        console.log('[Client Server][DEBUG]   GGUF server running:', !!llamaServerProcess);
+        console.log('[Client Server][DEBUG]   GGUF models resident:', [...ggufPool.entries.keys()]);
         console.log('[Client Server][DEBUG]   MLX server running:', !!mlxServerInstance);
         
         // 서버가 없으면 시작
@@ -677,11 +877,628 @@ const httpServer = http.createServer((req, res) => {
     return;
   }
 
+  // /api/model-pool - 상주 중인 GGUF 모델 목록과 메모리 사용량
+  if (parsedUrl.pathname === '/api/model-pool' && req.method === 'GET') {
+    res.writeHead(200, { 'Content-Type': 'application/json' });
+    res.end(JSON.stringify({ ...ggufPool.stats(), prewarm: modelPrewarmer.stats() }));
+    return;
+  }
+
+  // /api/memory-pressure - 현재 메모리 압력 단계와 swapout/압축 속도
+  if (parsedUrl.pathname === '/api/memory-pressure' && req.method === 'GET') {
+    res.writeHead(200, { 'Content-Type': 'application/json' });
+    res.end(JSON.stringify({ ...memoryPressure.stats(), maxTokensUnderCritical: MEMORY_PRESSURE_MAX_TOKENS }));
+    return;
+  }
+
+  // /api/response-cache - 응답 캐시 적중/미스, 크기 (DELETE: 비우기)
+  if (parsedUrl.pathname === '/api/response-cache') {
+    if (req.method === 'DELETE') {
+      const cleared = responseCache.clear();
+      console.log(`[Client Server] 🧹 Response cache cleared (${cleared} entries)`);
+      res.writeHead(200, { 'Content-Type': 'application/json' });
+      res.end(JSON.stringify({ ok: true, cleared }));
+      return;
+    }
+    if (req.method === 'GET') {
+      res.writeHead(200, { 'Content-Type': 'application/json' });
+      res.end(JSON.stringify(responseCache.stats()));
+      return;
+    }
+  }
+
+  // /api/traffic-recording - 트레이스 기록 상태 (POST { enabled }: 켜기/끄기)
+  if (parsedUrl.pathname === '/api/traffic-recording') {
+    if (req.method === 'POST') {
+      let body = '';
+      req.on('data', chunk => { body += chunk.toString(); });
+      req.on('end', () => {
+        try {
+          const { enabled } = JSON.parse(body || '{}');
+          trafficRecorder.setEnabled(enabled);
+          res.writeHead(200, { 'Content-Type': 'application/json' });
+          res.end(JSON.stringify({ ok: true, ...trafficRecorder.stats() }));
+        } catch (error) {
+          res.writeHead(400, { 'Content-Type': 'application/json' });
+          res.end(JSON.stringify({ error: error.message }));
+        }
+      });
+      return;
+    }
+    if (req.method === 'GET') {
+      res.writeHead(200, { 'Content-Type': 'application/json' });
+      res.end(JSON.stringify(trafficRecorder.stats()));
+      return;
+    }
+  }
+
+  // /api/traces - trace_id 가 붙은 최근 요청과 단계별 ms
+  if (parsedUrl.pathname === '/api/traces' && req.method === 'GET') {
+    res.writeHead(200, { 'Content-Type': 'application/json' });
+    res.end(JSON.stringify({ traces: spanTracer.list(Number(parsedUrl.query.limit) || 50) }));
+    return;
+  }
+
+  // /api/traces/<id> - Chrome trace JSON (POST { spans }: 프론트엔드 구간을 함께 넣음)
+  if (parsedUrl.pathname.startsWith('/api/traces/') && (req.method === 'GET' || req.method === 'POST')) {
+    const id = decodeURIComponent(parsedUrl.pathname.slice('/api/traces/'.length));
+    let body = '';
+    req.on('data', chunk => { body += chunk.toString(); });
+    req.on('end', async () => {
+      try {
+        const client = body ? (JSON.parse(body).spans || []) : [];
+        const exported = await exportTrace(id, client);
+        if (!exported) {
+          res.writeHead(404, { 'Content-Type': 'application/json' });
+          res.end(JSON.stringify({ error: 'trace_not_found' }));
+          return;
+        }
+        res.writeHead(200, { 'Content-Type': 'application/json', 'Content-Disposition': `attachment; filename="trace-${id}.json"` });
+        res.end(JSON.stringify(exported));
+      } catch (error) {
+        res.writeHead(400, { 'Content-Type': 'application/json' });
+        res.end(JSON.stringify({ error: error.message }));
+      }
+    });
+    return;
+  }
+
+  // /api/admission - 승인 대기열 (위치, 클라이언트, 예상 대기)과 worker 별 KV 용량 / 처리 중 토큰
+  if (parsedUrl.pathname === '/api/admission' && req.method === 'GET') {
+    const workers = [...workerRegistry.local.values(), ...workerRegistry.remote.values()].map(w => {
+      const capacity = workerCapacityTokens(w);
+      return { id: w.id, format: w.format, inFlight: w.inFlight, outstandingTokens: w.outstandingTokens, capacityTokens: Number.isFinite(capacity) ? capacity : null };
+    });
+    res.writeHead(200, { 'Content-Type': 'application/json' });
+    res.end(JSON.stringify({ ...admissionQueue.stats(), workers }));
+    return;
+  }
+
+  // /metrics - 모든 백엔드의 정규화된 메트릭 (Prometheus 텍스트)
+  if (parsedUrl.pathname === '/metrics' && req.method === 'GET') {
+    metricsHub.prometheus().then((text) => {
+      res.writeHead(200, { 'Content-Type': 'text/plain; version=0.0.4' });
+      res.end(text);
+    }).catch((error) => {
+      res.writeHead(500, { 'Content-Type': 'application/json' });
+      res.end(JSON.stringify({ error: error.message }));
+    });
+    return;
+  }
+
+  // /metrics/stream - 같은 메트릭의 SSE push (snapshot 후 바뀐 필드만 delta)
+  if (parsedUrl.pathname === '/metrics/stream' && req.method === 'GET') {
+    metricsHub.subscribe(req, res).catch((error) => {
+      console.error('[Client Server] ❌ Metrics stream failed:', error.message);
+      res.end();
+    });
+    return;
+  }
+
+  // /api/workers - 라우팅 대상 worker 목록과 부하 (POST: 등록, DELETE ?id=: 제거, 관리자 재시작 전까지 유지)
+  if (parsedUrl.pathname === '/api/workers') {
+    if (req.method === 'GET') {
+      res.writeHead(200, { 'Content-Type': 'application/json' });
+      res.end(JSON.stringify(workerRegistry.stats()));
+      return;
+    }
+    if (req.method === 'DELETE') {
+      const removed = workerRegistry.unregister(String(parsedUrl.query.id || ''));
+      res.writeHead(removed ? 200 : 404, { 'Content-Type': 'application/json' });
+      res.end(JSON.stringify({ success: removed }));
+      return;
+    }
+    if (req.method === 'POST') {
+      let body = '';
+      req.on('data', chunk => { body += chunk.toString(); });
+      req.on('end', () => {
+        let result;
+        try {
+          result = workerRegistry.register(JSON.parse(body));
+        } catch (error) {
+          result = { ok: false, error: error.message };
+        }
+        res.writeHead(result.ok ? 200 : 400, { 'Content-Type': 'application/json' });
+        res.end(JSON.stringify(result.ok ? { success: true, id: result.worker.id } : { success: false, error: result.error }));
+      });
+      return;
+    }
+  }
+
   // 404
   res.writeHead(404, { 'Content-Type': 'application/json' });
   res.end(JSON.stringify({ error: 'not_found' }));
 });
 
+// 관리자 trace + 로컬 MLX 서버의 같은 trace_id 구간 + 그 시간대의 GPU 사용률 샘플 → Chrome trace
+// (어느 쪽에도 없으면 null, 프론트엔드 구간만 있으면 그것만 내보냄)
+async function exportTrace(id, client) {
+  const trace = spanTracer.get(id);
+  let mlx = null;
+  if (mlxServerInstance) {
+    try {
+      const response = await kvSnapshot.requestJson(MLX_LOCAL_PORT, 'GET', `/trace/${encodeURIComponent(id)}`, null, 2000);
+      if (response.statusCode === 200) mlx = response.body;
+    } catch (error) {
+      // MLX 서버가 응답하지 않으면 관리자 구간만
+    }
+  }
+  if (!trace && !mlx && client.length === 0) return null;
+  const starts = [trace && trace.startedUs, mlx && mlx.startedUs, ...client.map(s => s.ts)].filter(Boolean);
+  const ends = [trace && (trace.endedUs || nowUs()), ...client.map(s => s.ts + (s.dur || 0))].filter(Boolean);
+  let gpuSamples = [];
+  if (nativeAddon && nativeAddon.getVRAMSamples && starts.length > 0) {
+    const fromMs = Math.min(...starts) / 1000 - 500;
+    const toMs = (ends.length > 0 ? Math.max(...ends) : nowUs()) / 1000 + 500;
+    gpuSamples = nativeAddon.getVRAMSamples(fromMs).filter(s => s.ts <= toMs);
+  }
+  return chromeTrace({ trace, mlx, client, gpuSamples });
+}
+
+// GGUF 라우터 (8080): 요청의 model 값으로 풀에 상주 중인 llama-server 또는 원격 worker 를 골라 그대로 전달
+// model 은 JSON 본문의 "model", 쿼리 ?model=, 또는 X-Model-Id 헤더에서 읽고,
+// 지정되지 않으면 가장 최근에 사용한 모델(없으면 활성 모델)로 보냅니다.
+function parseJsonBody(req, body) {
+  if (body.length === 0 || !(req.headers['content-type'] || '').includes('application/json')) return null;
+  try {
+    return JSON.parse(body.toString('utf-8'));
+  } catch (error) {
+    return null; // 본문이 JSON 이 아니면 그대로 전달
+  }
+}
+
+function pickModelKey(req, parsedUrl, json) {
+  if (req.headers['x-model-id']) return req.headers['x-model-id'];
+  if (parsedUrl.query && parsedUrl.query.model) return parsedUrl.query.model;
+  if (json && typeof json.model === 'string' && json.model) return json.model;
+  return null;
+}
+
+async function resolveGgufEntry(modelKey) {
+  const resident = modelKey ? ggufPool.findEntry(modelKey) : ggufPool.mostRecentEntry();
+  if (resident) return ggufPool.acquire(resident.modelConfig);
+
+  const config = loadConfig();
+  const ggufModels = (config.models || []).filter(m => (m.modelFormat || 'gguf') === 'gguf');
+  const modelConfig = modelKey
+    ? ggufModels.find(m => matchesModel(m, modelKey))
+    : ggufModels.find(m => m.id === config.activeModelId) || ggufModels[0];
+  if (!modelConfig) return null;
+  console.log(`[Client Server] 🔀 Model ${modelConfig.id} not resident, loading for request`);
+  return ggufPool.acquire(modelConfig);
+}
+
+// 상주 모델의 슬롯당 컨텍스트 크기 (/props, 한 번만 조회)
+async function entryContextSize(entry) {
+  if (!entry.contextSize) {
+    try {
+      const props = await kvSnapshot.requestJson(entry.port, 'GET', '/props', null, 5000);
+      entry.contextSize = props.body?.default_generation_settings?.n_ctx || 0;
+    } catch (error) {
+      // 구버전 llama-server: 계획값/설정값 사용
+    }
+    if (!entry.contextSize) entry.contextSize = entry.plan?.contextSize || Number(entry.modelConfig.contextSize) || 2048;
+  }
+  return entry.contextSize;
+}
+
+const turnTokenCache = new contextWindow.TurnTokenCache();
+
+// /completion 본문에 messages 가 있으면 턴 단위 토큰화 + 컨텍스트 맞춤 후 토큰 ID 프롬프트로 교체
+async function prepareGgufMessages(entry, json) {
+  const serverContext = await entryContextSize(entry);
+  const contextSize = json.context_size > 0 ? Math.min(json.context_size, serverContext) : serverContext;
+  const prepared = await contextWindow.prepareMessagesPrompt({
+    modelId: entry.id,
+    messages: json.messages,
+    contextSize,
+    nPredict: json.n_predict ?? -1,
+    policy: json.context_overflow === 'reject' ? 'reject' : 'truncate',
+    cache: turnTokenCache,
+    tokenize: async (content) => {
+      const res = await kvSnapshot.requestJson(entry.port, 'POST', '/tokenize', { content, add_special: false, parse_special: true, with_pieces: true }, 30000);
+      if (res.statusCode !== 200 || !Array.isArray(res.body?.tokens)) throw new Error(`tokenize failed (${res.statusCode})`);
+      return res.body.tokens;
+    }
+  });
+  if (prepared.truncatedTurns > 0) {
+    console.log(`[Client Server] ✂️  ${entry.id}: dropped ${prepared.truncatedTurns} oldest turns to fit ${contextSize} tokens`);
+  }
+  return prepared;
+}
+
+// model 이 지정되지 않은 요청의 대상: 가장 최근에 사용한 상주 모델, 없으면 활성 GGUF 모델
+// (원격 worker 에도 같은 모델로 가도록 X-Model-Id 로 넘김)
+function defaultGgufModelKey() {
+  const recent = ggufPool.mostRecentEntry();
+  if (recent) return recent.id;
+  const config = loadConfig();
+  const ggufModels = (config.models || []).filter(m => (m.modelFormat || 'gguf') === 'gguf');
+  const modelConfig = ggufModels.find(m => m.id === config.activeModelId) || ggufModels[0];
+  return modelConfig ? modelConfig.id : null;
+}
+
+// 라우팅 후보: 상주 중인 로컬 모델 + 상태가 정상인 원격 worker
+// 어디에도 없으면 로컬 풀에 올림 (다른 라우터에서 넘어온 요청은 로컬만)
+async function ggufCandidates(modelKey, hop, trace = NOOP_TRACE) {
+  const remote = hop ? [] : workerRegistry.candidates('gguf', modelKey);
+  const resident = ggufPool.findEntry(modelKey);
+  let entry = resident && resident.ready ? resident : null;
+  if (!entry && remote.length === 0) {
+    // 상주하지 않는 모델: llama-server 실행과 모델 로드가 이 구간에 들어감
+    const endAcquire = trace.begin('model acquire', { model: modelKey, resident: Boolean(resident) });
+    entry = await resolveGgufEntry(modelKey);
+    endAcquire({ loaded: Boolean(entry) });
+  }
+  const local = entry ? [workerRegistry.localWorker('gguf', entry.id, entry.port, [entry.id], entry)] : [];
+  return [...local, ...remote];
+}
+
+// 로컬 풀 엔트리로 전달 (messages 요청은 여기서 컨텍스트를 맞춤)
+async function forwardToLocalGguf(worker, req, res, parsedUrl, body, json, startedAt) {
+  const entry = worker.backend;
+  const trace = spanTracer.of(req);
+  // messages 요청: 클라이언트의 /tokenize 왕복 없이 여기서 컨텍스트를 맞추고 첫 이벤트로 토큰 수 보고
+  let upstreamBody = body;
+  let promptInfo = null;
+  if (req.method === 'POST' && parsedUrl.pathname === '/completion' && json && Array.isArray(json.messages) && json.messages.length > 0) {
+    let prepared;
+    const endPrepare = trace.begin('prepare messages', { turns: json.messages.length });
+    try {
+      prepared = await prepareGgufMessages(entry, json);
+    } catch (error) {
+      prepared = { error: error.message, promptTokens: 0, contextSize: 0 };
+    }
+    endPrepare({ prompt_tokens: prepared.promptTokens, truncated_turns: prepared.truncatedTurns || 0 });
+    if (prepared.error) {
+      requestRouter.sendError(res, 400, { message: prepared.error, type: 'exceed_context_size_error', n_prompt_tokens: prepared.promptTokens, n_ctx: prepared.contextSize });
+      return;
+    }
+    const { messages, context_size, context_overflow, ...rest } = json;
+    upstreamBody = Buffer.from(JSON.stringify({ ...rest, prompt: prepared.prompt, n_predict: prepared.nPredict }));
+    promptInfo = {
+      prompt_tokens: prepared.promptTokens,
+      context_size: prepared.contextSize,
+      truncated_turns: prepared.truncatedTurns,
+      n_predict: prepared.nPredict
+    };
+    // return_tokens: 프롬프트 토큰 ID 와 piece 도 첫 이벤트로 전달 (TokenDebugPanel 용, 추가 토큰화 없음)
+    if (json.return_tokens) {
+      promptInfo.tokens = prepared.prompt;
+      promptInfo.pieces = prepared.pieces;
+    }
+  }
+
+  entry.inFlight++;
+  entry.lastUsed = Date.now();
+  modelLastUsed.set(entry.id, entry.lastUsed);
+  const sentUs = nowUs();
+  try {
+    await requestRouter.forwardRequest(worker, req, res, upstreamBody, {
+      beforePipe: (upstreamRes) => {
+        trace.observeUpstream(upstreamRes, worker, sentUs);
+        if (promptInfo && upstreamRes.statusCode === 200 && (upstreamRes.headers['content-type'] || '').includes('text/event-stream')) {
+          res.write(`data: ${JSON.stringify(promptInfo)}\n\n`);
+        }
+        if (promptInfo && upstreamRes.statusCode === 200) logPrefixCacheHit(entry, upstreamRes, promptInfo.prompt_tokens);
+        metricsHub.observeStream(worker.id, upstreamRes, startedAt);
+      }
+    });
+  } finally {
+    entry.inFlight--;
+    entry.lastUsed = Date.now();
+  }
+}
+
+// messages 요청의 prefix 캐시 적중 토큰 수 (최종 이벤트의 tokens_cached / timings.cache_n) — 스냅샷 prefix 확인용
+function logPrefixCacheHit(entry, upstreamRes, promptTokens) {
+  let tail = '';
+  upstreamRes.on('data', (chunk) => {
+    tail = (tail + chunk.toString('utf8')).slice(-8192);
+  });
+  upstreamRes.on('end', () => {
+    const match = /"tokens_cached":\s*(\d+)/.exec(tail) || /"cache_n":\s*(\d+)/.exec(tail);
+    if (match) console.log(`[Client Server] 🧩 ${entry.id}: prefix cache hit ${match[1]}/${promptTokens} prompt tokens`);
+  });
+}
+
+// 대기 중 위치 전달: 스트리밍 요청은 SSE 헤더를 먼저 보내고 {"queue": {...}} 이벤트로, 그 외는 승인될 때까지 대기
+function queueUpdater(res, json) {
+  if (!json || json.stream !== true) return null;
+  return ({ position, estimatedWaitMs }) => {
+    if (!res.headersSent) {
+      res.writeHead(200, { 'Content-Type': 'text/event-stream', 'Cache-Control': 'no-cache', 'Access-Control-Allow-Origin': '*' });
+    }
+    res.write(`data: ${JSON.stringify({ queue: { position, estimated_wait_ms: estimatedWaitMs } })}\n\n`);
+  };
+}
+
+// 승인 제어를 거쳐 후보 중 하나로 전달, 응답 전에 연결이 실패하면 남은 후보로 재시도
+// 결정적 요청은 응답 캐시에 있으면 승인 대기 없이 바로 돌려주고, 없으면 로컬 백엔드의 응답을 기록
+async function routeRequest(candidates, req, res, body, json, modelKey, forwardLocal) {
+  const pathname = url.parse(req.url).pathname;
+  const tokens = requestRouter.estimateRequestTokens(json);
+  const client = clientOf(req);
+  const trace = trafficRecorder.observe(req, res, {
+    backend: candidates[0].format,
+    pathname,
+    json,
+    modelKey,
+    client,
+    estimatedTokens: tokens,
+    hop: Boolean(req.headers[requestRouter.HOP_HEADER])
+  });
+  const spans = spanTracer.of(req);
+  const identity = localModelIdentity(candidates);
+  const cacheKey = responseCache.keyFor(req, pathname, json, identity);
+  if (cacheKey) {
+    const endLookup = spans.begin('response cache lookup');
+    const cached = responseCache.get(cacheKey);
+    endLookup({ hit: Boolean(cached) });
+    if (cached) {
+      const endReplay = spans.begin('response cache replay', { bytes: cached.bytes });
+      responseCache.replay(cached, res);
+      endReplay();
+      return;
+    }
+  }
+  const affinityKey = requestRouter.prefixKey(modelKey, json);
+  const startedAt = Date.now();
+  modelPrewarmer.noteActivity();
+  let remaining = candidates;
+  // critical 압력에서는 긴 요청을 로컬에서 받지 않음 (메모리가 남는 원격 worker 로만)
+  if (memoryPressure.level === 'critical' && tokens > MEMORY_PRESSURE_MAX_TOKENS) {
+    remaining = candidates.filter(w => !w.local);
+    if (remaining.length === 0) {
+      requestRouter.sendError(res, 503, { message: `Memory pressure is critical, rejecting a ${tokens}-token request (limit ${MEMORY_PRESSURE_MAX_TOKENS})`, type: 'memory_pressure_error' }, { 'Retry-After': '10' });
+      return;
+    }
+  }
+  const onUpdate = queueUpdater(res, json);
+  let lastError = null;
+  let recording = false;
+  while (remaining.length > 0) {
+    const endAdmission = spans.begin('admission wait', { tokens, client: client.id });
+    const admitted = await admissionQueue.admit(remaining, tokens, { client, affinityKey, onUpdate, closed: res });
+    endAdmission({ worker: admitted.ok ? admitted.worker.id : null, queued: Boolean(admitted.queued), status: admitted.status || 200 });
+    if (!admitted.ok) {
+      if (admitted.cancelled) return;
+      if (admitted.status === 429) console.warn(`[Client Server] ⏳ Rejected ${tokens}-token request from ${client.id}: ${admitted.message}`);
+      requestRouter.sendError(res, admitted.status, { message: admitted.message, type: admitted.type }, { 'Retry-After': String(admitted.retryAfter), 'Access-Control-Expose-Headers': 'Retry-After' });
+      return;
+    }
+    const { worker, done } = admitted;
+    remaining = remaining.filter(w => w !== worker);
+    if (trace) trace.admitted(worker, admitted.waitedMs);
+    if (admitted.queued) {
+      if (res.headersSent) res.write(`data: ${JSON.stringify({ queue: { position: 0, waited_ms: admitted.waitedMs } })}\n\n`);
+      else res.setHeader('X-Queue-Wait-Ms', String(admitted.waitedMs));
+    }
+    if (cacheKey && worker.local && !recording) {
+      recording = true;
+      if (!res.headersSent) res.setHeader('X-Response-Cache', 'miss');
+      responseCache.record(cacheKey, res, identity);
+    }
+    try {
+      if (worker.local && forwardLocal) {
+        await forwardLocal(worker, startedAt);
+      } else {
+        const sentUs = nowUs();
+        await requestRouter.forwardRequest(worker, req, res, body, {
+          beforePipe: (upstreamRes) => {
+            spans.observeUpstream(upstreamRes, worker, sentUs);
+            metricsHub.observeStream(worker.id, upstreamRes, startedAt);
+          }
+        });
+      }
+      return;
+    } catch (error) {
+      lastError = error;
+      workerRegistry.markDown(worker, error);
+      console.error(`[Client Server] ❌ Upstream ${worker.id} (${worker.url}) error:`, error.message);
+    } finally {
+      done();
+    }
+  }
+  requestRouter.sendError(res, 502, { message: lastError ? lastError.message : 'No backend available', type: 'server_error' });
+}
+
+// GET /metrics: 로컬 풀의 모든 llama-server 와 원격 GGUF worker 의 Prometheus 메트릭을 합침
+async function serveGgufMetrics(res, hop) {
+  const local = [...ggufPool.entries.values()]
+    .filter(e => e.ready)
+    .map(e => workerRegistry.localWorker('gguf', e.id, e.port, [e.id], e));
+  const remote = hop ? [] : [...workerRegistry.remote.values()].filter(w => w.format === 'gguf' && w.healthy);
+  const results = await requestRouter.collectMetrics([...local, ...remote]);
+  const sources = results.filter(r => r.ok).map(r => ({
+    labels: { worker: r.worker.id, model: r.worker.local ? r.worker.backend.id : null },
+    text: r.body
+  }));
+  if (sources.length === 0) {
+    res.writeHead(503, { 'Content-Type': 'application/json', 'Access-Control-Allow-Origin': '*' });
+    res.end(JSON.stringify({ error: { code: 503, message: 'No GGUF backend metrics available', type: 'unavailable_error' } }));
+    return;
+  }
+  res.writeHead(200, { 'Content-Type': 'text/plain; version=0.0.4', 'Access-Control-Allow-Origin': '*' });
+  res.end(requestRouter.mergePrometheus(sources));
+}
+
+const ggufRouter = http.createServer((req, res) => {
+  const arrivedUs = nowUs();
+  const chunks = [];
+  req.on('data', chunk => chunks.push(chunk));
+  req.on('end', async () => {
+    const body = Buffer.concat(chunks);
+    const parsedUrl = url.parse(req.url, true);
+    const hop = Boolean(req.headers[requestRouter.HOP_HEADER]);
+    if (req.method === 'GET' && parsedUrl.pathname === '/metrics') {
+      await serveGgufMetrics(res, hop);
+      return;
+    }
+    const json = parseJsonBody(req, body);
+    const modelKey = pickModelKey(req, parsedUrl, json) || defaultGgufModelKey();
+    if (modelKey && !req.headers['x-model-id']) req.headers['x-model-id'] = modelKey;
+    const trace = spanTracer.begin(req, res, { json, query: parsedUrl.query, arrivedUs, meta: { backend: 'gguf', path: parsedUrl.pathname, model: modelKey } });
+
+    let candidates = [];
+    try {
+      candidates = await ggufCandidates(modelKey, hop, trace);
+    } catch (error) {
+      console.error(`[Client Server] ❌ GGUF routing failed:`, error.message);
+    }
+    if (candidates.length === 0) {
+      res.writeHead(503, { 'Content-Type': 'application/json', 'Access-Control-Allow-Origin': '*' });
+      res.end(JSON.stringify({ error: { code: 503, message: `Model not available: ${modelKey || 'default'}`, type: 'unavailable_error' } }));
+      return;
+    }
+    // 원격 worker(다른 관리자의 라우터)에는 본문을 그대로 넘겨 그쪽에서 컨텍스트를 맞춤
+    await routeRequest(candidates, req, res, body, json, modelKey,
+      (worker, startedAt) => forwardToLocalGguf(worker, req, res, parsedUrl, body, json, startedAt));
+  });
+});
+
+ggufRouter.listen(GGUF_ROUTER_PORT, () => {
+  console.log(`[Client Server] GGUF router listening on port ${GGUF_ROUTER_PORT} (pool: max ${GGUF_POOL_MAX_MODELS} models, ${(ggufPool.memoryBudgetBytes / 1024 / 1024 / 1024).toFixed(1)} GB budget)`);
+});
+
+// MLX 라우터 (8081): 로컬 MLX 서버(내부 포트)와 원격 MLX worker 로 HTTP / WebSocket 을 전달
+function mlxCandidates(requestedKey, hop) {
+  const modelKey = requestedKey || (mlxModelConfig ? mlxModelConfig.id : null);
+  const local = mlxServerInstance && mlxModelConfig && (!modelKey || matchesModel(mlxModelConfig, modelKey))
+    ? [workerRegistry.localWorker('mlx', mlxModelConfig.id, MLX_LOCAL_PORT, [mlxModelConfig.id])]
+    : [];
+  return [...local, ...(hop ? [] : workerRegistry.candidates('mlx', modelKey))];
+}
+
+// GET /metrics: MLX 서버 메트릭은 JSON 이므로 대상 worker 의 스냅샷을 그대로 두고 workers / 합계를 덧붙임
+async function serveMlxMetrics(res, modelKey, hop) {
+  const results = await requestRouter.collectMetrics(mlxCandidates(modelKey, hop));
+  const snapshots = [];
+  for (const r of results) {
+    try {
+      if (r.ok) snapshots.push({ worker: r.worker, metrics: JSON.parse(r.body) });
+    } catch (error) {
+      // JSON 이 아닌 응답은 제외
+    }
+  }
+  if (snapshots.length === 0) {
+    res.writeHead(503, { 'Content-Type': 'application/json', 'Access-Control-Allow-Origin': '*' });
+    res.end(JSON.stringify({ detail: 'MLX server not running' }));
+    return;
+  }
+  const merged = { ...snapshots[0].metrics };
+  if (snapshots.length > 1) {
+    const sum = (key) => snapshots.reduce((total, s) => total + (Number(s.metrics[key]) || 0), 0);
+    merged.cluster = { workers: snapshots.length, tps: sum('tps'), activeRequests: sum('activeRequests'), queueLength: sum('queueLength') };
+    merged.workers = snapshots.map(s => ({ id: s.worker.id, url: s.worker.url, ...s.metrics }));
+  }
+  res.writeHead(200, { 'Content-Type': 'application/json', 'Access-Control-Allow-Origin': '*' });
+  res.end(JSON.stringify(merged));
+}
+
+function mlxUnavailable(res) {
+  res.writeHead(503, { 'Content-Type': 'application/json', 'Access-Control-Allow-Origin': '*' });
+  res.end(JSON.stringify({ detail: 'MLX server not running' }));
+}
+
+const mlxRouter = http.createServer((req, res) => {
+  const arrivedUs = nowUs();
+  const chunks = [];
+  req.on('data', chunk => chunks.push(chunk));
+  req.on('end', async () => {
+    const body = Buffer.concat(chunks);
+    const parsedUrl = url.parse(req.url, true);
+    const hop = Boolean(req.headers[requestRouter.HOP_HEADER]);
+    const json = parseJsonBody(req, body);
+    const modelKey = pickModelKey(req, parsedUrl, json);
+    if (req.method === 'GET' && parsedUrl.pathname === '/metrics') {
+      await serveMlxMetrics(res, modelKey, hop);
+      return;
+    }
+    spanTracer.begin(req, res, { json, query: parsedUrl.query, arrivedUs, meta: { backend: 'mlx', path: parsedUrl.pathname, model: modelKey } });
+    const candidates = mlxCandidates(modelKey, hop);
+    if (candidates.length === 0) {
+      mlxUnavailable(res);
+      return;
+    }
+    await routeRequest(candidates, req, res, body, json, modelKey, null);
+  });
+});
+
+// WebSocket (/chat/ws, /metrics/stream, /logs/stream): 연결 단위로 worker 선택 (?model= 로 지정 가능)
+// /chat/ws 는 승인 제어를 거침 (핸드셰이크 전이라 위치는 알릴 수 없고, 승인될 때까지 업그레이드를 미룸)
+mlxRouter.on('upgrade', async (req, socket, head) => {
+  const parsedUrl = url.parse(req.url, true);
+  const hop = Boolean(req.headers[requestRouter.HOP_HEADER]);
+  const chat = parsedUrl.pathname === '/chat/ws';
+  let remaining = mlxCandidates(pickModelKey(req, parsedUrl, null), hop);
+  // /chat/ws 의 trace_id 는 쿼리로 받음 (첫 메시지의 trace_id 는 MLX 서버가 읽음)
+  const trace = chat
+    ? spanTracer.begin(req, socket, { query: parsedUrl.query, meta: { backend: 'mlx', path: parsedUrl.pathname, model: pickModelKey(req, parsedUrl, null) } })
+    : NOOP_TRACE;
+  modelPrewarmer.noteActivity();
+  while (remaining.length > 0) {
+    let worker;
+    let done;
+    if (chat) {
+      const endAdmission = trace.begin('admission wait', { client: clientOf(req).id });
+      const admitted = await admissionQueue.admit(remaining, requestRouter.estimateRequestTokens(null), { client: clientOf(req), closed: socket });
+      endAdmission({ worker: admitted.ok ? admitted.worker.id : null, status: admitted.status || 200 });
+      if (!admitted.ok) {
+        if (!admitted.cancelled) {
+          const reason = admitted.status === 429 ? 'Too Many Requests' : 'Service Unavailable';
+          socket.end(`HTTP/1.1 ${admitted.status} ${reason}\r\nRetry-After: ${admitted.retryAfter}\r\nContent-Length: 0\r\n\r\n`);
+        }
+        return;
+      }
+      ({ worker, done } = admitted);
+    } else {
+      worker = workerRegistry.pick(remaining);
+      done = workerRegistry.begin(worker, 0);
+    }
+    remaining = remaining.filter(w => w !== worker);
+    const endSession = trace.begin('websocket session', { worker: worker.id }); // 연결이 닫힐 때까지
+    try {
+      await requestRouter.forwardUpgrade(worker, req, socket, head);
+      endSession();
+      return;
+    } catch (error) {
+      workerRegistry.markDown(worker, error);
+      console.error(`[Client Server] ❌ Upstream ${worker.id} (${worker.url}) WebSocket error:`, error.message);
+    } finally {
+      done();
+    }
+  }
+  socket.end('HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n');
+});
+
+mlxRouter.listen(MLX_ROUTER_PORT, () => {
+  console.log(`[Client Server] MLX router listening on port ${MLX_ROUTER_PORT} (local MLX server on ${MLX_LOCAL_PORT})`);
+});
+workerRegistry.start();
+modelPrewarmer.start();
+memoryPressure.start();
+
 const HTTP_PORT = 8083; // 클라이언트 서버 관리자는 8083 포트 사용
 httpServer.listen(HTTP_PORT, () => {
   console.log(`[Client Server] HTTP API server started on port ${HTTP_PORT}`);
@@ -689,4 +1506,3 @@ httpServer.listen(HTTP_PORT, () => {
 
 console.log('[Client Server] Started. Watching config file for changes...');
 console.log(`[Client Server] Config file path: ${CONFIG_PATH}`);
-
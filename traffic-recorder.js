@@ -0,0 +1,233 @@
+// 라우터(GGUF 8080 / MLX 8081) 트래픽 기록: 요청마다 한 줄씩 JSON Lines 트레이스 파일에 이어 씀
+//
+// config.json 예:
+//   "trafficRecording": { "enabled": true, "dir": "traces", "prompts": true, "maxFileMB": 256 }
+// 실행 중에는 POST /api/traffic-recording { "enabled": true | false } 로 켜고 끌 수 있습니다.
+//
+// - 대상: 라우터로 들어온 POST 요청 전부 (/completion, /chat, /tokenize 등, WebSocket 업그레이드 제외).
+// - 한 줄 = 요청 하나 (짧은 키, 응답이 끝난 뒤 기록):
+//     { "t": 도착 시각(epoch ms), "b": "gguf" | "mlx", "p": 경로, "m": 모델, "c": 클라이언트, "est": 예상 토큰,
+//       "req": 요청 본문, "s": 상태 코드, "w": worker, "q": 승인 대기 ms, "rc": 응답 캐시 hit | miss,
+//       "ttft": 첫 토큰 ms, "itl": [p50, p90, p99] ms, "n": 받은 토큰 수, "pt": 프롬프트 토큰, "gt": 생성 토큰, "d": 전체 ms }
+//   측정값은 클라이언트에 쓴 시점 기준이라 대기열, 응답 캐시, 라우터 처리 시간이 모두 포함됩니다.
+// - prompts: false 면 prompt / messages / content 를 빼고 길이(pc, 글자 수)만 남깁니다
+//   (replay-traffic.js 가 같은 토큰 수의 합성 프롬프트로 대체).
+// - 파일: <dir>/traffic-<시작 시각>.jsonl, maxFileMB 를 넘으면 새 파일로 넘어감. 쓰기는 비동기 스트림.
+const fs = require('fs');
+const path = require('path');
+const { countStreamTokens } = require('./metrics-hub');
+
+const DEFAULTS = {
+  enabled: false,
+  dir: path.join(__dirname, 'traces'),
+  prompts: true,
+  maxFileMB: 256
+};
+const PROMPT_FIELDS = ['prompt', 'messages', 'content'];
+
+function quantile(sorted, q) {
+  if (sorted.length === 0) return null;
+  return sorted[Math.min(sorted.length - 1, Math.floor(q * sorted.length))];
+}
+
+function round(value) {
+  return value === null || value === undefined ? null : Math.round(value * 10) / 10;
+}
+
+function promptChars(json) {
+  let chars = 0;
+  for (const field of PROMPT_FIELDS) {
+    if (json[field] === undefined) continue;
+    chars += typeof json[field] === 'string' ? json[field].length : JSON.stringify(json[field]).length;
+  }
+  return chars;
+}
+
+class TrafficRecorder {
+  constructor({ log = console.log } = {}) {
+    this.log = log;
+    this.options = { ...DEFAULTS };
+    this.stream = null;
+    this.file = null;
+    this.fileBytes = 0;
+    this.counters = { recorded: 0, bytes: 0, files: 0, writeErrors: 0 };
+  }
+
+  // config.json 의 trafficRecording 적용
+  configure(options = {}) {
+    const next = { ...DEFAULTS };
+    for (const key of Object.keys(DEFAULTS)) {
+      if (options[key] === undefined) continue;
+      if (typeof DEFAULTS[key] === 'boolean') next[key] = Boolean(options[key]);
+      else if (typeof DEFAULTS[key] === 'number') next[key] = Number(options[key]) || DEFAULTS[key];
+      else next[key] = path.resolve(__dirname, String(options[key]));
+    }
+    const reopen = next.dir !== this.options.dir || !next.enabled;
+    this.options = next;
+    if (reopen) this.close();
+    return next;
+  }
+
+  setEnabled(enabled) {
+    this.options.enabled = Boolean(enabled);
+    if (!this.options.enabled) this.close();
+    this.log(`[Traffic] Recording ${this.options.enabled ? 'started' : 'stopped'}`);
+  }
+
+  open() {
+    try {
+      fs.mkdirSync(this.options.dir, { recursive: true });
+    } catch (error) {
+      this.log(`[Traffic] Cannot create ${this.options.dir}: ${error.message}`);
+      this.options.enabled = false;
+      return false;
+    }
+    const stamp = new Date().toISOString().replace(/[:.]/g, '-');
+    this.file = path.join(this.options.dir, `traffic-${stamp}.jsonl`);
+    this.fileBytes = 0;
+    this.stream = fs.createWriteStream(this.file, { flags: 'a' });
+    this.stream.on('error', (error) => {
+      this.counters.writeErrors++;
+      this.log(`[Traffic] Write to ${this.file} failed: ${error.message}`);
+      this.stream = null;
+    });
+    this.counters.files++;
+    this.log(`[Traffic] Recording to ${this.file}`);
+    return true;
+  }
+
+  close() {
+    if (this.stream) this.stream.end();
+    this.stream = null;
+  }
+
+  write(record) {
+    if (!this.stream && !this.open()) return;
+    if (this.fileBytes > this.options.maxFileMB * 1024 * 1024) {
+      this.close();
+      if (!this.open()) return;
+    }
+    const line = JSON.stringify(record) + '\n';
+    const bytes = Buffer.byteLength(line);
+    this.fileBytes += bytes;
+    this.counters.bytes += bytes;
+    this.counters.recorded++;
+    this.stream.write(line);
+  }
+
+  // 요청 하나 관찰 시작 (꺼져 있거나 POST 가 아니면 null)
+  // → { admitted(worker, waitedMs) } : routeRequest 가 승인 시 호출
+  observe(req, res, { backend, pathname, json, modelKey, client, estimatedTokens, hop = false }) {
+    if (!this.options.enabled || req.method !== 'POST') return null;
+    const arrivedAt = Date.now();
+    const record = {
+      t: arrivedAt,
+      b: backend,
+      p: pathname,
+      m: modelKey || null,
+      c: client ? client.id : null,
+      est: estimatedTokens
+    };
+    if (hop) record.hop = true;
+    if (json) {
+      if (this.options.prompts) {
+        record.req = json;
+      } else {
+        record.req = Object.fromEntries(Object.entries(json).filter(([key]) => !PROMPT_FIELDS.includes(key)));
+        record.pc = promptChars(json);
+      }
+    }
+    const gaps = [];
+    let firstAt = 0;
+    let lastAt = 0;
+    let tokens = 0;
+    let tail = ''; // 청크 경계에 걸친 마지막 이벤트 (토큰 수 / 타이밍 추출용)
+    const observeChunk = (chunk) => {
+      if (chunk === undefined || chunk === null || typeof chunk === 'function') return;
+      const text = Buffer.isBuffer(chunk) ? chunk.toString('utf8') : String(chunk);
+      const now = Date.now();
+      const events = countStreamTokens(text);
+      if (events > 0) {
+        if (!firstAt) {
+          firstAt = now;
+        } else {
+          const gap = (now - lastAt) / events;
+          for (let k = 0; k < events; k++) gaps.push(gap);
+        }
+        tokens += events;
+        lastAt = now;
+      }
+      tail = (tail + text).slice(-4096);
+    };
+    // writeHead 로 넘긴 헤더는 getHeader 로 보이지 않으므로 여기서 읽음
+    const headers = {};
+    const writeHead = res.writeHead;
+    const write = res.write;
+    const end = res.end;
+    res.writeHead = function (statusCode, ...args) {
+      const given = args.find(a => a && typeof a === 'object');
+      if (given) {
+        for (const [name, value] of Object.entries(given)) headers[name.toLowerCase()] = String(value);
+      }
+      return writeHead.call(this, statusCode, ...args);
+    };
+    res.write = function (chunk, encoding, ...rest) {
+      observeChunk(chunk);
+      return write.call(this, chunk, encoding, ...rest);
+    };
+    res.end = (chunk, encoding, ...rest) => {
+      observeChunk(chunk);
+      res.writeHead = writeHead;
+      res.write = write;
+      res.end = end;
+      const result = end.call(res, chunk, encoding, ...rest);
+      this.finish(record, res, headers, { arrivedAt, firstAt, gaps, tokens, tail });
+      return result;
+    };
+    return {
+      admitted: (worker, waitedMs) => {
+        record.w = worker.id;
+        record.q = waitedMs;
+      }
+    };
+  }
+
+  finish(record, res, headers, { arrivedAt, firstAt, gaps, tokens, tail }) {
+    const header = (name) => headers[name] || res.getHeader(name);
+    record.s = res.statusCode;
+    const cache = header('x-response-cache');
+    if (cache) record.rc = String(cache);
+    // 토큰 단위 측정은 SSE 응답만 (비스트리밍 JSON 의 content 는 토큰 이벤트가 아님)
+    if (String(header('content-type') || '').includes('text/event-stream')) {
+      if (firstAt) record.ttft = firstAt - arrivedAt;
+      if (gaps.length > 0) {
+        const sorted = gaps.sort((a, b) => a - b);
+        record.itl = [round(quantile(sorted, 0.5)), round(quantile(sorted, 0.9)), round(quantile(sorted, 0.99))];
+      }
+      if (tokens > 0) record.n = tokens;
+    }
+    // 마지막 이벤트 / 비스트리밍 응답의 토큰 수 (llama-server: tokens_evaluated / tokens_predicted)
+    const evaluated = /"tokens_evaluated":\s*(\d+)/.exec(tail);
+    const predicted = /"tokens_predicted":\s*(\d+)/.exec(tail);
+    if (evaluated) record.pt = Number(evaluated[1]);
+    if (predicted) record.gt = Number(predicted[1]);
+    record.d = Date.now() - arrivedAt;
+    try {
+      this.write(record);
+    } catch (error) {
+      this.counters.writeErrors++;
+      this.log(`[Traffic] Record failed: ${error.message}`);
+    }
+  }
+
+  stats() {
+    return {
+      ...this.options,
+      file: this.stream ? this.file : null,
+      fileBytes: this.stream ? this.fileBytes : 0,
+      ...this.counters
+    };
+  }
+}
+
+module.exports = { TrafficRecorder };
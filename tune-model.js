@@ -1,8 +1,43 @@
+// Sampling parameter auto-tuner
+//
+// Default (population) mode: every generation evaluates all candidate configs × questions at once,
+// spread over the server's parallel slots (llama-server --parallel / the MLX batcher), then keeps the
+// best candidates and breeds the next generation from them (crossover + mutation, plus one
+// issue-guided child per elite built with adjustParameters). Step mode is the original loop:
+// one config, one question at a time.
+//
+// Usage:
+//   node tune-model.js                                   # GGUF router (8080), slots from /props
+//   node tune-model.js --backend mlx --parallel 8        # MLX router (8081)
+//   node tune-model.js --population 12 --generations 8 --seed 7
+//   node tune-model.js --backend mlx --samples 5         # MLX ignores seed: average 5 samples per question
+//   node tune-model.js --mode step                       # original sequential search
 const fs = require('fs');
+const { parseArgs } = require('./cli-args');
 
 // Configuration for the tuning process
 const MAX_ITERATIONS = 20;
-const SERVER_URL = 'http://localhost:8080/completion';
+const BACKEND_URLS = {
+  gguf: 'http://localhost:8080',
+  mlx: 'http://localhost:8081'
+};
+const DEFAULTS = {
+  mode: 'population', // population | step
+  backend: 'gguf',
+  url: '',
+  parallel: 'auto', // concurrent requests (auto: llama-server total_slots / MLX maxBatchSize)
+  population: 8,
+  generations: 6,
+  seed: 1234, // generation seed per question (shared by all candidates) and search RNG seed
+  samples: 'auto', // generations per question and candidate (auto: 1 on llama-server, MLX_SAMPLES on MLX)
+  out: 'optimized_config.json'
+};
+const DEFAULT_PARALLEL = 4;
+// The MLX server ignores `seed`, so every request is a fresh sample: average several per question
+const MLX_SAMPLES = 3;
+const ELITE_FRACTION = 0.25;
+const MUTATION_RATE = 0.35;
+const MUTATION_SCALE = 0.15; // standard deviation as a fraction of the parameter range
 
 // Initial Model Parameters (starting point)
 let modelConfig = {
@@ -17,6 +52,18 @@ let modelConfig = {
   max_tokens: 300 // limit generation length
 };
 
+// Search space for population mode (max_tokens stays fixed)
+const PARAM_SPACE = {
+  temperature: { min: 0.1, max: 1.2, step: 0.05 },
+  top_k: { min: 10, max: 100, step: 1 },
+  top_p: { min: 0.5, max: 1.0, step: 0.01 },
+  min_p: { min: 0.0, max: 0.2, step: 0.01 },
+  repeat_penalty: { min: 1.0, max: 1.3, step: 0.01 },
+  presence_penalty: { min: 0.0, max: 1.0, step: 0.05 },
+  frequency_penalty: { min: 0.0, max: 1.0, step: 0.05 },
+  dry_multiplier: { min: 0.0, max: 1.0, step: 0.1 }
+};
+
 // Questions to test
 const questions = [
   "너 이름이 뭐지?",
@@ -29,7 +76,14 @@ const questions = [
 const BANNED_PATTERNS = ['~~', '!!', 'ㅎㅎ', 'ㅋㅋ', 'LAPTOP', 'aaaa', '....', ';;;;'];
 const MAX_SENTENCES = 5;
 
+const options = parseArgs(process.argv.slice(2), DEFAULTS);
+const SERVER_URL = `${options.url || BACKEND_URLS[options.backend] || BACKEND_URLS.gguf}/completion`;
+// Only llama-server honours `seed` (pass --backend mlx together with --url for an MLX server)
+const SEEDED = options.backend !== 'mlx';
+const SAMPLES = options.samples === 'auto' ? (SEEDED ? 1 : MLX_SAMPLES) : Math.max(1, Number(options.samples) || 1);
+
 // Helper: Build Prompt (matches api.js logic)
+// The system section must stay identical to "tune-ko" in prompt-prefixes.json so the KV snapshot is reused
 function buildPrompt(userQuery) {
   const systemPrompt = [
     "당신은 유용한 AI 어시스턴트 '뤼(Luu)'입니다.",
@@ -41,7 +95,11 @@ function buildPrompt(userQuery) {
 }
 
 // Helper: Call Llama Server
-async function runGeneration(prompt, config) {
+// Streams the response (the MLX server has no non-streaming /completion) and returns
+// { content, tokens } or null on a server error. cache_prompt keeps the shared system prefix
+// in each slot, so parallel requests only prefill the question. Unseeded samples (MLX) skip the
+// router's response cache so a candidate is never scored on a replayed sample.
+async function runGeneration(prompt, config, seed) {
   const payload = {
     prompt,
     n_predict: config.max_tokens,
@@ -54,13 +112,16 @@ async function runGeneration(prompt, config) {
     frequency_penalty: config.frequency_penalty,
     dry_multiplier: config.dry_multiplier,
     stop: ["<|eot_id|>", "<|end_of_text|>", "<|start_header_id|>", ...BANNED_PATTERNS], // Server-side stop
-    stream: false // We want the full response for analysis
+    cache_prompt: true,
+    stream: true,
+    stream_format: 'coalesced' // MLX: fewer, larger events (llama-server ignores it)
   };
+  if (seed !== undefined) payload.seed = seed;
 
   try {
     const response = await fetch(SERVER_URL, {
       method: 'POST',
-      headers: { 'Content-Type': 'application/json' },
+      headers: SEEDED ? { 'Content-Type': 'application/json' } : { 'Content-Type': 'application/json', 'Cache-Control': 'no-cache' },
       body: JSON.stringify(payload)
     });
 
@@ -68,8 +129,24 @@ async function runGeneration(prompt, config) {
       throw new Error(`Server error: ${response.status}`);
     }
 
-    const data = await response.json();
-    return data.content || "";
+    let content = "";
+    let tokens = 0;
+    let buffer = "";
+    const decoder = new TextDecoder();
+    for await (const chunk of response.body) {
+      buffer += decoder.decode(chunk, { stream: true });
+      const lines = buffer.split('\n');
+      buffer = lines.pop();
+      for (const line of lines) {
+        if (!line.startsWith('data: ')) continue;
+        const event = JSON.parse(line.slice(6));
+        if (event.error) throw new Error(event.error.message || JSON.stringify(event.error));
+        if (event.queue) continue; // router admission queue position
+        if (typeof event.content === 'string') content += event.content;
+        if (event.tokens_predicted) tokens = event.tokens_predicted;
+      }
+    }
+    return { content, tokens };
   } catch (error) {
     console.error("Error calling server:", error.message);
     return null;
@@ -93,7 +170,7 @@ function analyzeResponse(text) {
       const substr = text.substr(i, 20);
       if (text.indexOf(substr, i + 20) !== -1) {
           issues.push(`Contains repeated phrase (DRY failure): "${substr}..."`);
-          break; 
+          break;
       }
   }
 
@@ -104,7 +181,7 @@ function analyzeResponse(text) {
   if (sentenceCount > MAX_SENTENCES) {
     issues.push(`Too long: ${sentenceCount} sentences (max ${MAX_SENTENCES})`);
   }
-  
+
   // 3. Length Check (Raw Chars) - Just in case it's huge
   if (text.length > 500) {
       issues.push(`Too long: ${text.length} characters`);
@@ -118,11 +195,212 @@ function analyzeResponse(text) {
   return issues;
 }
 
-// Main Tuning Loop
+// Helper: concurrent requests the server can decode at once
+async function detectParallel() {
+  if (options.parallel !== 'auto') return Math.max(1, Number(options.parallel) || 1);
+  const base = SERVER_URL.replace(/\/completion$/, '');
+  try {
+    if (options.backend === 'mlx') {
+      const metrics = await (await fetch(`${base}/metrics`)).json();
+      if (metrics.admitLimit || metrics.maxBatchSize) return metrics.admitLimit || metrics.maxBatchSize;
+    } else {
+      const props = await (await fetch(`${base}/props`)).json();
+      if (props.total_slots) return props.total_slots;
+    }
+  } catch (error) {
+    // Older server or router without the endpoint
+  }
+  return DEFAULT_PARALLEL;
+}
+
+// Helper: run tasks with at most `limit` in flight
+async function runPool(tasks, limit, worker) {
+  const results = new Array(tasks.length);
+  let next = 0;
+  const lanes = Array.from({ length: Math.min(limit, tasks.length) }, async () => {
+    while (next < tasks.length) {
+      const index = next++;
+      results[index] = await worker(tasks[index], index);
+    }
+  });
+  await Promise.all(lanes);
+  return results;
+}
+
+// Helper: seeded RNG (mulberry32) so a search can be repeated with --seed
+function createRandom(seed) {
+  let state = seed >>> 0;
+  return () => {
+    state = (state + 0x6D2B79F5) >>> 0;
+    let t = state;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+function clampParam(name, value) {
+  const { min, max, step } = PARAM_SPACE[name];
+  const snapped = Math.round(Math.min(max, Math.max(min, value)) / step) * step;
+  return parseFloat(snapped.toFixed(2));
+}
+
+function configKey(config) {
+  return Object.keys(PARAM_SPACE).map(name => config[name]).join('|');
+}
+
+function mutate(config, random) {
+  const child = { ...config };
+  for (const [name, { min, max }] of Object.entries(PARAM_SPACE)) {
+    if (random() >= MUTATION_RATE) continue;
+    // Box-Muller normal sample
+    const gaussian = Math.sqrt(-2 * Math.log(1 - random())) * Math.cos(2 * Math.PI * random());
+    child[name] = clampParam(name, child[name] + gaussian * MUTATION_SCALE * (max - min));
+  }
+  return child;
+}
+
+function crossover(a, b, random) {
+  const child = { ...a };
+  for (const name of Object.keys(PARAM_SPACE)) {
+    if (random() < 0.5) child[name] = b[name];
+  }
+  return child;
+}
+
+// Higher is better: 1 per passing question, minus a quarter per issue otherwise
+function scoreOf(results) {
+  return results.reduce((sum, r) => sum + (r.issues.length === 0 ? 1 : -0.25 * r.issues.length), 0) / results.length;
+}
+
+// Evaluate candidates × questions × samples concurrently. On llama-server every candidate gets the
+// same seed per question and sample, so score differences come from the parameters rather than
+// sampling luck; on MLX the seed is ignored and the score is an average over SAMPLES draws.
+async function evaluateCandidates(candidates, parallel, stats) {
+  const tasks = [];
+  candidates.forEach((candidate, c) => {
+    questions.forEach((q, i) => {
+      for (let k = 0; k < SAMPLES; k++) tasks.push({ c, q, seed: options.seed + i + k * questions.length });
+    });
+  });
+  const outcomes = await runPool(tasks, parallel, async ({ c, q, seed }) => {
+    const response = await runGeneration(buildPrompt(q), candidates[c].config, seed);
+    if (response === null) return null;
+    stats.requests++;
+    stats.tokens += response.tokens;
+    return { c, question: q, response: response.content, issues: analyzeResponse(response.content) };
+  });
+  if (outcomes.includes(null)) return false;
+  candidates.forEach((candidate, c) => {
+    candidate.results = outcomes.filter(o => o.c === c);
+    candidate.issues = candidate.results.flatMap(r => r.issues);
+    // A question passes only if every sample of it passed
+    candidate.passed = questions.filter(q => candidate.results.every(r => r.question !== q || r.issues.length === 0)).length;
+    candidate.score = scoreOf(candidate.results);
+  });
+  return true;
+}
+
+function nextGeneration(ranked, size, random, seen) {
+  const eliteCount = Math.max(1, Math.round(size * ELITE_FRACTION));
+  const elites = ranked.slice(0, eliteCount);
+  const next = [...elites];
+  const add = (config) => {
+    const key = configKey(config);
+    if (seen.has(key)) return;
+    seen.add(key);
+    next.push({ config });
+  };
+  // Issue-guided children: the old step heuristic applied to each elite
+  for (const elite of elites) {
+    if (next.length >= size) break;
+    const guided = { ...elite.config };
+    adjustParameters(guided, elite.issues, () => {});
+    for (const name of Object.keys(PARAM_SPACE)) guided[name] = clampParam(name, guided[name]);
+    add(guided);
+  }
+  // Tournament selection + crossover + mutation for the rest
+  const pick = () => {
+    const a = ranked[Math.floor(random() * ranked.length)];
+    const b = ranked[Math.floor(random() * ranked.length)];
+    return a.score >= b.score ? a : b;
+  };
+  for (let attempts = 0; next.length < size && attempts < size * 20; attempts++) {
+    add(mutate(crossover(pick().config, pick().config, random), random));
+  }
+  return next;
+}
+
+function saveConfig(config) {
+  fs.writeFileSync(options.out, JSON.stringify(config, null, 2));
+  console.log(`Saved to ${options.out}`);
+}
+
+// Population Search
+async function runPopulationSearch() {
+  const parallel = await detectParallel();
+  const random = createRandom(options.seed);
+  const size = Math.max(2, options.population);
+  console.log("Starting Parallel Auto-Tuning (population search)...");
+  console.log("Target Server:", SERVER_URL);
+  console.log(`Population ${size}, up to ${options.generations} generations, ${parallel} concurrent requests`);
+  if (!SEEDED) {
+    console.warn(`⚠️ The MLX server ignores seed: scores average ${SAMPLES} unseeded samples per question (--samples)`);
+  }
+
+  const seen = new Set([configKey(modelConfig)]);
+  let population = [{ config: { ...modelConfig } }];
+  while (population.length < size) {
+    const config = mutate(modelConfig, random);
+    if (!seen.has(configKey(config))) {
+      seen.add(configKey(config));
+      population.push({ config });
+    }
+  }
+
+  const stats = { requests: 0, tokens: 0 };
+  const startedAt = Date.now();
+  let best = null;
+  for (let generation = 1; generation <= options.generations; generation++) {
+    const generationStart = Date.now();
+    const pending = population.filter(c => c.score === undefined);
+    console.log(`\n--- Generation ${generation} (${pending.length} new candidates × ${questions.length} questions × ${SAMPLES} samples) ---`);
+    if (!(await evaluateCandidates(pending, parallel, stats))) {
+      console.log("FAILED (Server Error)");
+      return;
+    }
+    const ranked = [...population].sort((a, b) => b.score - a.score || b.passed - a.passed);
+    best = ranked[0];
+    const seconds = (Date.now() - generationStart) / 1000;
+    console.log(`Evaluated in ${seconds.toFixed(1)}s. Best score ${best.score.toFixed(2)} (${best.passed}/${questions.length} passed)`);
+    ranked.slice(0, 3).forEach((c, i) => {
+      console.log(`  #${i + 1} score ${c.score.toFixed(2)}: ${JSON.stringify(c.config)}`);
+    });
+    if (best.passed === questions.length) break;
+    population = nextGeneration(ranked, size, random, seen);
+  }
+
+  const elapsed = (Date.now() - startedAt) / 1000;
+  console.log(`\n${stats.requests} requests in ${elapsed.toFixed(1)}s (${(stats.tokens / Math.max(elapsed, 0.001)).toFixed(1)} tokens/s aggregate)`);
+  for (const r of best.results) {
+    console.log(`${r.issues.length === 0 ? "  [PASS]" : "  [FAIL]"} "${r.question}" → "${r.response.trim()}"`);
+    if (r.issues.length > 0) console.log(`         Issues: ${r.issues.join(', ')}`);
+  }
+  if (best.passed === questions.length) {
+    console.log("\n✅ SUCCESS! Optimal configuration found.");
+    console.log("\n=== Final Optimized Configuration ===");
+  } else {
+    console.log("\n⚠️ Max generations reached without finding perfect config. Best configuration:");
+  }
+  console.log(JSON.stringify(best.config, null, 2));
+  saveConfig(best.config);
+}
+
+// Main Tuning Loop (step mode)
 async function runTuning() {
   console.log("Starting Auto-Tuning Process...");
   console.log("Target Server:", SERVER_URL);
-  
+
   let iteration = 0;
   let optimalFound = false;
 
@@ -137,15 +415,16 @@ async function runTuning() {
     for (const q of questions) {
       process.stdout.write(`Testing: "${q}" ... `);
       const prompt = buildPrompt(q);
-      const response = await runGeneration(prompt, modelConfig);
-      
-      if (response === null) {
+      const result = await runGeneration(prompt, modelConfig);
+
+      if (result === null) {
         console.log("FAILED (Server Error)");
         return; // Stop if server is down
       }
+      const response = result.content;
 
       console.log(`\nResponse: "${response.trim()}"`);
-      
+
       const issues = analyzeResponse(response);
       if (issues.length > 0) {
         console.log(`  [FAIL] Issues: ${issues.join(', ')}`);
@@ -164,17 +443,16 @@ async function runTuning() {
       console.log("\n✅ SUCCESS! Optimal configuration found.");
     } else {
       console.log("\n❌ Iteration Failed. Adjusting parameters...");
-      adjustParameters(accumulatedIssues);
+      adjustParameters(modelConfig, accumulatedIssues);
     }
   }
 
   if (optimalFound) {
     console.log("\n=== Final Optimized Configuration ===");
     console.log(JSON.stringify(modelConfig, null, 2));
-    
+
     // Write to a file for easy copying
-    fs.writeFileSync('optimized_config.json', JSON.stringify(modelConfig, null, 2));
-    console.log("Saved to optimized_config.json");
+    saveConfig(modelConfig);
   } else {
     console.log("\n⚠️ Max iterations reached without finding perfect config.");
     console.log("Last Config:", JSON.stringify(modelConfig, null, 2));
@@ -182,48 +460,51 @@ async function runTuning() {
 }
 
 // Helper: Adjust Parameters based on issues
-function adjustParameters(issues) {
+function adjustParameters(config, issues, log = console.log) {
   // Simple heuristic adjustments
   const hasRepetition = issues.some(i => i.includes("banned pattern"));
   const hasLengthIssue = issues.some(i => i.includes("Too long"));
   const hasIdentityIssue = issues.some(i => i.includes("Identity"));
 
   if (hasRepetition) {
-    console.log("  -> Increasing Repeat Penalty & Frequency Penalty");
-    modelConfig.repeat_penalty = parseFloat((modelConfig.repeat_penalty + 0.05).toFixed(2));
+    log("  -> Increasing Repeat Penalty & Frequency Penalty");
+    config.repeat_penalty = parseFloat((config.repeat_penalty + 0.05).toFixed(2));
     // Cap at reasonable max
-    if (modelConfig.repeat_penalty > 1.3) modelConfig.repeat_penalty = 1.3;
-    
+    if (config.repeat_penalty > 1.3) config.repeat_penalty = 1.3;
+
     // Also try DRY if simple penalty isn't working
-    if (modelConfig.repeat_penalty > 1.15 && modelConfig.dry_multiplier === 0.0) {
-        console.log("  -> Enabling DRY Sampling");
-        modelConfig.dry_multiplier = 0.5;
+    if (config.repeat_penalty > 1.15 && config.dry_multiplier === 0.0) {
+        log("  -> Enabling DRY Sampling");
+        config.dry_multiplier = 0.5;
     }
   }
 
   if (hasLengthIssue) {
-    console.log("  -> Increasing Min P (to cut off low-prob tokens) & Reducing Max Tokens");
-    modelConfig.min_p = parseFloat((modelConfig.min_p + 0.02).toFixed(2));
-    if (modelConfig.min_p > 0.2) modelConfig.min_p = 0.2;
-    
+    log("  -> Increasing Min P (to cut off low-prob tokens) & Reducing Max Tokens");
+    config.min_p = parseFloat((config.min_p + 0.02).toFixed(2));
+    if (config.min_p > 0.2) config.min_p = 0.2;
+
     // Reduce max_tokens slightly to force brevity via hard limit if needed
     // But mainly rely on min_p and stop tokens
   }
 
   if (hasIdentityIssue) {
-    console.log("  -> Decreasing Temperature (more deterministic)");
-    modelConfig.temperature = parseFloat((modelConfig.temperature - 0.05).toFixed(2));
-    if (modelConfig.temperature < 0.1) modelConfig.temperature = 0.1;
+    log("  -> Decreasing Temperature (more deterministic)");
+    config.temperature = parseFloat((config.temperature - 0.05).toFixed(2));
+    if (config.temperature < 0.1) config.temperature = 0.1;
   }
-  
+
   // General adjustment if nothing specific but still failing (e.g. slight incoherence)
   // or just to perturb the model
   if (!hasRepetition && !hasLengthIssue && !hasIdentityIssue) {
-       console.log("  -> General Tweak: Slightly increasing Top P");
-       modelConfig.top_p = parseFloat((modelConfig.top_p - 0.05).toFixed(2)); // tighten top_p
+       log("  -> General Tweak: Slightly increasing Top P");
+       config.top_p = parseFloat((config.top_p - 0.05).toFixed(2)); // tighten top_p
   }
 }
 
 // Run the script
-runTuning();
-
+if (options.mode === 'step') {
+  runTuning();
+} else {
+  runPopulationSearch();
+}